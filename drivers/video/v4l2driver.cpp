@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 #include "v4l2driver.h"
 #include "indistandardproperty.h"
 #include "lx/Lx.h"
+#include "ccvt.h"
 
 // Pixel size info for different cameras
 typedef struct PixelSizeInfo
@@ -91,6 +92,7 @@ V4L2_Driver::V4L2_Driver(std::string label, std::string path)
 
     frame_received.tv_sec = 0;
     frame_received.tv_usec = 0;
+    dropped_frames_update = frame_received;
 
     v4l_capture_started = false;
 
@@ -122,6 +124,7 @@ V4L2_Driver::V4L2_Driver()
 
     frame_received.tv_sec = 0;
     frame_received.tv_usec = 0;
+    dropped_frames_update = frame_received;
 
     v4l_capture_started = false;
 
@@ -198,6 +201,26 @@ bool V4L2_Driver::initProperties()
 
     m_StackMode = StackModeSP.findOnSwitchIndex();
 
+    /* Capture buffers */
+    CaptureIOSP[CAPTURE_IO_MMAP].fill("MMAP", "Memory mapped", ISS_ON);
+    CaptureIOSP[CAPTURE_IO_USERPTR].fill("USERPTR", "User pointer", ISS_OFF);
+    CaptureIOSP.fill(getDeviceName(), "V4L2_IO_METHOD", "Buffers", CAPTURE_FORMAT, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+    BufferCountNP[0].fill("COUNT", "Count", "%.f", INDI::V4L2_Base::MIN_BUFFERS, INDI::V4L2_Base::MAX_BUFFERS, 1,
+                          v4l_base->getBufferCount());
+    BufferCountNP.fill(getDeviceName(), "V4L2_BUFFERS", "Buffers", CAPTURE_FORMAT, IP_RW, 60, IPS_IDLE);
+
+    /* Bayer interpolation */
+    DemosaicSP[DEMOSAIC_BILINEAR].fill("BILINEAR", "Bilinear", ISS_ON);
+    DemosaicSP[DEMOSAIC_EDGE_AWARE].fill("EDGE_AWARE", "Edge aware", ISS_OFF);
+    DemosaicSP.fill(getDeviceName(), "V4L2_DEMOSAIC", "Debayer", CAPTURE_FORMAT, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
+    /* Decoding */
+    DecodersNP[0].fill("COUNT", "MJPEG", "%.f", 1, INDI::V4L2_Base::MAX_DECODERS, 1, v4l_base->getDecoderCount());
+    DecodersNP.fill(getDeviceName(), "V4L2_DECODERS", "Decoders", CAPTURE_FORMAT, IP_RW, 60, IPS_IDLE);
+    DroppedFramesNP[DROPPED_DEVICE].fill("DEVICE", "Device", "%.f", 0, 0, 0, 0);
+    DroppedFramesNP[DROPPED_DECODER].fill("DECODER", "Decoder", "%.f", 0, 0, 0, 0);
+    DroppedFramesNP.fill(getDeviceName(), "V4L2_DROPPED_FRAMES", "Dropped", CAPTURE_FORMAT, IP_RO, 60, IPS_IDLE);
+
     /* Inputs */
     IUFillSwitchVector(&InputsSP, nullptr, 0, getDeviceName(), "V4L2_INPUT", "Inputs", CAPTURE_FORMAT, IP_RW,
                        ISR_1OFMANY, 0, IPS_IDLE);
@@ -281,6 +304,11 @@ void V4L2_Driver::ISGetProperties(const char * dev)
             defineProperty(&FrameRateNP);
 
         defineProperty(StackModeSP);
+        defineProperty(CaptureIOSP);
+        defineProperty(BufferCountNP);
+        defineProperty(DemosaicSP);
+        defineProperty(DecodersNP);
+        defineProperty(DroppedFramesNP);
 
         v4l_base->setNative(EncodeFormatSP[FORMAT_NATIVE].getState() == ISS_ON);
 
@@ -314,6 +342,11 @@ bool V4L2_Driver::updateProperties()
             defineProperty(&FrameRateNP);
 
         defineProperty(StackModeSP);
+        defineProperty(CaptureIOSP);
+        defineProperty(BufferCountNP);
+        defineProperty(DemosaicSP);
+        defineProperty(DecodersNP);
+        defineProperty(DroppedFramesNP);
 
 #ifdef WITH_V4L2_EXPERIMENTS
         defineProperty(&ImageDepthSP);
@@ -401,6 +434,11 @@ bool V4L2_Driver::updateProperties()
         v4loptions = 0;
 
         deleteProperty(StackModeSP);
+        deleteProperty(CaptureIOSP);
+        deleteProperty(BufferCountNP);
+        deleteProperty(DemosaicSP);
+        deleteProperty(DecodersNP);
+        deleteProperty(DroppedFramesNP);
 
 #ifdef WITH_V4L2_EXPERIMENTS
         deleteProperty(ImageDepthSP.name);
@@ -668,6 +706,48 @@ bool V4L2_Driver::ISNewSwitch(const char * dev, const char * name, ISState * sta
         return true;
     }
 
+    /* Capture buffers memory */
+    if (CaptureIOSP.isNameMatch(name))
+    {
+        if (PrimaryCCD.isExposing() || Streamer->isBusy())
+        {
+            LOG_ERROR("Can not change capture buffers while capturing.");
+            CaptureIOSP.setState(IPS_ALERT);
+            CaptureIOSP.apply();
+            return false;
+        }
+
+        int const previous = CaptureIOSP.findOnSwitchIndex();
+        CaptureIOSP.update(states, names, n);
+        INDI::V4L2_Base::io_method const method = CaptureIOSP.findOnSwitchIndex() == CAPTURE_IO_USERPTR ?
+                INDI::V4L2_Base::IO_METHOD_USERPTR : INDI::V4L2_Base::IO_METHOD_MMAP;
+        if (v4l_base->setIOMethod(method, errmsg) < 0)
+        {
+            LOGF_ERROR("Unable to set capture buffers: %s", errmsg);
+            CaptureIOSP.reset();
+            CaptureIOSP[previous].setState(ISS_ON);
+            CaptureIOSP.setState(IPS_ALERT);
+            CaptureIOSP.apply();
+            return false;
+        }
+
+        CaptureIOSP.setState(IPS_OK);
+        CaptureIOSP.apply();
+        saveConfig(true, CaptureIOSP.getName());
+        return true;
+    }
+
+    /* Bayer interpolation */
+    if (DemosaicSP.isNameMatch(name))
+    {
+        DemosaicSP.update(states, names, n);
+        v4l_base->setEdgeAwareDemosaic(DemosaicSP.findOnSwitchIndex() == DEMOSAIC_EDGE_AWARE);
+        DemosaicSP.setState(IPS_OK);
+        DemosaicSP.apply();
+        saveConfig(true, DemosaicSP.getName());
+        return true;
+    }
+
     /* V4L2 Options/Menus */
     for (iopt = 0; iopt < v4loptions; iopt++)
         if (strcmp(Options[iopt].name, name) == 0)
@@ -770,6 +850,43 @@ bool V4L2_Driver::ISNewNumber(const char * dev, const char * name, double values
     if (dev != nullptr && strcmp(getDeviceName(), dev) != 0)
         return true;
 
+    /* Capture buffers */
+    if (BufferCountNP.isNameMatch(name))
+    {
+        if (PrimaryCCD.isExposing() || Streamer->isBusy())
+        {
+            LOG_ERROR("Can not change capture buffers while capturing.");
+            BufferCountNP.setState(IPS_ALERT);
+            BufferCountNP.apply();
+            return false;
+        }
+
+        if (v4l_base->setBufferCount(static_cast<unsigned int>(values[0]), errmsg) < 0)
+        {
+            LOGF_ERROR("Unable to set capture buffers: %s", errmsg);
+            BufferCountNP.setState(IPS_ALERT);
+            BufferCountNP.apply();
+            return false;
+        }
+
+        BufferCountNP[0].setValue(v4l_base->getBufferCount());
+        BufferCountNP.setState(IPS_OK);
+        BufferCountNP.apply();
+        saveConfig(true, BufferCountNP.getName());
+        return true;
+    }
+
+    /* Parallel decoders, used from the next capture */
+    if (DecodersNP.isNameMatch(name))
+    {
+        v4l_base->setDecoderCount(static_cast<unsigned int>(values[0]));
+        DecodersNP[0].setValue(v4l_base->getDecoderCount());
+        DecodersNP.setState(IPS_OK);
+        DecodersNP.apply();
+        saveConfig(true, DecodersNP.getName());
+        return true;
+    }
+
     /* Capture Size (Step/Continuous) */
     if (strcmp(name, CaptureSizesNP.name) == 0)
     {
@@ -1361,11 +1478,31 @@ float V4L2_Driver::getRemainingExposure() const
     return (float) remaining.tv_sec + (float) remaining.tv_usec / 1000000.0f;
 }
 
+void V4L2_Driver::updateDroppedFrames()
+{
+    uint32_t const device = v4l_base->getDeviceDroppedFrames();
+    uint32_t const decoder = v4l_base->getDecoderDroppedFrames();
+    if (device == DroppedFramesNP[DROPPED_DEVICE].getValue() && decoder == DroppedFramesNP[DROPPED_DECODER].getValue())
+        return;
+
+    struct timeval elapsed = { .tv_sec = 0, .tv_usec = 0 };
+    timersub(&frame_received, &dropped_frames_update, &elapsed);
+    if (elapsed.tv_sec < 1)
+        return;
+
+    dropped_frames_update = frame_received;
+    DroppedFramesNP[DROPPED_DEVICE].setValue(device);
+    DroppedFramesNP[DROPPED_DECODER].setValue(decoder);
+    DroppedFramesNP.setState(IPS_OK);
+    DroppedFramesNP.apply();
+}
+
 void V4L2_Driver::newFrame()
 {
     struct timeval current_frame_duration = frame_received;
     gettimeofday(&frame_received, nullptr);
     timersub(&frame_received, &current_frame_duration, &current_frame_duration);
+    updateDroppedFrames();
 
 
     if (Streamer->isBusy())
@@ -1411,38 +1548,7 @@ void V4L2_Driver::newFrame()
 
         // downscale Y10 Y12 Y16
         if (bpp > dbpp)
-        {
-            unsigned short * src = (unsigned short *)buffer;
-            unsigned char * dest = buffer;
-            unsigned char shift = 0;
-
-            if (bpp < 16)
-            {
-                switch (bpp)
-                {
-                    case 10:
-                        shift = 2;
-                        break;
-                    case 12:
-                        shift = 4;
-                        break;
-                }
-                for (int i = 0; i < totalBytes; i++)
-                {
-                    *dest++ = *(src++) >> shift;
-                }
-            }
-            else
-            {
-                unsigned char * src = (unsigned char *)buffer + 1; // Y16 is little endian
-
-                for (int i = 0; i < totalBytes; i++)
-                {
-                    *dest++ = *src;
-                    src += 2;
-                }
-            }
-        }
+            ccvt_y16_y8(totalBytes, buffer, buffer, bpp);
 
         if (PrimaryCCD.getBinX() > 1)
         {
@@ -1951,6 +2057,10 @@ bool V4L2_Driver::saveConfigItems(FILE * fp)
 
     IUSaveConfigText(fp, &PortTP);
     StackModeSP.save(fp);
+    CaptureIOSP.save(fp);
+    BufferCountNP.save(fp);
+    DemosaicSP.save(fp);
+    DecodersNP.save(fp);
 
     if (ImageAdjustNP.nnp > 0)
         IUSaveConfigNumber(fp, &ImageAdjustNP);
@@ -65,6 +65,7 @@ public:
         static void newFrame(void *p);
         void stackFrame();
         void newFrame();
+        void updateDroppedFrames();
 
     protected:
         virtual bool Connect() override;
@@ -113,6 +114,24 @@ public:
             STACK_RESET_DARK = 4
         };
 
+        enum
+        {
+            CAPTURE_IO_MMAP = 0,
+            CAPTURE_IO_USERPTR
+        };
+
+        enum
+        {
+            DEMOSAIC_BILINEAR = 0,
+            DEMOSAIC_EDGE_AWARE
+        };
+
+        enum
+        {
+            DROPPED_DEVICE = 0,
+            DROPPED_DECODER
+        };
+
         /* Switches */
 
         ISwitch ImageDepthS[2];
@@ -131,6 +150,11 @@ public:
         /* Switch vectors */
         ISwitchVectorProperty ImageDepthSP;     /* 8 bits or 16 bits switch */
         INDI::PropertySwitch  StackModeSP {5};  /* StackMode switch */
+        INDI::PropertySwitch  CaptureIOSP {2};  /* Capture buffers memory switch */
+        INDI::PropertyNumber  BufferCountNP {1};/* Number of capture buffers */
+        INDI::PropertySwitch  DemosaicSP {2};   /* Bayer interpolation switch */
+        INDI::PropertyNumber  DecodersNP {1};   /* Number of parallel MJPEG decoders */
+        INDI::PropertyNumber  DroppedFramesNP {2}; /* Frames dropped by the device and the decoders */
         ISwitchVectorProperty InputsSP;         /* Select input switch */
         ISwitchVectorProperty CaptureFormatsSP; /* Select Capture format switch */
         ISwitchVectorProperty CaptureSizesSP;   /* Select Capture size switch (Discrete)*/
@@ -194,6 +218,7 @@ public:
 
         struct timeval frame_duration;
         struct timeval frame_received;
+        struct timeval dropped_frames_update; /* Dropped frames are published at most once per second */
 
         struct timeval exposure_duration;
         struct timeval elapsed_exposure;
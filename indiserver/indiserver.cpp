@@ -461,6 +461,10 @@ class Msg
         bool hasInlineBlobs;
         bool hasSharedBufferBlobs;
 
+        // Offset of the BLOB chunk carried by the message, -1 if the BLOB is sent at once
+        long chunkOffset;
+        bool lastChunk;
+
         std::vector<int> sharedBuffers; /* fds of shared buffer */
 
         // Convertion task and resultat of the task
@@ -489,6 +493,11 @@ class Msg
 
         Msg(MsgQueue * from, XMLEle * root);
 
+        /* Message holds a part of a BLOB sent progressively */
+        bool isChunk() const { return chunkOffset >= 0; }
+        bool isFirstChunk() const { return chunkOffset == 0; }
+        bool isLastChunk() const { return lastChunk; }
+
         static Msg * fromXml(MsgQueue * from, XMLEle * root, std::list<int> &incomingSharedBuffers);
 
         /**
@@ -655,6 +664,7 @@ class ClInfo: public MsgQueue
         std::list<Property*> props;     /* props we want */
         int allprops = 0;               /* saw getProperties w/o device */
         BLOBHandling blob = B_NEVER;    /* when to send setBLOBs */
+        std::set<std::string> droppedChunks; /* dev.name of chunked BLOBs being dropped */
 
         ClInfo(bool useSharedBuffer);
         virtual ~ClInfo();
@@ -2237,9 +2247,20 @@ void ClInfo::q2Clients(ClInfo *notme, int isblob, const std::string &dev, const
                 continue;
         }
 
-        /* shut down this client if its q is already too large */
+        /* a chunked BLOB is either sent completely or dropped completely */
         unsigned long ql = cp->msgQSize();
-        if (isblob && maxstreamsiz > 0 && ql > maxstreamsiz)
+        if (isblob && mp->isChunk() && !mp->isFirstChunk())
+        {
+            auto dropped = cp->droppedChunks.find(dev + "." + name);
+            if (dropped != cp->droppedChunks.end())
+            {
+                if (mp->isLastChunk())
+                    cp->droppedChunks.erase(dropped);
+                continue;
+            }
+        }
+        /* drop stream BLOBs if this client is too far behind */
+        else if (isblob && maxstreamsiz > 0 && ql > maxstreamsiz)
         {
             // Drop frames for streaming blobs
             /* pull out each name/BLOB pair, decode */
@@ -2262,9 +2283,12 @@ void ClInfo::q2Clients(ClInfo *notme, int isblob, const std::string &dev, const
             {
                 if (verbose > 1)
                     cp->log(fmt("%ld bytes behind. Dropping stream BLOB...\n", ql));
+                if (mp->isChunk() && !mp->isLastChunk())
+                    cp->droppedChunks.insert(dev + "." + name);
                 continue;
             }
         }
+        /* shut down this client if its q is already too large */
         if (ql > maxqsiz)
         {
             if (verbose)
@@ -3090,6 +3114,9 @@ Msg::Msg(MsgQueue * from, XMLEle * ele): sharedBuffers()
     convertionToSharedBuffer = nullptr;
     convertionToInline = nullptr;
 
+    chunkOffset = -1;
+    lastChunk = false;
+
     queueSize = sprlXMLEle(xmlContent, 0);
     for(auto blobContent : findBlobElements(xmlContent))
     {
@@ -3102,6 +3129,13 @@ Msg::Msg(MsgQueue * from, XMLEle * ele): sharedBuffers()
         {
             hasInlineBlobs = true;
         }
+
+        XMLAtt * offset = findXMLAtt(blobContent, "offset");
+        if (offset)
+        {
+            chunkOffset = atol(valuXMLAtt(offset));
+            lastChunk = chunkOffset + atol(findXMLAttValu(blobContent, "size")) >= atol(findXMLAttValu(blobContent, "total"));
+        }
     }
 }
 
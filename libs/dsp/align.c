@@ -32,63 +32,6 @@ static int dsp_qsort_delta_diff_desc (const void *arg1, const void *arg2)
     return ((*a1).delta < (*a2).delta ? 1 : -1);
 }
 
-static int dsp_qsort_delta_diff_asc (const void *arg1, const void *arg2)
-{
-    delta_diff* a1 = (delta_diff*)arg1;
-    delta_diff* a2 = (delta_diff*)arg2;
-    return ((*a1).delta > (*a2).delta ? 1 : -1);
-}
-
-static int dsp_qsort_triangle_delta_desc(const void *arg1, const void *arg2)
-{
-    dsp_triangle* a = (dsp_triangle*)arg1;
-    dsp_triangle* b = (dsp_triangle*)arg2;
-    int ret = 0;
-    int s = 0;
-    for(s = 0; s < (*a).stars_count; s++)
-        ret |= ((*a).sizes[s] < (*b).sizes[s]);
-    return (ret ? 1 : -1);
-}
-
-static int dsp_qsort_triangle_delta_asc(const void *arg1, const void *arg2)
-{
-    dsp_triangle* a = (dsp_triangle*)arg1;
-    dsp_triangle* b = (dsp_triangle*)arg2;
-    int ret = 0;
-    int s = 0;
-    for(s = 0; s < (*a).stars_count; s++)
-        ret |= ((*a).sizes[s] > (*b).sizes[s]);
-    return (ret ? 1 : -1);
-}
-
-static int dsp_qsort_triangle_diameter_desc(const void *arg1, const void *arg2)
-{
-    dsp_triangle* a = (dsp_triangle*)arg1;
-    dsp_triangle* b = (dsp_triangle*)arg2;
-    int ret = 0;
-    int s = 0;
-    for(s = 0; s < (*a).stars_count; s++) {
-        ret |= ((*a).stars[s].diameter < (*b).stars[s].diameter);
-        ret |= ((*a).stars[s].peak < (*b).stars[s].peak);
-        ret |= ((*a).stars[s].flux < (*b).stars[s].flux);
-    }
-    return (ret ? 1 : -1);
-}
-
-static int dsp_qsort_triangle_diameter_asc(const void *arg1, const void *arg2)
-{
-    dsp_triangle* a = (dsp_triangle*)arg1;
-    dsp_triangle* b = (dsp_triangle*)arg2;
-    int ret = 0;
-    int s = 0;
-    for(s = 0; s < (*a).stars_count; s++) {
-        ret |= ((*a).stars[s].diameter > (*b).stars[s].diameter);
-        ret |= ((*a).stars[s].peak > (*b).stars[s].peak);
-        ret |= ((*a).stars[s].flux > (*b).stars[s].flux);
-    }
-    return (ret ? 1 : -1);
-}
-
 static int dsp_qsort_star_diameter_desc(const void *arg1, const void *arg2)
 {
     dsp_star* a = (dsp_star*)arg1;
@@ -96,27 +39,6 @@ static int dsp_qsort_star_diameter_desc(const void *arg1, const void *arg2)
     return ((*a).diameter < (*b).diameter ? 1 : -1);
 }
 
-static int dsp_qsort_star_diameter_asc(const void *arg1, const void *arg2)
-{
-    dsp_star* a = (dsp_star*)arg1;
-    dsp_star* b = (dsp_star*)arg2;
-    return ((*a).diameter > (*b).diameter ? 1 : -1);
-}
-
-static int dsp_qsort_double_desc (const void *arg1, const void *arg2)
-{
-    double* a = (double*)arg1;
-    double* b = (double*)arg2;
-    return ((*a) < (*b) ? 1 : -1);
-}
-
-static int dsp_qsort_double_asc (const void *arg1, const void *arg2)
-{
-    double* a = (double*)arg1;
-    double* b = (double*)arg2;
-    return ((*a) > (*b) ? 1 : -1);
-}
-
 static double calc_match_score(dsp_triangle t1, dsp_triangle t2, dsp_align_info align_info)
 {
     int x = 0;
@@ -337,3 +259,242 @@ int dsp_align_get_offset(dsp_stream_p stream1, dsp_stream_p stream2, double tole
         stream2->align_info.err &= ~DSP_ALIGN_ROTATED;
     return stream2->align_info.err;
 }
+
+typedef struct {
+    int x;
+    int y;
+    dsp_t peak;
+} dsp_star_candidate;
+
+typedef struct {
+    double radius;
+    double flux;
+} dsp_star_ring;
+
+static int dsp_qsort_star_ring_asc(const void *arg1, const void *arg2)
+{
+    dsp_star_ring* a = (dsp_star_ring*)arg1;
+    dsp_star_ring* b = (dsp_star_ring*)arg2;
+    return ((*a).radius < (*b).radius ? -1 : ((*a).radius > (*b).radius ? 1 : 0));
+}
+
+static int dsp_qsort_star_candidate_desc(const void *arg1, const void *arg2)
+{
+    dsp_star_candidate* a = (dsp_star_candidate*)arg1;
+    dsp_star_candidate* b = (dsp_star_candidate*)arg2;
+    return ((*a).peak < (*b).peak ? 1 : ((*a).peak > (*b).peak ? -1 : 0));
+}
+
+struct dsp_align_stars_band {
+    dsp_star_candidate *candidates;
+    int candidates_count;
+};
+
+struct dsp_align_stars_job {
+    int tile_size;
+    double threshold;
+    dsp_stream_p stream;
+    dsp_t *background;
+    dsp_t *noise;
+    int bands_count;
+    struct dsp_align_stars_band *bands;
+};
+
+static void dsp_align_find_stars_range(void* arg, int first, int last, int worker)
+{
+    (void)worker;
+    struct dsp_align_stars_job *job = arg;
+    dsp_stream_p stream = job->stream;
+    int tile_size = job->tile_size;
+    int width = stream->sizes[0];
+    int height = stream->sizes[1];
+    int tiles_x = (width + tile_size - 1) / tile_size;
+    int b, x, y;
+    for(b = first; b < last; b++) {
+        struct dsp_align_stars_band *band = &job->bands[b];
+        int start = 1 + b * (height - 2) / job->bands_count;
+        int end = 1 + (b + 1) * (height - 2) / job->bands_count;
+        int allocated = 64;
+        band->candidates = (dsp_star_candidate*)malloc(sizeof(dsp_star_candidate) * allocated);
+        band->candidates_count = 0;
+        for(y = start; y < end; y++) {
+            dsp_t *above = &stream->buf[(y - 1) * width];
+            dsp_t *row = &stream->buf[y * width];
+            dsp_t *below = &stream->buf[(y + 1) * width];
+            int tile_row = (y / tile_size) * tiles_x;
+            for(x = 1; x < width - 1; x++) {
+                int t = tile_row + x / tile_size;
+                dsp_t level = job->background[t] + job->threshold * job->noise[t];
+                dsp_t v = row[x];
+                if(v <= level)
+                    continue;
+                // Strict local maximum towards the already scanned pixels to report plateaus once
+                if(v <= above[x - 1] || v <= above[x] || v <= above[x + 1] || v <= row[x - 1] ||
+                   v < row[x + 1] || v < below[x - 1] || v < below[x] || v < below[x + 1])
+                    continue;
+                // Reject isolated hot pixels
+                dsp_t half = job->background[t] + job->threshold * job->noise[t] / 2;
+                int neighbours = (above[x - 1] > half) + (above[x] > half) + (above[x + 1] > half) + (row[x - 1] > half) +
+                                 (row[x + 1] > half) + (below[x - 1] > half) + (below[x] > half) + (below[x + 1] > half);
+                if(neighbours < 2)
+                    continue;
+                if(band->candidates_count == allocated) {
+                    allocated *= 2;
+                    band->candidates = (dsp_star_candidate*)realloc(band->candidates, sizeof(dsp_star_candidate) * allocated);
+                }
+                band->candidates[band->candidates_count].x = x;
+                band->candidates[band->candidates_count].y = y;
+                band->candidates[band->candidates_count].peak = v;
+                band->candidates_count++;
+            }
+        }
+    }
+}
+
+int dsp_align_find_stars(dsp_stream_p stream, int tile_size, double threshold, int max_stars)
+{
+    int s;
+    for(s = 0; s < stream->stars_count; s++)
+        free(stream->stars[s].center.location);
+    stream->stars_count = 0;
+    if(stream->dims < 2 || stream->sizes[0] < 3 || stream->sizes[1] < 3 || tile_size < 1 || max_stars < 1)
+        return 0;
+
+    int width = stream->sizes[0];
+    int height = stream->sizes[1];
+    int tiles_x = (width + tile_size - 1) / tile_size;
+    int tiles_y = (height + tile_size - 1) / tile_size;
+    dsp_t *background = (dsp_t*)malloc(sizeof(dsp_t) * tiles_x * tiles_y);
+    dsp_t *noise = (dsp_t*)malloc(sizeof(dsp_t) * tiles_x * tiles_y);
+    dsp_stats_background(stream, tile_size, background, noise);
+
+    int y;
+    // Candidates are listed by bands of rows, their order does not depend on the threads
+    struct dsp_align_stars_job job = { tile_size, threshold, stream, background, noise, (int)dsp_max_threads(0), NULL };
+    job.bands = (struct dsp_align_stars_band*)calloc(job.bands_count, sizeof(struct dsp_align_stars_band));
+    dsp_parallel_for(job.bands_count, 1, dsp_align_find_stars_range, &job);
+    int candidates_count = 0;
+    for(y = 0; y < job.bands_count; y++)
+        candidates_count += job.bands[y].candidates_count;
+    dsp_star_candidate *candidates = (dsp_star_candidate*)malloc(sizeof(dsp_star_candidate) * Max(1, candidates_count));
+    candidates_count = 0;
+    for(y = 0; y < job.bands_count; y++) {
+        memcpy(&candidates[candidates_count], job.bands[y].candidates, sizeof(dsp_star_candidate) * job.bands[y].candidates_count);
+        candidates_count += job.bands[y].candidates_count;
+        free(job.bands[y].candidates);
+    }
+    free(job.bands);
+    qsort(candidates, candidates_count, sizeof(dsp_star_candidate), dsp_qsort_star_candidate_desc);
+
+    int max_radius = Max(2, Min(32, tile_size / 2));
+    dsp_star_ring *rings = (dsp_star_ring*)malloc(sizeof(dsp_star_ring) * (2 * max_radius + 3) * (2 * max_radius + 3));
+    double location[2];
+    dsp_star star;
+    memset(&star, 0, sizeof(dsp_star));
+    star.center.dims = 2;
+    star.center.location = location;
+    int c;
+    for(c = 0; c < candidates_count && stream->stars_count < max_stars; c++) {
+        int cx = candidates[c].x;
+        int cy = candidates[c].y;
+        int t = (cy / tile_size) * tiles_x + cx / tile_size;
+        dsp_t bg = background[t];
+        dsp_t edge = bg + noise[t];
+
+        // Skip maxima belonging to an already measured star
+        int duplicate = 0;
+        for(s = 0; s < stream->stars_count && !duplicate; s++) {
+            double dx = stream->stars[s].center.location[0] - cx;
+            double dy = stream->stars[s].center.location[1] - cy;
+            double r = Max(stream->stars[s].diameter, 2.0 * stream->stars[s].hfr) + 1.0;
+            duplicate = (dx * dx + dy * dy) <= r * r;
+        }
+        if(duplicate)
+            continue;
+
+        // Grow the aperture until the ring reaches the background
+        int radius;
+        for(radius = 1; radius < max_radius; radius++) {
+            double sum = 0;
+            int count = 0;
+            int i;
+            for(i = -radius; i <= radius; i++) {
+                int px[4] = { cx + i, cx + i, cx - radius, cx + radius };
+                int py[4] = { cy - radius, cy + radius, cy + i, cy + i };
+                int k;
+                for(k = 0; k < 4; k++) {
+                    if(px[k] < 0 || py[k] < 0 || px[k] >= width || py[k] >= height)
+                        continue;
+                    sum += stream->buf[py[k] * width + px[k]];
+                    count++;
+                }
+            }
+            if(count == 0 || sum / count < edge)
+                break;
+        }
+        radius++;
+
+        int x0 = Max(0, cx - radius), x1 = Min(width - 1, cx + radius);
+        int y0 = Max(0, cy - radius), y1 = Min(height - 1, cy + radius);
+        double half = (candidates[c].peak - bg) / 2.0;
+        double flux = 0, sx = 0, sy = 0;
+        int above_half = 0;
+        int px, py;
+        for(py = y0; py <= y1; py++) {
+            for(px = x0; px <= x1; px++) {
+                if((px - cx) * (px - cx) + (py - cy) * (py - cy) > radius * radius)
+                    continue;
+                double w = stream->buf[py * width + px] - bg;
+                if(w <= 0)
+                    continue;
+                flux += w;
+                sx += w * px;
+                sy += w * py;
+                if(w >= half)
+                    above_half++;
+            }
+        }
+        if(flux <= 0)
+            continue;
+        location[0] = sx / flux;
+        location[1] = sy / flux;
+        // Half flux radius: the distance from the centroid within which the pixels hold half of the flux
+        int rings_count = 0;
+        for(py = y0; py <= y1; py++) {
+            for(px = x0; px <= x1; px++) {
+                if((px - cx) * (px - cx) + (py - cy) * (py - cy) > radius * radius)
+                    continue;
+                double w = stream->buf[py * width + px] - bg;
+                if(w <= 0)
+                    continue;
+                rings[rings_count].radius = sqrt((px - location[0]) * (px - location[0]) + (py - location[1]) * (py - location[1]));
+                rings[rings_count].flux = w;
+                rings_count++;
+            }
+        }
+        qsort(rings, rings_count, sizeof(dsp_star_ring), dsp_qsort_star_ring_asc);
+        double enclosed = 0, previous = 0;
+        star.hfr = rings[rings_count - 1].radius;
+        for(s = 0; s < rings_count; s++) {
+            // Each pixel adds its flux over the distance from the previous one
+            if(enclosed + rings[s].flux >= flux / 2) {
+                star.hfr = previous + (rings[s].radius - previous) * (flux / 2 - enclosed) / rings[s].flux;
+                break;
+            }
+            enclosed += rings[s].flux;
+            previous = rings[s].radius;
+        }
+        star.diameter = 2.0 * sqrt(above_half / M_PI);
+        star.peak = candidates[c].peak;
+        star.flux = flux;
+        star.theta = 0;
+        snprintf(star.name, DSP_NAME_SIZE, "%d", stream->stars_count);
+        dsp_stream_add_star(stream, star);
+    }
+
+    free(rings);
+    free(candidates);
+    free(background);
+    free(noise);
+    return stream->stars_count;
+}
@@ -20,26 +20,29 @@
 #include "dsp.h"
 #include <setjmp.h>
 #include <signal.h>
+#include <limits.h>
 
 void dsp_buffer_shift(dsp_stream_p stream)
 {
     if(stream->dims == 0)
         return;
     dsp_t* tmp = (dsp_t*)malloc(sizeof(dsp_t) * stream->len);
+    int* pos = (int*)calloc(stream->dims * 2, sizeof(int));
+    int* shifted = pos + stream->dims;
     int x, d;
-    for(x = 0; x < stream->len/2; x++) {
-        int* pos = dsp_stream_get_position(stream, x);
+    for(x = 0; x < stream->len/2; x++, dsp_stream_next_position(stream, pos)) {
         for(d = 0; d < stream->dims; d++) {
             if(pos[d]<stream->sizes[d] / 2) {
-                pos[d] += stream->sizes[d] / 2;
+                shifted[d] = pos[d] + stream->sizes[d] / 2;
             } else {
-                pos[d] -= stream->sizes[d] / 2;
+                shifted[d] = pos[d] - stream->sizes[d] / 2;
             }
         }
-        tmp[x] = stream->buf[dsp_stream_set_position(stream, pos)];
-        tmp[dsp_stream_set_position(stream, pos)] = stream->buf[x];
-        free(pos);
+        int y = dsp_stream_set_position(stream, shifted);
+        tmp[x] = stream->buf[y];
+        tmp[y] = stream->buf[x];
     }
+    free(pos);
     memcpy(stream->buf, tmp, stream->len * sizeof(dsp_t));
     free(tmp);
 }
@@ -47,31 +50,34 @@ void dsp_buffer_shift(dsp_stream_p stream)
 void dsp_buffer_removemean(dsp_stream_p stream)
 {
     int k;
+    dsp_t *buf = stream->buf;
 
-    dsp_t mean = dsp_stats_mean(stream->buf, stream->len);
+    dsp_t mean = dsp_stats_mean(buf, stream->len);
     for(k = 0; k < stream->len; k++)
-        stream->buf[k] = stream->buf[k] - mean;
+        buf[k] = buf[k] - mean;
 
 }
 
 void dsp_buffer_sub(dsp_stream_p stream, dsp_t* in, int inlen)
 {
     int len = Min(stream->len, inlen);
+    dsp_t *buf = stream->buf;
 
-	int k;
-	for(k = 0; k < len; k++) {
-        stream->buf[k] = stream->buf[k] - in[k];
-	}
+    int k;
+    for(k = 0; k < len; k++) {
+        buf[k] = buf[k] - in[k];
+    }
 
 }
 
 void dsp_buffer_sum(dsp_stream_p stream, dsp_t* in, int inlen)
 {
     int len = Min(stream->len, inlen);
+    dsp_t *buf = stream->buf;
 
     int k;
     for(k = 0; k < len; k++) {
-        stream->buf[k] += in[k];
+        buf[k] += in[k];
     }
 
 }
@@ -79,10 +85,11 @@ void dsp_buffer_sum(dsp_stream_p stream, dsp_t* in, int inlen)
 void dsp_buffer_max(dsp_stream_p stream, dsp_t* in, int inlen)
 {
     int len = Min(stream->len, inlen);
+    dsp_t *buf = stream->buf;
 
     int k;
     for(k = 0; k < len; k++) {
-        stream->buf[k] = Max(stream->buf[k], in[k]);
+        buf[k] = Max(buf[k], in[k]);
     }
 
 }
@@ -90,10 +97,11 @@ void dsp_buffer_max(dsp_stream_p stream, dsp_t* in, int inlen)
 void dsp_buffer_min(dsp_stream_p stream, dsp_t* in, int inlen)
 {
     int len = Min(stream->len, inlen);
+    dsp_t *buf = stream->buf;
 
     int k;
     for(k = 0; k < len; k++) {
-        stream->buf[k] = Min(stream->buf[k], in[k]);
+        buf[k] = Min(buf[k], in[k]);
     }
 
 }
@@ -101,21 +109,23 @@ void dsp_buffer_min(dsp_stream_p stream, dsp_t* in, int inlen)
 void dsp_buffer_div(dsp_stream_p stream, dsp_t* in, int inlen)
 {
     int len = Min(stream->len, inlen);
+    dsp_t *buf = stream->buf;
 
-	int k;
-	for(k = 0; k < len; k++) {
-        stream->buf[k] = stream->buf[k] / in[k];
-	}
+    int k;
+    for(k = 0; k < len; k++) {
+        buf[k] = buf[k] / in[k];
+    }
 
 }
 
 void dsp_buffer_mul(dsp_stream_p stream, dsp_t* in, int inlen)
 {
     int len = Min(stream->len, inlen);
+    dsp_t *buf = stream->buf;
 
     int k;
     for(k = 0; k < len; k++) {
-        stream->buf[k] = stream->buf[k] * in[k];
+        buf[k] = buf[k] * in[k];
     }
 
 }
@@ -123,10 +133,11 @@ void dsp_buffer_mul(dsp_stream_p stream, dsp_t* in, int inlen)
 void dsp_buffer_pow(dsp_stream_p stream, dsp_t* in, int inlen)
 {
     int len = Min(stream->len, inlen);
+    dsp_t *buf = stream->buf;
 
     int k;
     for(k = 0; k < len; k++) {
-        stream->buf[k] = pow(stream->buf[k], in[k]);
+        buf[k] = pow(buf[k], in[k]);
     }
 
 }
@@ -134,10 +145,11 @@ void dsp_buffer_pow(dsp_stream_p stream, dsp_t* in, int inlen)
 void dsp_buffer_log(dsp_stream_p stream, dsp_t* in, int inlen)
 {
     int len = Min(stream->len, inlen);
+    dsp_t *buf = stream->buf;
 
     int k;
     for(k = 0; k < len; k++) {
-        stream->buf[k] = Log(stream->buf[k], in[k]);
+        buf[k] = Log(buf[k], in[k]);
     }
 
 }
@@ -145,9 +157,11 @@ void dsp_buffer_log(dsp_stream_p stream, dsp_t* in, int inlen)
 void dsp_buffer_1sub(dsp_stream_p stream, dsp_t val)
 {
     int k;
+    int len = stream->len;
+    dsp_t *buf = stream->buf;
 
-    for(k = 0; k < stream->len; k++) {
-        stream->buf[k] = val - stream->buf[k];
+    for(k = 0; k < len; k++) {
+        buf[k] = val - buf[k];
     }
 
 }
@@ -155,29 +169,35 @@ void dsp_buffer_1sub(dsp_stream_p stream, dsp_t val)
 void dsp_buffer_sub1(dsp_stream_p stream, dsp_t val)
 {
     int k;
+    int len = stream->len;
+    dsp_t *buf = stream->buf;
 
-    for(k = 0; k < stream->len; k++) {
-        stream->buf[k] = stream->buf[k] - val;
+    for(k = 0; k < len; k++) {
+        buf[k] = buf[k] - val;
     }
 
 }
 
 void dsp_buffer_sum1(dsp_stream_p stream, dsp_t val)
 {
-	int k;
+    int k;
+    int len = stream->len;
+    dsp_t *buf = stream->buf;
 
-    for(k = 0; k < stream->len; k++) {
-        stream->buf[k] += val;
-	}
+    for(k = 0; k < len; k++) {
+        buf[k] += val;
+    }
 
 }
 
 void dsp_buffer_1div(dsp_stream_p stream, double val)
 {
     int k;
+    int len = stream->len;
+    dsp_t *buf = stream->buf;
 
-    for(k = 0; k < stream->len; k++) {
-        stream->buf[k] = val / stream->buf[k];
+    for(k = 0; k < len; k++) {
+        buf[k] = val / buf[k];
     }
 
 }
@@ -185,9 +205,11 @@ void dsp_buffer_1div(dsp_stream_p stream, double val)
 void dsp_buffer_div1(dsp_stream_p stream, double val)
 {
     int k;
+    int len = stream->len;
+    dsp_t *buf = stream->buf;
 
-    for(k = 0; k < stream->len; k++) {
-        stream->buf[k] /= val;
+    for(k = 0; k < len; k++) {
+        buf[k] /= val;
     }
 
 }
@@ -195,9 +217,11 @@ void dsp_buffer_div1(dsp_stream_p stream, double val)
 void dsp_buffer_mul1(dsp_stream_p stream, double val)
 {
     int k;
+    int len = stream->len;
+    dsp_t *buf = stream->buf;
 
-    for(k = 0; k < stream->len; k++) {
-        stream->buf[k] = stream->buf[k] * val;
+    for(k = 0; k < len; k++) {
+        buf[k] = buf[k] * val;
     }
 
 }
@@ -205,9 +229,11 @@ void dsp_buffer_mul1(dsp_stream_p stream, double val)
 void dsp_buffer_pow1(dsp_stream_p stream, double val)
 {
     int k;
+    int len = stream->len;
+    dsp_t *buf = stream->buf;
 
-    for(k = 0; k < stream->len; k++) {
-        stream->buf[k] = pow(stream->buf[k], val);
+    for(k = 0; k < len; k++) {
+        buf[k] = pow(buf[k], val);
     }
 
 }
@@ -215,9 +241,11 @@ void dsp_buffer_pow1(dsp_stream_p stream, double val)
 void dsp_buffer_log1(dsp_stream_p stream, double val)
 {
     int k;
+    int len = stream->len;
+    dsp_t *buf = stream->buf;
 
-    for(k = 0; k < stream->len; k++) {
-        stream->buf[k] = Log(stream->buf[k], val);
+    for(k = 0; k < len; k++) {
+        buf[k] = Log(buf[k], val);
     }
 
 }
@@ -232,160 +260,350 @@ static int compare( const void* a, const void* b)
      else return 1;
 }
 
-static void* dsp_buffer_median_th(void* arg)
-{
-    struct {
-        int cur_th;
-        int size;
-        int median;
-        dsp_stream_p stream;
-        dsp_stream_p box;
-     } *arguments = arg;
-    dsp_stream_p stream = arguments->stream;
-    dsp_stream_p box = arguments->box;
-    dsp_stream_p in = stream->parent;
-    int cur_th = arguments->cur_th;
-    int size = arguments->size;
-    int median = arguments->median;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
-    int x, y, dim, idx;
-    dsp_t* sorted = (dsp_t*)malloc(pow(size, stream->dims) * sizeof(dsp_t));
-    int len = pow(size, in->dims);
-    for(x = start; x < end; x++) {
-        dsp_t* buf = sorted;
-        for(y = 0; y < box->len; y++) {
-            int *pos = dsp_stream_get_position(stream, x);
-            int *mat = dsp_stream_get_position(box, y);
-            for(dim = 0; dim < stream->dims; dim++) {
-                pos[dim] += mat[dim] - size / 2;
-            }
-            idx = dsp_stream_set_position(stream, pos);
-            if(idx >= 0 && idx < in->len) {
-                *buf++ = in->buf[idx];
+/*
+ * Median and sigma filters of 2D streams holding integer samples within DSP_BUFFER_HISTOGRAM_RANGE
+ * values keep a histogram of the window, which is moved along each row by adding the entering
+ * column and removing the leaving one (Huang). The bin of the wanted rank, or of the window mean,
+ * is reached from the one of the previous element, through coarser levels of the histogram when it
+ * is far. Other streams sort or scan the window of each element. Windows are clipped to the stream,
+ * the rank of the median is scaled to the number of samples inside of it.
+ */
+#define DSP_BUFFER_HISTOGRAM_RANGE 65536
+#define DSP_BUFFER_HISTOGRAM_LEVELS 3
+///Each level of the histogram has bins 2^DSP_BUFFER_HISTOGRAM_SHIFT times wider than the one below
+#define DSP_BUFFER_HISTOGRAM_SHIFT 4
+
+struct dsp_buffer_window_job {
+    dsp_stream_p in;
+    dsp_t *out;
+    int size;
+    int median;
+    /// Histogram bin of each sample, NULL when the windows are sorted
+    unsigned short *bins;
+    /// Minimum sample, the one of the first bin
+    dsp_t offset;
+    /// Number of bins
+    int range;
+};
+
+struct dsp_buffer_histogram {
+    int *counts[DSP_BUFFER_HISTOGRAM_LEVELS];
+    /// Sums of the bins of the samples within the bins of the coarser levels, kept by the sigma filter only
+    long long *sums[DSP_BUFFER_HISTOGRAM_LEVELS];
+    int count;
+    long long sum;
+    /// Current bin, below and below_sum are the count and the sum of the bins of the samples under it
+    int level;
+    int below;
+    long long below_sum;
+};
+
+static int dsp_buffer_histogram_init(struct dsp_buffer_histogram *h, int range, int sums)
+{
+    int l, ok = 1;
+    memset(h, 0, sizeof(struct dsp_buffer_histogram));
+    for(l = 0; l < DSP_BUFFER_HISTOGRAM_LEVELS; l++) {
+        size_t bins = (size_t)(range >> (l * DSP_BUFFER_HISTOGRAM_SHIFT)) + 1;
+        h->counts[l] = (int*)calloc(bins, sizeof(int));
+        ok = ok && h->counts[l] != NULL;
+        if(sums && l > 0) {
+            h->sums[l] = (long long*)calloc(bins, sizeof(long long));
+            ok = ok && h->sums[l] != NULL;
+        }
+    }
+    return ok;
+}
+
+static void dsp_buffer_histogram_free(struct dsp_buffer_histogram *h)
+{
+    int l;
+    for(l = 0; l < DSP_BUFFER_HISTOGRAM_LEVELS; l++) {
+        free(h->counts[l]);
+        free(h->sums[l]);
+    }
+}
+
+static inline int dsp_buffer_histogram_bin_count(struct dsp_buffer_histogram *h, int l, int bin)
+{
+    return h->counts[l][bin >> (l * DSP_BUFFER_HISTOGRAM_SHIFT)];
+}
+
+static inline long long dsp_buffer_histogram_bin_sum(struct dsp_buffer_histogram *h, int l, int bin)
+{
+    if(h->sums[1] == NULL)
+        return 0;
+    if(l == 0)
+        return (long long)h->counts[0][bin] * bin;
+    return h->sums[l][bin >> (l * DSP_BUFFER_HISTOGRAM_SHIFT)];
+}
+
+static inline int dsp_buffer_histogram_aligned(struct dsp_buffer_histogram *h, int l)
+{
+    return (h->level & ((1 << (l * DSP_BUFFER_HISTOGRAM_SHIFT)) - 1)) == 0;
+}
+
+/* Moves the current bin down or up by a bin of level l, the current bin must be aligned to it. */
+static inline void dsp_buffer_histogram_down(struct dsp_buffer_histogram *h, int l)
+{
+    h->level -= 1 << (l * DSP_BUFFER_HISTOGRAM_SHIFT);
+    h->below -= dsp_buffer_histogram_bin_count(h, l, h->level);
+    h->below_sum -= dsp_buffer_histogram_bin_sum(h, l, h->level);
+}
+
+static inline void dsp_buffer_histogram_up(struct dsp_buffer_histogram *h, int l)
+{
+    h->below += dsp_buffer_histogram_bin_count(h, l, h->level);
+    h->below_sum += dsp_buffer_histogram_bin_sum(h, l, h->level);
+    h->level += 1 << (l * DSP_BUFFER_HISTOGRAM_SHIFT);
+}
+
+/* Moves to the bin holding the sample of the given rank in ascending order. */
+static void dsp_buffer_histogram_rank(struct dsp_buffer_histogram *h, int rank)
+{
+    int l;
+    while(h->below > rank) {
+        for(l = DSP_BUFFER_HISTOGRAM_LEVELS - 1; l > 0; l--) {
+            int width = 1 << (l * DSP_BUFFER_HISTOGRAM_SHIFT);
+            if(dsp_buffer_histogram_aligned(h, l) && h->level >= width &&
+                    h->below - dsp_buffer_histogram_bin_count(h, l, h->level - width) > rank)
+                break;
+        }
+        dsp_buffer_histogram_down(h, l);
+    }
+    while(h->below + h->counts[0][h->level] <= rank) {
+        for(l = DSP_BUFFER_HISTOGRAM_LEVELS - 1; l > 0; l--) {
+            if(dsp_buffer_histogram_aligned(h, l) &&
+                    h->below + dsp_buffer_histogram_bin_count(h, l, h->level) <= rank)
+                break;
+        }
+        dsp_buffer_histogram_up(h, l);
+    }
+}
+
+/* Moves to the given bin. */
+static void dsp_buffer_histogram_level(struct dsp_buffer_histogram *h, int level)
+{
+    int l;
+    while(h->level > level) {
+        for(l = DSP_BUFFER_HISTOGRAM_LEVELS - 1; l > 0; l--) {
+            if(dsp_buffer_histogram_aligned(h, l) && h->level - (1 << (l * DSP_BUFFER_HISTOGRAM_SHIFT)) >= level)
+                break;
+        }
+        dsp_buffer_histogram_down(h, l);
+    }
+    while(h->level < level) {
+        for(l = DSP_BUFFER_HISTOGRAM_LEVELS - 1; l > 0; l--) {
+            if(dsp_buffer_histogram_aligned(h, l) && h->level + (1 << (l * DSP_BUFFER_HISTOGRAM_SHIFT)) <= level)
+                break;
+        }
+        dsp_buffer_histogram_up(h, l);
+    }
+}
+
+static void dsp_buffer_histogram_column(struct dsp_buffer_histogram *h, struct dsp_buffer_window_job *job, int x, int y0, int y1, int n)
+{
+    int width = job->in->sizes[0];
+    unsigned short *bins = job->bins + x;
+    int y, l, below = 0;
+    long long sum = 0, below_sum = 0;
+    // Counters of the window are updated once per column, they could alias the histogram otherwise
+    for(y = y0; y < y1; y++) {
+        int bin = bins[y * width];
+        h->counts[0][bin] += n;
+        for(l = 1; l < DSP_BUFFER_HISTOGRAM_LEVELS; l++)
+            h->counts[l][bin >> (l * DSP_BUFFER_HISTOGRAM_SHIFT)] += n;
+        // The comparison with the current bin is not predictable, it is used as a factor
+        below += bin < h->level;
+        if(h->sums[1] != NULL) {
+            for(l = 1; l < DSP_BUFFER_HISTOGRAM_LEVELS; l++)
+                h->sums[l][bin >> (l * DSP_BUFFER_HISTOGRAM_SHIFT)] += n * bin;
+            sum += bin;
+            below_sum += (bin < h->level) * bin;
+        }
+    }
+    h->count += n * (y1 - y0);
+    h->below += n * below;
+    h->sum += n * sum;
+    h->below_sum += n * below_sum;
+}
+
+/* Filters the rows from start to end of a 2D stream, writing the median or the sigma of each window. */
+static void dsp_buffer_histogram_rows(struct dsp_buffer_window_job *job, int start, int end, int sigma)
+{
+    int width = job->in->sizes[0];
+    int height = job->in->sizes[1];
+    int size = job->size;
+    int half = size / 2;
+    int x, y, c;
+    struct dsp_buffer_histogram h;
+    if(!dsp_buffer_histogram_init(&h, job->range, sigma)) {
+        dsp_buffer_histogram_free(&h);
+        return;
+    }
+    for(y = start; y < end; y++) {
+        int y0 = Max(0, y - half);
+        int y1 = Min(height, y - half + size);
+        for(c = 0; c < Min(width, size - half); c++)
+            dsp_buffer_histogram_column(&h, job, c, y0, y1, 1);
+        for(x = 0; x < width; x++) {
+            int n = h.count;
+            if(sigma) {
+                double mean = (double)h.sum / n;
+                dsp_buffer_histogram_level(&h, Min(job->range, (int)floor(mean) + 1));
+                double deviation = mean * h.below - h.below_sum + (h.sum - h.below_sum) - mean * (n - h.below);
+                job->out[y * width + x] = deviation / n;
+            } else {
+                dsp_buffer_histogram_rank(&h, Max(0, Min(n - 1, job->median * n / size)));
+                job->out[y * width + x] = h.level + job->offset;
             }
-            free(pos);
-            free(mat);
+            if(x - half >= 0)
+                dsp_buffer_histogram_column(&h, job, x - half, y0, y1, -1);
+            if(x - half + size < width)
+                dsp_buffer_histogram_column(&h, job, x - half + size, y0, y1, 1);
+        }
+        for(c = Max(0, width - half); c < width; c++)
+            dsp_buffer_histogram_column(&h, job, c, y0, y1, -1);
+    }
+    dsp_buffer_histogram_free(&h);
+}
+
+/* Fills the histogram bins of the samples of a 2D stream when they are integers within the range. */
+static void dsp_buffer_histogram_bins(struct dsp_buffer_window_job *job)
+{
+    dsp_stream_p in = job->in;
+    int x;
+    if(in->dims != 2 || in->len < 1)
+        return;
+    dsp_t mn = dsp_stats_min(in->buf, in->len);
+    dsp_t mx = dsp_stats_max(in->buf, in->len);
+    if(!(mn >= INT_MIN && mx < INT_MAX && mx - mn < DSP_BUFFER_HISTOGRAM_RANGE))
+        return;
+    job->bins = (unsigned short*)malloc(sizeof(unsigned short) * in->len);
+    if(job->bins == NULL)
+        return;
+    for(x = 0; x < in->len; x++) {
+        int value = (int)in->buf[x];
+        if(value != in->buf[x]) {
+            free(job->bins);
+            job->bins = NULL;
+            return;
         }
-        qsort(sorted, len, sizeof(dsp_t), compare);
-        stream->buf[x] = sorted[median*box->len/size];
+        job->bins[x] = (unsigned short)(value - (int)mn);
     }
+    job->offset = mn;
+    job->range = (int)(mx - mn) + 1;
+}
+
+/* Collects the samples of the window of the element at pos that are inside the stream. */
+static int dsp_buffer_window(dsp_stream_p in, dsp_stream_p box, int size, int* pos, int* mat, dsp_t* out)
+{
+    int y, dim, idx, count = 0;
+    memset(mat, 0, sizeof(int) * in->dims);
+    for(y = 0; y < box->len; y++, dsp_stream_next_position(box, mat)) {
+        idx = 0;
+        for(dim = in->dims - 1; dim >= 0; dim--) {
+            int w = pos[dim] + mat[dim] - size / 2;
+            if(w < 0 || w >= in->sizes[dim])
+                break;
+            idx = idx * in->sizes[dim] + w;
+        }
+        if(dim < 0)
+            out[count++] = in->buf[idx];
+    }
+    return count;
+}
+
+static void dsp_buffer_median_range(void* arg, int start, int end, int worker)
+{
+    (void)worker;
+    struct dsp_buffer_window_job *job = arg;
+    if(job->bins != NULL) {
+        dsp_buffer_histogram_rows(job, start, end, 0);
+        return;
+    }
+    dsp_stream_p in = job->in;
+    int size = job->size;
+    int x, d;
+    dsp_stream_p box = dsp_stream_new();
+    for(d = 0; d < in->dims; d++)
+        dsp_stream_add_dim(box, size);
+    dsp_t* sorted = (dsp_t*)malloc(sizeof(dsp_t) * box->len);
+    int* pos = (int*)malloc(sizeof(int) * in->dims * 2);
+    int* mat = pos + in->dims;
+    dsp_stream_fill_position(in, start, pos);
+    for(x = start; x < end; x++, dsp_stream_next_position(in, pos)) {
+        int n = dsp_buffer_window(in, box, size, pos, mat, sorted);
+        qsort(sorted, n, sizeof(dsp_t), compare);
+        job->out[x] = sorted[Max(0, Min(n - 1, job->median * n / size))];
+    }
+    free(pos);
     dsp_stream_free_buffer(box);
     dsp_stream_free(box);
     free(sorted);
-    return NULL;
 }
 
 void dsp_buffer_median(dsp_stream_p in, int size, int median)
 {
-    size_t y;
-    int d;
-    dsp_stream_p stream = dsp_stream_copy(in);
-    dsp_buffer_set(stream->buf, stream->len, 0);
-    stream->parent = in;
-    pthread_t *th = (pthread_t *)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       int size;
-       int median;
-       dsp_stream_p stream;
-       dsp_stream_p box;
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++)
-    {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].size = size;
-        thread_arguments[y].median = median;
-        thread_arguments[y].stream = stream;
-        thread_arguments[y].box = dsp_stream_new();
-        for(d = 0; d < stream->dims; d++)
-            dsp_stream_add_dim(thread_arguments[y].box, size);
-        dsp_stream_alloc_buffer(thread_arguments[y].box, thread_arguments[y].box->len);
-        pthread_create(&th[y], NULL, dsp_buffer_median_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
-    stream->parent = NULL;
-    dsp_buffer_copy(stream->buf, in->buf, stream->len);
-    dsp_stream_free_buffer(stream);
-    dsp_stream_free(stream);
-}
-
-static void* dsp_buffer_sigma_th(void* arg)
-{
-    struct {
-        int cur_th;
-        int size;
-        dsp_stream_p stream;
-        dsp_stream_p box;
-     } *arguments = arg;
-    dsp_stream_p stream = arguments->stream;
-    dsp_stream_p in = stream->parent;
-    dsp_stream_p box = arguments->box;
-    int cur_th = arguments->cur_th;
-    int size = arguments->size;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
-    int x, y, dim, idx;
-    dsp_t* sigma = (dsp_t*)malloc(pow(size, stream->dims) * sizeof(dsp_t));
-    int len = pow(size, in->dims);
-    for(x = start; x < end; x++) {
-        dsp_t* buf = sigma;
-        for(y = 0; y < box->len; y++) {
-            int *pos = dsp_stream_get_position(stream, x);
-            int *mat = dsp_stream_get_position(box, y);
-            for(dim = 0; dim < stream->dims; dim++) {
-                pos[dim] += mat[dim] - size / 2;
-            }
-            idx = dsp_stream_set_position(stream, pos);
-            if(idx >= 0 && idx < in->len) {
-                buf[y] = in->buf[idx];
-            }
-            free(pos);
-            free(mat);
-        }
-        stream->buf[x] = dsp_stats_stddev(buf, len);
+    if(size < 1)
+        return;
+    struct dsp_buffer_window_job job = { in, NULL, size, median, NULL, 0, 0 };
+    job.out = (dsp_t*)malloc(sizeof(dsp_t) * in->len);
+    if(job.out == NULL)
+        return;
+    dsp_buffer_histogram_bins(&job);
+    if(job.bins != NULL)
+        dsp_parallel_for(in->sizes[1], 0, dsp_buffer_median_range, &job);
+    else
+        dsp_parallel_for(in->len, 0, dsp_buffer_median_range, &job);
+    memcpy(in->buf, job.out, sizeof(dsp_t) * in->len);
+    free(job.out);
+    free(job.bins);
+}
+
+static void dsp_buffer_sigma_range(void* arg, int start, int end, int worker)
+{
+    (void)worker;
+    struct dsp_buffer_window_job *job = arg;
+    if(job->bins != NULL) {
+        dsp_buffer_histogram_rows(job, start, end, 1);
+        return;
+    }
+    dsp_stream_p in = job->in;
+    int size = job->size;
+    int x, d;
+    dsp_stream_p box = dsp_stream_new();
+    for(d = 0; d < in->dims; d++)
+        dsp_stream_add_dim(box, size);
+    dsp_t* sigma = (dsp_t*)malloc(sizeof(dsp_t) * box->len);
+    int* pos = (int*)malloc(sizeof(int) * in->dims * 2);
+    int* mat = pos + in->dims;
+    dsp_stream_fill_position(in, start, pos);
+    for(x = start; x < end; x++, dsp_stream_next_position(in, pos)) {
+        int n = dsp_buffer_window(in, box, size, pos, mat, sigma);
+        job->out[x] = dsp_stats_stddev(sigma, n);
     }
+    free(pos);
     dsp_stream_free_buffer(box);
     dsp_stream_free(box);
     free(sigma);
-    return NULL;
 }
 
 void dsp_buffer_sigma(dsp_stream_p in, int size)
 {
-    size_t y;
-    int d;
-    dsp_stream_p stream = dsp_stream_copy(in);
-    dsp_buffer_set(stream->buf, stream->len, 0);
-    stream->parent = in;
-    pthread_t *th = (pthread_t *)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       int size;
-       dsp_stream_p stream;
-       dsp_stream_p box;
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++)
-    {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].size = size;
-        thread_arguments[y].stream = stream;
-        thread_arguments[y].box = dsp_stream_new();
-        for(d = 0; d < stream->dims; d++)
-            dsp_stream_add_dim(thread_arguments[y].box, size);
-        pthread_create(&th[y], NULL, dsp_buffer_sigma_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
-    stream->parent = NULL;
-    dsp_buffer_copy(stream->buf, in->buf, stream->len);
-    dsp_stream_free_buffer(stream);
-    dsp_stream_free(stream);
+    if(size < 1)
+        return;
+    struct dsp_buffer_window_job job = { in, NULL, size, 0, NULL, 0, 0 };
+    job.out = (dsp_t*)malloc(sizeof(dsp_t) * in->len);
+    if(job.out == NULL)
+        return;
+    dsp_buffer_histogram_bins(&job);
+    if(job.bins != NULL)
+        dsp_parallel_for(in->sizes[1], 0, dsp_buffer_sigma_range, &job);
+    else
+        dsp_parallel_for(in->len, 0, dsp_buffer_sigma_range, &job);
+    memcpy(in->buf, job.out, sizeof(dsp_t) * in->len);
+    free(job.out);
+    free(job.bins);
 }
 
 void dsp_buffer_deviate(dsp_stream_p stream, dsp_t* deviation, dsp_t mindeviation, dsp_t maxdeviation)
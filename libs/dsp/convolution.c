@@ -18,44 +18,196 @@
 */
 
 #include "dsp.h"
+#include <float.h>
+
+/*
+ * Matrices up to DSP_CONVOLUTION_DIRECT_TAPS elements are applied directly, one tap at a time over
+ * whole rows so that the inner loop vectorizes. Two dimensional matrices that are the product of a
+ * column and a row are applied as two one dimensional passes when those have at most as many taps
+ * together. Larger matrices go through tiled transforms, see dsp_fourier_convolution.
+ */
+#define DSP_CONVOLUTION_DIRECT_TAPS 64
+
+struct dsp_convolution_job {
+    dsp_stream_p stream;
+    dsp_t *in;
+    dsp_t *out;
+    dsp_t *matrix;
+    /// Sizes of the matrix, 1 past its dimensions
+    int *sizes;
+    int len;
+};
+
+static void dsp_convolution_direct_range(void *arg, int start, int end, int worker)
+{
+    (void)worker;
+    struct dsp_convolution_job *job = arg;
+    dsp_stream_p stream = job->stream;
+    int dims = stream->dims;
+    int width = stream->sizes[0];
+    int size = job->sizes[0];
+    int rows = job->len / size;
+    int r, m, d, x, i;
+    int *pos = (int*)malloc(sizeof(int) * (size_t)dims * 2);
+    if(pos == NULL)
+        return;
+    int *in = pos + dims;
+    for(r = start; r < end; r++) {
+        int row = r;
+        for(d = 1; d < dims; d++) {
+            pos[d] = row % stream->sizes[d];
+            row /= stream->sizes[d];
+        }
+        dsp_t *out = job->out + (size_t)r * width;
+        for(m = 0; m < rows; m++) {
+            int inside = 1, k = m, offset = 0;
+            // Position read by the current row of the matrix
+            for(d = 1; d < dims; d++) {
+                in[d] = pos[d] + job->sizes[d] / 2 - k % job->sizes[d];
+                k /= job->sizes[d];
+                inside = inside && in[d] >= 0 && in[d] < stream->sizes[d];
+            }
+            if(!inside)
+                continue;
+            for(d = dims - 1; d > 0; d--)
+                offset = offset * stream->sizes[d] + in[d];
+            dsp_t *src = job->in + (size_t)offset * width;
+            dsp_t *taps = job->matrix + (size_t)m * size;
+            for(i = 0; i < size; i++) {
+                dsp_t w = taps[i];
+                int shift = size / 2 - i;
+                if(w == 0)
+                    continue;
+                int x0 = Max(0, -shift);
+                int x1 = Min(width, width - shift);
+                for(x = x0; x < x1; x++)
+                    out[x] += w * src[x + shift];
+            }
+        }
+    }
+    free(pos);
+}
+
+static void dsp_convolution_direct(dsp_stream_p stream, dsp_t *in, dsp_t *out, dsp_t *matrix, int *sizes)
+{
+    struct dsp_convolution_job job;
+    int d;
+    job.stream = stream;
+    job.in = in;
+    job.out = out;
+    job.matrix = matrix;
+    job.sizes = sizes;
+    job.len = 1;
+    for(d = 0; d < stream->dims; d++)
+        job.len *= sizes[d];
+    dsp_buffer_set(out, stream->len, 0);
+    dsp_parallel_for(stream->len / stream->sizes[0], 0, dsp_convolution_direct_range, &job);
+}
+
+/* Fills column and row with the factors of a two dimensional matrix, returns 0 if it has none. */
+static int dsp_convolution_separate(dsp_stream_p matrix, dsp_t *column, dsp_t *row)
+{
+    int w = matrix->sizes[0];
+    int h = matrix->sizes[1];
+    int x, y, px = 0, py = 0;
+    double pivot = 0;
+    double tolerance = 1000.0 * (sizeof(dsp_t) == sizeof(float) ? FLT_EPSILON : DBL_EPSILON);
+    for(y = 0; y < h; y++) {
+        for(x = 0; x < w; x++) {
+            if(fabs(matrix->buf[x + y * w]) > fabs(pivot)) {
+                pivot = matrix->buf[x + y * w];
+                px = x;
+                py = y;
+            }
+        }
+    }
+    if(pivot == 0)
+        return 0;
+    for(x = 0; x < w; x++)
+        row[x] = matrix->buf[x + py * w];
+    for(y = 0; y < h; y++)
+        column[y] = matrix->buf[px + y * w] / pivot;
+    for(y = 0; y < h; y++) {
+        for(x = 0; x < w; x++) {
+            if(fabs(matrix->buf[x + y * w] - (double)column[y] * row[x]) > tolerance * fabs(pivot))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+static void dsp_convolution_apply(dsp_stream_p stream, dsp_stream_p matrix)
+{
+    int d;
+    int dims = stream->dims;
+    if(matrix->dims > dims || matrix->len < 1 || stream->len < 1)
+        return;
+    if(matrix->len > DSP_CONVOLUTION_DIRECT_TAPS && (dims != 2 || matrix->dims != 2 ||
+            matrix->sizes[0] + matrix->sizes[1] > DSP_CONVOLUTION_DIRECT_TAPS)) {
+        dsp_fourier_convolution(stream, matrix);
+        return;
+    }
+    int *sizes = (int*)malloc(sizeof(int) * (size_t)dims);
+    dsp_t *out = (dsp_t*)malloc(sizeof(dsp_t) * (size_t)stream->len);
+    dsp_t *factors = NULL;
+    if(sizes == NULL || out == NULL)
+        goto done;
+    for(d = 0; d < dims; d++)
+        sizes[d] = d < matrix->dims ? matrix->sizes[d] : 1;
+    if(dims == 2 && matrix->dims == 2 && sizes[0] > 1 && sizes[1] > 1 &&
+            sizes[0] + sizes[1] <= DSP_CONVOLUTION_DIRECT_TAPS) {
+        factors = (dsp_t*)malloc(sizeof(dsp_t) * (size_t)(sizes[0] + sizes[1]));
+        if(factors != NULL && dsp_convolution_separate(matrix, factors + sizes[0], factors)) {
+            int h = sizes[1];
+            sizes[1] = 1;
+            dsp_convolution_direct(stream, stream->buf, out, factors, sizes);
+            sizes[0] = 1;
+            sizes[1] = h;
+            dsp_convolution_direct(stream, out, stream->buf, factors + matrix->sizes[0], sizes);
+            goto done;
+        }
+        if(matrix->len > DSP_CONVOLUTION_DIRECT_TAPS) {
+            dsp_fourier_convolution(stream, matrix);
+            goto done;
+        }
+    }
+    dsp_convolution_direct(stream, stream->buf, out, matrix->buf, sizes);
+    dsp_buffer_copy(out, stream->buf, stream->len);
+done:
+    free(factors);
+    free(out);
+    free(sizes);
+}
 
 void dsp_convolution_convolution(dsp_stream_p stream, dsp_stream_p matrix) {
-    int x, y, d;
     dsp_t mn = dsp_stats_min(stream->buf, stream->len);
     dsp_t mx = dsp_stats_max(stream->buf, stream->len);
-    int* d_pos = (int*)malloc(sizeof(int)*stream->dims);
-    for(y = 0; y < matrix->len; y++) {
-        int* pos = dsp_stream_get_position(matrix, y);
-        for(d = 0; d < stream->dims; d++) {
-            d_pos[d] = stream->sizes[d]/2+pos[d]-matrix->sizes[d]/2;
-        }
-        x = dsp_stream_set_position(stream, d_pos);
-        free(pos);
-        if(x >= 0 && x < stream->magnitude->len)
-            stream->magnitude->buf[x] *= sqrt(matrix->magnitude->buf[y]);
-    }
-    free(d_pos);
-    dsp_fourier_idft(stream);
+    dsp_convolution_apply(stream, matrix);
     dsp_buffer_stretch(stream->buf, stream->len, mn, mx);
 }
 
 void dsp_convolution_correlation(dsp_stream_p stream, dsp_stream_p matrix) {
-    int x, y, d;
+    int y, d;
     dsp_t mn = dsp_stats_min(stream->buf, stream->len);
     dsp_t mx = dsp_stats_max(stream->buf, stream->len);
-    int* d_pos = (int*)malloc(sizeof(int)*stream->dims);
-    dsp_buffer_shift(matrix->magnitude);
+    // Flipped matrix, even sizes get a leading zero to keep the same center
+    dsp_stream_p flipped = dsp_stream_new();
+    for(d = 0; d < matrix->dims; d++)
+        dsp_stream_add_dim(flipped, matrix->sizes[d] + 1 - matrix->sizes[d] % 2);
+    dsp_stream_alloc_buffer(flipped, flipped->len);
+    dsp_buffer_set(flipped->buf, flipped->len, 0);
     for(y = 0; y < matrix->len; y++) {
-        int* pos = dsp_stream_get_position(matrix, y);
-        for(d = 0; d < stream->dims; d++) {
-            d_pos[d] = stream->sizes[d]/2+pos[d]-matrix->sizes[d]/2;
+        int pos = y, offset = 0, stride = 1;
+        for(d = 0; d < matrix->dims; d++) {
+            int p = matrix->sizes[d] - 1 - pos % matrix->sizes[d] + 1 - matrix->sizes[d] % 2;
+            pos /= matrix->sizes[d];
+            offset += p * stride;
+            stride *= flipped->sizes[d];
         }
-        x = dsp_stream_set_position(stream, d_pos);
-        free(pos);
-        stream->magnitude->buf[x] *= sqrt(matrix->magnitude->buf[y]);
+        flipped->buf[offset] = matrix->buf[y];
     }
-    dsp_buffer_shift(matrix->magnitude);
-    free(d_pos);
-    dsp_fourier_idft(stream);
+    dsp_convolution_apply(stream, flipped);
+    dsp_stream_free_buffer(flipped);
+    dsp_stream_free(flipped);
     dsp_buffer_stretch(stream->buf, stream->len, mn, mx);
 }
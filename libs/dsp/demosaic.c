@@ -0,0 +1,368 @@
+/*
+*   DSP API - a digital signal processing library for astronomy usage
+*   Copyright © 2026  INDI Library contributors
+*
+*   This program is free software; you can redistribute it and/or
+*   modify it under the terms of the GNU Lesser General Public
+*   License as published by the Free Software Foundation; either
+*   version 3 of the License, or (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*   Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program; if not, write to the Free Software Foundation,
+*   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "dsp.h"
+
+/*
+ * Rows are converted to float lines with two mirrored pixels on each side. Mirroring keeps the color
+ * of the pixels, so the same kernels run up to the borders. Each band of rows keeps the five lines
+ * around the current row, every source row is converted once per band.
+ * The kernels write the components of a row in separate planes, the sample type only matters when
+ * loading lines and interleaving the planes in the output.
+ */
+#define DEMOSAIC_PAD 2
+#define DEMOSAIC_LINES 5
+/*
+ * Kernels run on blocks of pixels of constant length, which the compiler vectorizes without a scalar
+ * remainder: lines and planes are rounded up to whole blocks, the pixels past the width are not stored.
+ */
+#define DEMOSAIC_BLOCK 64
+// Fewer rows per thread are not worth starting a thread.
+#define DEMOSAIC_MIN_ROWS 64
+
+typedef void (*dsp_demosaic_load)(const void *src, int width, float *line);
+typedef void (*dsp_demosaic_store)(float *red, float *green, float *blue, int width, void *dst);
+
+struct dsp_demosaic_job
+{
+    const uint8_t *src;
+    size_t src_stride;
+    uint8_t *dst;
+    size_t dst_stride;
+    int width;
+    int height;
+    int red_x;
+    int red_y;
+    dsp_demosaic_method method;
+    dsp_demosaic_load load;
+    dsp_demosaic_store store;
+    int first;
+    int last;
+};
+
+static inline void dsp_demosaic_load_block_8(const uint8_t *restrict in, float *restrict line)
+{
+    int x;
+    for(x = 0; x < DEMOSAIC_BLOCK; x++)
+        line[x] = in[x];
+}
+
+static void dsp_demosaic_load_8(const void *src, int width, float *line)
+{
+    const uint8_t *in = (const uint8_t *)src;
+    int x;
+    for(x = 0; x + DEMOSAIC_BLOCK <= width; x += DEMOSAIC_BLOCK)
+        dsp_demosaic_load_block_8(in + x, line + x);
+    for(; x < width; x++)
+        line[x] = in[x];
+}
+
+static inline void dsp_demosaic_load_block_16(const uint16_t *restrict in, float *restrict line)
+{
+    int x;
+    for(x = 0; x < DEMOSAIC_BLOCK; x++)
+        line[x] = in[x];
+}
+
+static void dsp_demosaic_load_16(const void *src, int width, float *line)
+{
+    const uint16_t *in = (const uint16_t *)src;
+    int x;
+    for(x = 0; x + DEMOSAIC_BLOCK <= width; x += DEMOSAIC_BLOCK)
+        dsp_demosaic_load_block_16(in + x, line + x);
+    for(; x < width; x++)
+        line[x] = in[x];
+}
+
+static void dsp_demosaic_load_dsp(const void *src, int width, float *line)
+{
+    const dsp_t *in = (const dsp_t *)src;
+    int x;
+    for(x = 0; x < width; x++)
+        line[x] = (float)in[x];
+}
+
+/*
+ * Rounds and clamps the components before interleaving them, the planes are rounded up to whole
+ * blocks. Clamping a plane vectorizes, the interleaved stores do not.
+ */
+static inline void dsp_demosaic_clamp_block(float *restrict plane, float maximum)
+{
+    int x;
+    for(x = 0; x < DEMOSAIC_BLOCK; x++) {
+        float v = plane[x] + 0.5f;
+        v = v < 0.0f ? 0.0f : v;
+        plane[x] = v > maximum ? maximum : v;
+    }
+}
+
+static void dsp_demosaic_clamp(float *red, float *green, float *blue, int width, float maximum)
+{
+    int x;
+    for(x = 0; x < width; x += DEMOSAIC_BLOCK) {
+        dsp_demosaic_clamp_block(red + x, maximum);
+        dsp_demosaic_clamp_block(green + x, maximum);
+        dsp_demosaic_clamp_block(blue + x, maximum);
+    }
+}
+
+static void dsp_demosaic_store_8(float *red, float *green, float *blue, int width, void *dst)
+{
+    uint8_t *out = (uint8_t *)dst;
+    int x;
+    dsp_demosaic_clamp(red, green, blue, width, 255.0f);
+    for(x = 0; x < width; x++) {
+        out[3 * x] = (uint8_t)red[x];
+        out[3 * x + 1] = (uint8_t)green[x];
+        out[3 * x + 2] = (uint8_t)blue[x];
+    }
+}
+
+static void dsp_demosaic_store_16(float *red, float *green, float *blue, int width, void *dst)
+{
+    uint16_t *out = (uint16_t *)dst;
+    int x;
+    dsp_demosaic_clamp(red, green, blue, width, 65535.0f);
+    for(x = 0; x < width; x++) {
+        out[3 * x] = (uint16_t)red[x];
+        out[3 * x + 1] = (uint16_t)green[x];
+        out[3 * x + 2] = (uint16_t)blue[x];
+    }
+}
+
+static void dsp_demosaic_store_dsp(float *red, float *green, float *blue, int width, void *dst)
+{
+    dsp_t *out = (dsp_t *)dst;
+    int x;
+    for(x = 0; x < width; x++) {
+        out[3 * x] = (dsp_t)red[x];
+        out[3 * x + 1] = (dsp_t)green[x];
+        out[3 * x + 2] = (dsp_t)blue[x];
+    }
+}
+
+// Reflect an index around the borders, frames smaller than the kernel repeat their last pixel.
+static int dsp_demosaic_mirror(int i, int n)
+{
+    if(i < 0)
+        i = -i;
+    if(i >= n)
+        i = 2 * (n - 1) - i;
+    return i < 0 ? 0 : (i >= n ? n - 1 : i);
+}
+
+/*
+ * Own is the component of the colored pixels of the row, red or blue. The same component is found
+ * left and right of the green pixels, the other one above and below. Both interpolations are computed
+ * for every pixel and blended with the site mask, 1 on colored pixels and 0 on green ones: the blend is
+ * exact and, unlike a branch, it does not keep the loop from being vectorized.
+ */
+static inline void dsp_demosaic_block_bilinear(const float *restrict up, const float *restrict c,
+        const float *restrict down, const float *restrict site, float *restrict own, float *restrict green,
+        float *restrict other)
+{
+    int x;
+    for(x = 0; x < DEMOSAIC_BLOCK; x++) {
+        float horizontal = c[x - 1] + c[x + 1];
+        float vertical = up[x] + down[x];
+        float diagonal = up[x - 1] + up[x + 1] + down[x - 1] + down[x + 1];
+        float s = site[x], g = 1.0f - site[x];
+        own[x] = s * c[x] + g * (0.5f * horizontal);
+        green[x] = s * (0.25f * (horizontal + vertical)) + g * c[x];
+        other[x] = s * (0.25f * diagonal) + g * (0.5f * vertical);
+    }
+}
+
+/*
+ * Gradient corrected interpolation of Malvar, He and Cutler: the bilinear estimate is corrected by the
+ * Laplacian of the known component, which follows edges without a direction search.
+ */
+static inline void dsp_demosaic_block_mhc(const float *restrict up2, const float *restrict up,
+        const float *restrict c, const float *restrict down, const float *restrict down2, const float *restrict site,
+        float *restrict own, float *restrict green, float *restrict other)
+{
+    int x;
+    for(x = 0; x < DEMOSAIC_BLOCK; x++) {
+        float horizontal = c[x - 1] + c[x + 1];
+        float vertical = up[x] + down[x];
+        float horizontal_far = c[x - 2] + c[x + 2];
+        float vertical_far = up2[x] + down2[x];
+        float diagonal = up[x - 1] + up[x + 1] + down[x - 1] + down[x + 1];
+        float far = horizontal_far + vertical_far;
+        float base = 5.0f * c[x] - diagonal;
+        float s = site[x], g = 1.0f - site[x];
+        own[x] = s * c[x] + g * (0.125f * (base + 4.0f * horizontal - horizontal_far + 0.5f * vertical_far));
+        green[x] = s * (0.125f * (4.0f * c[x] + 2.0f * (horizontal + vertical) - far)) + g * c[x];
+        other[x] = s * (0.125f * (6.0f * c[x] + 2.0f * diagonal - 1.5f * far)) +
+                   g * (0.125f * (base + 4.0f * vertical - vertical_far + 0.5f * horizontal_far));
+    }
+}
+
+static void dsp_demosaic_row_bilinear(const float **row, int width, const float *site, float *own, float *green,
+                                      float *other)
+{
+    int x;
+    for(x = 0; x < width; x += DEMOSAIC_BLOCK)
+        dsp_demosaic_block_bilinear(row[1] + x, row[2] + x, row[3] + x, site, own + x, green + x, other + x);
+}
+
+static void dsp_demosaic_row_mhc(const float **row, int width, const float *site, float *own, float *green,
+                                 float *other)
+{
+    int x;
+    for(x = 0; x < width; x += DEMOSAIC_BLOCK)
+        dsp_demosaic_block_mhc(row[0] + x, row[1] + x, row[2] + x, row[3] + x, row[4] + x, site, own + x, green + x,
+                               other + x);
+}
+
+static void *dsp_demosaic_th(void *arg)
+{
+    struct dsp_demosaic_job *job = (struct dsp_demosaic_job *)arg;
+    const int width = job->width;
+    const int blocks_width = (width + DEMOSAIC_BLOCK - 1) / DEMOSAIC_BLOCK * DEMOSAIC_BLOCK;
+    const int line_size = blocks_width + 2 * DEMOSAIC_PAD;
+    // Lines are zeroed, the pixels past the mirrored ones are computed but never stored.
+    float *lines = (float*)calloc((size_t)(line_size * DEMOSAIC_LINES + 3 * blocks_width + 2 * DEMOSAIC_BLOCK),
+                                  sizeof(float));
+    // Output components of the row: red, green and blue.
+    float *planes[3];
+    // Site masks of rows with the colored pixels in even and odd columns.
+    float *sites[2];
+    int cached[DEMOSAIC_LINES];
+    const float *row[DEMOSAIC_LINES];
+    int y, k;
+
+    if(lines == NULL)
+        return NULL;
+    for(k = 0; k < 3; k++)
+        planes[k] = lines + line_size * DEMOSAIC_LINES + k * blocks_width;
+    for(k = 0; k < 2; k++) {
+        int x;
+        sites[k] = lines + line_size * DEMOSAIC_LINES + 3 * blocks_width + k * DEMOSAIC_BLOCK;
+        for(x = 0; x < DEMOSAIC_BLOCK; x++)
+            sites[k][x] = ((x ^ k) & 1) == 0 ? 1.0f : 0.0f;
+    }
+    for(k = 0; k < DEMOSAIC_LINES; k++)
+        cached[k] = -1;
+
+    for(y = job->first; y < job->last; y++) {
+        // The mirrored rows around y are at most five consecutive rows, they never share a slot.
+        for(k = 0; k < DEMOSAIC_LINES; k++) {
+            int r = dsp_demosaic_mirror(y + k - DEMOSAIC_PAD, job->height);
+            int slot = r % DEMOSAIC_LINES;
+            float *line = lines + slot * line_size + DEMOSAIC_PAD;
+            if(cached[slot] != r) {
+                int p;
+                job->load(job->src + (size_t)r * job->src_stride, width, line);
+                for(p = 1; p <= DEMOSAIC_PAD; p++) {
+                    line[-p] = line[dsp_demosaic_mirror(-p, width)];
+                    line[width - 1 + p] = line[dsp_demosaic_mirror(width - 1 + p, width)];
+                }
+                cached[slot] = r;
+            }
+            row[k] = line;
+        }
+
+        int red_row = ((y ^ job->red_y) & 1) == 0;
+        int own = red_row ? 0 : 2;
+        const float *site = sites[red_row ? job->red_x : (job->red_x ^ 1)];
+        if(job->method == DSP_DEMOSAIC_MHC)
+            dsp_demosaic_row_mhc(row, width, site, planes[own], planes[1], planes[2 - own]);
+        else
+            dsp_demosaic_row_bilinear(row, width, site, planes[own], planes[1], planes[2 - own]);
+        job->store(planes[0], planes[1], planes[2], width, job->dst + (size_t)y * job->dst_stride);
+    }
+    free(lines);
+    return NULL;
+}
+
+static void dsp_demosaic_range(void *arg, int start, int end, int worker)
+{
+    (void)worker;
+    struct dsp_demosaic_job *bands = (struct dsp_demosaic_job *)arg;
+    int y;
+    for(y = start; y < end; y++)
+        dsp_demosaic_th(&bands[y]);
+}
+
+static void dsp_demosaic_run(const void *src, size_t src_stride, void *dst, size_t dst_stride, int width, int height,
+                             dsp_bayer_pattern pattern, dsp_demosaic_method method, int threads,
+                             dsp_demosaic_load load, dsp_demosaic_store store)
+{
+    if(src == NULL || dst == NULL || width < 1 || height < 1)
+        return;
+
+    if(threads < 1)
+        threads = (int)dsp_max_threads(0);
+    if(threads > height / DEMOSAIC_MIN_ROWS)
+        threads = height / DEMOSAIC_MIN_ROWS;
+    if(threads < 1)
+        threads = 1;
+
+    struct dsp_demosaic_job job;
+    job.src = (const uint8_t *)src;
+    job.src_stride = src_stride;
+    job.dst = (uint8_t *)dst;
+    job.dst_stride = dst_stride;
+    job.width = width;
+    job.height = height;
+    job.red_x = pattern & 1;
+    job.red_y = (pattern >> 1) & 1;
+    job.method = method;
+    job.load = load;
+    job.store = store;
+    job.first = 0;
+    job.last = height;
+
+    if(threads == 1) {
+        dsp_demosaic_th(&job);
+        return;
+    }
+
+    int y;
+    struct dsp_demosaic_job *bands = (struct dsp_demosaic_job *)malloc(sizeof(struct dsp_demosaic_job)*(size_t)threads);
+    for(y = 0; y < threads; y++) {
+        bands[y] = job;
+        bands[y].first = y * height / threads;
+        bands[y].last = (y + 1) * height / threads;
+    }
+    dsp_parallel_for(threads, 1, dsp_demosaic_range, bands);
+    free(bands);
+}
+
+void dsp_demosaic_8(const uint8_t *src, int src_stride, uint8_t *dst, int dst_stride, int width, int height,
+                    dsp_bayer_pattern pattern, dsp_demosaic_method method, int threads)
+{
+    dsp_demosaic_run(src, (size_t)src_stride, dst, (size_t)dst_stride, width, height, pattern, method, threads,
+                     dsp_demosaic_load_8, dsp_demosaic_store_8);
+}
+
+void dsp_demosaic_16(const uint16_t *src, int src_stride, uint16_t *dst, int dst_stride, int width, int height,
+                     dsp_bayer_pattern pattern, dsp_demosaic_method method, int threads)
+{
+    dsp_demosaic_run(src, sizeof(uint16_t)*(size_t)src_stride, dst, sizeof(uint16_t)*(size_t)dst_stride, width, height,
+                     pattern, method, threads, dsp_demosaic_load_16, dsp_demosaic_store_16);
+}
+
+void dsp_demosaic(const dsp_t *src, dsp_t *dst, int width, int height, dsp_bayer_pattern pattern,
+                  dsp_demosaic_method method, int threads)
+{
+    dsp_demosaic_run(src, sizeof(dsp_t)*(size_t)width, dst, sizeof(dsp_t)*(size_t)width*3, width, height, pattern,
+                     method, threads, dsp_demosaic_load_dsp, dsp_demosaic_store_dsp);
+}
@@ -23,6 +23,8 @@
 extern "C" {
 #endif
 
+#include "dspconfig.h"
+
 #ifndef DLL_EXPORT
 #ifdef _WIN32
 #define DLL_EXPORT __declspec(dllexport)
@@ -40,6 +42,7 @@ extern "C" {
 #endif
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <math.h>
 #include <float.h>
@@ -73,7 +76,11 @@ extern "C" {
 */
 /**\{*/
 #define DSP_MAX_STARS 200
+#ifdef DSP_SINGLE_PRECISION
+typedef float dsp_t;
+#else
 typedef double dsp_t;
+#endif
 typedef double complex_t[2];
 #define dsp_t_max 255
 #define dsp_t_min -dsp_t_max
@@ -86,6 +93,24 @@ typedef double complex_t[2];
 */
 DLL_EXPORT unsigned long int dsp_max_threads(unsigned long value);
 
+/**
+* \brief Work on a range of items of a parallel job
+* \param arg the argument passed to dsp_parallel_for
+* \param start the first item of the range
+* \param end the item after the last one of the range
+* \param worker index of the thread running the range, below dsp_max_threads
+*/
+typedef void (*dsp_parallel_func)(void *arg, int start, int end, int worker);
+
+/**
+* \brief Split items among the shared pool of dsp_max_threads threads and wait until all are done
+* \param count the number of items
+* \param chunk 0 cuts the items in one range per thread, a positive value hands out ranges of chunk items to idle threads
+* \param func the function called for each range
+* \param arg argument passed to func
+*/
+DLL_EXPORT void dsp_parallel_for(int count, int chunk, dsp_parallel_func func, void *arg);
+
 #ifndef DSP_DEBUG
 #define DSP_DEBUG
 /**
@@ -210,6 +235,10 @@ dsp_print(x, str); \
 ///No matches were found during comparison
 #define DSP_ALIGN_NO_MATCH 8
 #endif
+#ifndef DSP_STATS_LANES
+///Partial results kept by the minimum and maximum scans, a multiple of the widest vector register
+#define DSP_STATS_LANES 16
+#endif
 /**\}*/
 /**
  * \defgroup DSP_Types DSP API types
@@ -256,6 +285,8 @@ typedef struct dsp_star_t
     double theta;
     /// The name of the star
     char name[DSP_NAME_SIZE];
+    /// The half flux radius of the star
+    double hfr;
 } dsp_star;
 
 /**
@@ -443,6 +474,34 @@ typedef struct dsp_stream_t
     int frame_number;
 } dsp_stream, *dsp_stream_p;
 
+/**
+* \brief Position of the red pixel in the 2x2 cell of a color filter array
+*
+* The value is the column of the red pixel plus twice its row, the order of the INDI Bayer pixel formats.
+*/
+typedef enum
+{
+    /// RG/GB
+    DSP_BAYER_RGGB = 0,
+    /// GR/BG
+    DSP_BAYER_GRBG = 1,
+    /// GB/RG
+    DSP_BAYER_GBRG = 2,
+    /// BG/GR
+    DSP_BAYER_BGGR = 3,
+} dsp_bayer_pattern;
+
+/**
+* \brief Interpolation of the missing color components
+*/
+typedef enum
+{
+    /// Average of the nearest pixels of each color
+    DSP_DEMOSAIC_BILINEAR = 0,
+    /// Bilinear corrected by the gradient of the known color (Malvar-He-Cutler), sharper along edges
+    DSP_DEMOSAIC_MHC = 1,
+} dsp_demosaic_method;
+
 /**\}*/
 /**
  * \defgroup dsp_FourierTransform DSP API Fourier transform related functions
@@ -462,6 +521,15 @@ DLL_EXPORT void dsp_fourier_dft(dsp_stream_p stream, int exp);
 */
 DLL_EXPORT void dsp_fourier_idft(dsp_stream_p stream);
 
+/**
+* \brief Convolve a dsp_stream with a matrix through tiled Fourier transforms
+* The output keeps the sizes of the stream, the matrix is centered at the half of its sizes and the
+* stream is padded with zeros. The matrix can have less dimensions than the stream.
+* \param stream the inout stream.
+* \param matrix the convolution matrix stream.
+*/
+DLL_EXPORT void dsp_fourier_convolution(dsp_stream_p stream, dsp_stream_p matrix);
+
 /**
 * \brief Fill the magnitude and phase buffers with the current data in stream->dft
 * \param stream the inout stream.
@@ -482,7 +550,7 @@ DLL_EXPORT void dsp_fourier_2complex_t(dsp_stream_p stream);
 * \param len the input arrays length.
 * \return the array filled with the complex numbers
 */
-DLL_EXPORT void dsp_fourier_phase_mag_array_get_complex(double* mag, double* phi, complex_t *out, int len);
+DLL_EXPORT void dsp_fourier_phase_mag_array_get_complex(dsp_t* mag, dsp_t* phi, complex_t *out, int len);
 
 /**
 * \brief Obtain a complex number's array magnitudes
@@ -490,7 +558,7 @@ DLL_EXPORT void dsp_fourier_phase_mag_array_get_complex(double* mag, double* phi
 * \param len the input array length.
 * \return the array filled with the magnitudes
 */
-DLL_EXPORT double* dsp_fourier_complex_array_get_magnitude(dsp_complex in, int len);
+DLL_EXPORT dsp_t* dsp_fourier_complex_array_get_magnitude(dsp_complex in, int len);
 
 /**
 * \brief Obtain a complex number's array phases
@@ -498,7 +566,38 @@ DLL_EXPORT double* dsp_fourier_complex_array_get_magnitude(dsp_complex in, int l
 * \param len the input array length.
 * \return the array filled with the phases
 */
-DLL_EXPORT double* dsp_fourier_complex_array_get_phase(dsp_complex in, int len);
+DLL_EXPORT dsp_t* dsp_fourier_complex_array_get_phase(dsp_complex in, int len);
+
+/**
+* \brief Set the number of threads of each transform, plans made afterwards use them
+* \param threads the number of threads, 0 uses dsp_max_threads. Ignored when FFTW was built without threads
+*/
+DLL_EXPORT void dsp_fourier_set_threads(int threads);
+
+/**
+* \brief Load FFTW wisdom from a file, then measure new plans and save the wisdom there after each one
+* \param filename the wisdom file, NULL stops measuring and saving wisdom. Without wisdom in the file,
+* made by fftw-wisdom or by a previous run, plans are estimated and nothing is saved
+* \return 1 if wisdom was imported from the file, 0 otherwise
+*/
+DLL_EXPORT int dsp_fourier_set_wisdom_file(const char *filename);
+
+/**
+* \brief Destroy the cached plans that are not in use
+*/
+DLL_EXPORT void dsp_fourier_clear_plans();
+
+/**
+* \brief Lock the FFTW planner of the process
+* The FFTW planner is not thread safe: plans made outside of this library must be created and destroyed
+* while holding this lock. Executing a plan does not need it.
+*/
+DLL_EXPORT void dsp_fourier_planner_lock();
+
+/**
+* \brief Unlock the FFTW planner of the process
+*/
+DLL_EXPORT void dsp_fourier_planner_unlock();
 
 /**\}*/
 /**
@@ -550,14 +649,18 @@ DLL_EXPORT void dsp_filter_bandreject(dsp_stream_p stream, double LowFrequency,
 /**\{*/
 /**
 * \brief A cross-convolution processor
-* \param stream the input stream.
+* The matrix is centered at the half of its sizes, the result is stretched to the range of the input.
+* Small matrices are applied directly, or as a row and a column when separable, larger ones through
+* tiled Fourier transforms.
+* \param stream the inout stream.
 * \param matrix the convolution matrix stream.
 */
 DLL_EXPORT void dsp_convolution_convolution(dsp_stream_p stream, dsp_stream_p matrix);
 
 /**
 * \brief A cross-correlation processor
-* \param stream the input stream.
+* Convolves the stream with the flipped matrix, see dsp_convolution_convolution.
+* \param stream the inout stream.
 * \param matrix the correlation matrix stream.
 */
 DLL_EXPORT void dsp_convolution_correlation(dsp_stream_p stream, dsp_stream_p matrix);
@@ -571,18 +674,26 @@ DLL_EXPORT void dsp_convolution_correlation(dsp_stream_p stream, dsp_stream_p ma
 #ifndef dsp_stats_min
 /**
 * \brief Gets the minimum value of the input stream
+* The buffer is scanned in blocks of DSP_STATS_LANES elements, so that the compiler can vectorize the comparisons
 * \param buf the input buffer
 * \param len the length in elements of the buffer.
 * \return the minimum value.
 */
 #define dsp_stats_min(buf, len)\
 ({\
-    int i;\
-    __typeof(buf[0]) min = (__typeof(buf[0]))buf[0];\
-    for(i = 0; i < len; i++) {\
-        min = Min(buf[i], min);\
+    int __i, __j;\
+    __typeof(buf[0]) __min[DSP_STATS_LANES];\
+    for(__j = 0; __j < DSP_STATS_LANES; __j++)\
+        __min[__j] = (__typeof(buf[0]))buf[0];\
+    for(__i = 0; __i + DSP_STATS_LANES <= (len); __i += DSP_STATS_LANES) {\
+        for(__j = 0; __j < DSP_STATS_LANES; __j++)\
+            __min[__j] = Min(buf[__i + __j], __min[__j]);\
     }\
-    min;\
+    for(; __i < (len); __i++)\
+        __min[0] = Min(buf[__i], __min[0]);\
+    for(__j = 1; __j < DSP_STATS_LANES; __j++)\
+        __min[0] = Min(__min[__j], __min[0]);\
+    __min[0];\
     })
 #endif
 
@@ -595,12 +706,19 @@ DLL_EXPORT void dsp_convolution_correlation(dsp_stream_p stream, dsp_stream_p ma
 */
 #define dsp_stats_max(buf, len)\
 ({\
-    int i;\
-    __typeof(buf[0]) max = (__typeof(buf[0]))buf[0];\
-    for(i = 0; i < len; i++) {\
-        max = Max(buf[i], max);\
+    int __i, __j;\
+    __typeof(buf[0]) __max[DSP_STATS_LANES];\
+    for(__j = 0; __j < DSP_STATS_LANES; __j++)\
+        __max[__j] = (__typeof(buf[0]))buf[0];\
+    for(__i = 0; __i + DSP_STATS_LANES <= (len); __i += DSP_STATS_LANES) {\
+        for(__j = 0; __j < DSP_STATS_LANES; __j++)\
+            __max[__j] = Max(buf[__i + __j], __max[__j]);\
     }\
-    max;\
+    for(; __i < (len); __i++)\
+        __max[0] = Max(buf[__i], __max[0]);\
+    for(__j = 1; __j < DSP_STATS_LANES; __j++)\
+        __max[0] = Max(__max[__j], __max[0]);\
+    __max[0];\
     })
 #endif
 
@@ -779,6 +897,15 @@ DLL_EXPORT void dsp_convolution_correlation(dsp_stream_p stream, dsp_stream_p ma
 */
 DLL_EXPORT double* dsp_stats_histogram(dsp_stream_p stream, int size);
 
+/**
+* \brief Tiled background estimation of a bidimensional stream
+* \param stream the input stream.
+* \param tile_size the side length of the square tiles.
+* \param background array of ceil(width/tile_size)*ceil(height/tile_size) elements receiving the median of each tile.
+* \param noise array of the same size receiving the noise (MAD based standard deviation) of each tile.
+*/
+DLL_EXPORT void dsp_stats_background(dsp_stream_p stream, int tile_size, dsp_t *background, dsp_t *noise);
+
 /**\}*/
 /**
  * \defgroup dsp_Buffers DSP API Buffer editing functions
@@ -976,6 +1103,8 @@ DLL_EXPORT void dsp_buffer_log1(dsp_stream_p stream, double val);
 
 /**
 * \brief Median elements of the input stream
+* Windows are clipped to the stream. 2D streams of integer samples spanning less than 65536 values
+* are filtered with a sliding histogram, whose cost does not depend on the number of samples of the window.
 * \param stream the stream on which execute
 * \param size the length of the median.
 * \param median the location of the median value.
@@ -984,6 +1113,8 @@ DLL_EXPORT void dsp_buffer_median(dsp_stream_p stream, int size, int median);
 
 /**
 * \brief Standard deviation of each element of the input stream within the given size
+* The deviation is the one of dsp_stats_stddev, over windows clipped to the stream. 2D streams of integer
+* samples spanning less than 65536 values are filtered with a sliding histogram.
 * \param stream the stream on which execute
 * \param size the reference size.
 */
@@ -1252,6 +1383,24 @@ DLL_EXPORT int dsp_stream_set_position(dsp_stream_p stream, int *pos);
 */
 DLL_EXPORT int* dsp_stream_get_position(dsp_stream_p stream, int index);
 
+/**
+* \brief Write the multidimensional positional indexes of a linear index of a DSP stream, without allocating them
+* \param stream the target DSP stream.
+* \param index the position of the index on a single dimension.
+* \param pos the position on each dimension, an array of stream->dims elements.
+* \sa dsp_stream_get_position
+* \sa dsp_stream_next_position
+*/
+DLL_EXPORT void dsp_stream_fill_position(dsp_stream_p stream, int index, int *pos);
+
+/**
+* \brief Move multidimensional positional indexes to the next linear index of a DSP stream
+* \param stream the target DSP stream.
+* \param pos the position on each dimension, updated in place. The last position wraps to the first one.
+* \sa dsp_stream_fill_position
+*/
+DLL_EXPORT void dsp_stream_next_position(dsp_stream_p stream, int *pos);
+
 /**
 * \brief Execute the function callback pointed by the func field of the passed stream
 * \param stream the target DSP stream.
@@ -1384,6 +1533,47 @@ DLL_EXPORT void dsp_modulation_amplitude(dsp_stream_p stream, double samplefreq,
 */
 void dsp_recons_align(dsp_stream_p stream, dsp_stream_p matrix);
 
+/**\}*/
+/**
+ * \defgroup dsp_Demosaic DSP API Color filter array interpolation
+*/
+/**\{*/
+
+/**
+* \brief Interpolate an 8 bit Bayer frame into interleaved RGB
+* \param src the raw frame
+* \param src_stride pixels from the start of a row of the raw frame to the next one
+* \param dst the RGB output, three samples per pixel
+* \param dst_stride samples from the start of an output row to the next one
+* \param width the frame width
+* \param height the frame height
+* \param pattern the color filter array of the frame
+* \param method the interpolation
+* \param threads number of bands of rows run on the shared thread pool, 0 uses dsp_max_threads
+*/
+DLL_EXPORT void dsp_demosaic_8(const uint8_t *src, int src_stride, uint8_t *dst, int dst_stride, int width, int height,
+                               dsp_bayer_pattern pattern, dsp_demosaic_method method, int threads);
+
+/**
+* \brief Interpolate a 16 bit Bayer frame into interleaved RGB
+* \sa dsp_demosaic_8
+*/
+DLL_EXPORT void dsp_demosaic_16(const uint16_t *src, int src_stride, uint16_t *dst, int dst_stride, int width, int height,
+                                dsp_bayer_pattern pattern, dsp_demosaic_method method, int threads);
+
+/**
+* \brief Interpolate a Bayer dsp_t array into interleaved RGB, values are not clamped
+* \param src the input buffer
+* \param dst the output buffer of width * height * 3 elements
+* \param width the picture width
+* \param height the picture height
+* \param pattern the color filter array of the picture
+* \param method the interpolation
+* \param threads number of bands of rows run on the shared thread pool, 0 uses dsp_max_threads
+*/
+DLL_EXPORT void dsp_demosaic(const dsp_t *src, dsp_t *dst, int width, int height, dsp_bayer_pattern pattern,
+                             dsp_demosaic_method method, int threads);
+
 /**\}*/
 /**
  * \defgroup dsp_FileManagement DSP API File read/write functions
@@ -1574,6 +1764,18 @@ DLL_EXPORT void dsp_align_free_triangle(dsp_triangle *triangle);
 */
 DLL_EXPORT int dsp_align_get_offset(dsp_stream_p ref, dsp_stream_p to_align, double tolerance, double target_score, int num_stars);
 
+/**
+* \brief Detect stars into a bidimensional stream and fill its stars array
+* \param stream the input stream, existing stars are removed.
+* \param tile_size the side length of the tiles used to estimate the background.
+* \param threshold the detection threshold in units of background noise.
+* \param max_stars the maximum number of stars to keep, brightest first.
+* \return The number of stars detected
+* \note The center of each star is its flux weighted centroid, diameter is the FWHM, estimated from the area above half of
+* the peak, and hfr is the radius around the centroid enclosing half of the flux, in pixels.
+*/
+DLL_EXPORT int dsp_align_find_stars(dsp_stream_p stream, int tile_size, double threshold, int max_stars);
+
 /**\}*/
 /// \defgroup dsp_FitsExtensions
 #include <fits_extensions.h>
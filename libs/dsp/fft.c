@@ -20,6 +20,255 @@
 #include "dsp.h"
 #include <fftw3.h>
 
+/*
+ * Plans are cached by direction and sizes. Each plan owns aligned real and complex buffers allocated
+ * by FFTW: a transform copies its input in, executes and copies its output out, so a plan is made
+ * once per size and always runs on the arrays it was made for. A plan in use is marked busy, a
+ * concurrent transform of the same size makes another one. The FFTW planner is not thread safe, plans
+ * are made and destroyed under a lock, the same one other code of the process takes to make its own plans.
+ * Plans are estimated unless wisdom was imported from a file, measuring holds the lock for up to the
+ * time limit. Then new plans are measured and the wisdom is saved after each one so that later runs
+ * make the same plans at once: it is exported to memory under the lock and written to the file once
+ * the lock is released.
+ */
+#define DSP_FOURIER_PLANS 16
+#define DSP_FOURIER_MEASURE_SECONDS 1.0
+
+// Transforms run in the precision of dsp_t, the spectrum is stored in double precision.
+#ifdef DSP_SINGLE_PRECISION
+#define DSP_FFTW(name) fftwf_##name
+#else
+#define DSP_FFTW(name) fftw_##name
+#endif
+
+struct dsp_fourier_plan
+{
+    DSP_FFTW(plan) plan;
+    int forward;
+    int dims;
+    int *sizes;
+    int busy;
+    unsigned long last_use;
+    dsp_t *real;
+    DSP_FFTW(complex) *complex;
+    int len;
+    int complex_len;
+};
+
+static struct dsp_fourier_plan dsp_fourier_plans[DSP_FOURIER_PLANS];
+static pthread_mutex_t dsp_fourier_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long dsp_fourier_clock = 0;
+#ifdef HAVE_FFTW3_THREADS
+static int dsp_fourier_threads = 1;
+#endif
+static char dsp_fourier_wisdom[DSP_NAME_SIZE * 4] = "";
+static int dsp_fourier_measure = 0;
+static int dsp_fourier_wisdom_changed = 0;
+static unsigned long dsp_fourier_wisdom_exported = 0;
+static unsigned long dsp_fourier_wisdom_written = 0;
+static pthread_mutex_t dsp_fourier_wisdom_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void dsp_fourier_plan_destroy(struct dsp_fourier_plan *p)
+{
+    if(p->plan != NULL)
+        DSP_FFTW(destroy_plan)(p->plan);
+    DSP_FFTW(free)(p->real);
+    DSP_FFTW(free)(p->complex);
+    free(p->sizes);
+    memset(p, 0, sizeof(struct dsp_fourier_plan));
+}
+
+// Called with the lock held. Sizes are in FFTW order, the last one varying fastest.
+static int dsp_fourier_plan_create(struct dsp_fourier_plan *p, int forward, int dims, int *sizes)
+{
+    int d;
+    p->forward = forward;
+    p->dims = dims;
+    p->sizes = (int*)malloc(sizeof(int) * (size_t)dims);
+    memcpy(p->sizes, sizes, sizeof(int) * (size_t)dims);
+    p->len = 1;
+    for(d = 0; d < dims; d++)
+        p->len *= sizes[d];
+    // The real to complex transform keeps the non redundant half of the last dimension.
+    p->complex_len = p->len / sizes[dims - 1] * (sizes[dims - 1] / 2 + 1);
+    p->real = (dsp_t*)DSP_FFTW(malloc)(sizeof(dsp_t) * (size_t)p->len);
+    p->complex = (DSP_FFTW(complex)*)DSP_FFTW(malloc)(sizeof(DSP_FFTW(complex)) * (size_t)p->complex_len);
+    if(p->sizes == NULL || p->real == NULL || p->complex == NULL) {
+        dsp_fourier_plan_destroy(p);
+        return -1;
+    }
+    unsigned flags = dsp_fourier_measure ? FFTW_MEASURE : FFTW_ESTIMATE;
+#ifdef HAVE_FFTW3_THREADS
+    DSP_FFTW(plan_with_nthreads)(dsp_fourier_threads);
+#endif
+    DSP_FFTW(set_timelimit)(DSP_FOURIER_MEASURE_SECONDS);
+    if(forward)
+        p->plan = DSP_FFTW(plan_dft_r2c)(dims, sizes, p->real, p->complex, flags);
+    else
+        p->plan = DSP_FFTW(plan_dft_c2r)(dims, sizes, p->complex, p->real, flags);
+    if(p->plan == NULL) {
+        dsp_fourier_plan_destroy(p);
+        return -1;
+    }
+    if(dsp_fourier_measure)
+        dsp_fourier_wisdom_changed = 1;
+    return 0;
+}
+
+/*
+ * Called with the lock held after new plans: returns the wisdom exported to a string, with the file
+ * name and the order of the export, or NULL when there is nothing to save.
+ */
+static char *dsp_fourier_wisdom_export(char *filename, unsigned long *order)
+{
+    char *wisdom = NULL;
+    if(dsp_fourier_wisdom_changed && dsp_fourier_measure) {
+        wisdom = DSP_FFTW(export_wisdom_to_string)();
+        snprintf(filename, sizeof(dsp_fourier_wisdom), "%s", dsp_fourier_wisdom);
+        *order = ++dsp_fourier_wisdom_exported;
+    }
+    dsp_fourier_wisdom_changed = 0;
+    return wisdom;
+}
+
+// Called without the lock, a wisdom exported before the one already written is dropped.
+static void dsp_fourier_wisdom_write(char *wisdom, const char *filename, unsigned long order)
+{
+    pthread_mutex_lock(&dsp_fourier_wisdom_mutex);
+    if(order > dsp_fourier_wisdom_written) {
+        FILE *f = fopen(filename, "w");
+        if(f != NULL) {
+            fputs(wisdom, f);
+            fclose(f);
+        }
+        dsp_fourier_wisdom_written = order;
+    }
+    pthread_mutex_unlock(&dsp_fourier_wisdom_mutex);
+    free(wisdom);
+}
+
+/*
+ * Returns an idle plan for the transform, making one if needed. The least recently used idle plan
+ * is replaced when the cache is full; if all plans are busy, a plan outside of the cache is returned
+ * and destroyed on release.
+ */
+static struct dsp_fourier_plan *dsp_fourier_plan_acquire(int forward, int dims, int *sizes)
+{
+    struct dsp_fourier_plan *p = NULL;
+    char filename[sizeof(dsp_fourier_wisdom)];
+    unsigned long order = 0;
+    char *wisdom;
+    int i;
+    pthread_mutex_lock(&dsp_fourier_mutex);
+    for(i = 0; i < DSP_FOURIER_PLANS; i++) {
+        struct dsp_fourier_plan *c = &dsp_fourier_plans[i];
+        if(c->plan == NULL || c->busy || c->forward != forward || c->dims != dims)
+            continue;
+        if(!memcmp(c->sizes, sizes, sizeof(int) * (size_t)dims)) {
+            p = c;
+            break;
+        }
+    }
+    if(p == NULL) {
+        for(i = 0; i < DSP_FOURIER_PLANS; i++) {
+            struct dsp_fourier_plan *c = &dsp_fourier_plans[i];
+            if(c->busy)
+                continue;
+            if(p == NULL || c->plan == NULL || (p->plan != NULL && c->last_use < p->last_use))
+                p = c;
+            if(p->plan == NULL)
+                break;
+        }
+        if(p == NULL)
+            p = (struct dsp_fourier_plan*)calloc(1, sizeof(struct dsp_fourier_plan));
+        else
+            dsp_fourier_plan_destroy(p);
+        if(p != NULL && dsp_fourier_plan_create(p, forward, dims, sizes) < 0) {
+            if(p < dsp_fourier_plans || p >= dsp_fourier_plans + DSP_FOURIER_PLANS)
+                free(p);
+            p = NULL;
+        }
+    }
+    if(p != NULL) {
+        p->busy = 1;
+        p->last_use = ++dsp_fourier_clock;
+    }
+    wisdom = dsp_fourier_wisdom_export(filename, &order);
+    pthread_mutex_unlock(&dsp_fourier_mutex);
+    if(wisdom != NULL)
+        dsp_fourier_wisdom_write(wisdom, filename, order);
+    return p;
+}
+
+static void dsp_fourier_plan_release(struct dsp_fourier_plan *p)
+{
+    pthread_mutex_lock(&dsp_fourier_mutex);
+    p->busy = 0;
+    if(p < dsp_fourier_plans || p >= dsp_fourier_plans + DSP_FOURIER_PLANS) {
+        dsp_fourier_plan_destroy(p);
+        free(p);
+    }
+    pthread_mutex_unlock(&dsp_fourier_mutex);
+}
+
+void dsp_fourier_set_threads(int threads)
+{
+    pthread_mutex_lock(&dsp_fourier_mutex);
+#ifdef HAVE_FFTW3_THREADS
+    static int initialized = 0;
+    if(!initialized)
+        initialized = DSP_FFTW(init_threads)();
+    if(threads < 1)
+        threads = (int)dsp_max_threads(0);
+    if(initialized && threads != dsp_fourier_threads) {
+        int i;
+        dsp_fourier_threads = threads;
+        // Idle plans are made again with the new number of threads.
+        for(i = 0; i < DSP_FOURIER_PLANS; i++)
+            if(!dsp_fourier_plans[i].busy)
+                dsp_fourier_plan_destroy(&dsp_fourier_plans[i]);
+    }
+#else
+    (void)threads;
+#endif
+    pthread_mutex_unlock(&dsp_fourier_mutex);
+}
+
+int dsp_fourier_set_wisdom_file(const char *filename)
+{
+    int imported = 0;
+    pthread_mutex_lock(&dsp_fourier_mutex);
+    if(filename == NULL) {
+        dsp_fourier_wisdom[0] = 0;
+    } else {
+        snprintf(dsp_fourier_wisdom, sizeof(dsp_fourier_wisdom), "%s", filename);
+        imported = DSP_FFTW(import_wisdom_from_filename)(dsp_fourier_wisdom);
+    }
+    dsp_fourier_measure = imported;
+    pthread_mutex_unlock(&dsp_fourier_mutex);
+    return imported;
+}
+
+void dsp_fourier_clear_plans()
+{
+    int i;
+    pthread_mutex_lock(&dsp_fourier_mutex);
+    for(i = 0; i < DSP_FOURIER_PLANS; i++)
+        if(!dsp_fourier_plans[i].busy)
+            dsp_fourier_plan_destroy(&dsp_fourier_plans[i]);
+    pthread_mutex_unlock(&dsp_fourier_mutex);
+}
+
+void dsp_fourier_planner_lock()
+{
+    pthread_mutex_lock(&dsp_fourier_mutex);
+}
+
+void dsp_fourier_planner_unlock()
+{
+    pthread_mutex_unlock(&dsp_fourier_mutex);
+}
+
 static void dsp_fourier_dft_magnitude(dsp_stream_p stream)
 {
     if(stream->magnitude)
@@ -39,16 +288,15 @@ void dsp_fourier_2dsp(dsp_stream_p stream)
     memcpy(dft, stream->dft.pairs, sizeof(complex_t) * stream->len);
     y = 0;
     for(x = 0; x < stream->len && y < stream->len; x++) {
-        int *pos = dsp_stream_get_position(stream, x);
-        if(pos[0] <= stream->sizes[0] / 2) {
+        if(x % stream->sizes[0] <= stream->sizes[0] / 2) {
             stream->dft.pairs[x][0] = dft[y][0];
             stream->dft.pairs[x][1] = dft[y][1];
             stream->dft.pairs[stream->len-1-x][0] = dft[y][0];
             stream->dft.pairs[stream->len-1-x][1] = dft[y][1];
             y++;
         }
-        free(pos);
     }
+    free(dft);
     dsp_fourier_dft_magnitude(stream);
     dsp_buffer_shift(stream->magnitude);
     dsp_fourier_dft_phase(stream);
@@ -67,21 +315,19 @@ void dsp_fourier_2complex_t(dsp_stream_p stream)
     dsp_buffer_set(stream->dft.buf, stream->len*2, 0);
     y = 0;
     for(x = 0; x < stream->len; x++) {
-        int *pos = dsp_stream_get_position(stream, x);
-        if(pos[0] <= stream->sizes[0] / 2) {
+        if(x % stream->sizes[0] <= stream->sizes[0] / 2) {
             stream->dft.pairs[y][0] = dft[x][0];
             stream->dft.pairs[y][1] = dft[x][1];
             y++;
         }
-        free(pos);
     }
     free(dft);
 }
 
-double* dsp_fourier_complex_array_get_magnitude(dsp_complex in, int len)
+dsp_t* dsp_fourier_complex_array_get_magnitude(dsp_complex in, int len)
 {
     int i;
-    double* out = (double*)malloc(sizeof(double) * len);
+    dsp_t* out = (dsp_t*)malloc(sizeof(dsp_t) * len);
     for(i = 0; i < len; i++) {
         double real = in.complex[i].real;
         double imaginary = in.complex[i].imaginary;
@@ -90,10 +336,10 @@ double* dsp_fourier_complex_array_get_magnitude(dsp_complex in, int len)
     return out;
 }
 
-double* dsp_fourier_complex_array_get_phase(dsp_complex in, int len)
+dsp_t* dsp_fourier_complex_array_get_phase(dsp_complex in, int len)
 {
     int i;
-    double* out = (double*)malloc(sizeof(double) * len);
+    dsp_t* out = (dsp_t*)malloc(sizeof(dsp_t) * len);
     for(i = 0; i < len; i++) {
         out [i] = 0;
         if (in.complex[i].real != 0) {
@@ -112,7 +358,7 @@ double* dsp_fourier_complex_array_get_phase(dsp_complex in, int len)
     return out;
 }
 
-void dsp_fourier_phase_mag_array_get_complex(double* mag, double* phi, complex_t* out, int len)
+void dsp_fourier_phase_mag_array_get_complex(dsp_t* mag, dsp_t* phi, complex_t* out, int len)
 {
     int i;
     for(i = 0; i < len; i++) {
@@ -123,70 +369,252 @@ void dsp_fourier_phase_mag_array_get_complex(double* mag, double* phi, complex_t
     }
 }
 
-static void* dsp_stream_dft_th(void* arg)
+struct dsp_stream_dft_job {
+    int exp;
+    dsp_stream_p streams[2];
+};
+
+static void dsp_stream_dft_range(void* arg, int start, int end, int worker)
 {
-    struct {
-        int exp;
-       dsp_stream_p stream;
-    } *arguments = arg;
-    dsp_fourier_dft(arguments->stream, arguments->exp);
-    return NULL;
+    (void)worker;
+    struct dsp_stream_dft_job *job = arg;
+    int y;
+    for(y = start; y < end; y++)
+        dsp_fourier_dft(job->streams[y], job->exp);
 }
 void dsp_fourier_dft(dsp_stream_p stream, int exp)
 {
     if(exp < 1)
         return;
-    double* buf = (double*)malloc(sizeof(double) * stream->len);
     if(stream->phase == NULL)
         stream->phase = dsp_stream_copy(stream);
     if(stream->magnitude == NULL)
         stream->magnitude = dsp_stream_copy(stream);
     dsp_buffer_set(stream->dft.buf, stream->len * 2, 0);
-    dsp_buffer_copy(stream->buf, buf, stream->len);
     int *sizes = (int*)malloc(sizeof(int)*stream->dims);
     dsp_buffer_copy(stream->sizes, sizes, stream->dims);
     dsp_buffer_reverse(sizes, stream->dims);
-    fftw_plan plan = fftw_plan_dft_r2c(stream->dims, sizes, buf, stream->dft.pairs, FFTW_ESTIMATE_PATIENT);
-    fftw_execute(plan);
-    fftw_free(plan);
+    struct dsp_fourier_plan *plan = dsp_fourier_plan_acquire(1, stream->dims, sizes);
     free(sizes);
-    free(buf);
+    if(plan == NULL)
+        return;
+    dsp_buffer_copy(stream->buf, plan->real, stream->len);
+    DSP_FFTW(execute)(plan->plan);
+    dsp_buffer_copy(((dsp_t*)plan->complex), stream->dft.buf, plan->complex_len * 2);
+    dsp_fourier_plan_release(plan);
     dsp_fourier_2dsp(stream);
     if(exp > 1) {
-        exp--;
-        pthread_t th[2];
-        struct {
-           int exp;
-           dsp_stream_p stream;
-        } thread_arguments[2];
-        thread_arguments[0].exp = exp;
-        thread_arguments[0].stream = stream->phase;
-        pthread_create(&th[0], NULL, dsp_stream_dft_th, &thread_arguments[0]);
-        thread_arguments[1].exp = exp;
-        thread_arguments[1].stream = stream->magnitude;
-        pthread_create(&th[1], NULL, dsp_stream_dft_th, &thread_arguments[1]);
-        pthread_join(th[0], NULL);
-        pthread_join(th[1], NULL);
+        struct dsp_stream_dft_job job = { exp - 1, { stream->phase, stream->magnitude } };
+        dsp_parallel_for(2, 1, dsp_stream_dft_range, &job);
     }
 }
 
 void dsp_fourier_idft(dsp_stream_p stream)
 {
-    double *buf = (double*)malloc(sizeof(double)*stream->len);
     dsp_t mn = dsp_stats_min(stream->buf, stream->len);
     dsp_t mx = dsp_stats_max(stream->buf, stream->len);
-    dsp_buffer_set(buf, stream->len, 0);
     dsp_fourier_2complex_t(stream);
     int *sizes = (int*)malloc(sizeof(int)*stream->dims);
     dsp_buffer_copy(stream->sizes, sizes, stream->dims);
     dsp_buffer_reverse(sizes, stream->dims);
-    fftw_plan plan = fftw_plan_dft_c2r(stream->dims, sizes, stream->dft.pairs, buf, FFTW_ESTIMATE_PATIENT);
-    fftw_execute(plan);
-    fftw_free(plan);
+    struct dsp_fourier_plan *plan = dsp_fourier_plan_acquire(0, stream->dims, sizes);
     free(sizes);
-    dsp_buffer_stretch(buf, stream->len, mn, mx);
-    dsp_buffer_copy(buf, stream->buf, stream->len);
+    if(plan == NULL)
+        return;
+    // The complex to real transform overwrites its input, the stream spectrum is left untouched.
+    dsp_buffer_copy(stream->dft.buf, ((dsp_t*)plan->complex), plan->complex_len * 2);
+    DSP_FFTW(execute)(plan->plan);
+    dsp_buffer_stretch(plan->real, stream->len, mn, mx);
+    dsp_buffer_copy(plan->real, stream->buf, stream->len);
+    dsp_fourier_plan_release(plan);
     dsp_buffer_shift(stream->magnitude);
     dsp_buffer_shift(stream->phase);
-    free(buf);
+}
+
+/*
+ * Linear convolution through transforms. The stream is cut in tiles: each one is transformed together
+ * with the margins the matrix needs around it, multiplied by the spectrum of the matrix and transformed
+ * back, then only its own part of the output is kept. Tiles write separate parts of the output and run
+ * in parallel, each worker with its own pair of cached plans. Transform sizes are made of the factors
+ * 2, 3, 5 and 7 only, at least DSP_FOURIER_TILE long or twice the matrix, and never larger than the
+ * size of a single tile covering the whole stream.
+ */
+#define DSP_FOURIER_TILE 256
+
+static int dsp_fourier_fast_size(int n)
+{
+    for(;; n++) {
+        int m = n;
+        while(m % 2 == 0)
+            m /= 2;
+        while(m % 3 == 0)
+            m /= 3;
+        while(m % 5 == 0)
+            m /= 5;
+        while(m % 7 == 0)
+            m /= 7;
+        if(m == 1)
+            return n;
+    }
+}
+
+struct dsp_fourier_convolution_job {
+    dsp_stream_p stream;
+    dsp_t *out;
+    int dims;
+    /// Sizes of the matrix, 1 past its dimensions
+    int *matrix;
+    /// Sizes of the transforms, of the tiles and number of tiles per dimension
+    int *fft;
+    int *tile;
+    int *tiles;
+    /// Transform sizes in FFTW order
+    int *plan;
+    /// Normalized spectrum of the matrix
+    DSP_FFTW(complex) *spectrum;
+};
+
+/* Fills the position of the first element of a row of a box and returns the length of the rows. */
+static int dsp_fourier_box_row(int dims, int *sizes, int row, int *pos)
+{
+    int d;
+    pos[0] = 0;
+    for(d = 1; d < dims; d++) {
+        pos[d] = row % sizes[d];
+        row /= sizes[d];
+    }
+    return sizes[0];
+}
+
+static void dsp_fourier_convolution_range(void *arg, int start, int end, int worker)
+{
+    (void)worker;
+    struct dsp_fourier_convolution_job *job = arg;
+    dsp_stream_p stream = job->stream;
+    int dims = job->dims;
+    int t, d, r, x, i;
+    struct dsp_fourier_plan *forward = dsp_fourier_plan_acquire(1, dims, job->plan);
+    struct dsp_fourier_plan *inverse = dsp_fourier_plan_acquire(0, dims, job->plan);
+    int *origin = (int*)malloc(sizeof(int) * (size_t)dims * 2);
+    int *pos = origin + dims;
+    if(forward == NULL || inverse == NULL || origin == NULL)
+        goto done;
+    int rows = forward->len / job->fft[0];
+    for(t = start; t < end; t++) {
+        int tile = t;
+        for(d = 0; d < dims; d++) {
+            origin[d] = (tile % job->tiles[d]) * job->tile[d];
+            tile /= job->tiles[d];
+        }
+        // The segment read for the tile starts the margin of the matrix before it
+        for(r = 0; r < rows; r++) {
+            int len = dsp_fourier_box_row(dims, job->fft, r, pos);
+            dsp_t *real = forward->real + (size_t)r * len;
+            int in = 0, inside = 1;
+            for(d = dims - 1; d > 0; d--) {
+                int p = origin[d] + job->matrix[d] / 2 - (job->matrix[d] - 1) + pos[d];
+                inside = inside && p >= 0 && p < stream->sizes[d] && pos[d] < job->tile[d] + job->matrix[d] - 1;
+                in = in * stream->sizes[d] + p;
+            }
+            int first = origin[0] + job->matrix[0] / 2 - (job->matrix[0] - 1);
+            int x0 = inside ? Max(0, -first) : len;
+            int x1 = inside ? Min(Min(len, job->tile[0] + job->matrix[0] - 1), stream->sizes[0] - first) : len;
+            for(x = 0; x < Min(x0, len); x++)
+                real[x] = 0;
+            for(x = x0; x < x1; x++)
+                real[x] = stream->buf[(size_t)in * stream->sizes[0] + first + x];
+            for(x = Max(x0, x1); x < len; x++)
+                real[x] = 0;
+        }
+        DSP_FFTW(execute)(forward->plan);
+        for(i = 0; i < forward->complex_len; i++) {
+            double re = forward->complex[i][0], im = forward->complex[i][1];
+            inverse->complex[i][0] = re * job->spectrum[i][0] - im * job->spectrum[i][1];
+            inverse->complex[i][1] = re * job->spectrum[i][1] + im * job->spectrum[i][0];
+        }
+        DSP_FFTW(execute)(inverse->plan);
+        // The output of the tile follows the margin of the matrix
+        int tile_rows = 1;
+        for(d = 1; d < dims; d++)
+            tile_rows *= job->tile[d];
+        for(r = 0; r < tile_rows; r++) {
+            int len = dsp_fourier_box_row(dims, job->tile, r, pos);
+            int out = 0, src = 0, inside = 1;
+            for(d = dims - 1; d > 0; d--) {
+                inside = inside && origin[d] + pos[d] < stream->sizes[d];
+                out = out * stream->sizes[d] + origin[d] + pos[d];
+                src = src * job->fft[d] + pos[d] + job->matrix[d] - 1;
+            }
+            if(!inside)
+                continue;
+            len = Min(len, stream->sizes[0] - origin[0]);
+            dsp_t *real = inverse->real + (size_t)src * job->fft[0] + job->matrix[0] - 1;
+            dsp_buffer_copy(real, (job->out + (size_t)out * stream->sizes[0] + origin[0]), len);
+        }
+    }
+done:
+    free(origin);
+    if(forward != NULL)
+        dsp_fourier_plan_release(forward);
+    if(inverse != NULL)
+        dsp_fourier_plan_release(inverse);
+}
+
+void dsp_fourier_convolution(dsp_stream_p stream, dsp_stream_p matrix)
+{
+    int d, i, r;
+    int dims = stream->dims;
+    if(matrix->dims > dims || matrix->len < 1 || stream->len < 1)
+        return;
+    struct dsp_fourier_convolution_job job;
+    job.stream = stream;
+    job.dims = dims;
+    job.matrix = (int*)malloc(sizeof(int) * (size_t)dims * 5);
+    job.fft = job.matrix + dims;
+    job.tile = job.fft + dims;
+    job.tiles = job.tile + dims;
+    job.plan = job.tiles + dims;
+    job.out = (dsp_t*)malloc(sizeof(dsp_t) * (size_t)stream->len);
+    job.spectrum = NULL;
+    int count = 1;
+    for(d = 0; d < dims; d++) {
+        job.matrix[d] = d < matrix->dims ? matrix->sizes[d] : 1;
+        int whole = dsp_fourier_fast_size(stream->sizes[d] + job.matrix[d] - 1);
+        job.fft[d] = Min(whole, dsp_fourier_fast_size(Max(DSP_FOURIER_TILE, job.matrix[d] * 2)));
+        job.tile[d] = job.fft[d] - job.matrix[d] + 1;
+        job.tiles[d] = (stream->sizes[d] + job.tile[d] - 1) / job.tile[d];
+        job.plan[dims - 1 - d] = job.fft[d];
+        count *= job.tiles[d];
+    }
+    struct dsp_fourier_plan *plan = dsp_fourier_plan_acquire(1, dims, job.plan);
+    if(plan == NULL || job.out == NULL)
+        goto done;
+    // Spectrum of the matrix placed at the origin of the transform, normalized for the inverse transform
+    int *pos = (int*)malloc(sizeof(int) * (size_t)dims);
+    dsp_buffer_set(plan->real, plan->len, 0);
+    for(r = 0; r < matrix->len / job.matrix[0]; r++) {
+        int len = dsp_fourier_box_row(dims, job.matrix, r, pos);
+        int offset = 0;
+        for(d = dims - 1; d > 0; d--)
+            offset = offset * job.fft[d] + pos[d];
+        dsp_buffer_copy((matrix->buf + (size_t)r * len), (plan->real + (size_t)offset * job.fft[0]), len);
+    }
+    free(pos);
+    DSP_FFTW(execute)(plan->plan);
+    job.spectrum = (DSP_FFTW(complex)*)malloc(sizeof(DSP_FFTW(complex)) * (size_t)plan->complex_len);
+    if(job.spectrum != NULL) {
+        for(i = 0; i < plan->complex_len; i++) {
+            job.spectrum[i][0] = plan->complex[i][0] / plan->len;
+            job.spectrum[i][1] = plan->complex[i][1] / plan->len;
+        }
+    }
+    dsp_fourier_plan_release(plan);
+    if(job.spectrum == NULL)
+        goto done;
+    dsp_parallel_for(count, 1, dsp_fourier_convolution_range, &job);
+    dsp_buffer_copy(job.out, stream->buf, stream->len);
+done:
+    free(job.spectrum);
+    free(job.out);
+    free(job.matrix);
 }
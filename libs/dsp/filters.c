@@ -44,18 +44,18 @@ void dsp_filter_lowpass(dsp_stream_p stream, double Frequency)
     }
     radius = sqrt(radius);
     dsp_fourier_dft(stream, 1);
-    for(x = 0; x < stream->len; x++) {
-        int* pos = dsp_stream_get_position(stream, x);
+    int* pos = (int*)calloc(stream->dims, sizeof(int));
+    for(x = 0; x < stream->len; x++, dsp_stream_next_position(stream, pos)) {
         double dist = 0.0;
         for(d = 0; d < stream->dims; d++) {
             dist += pow(stream->sizes[d]/2.0-pos[d], 2);
         }
-        free(pos);
         dist = sqrt(dist);
         dist *= M_PI/radius;
         if(dist>Frequency)
             stream->magnitude->buf[x] = 0.0;
     }
+    free(pos);
     dsp_fourier_idft(stream);
 }
 
@@ -68,18 +68,18 @@ void dsp_filter_highpass(dsp_stream_p stream, double Frequency)
     }
     radius = sqrt(radius);
     dsp_fourier_dft(stream, 1);
-    for(x = 0; x < stream->len; x++) {
-        int* pos = dsp_stream_get_position(stream, x);
+    int* pos = (int*)calloc(stream->dims, sizeof(int));
+    for(x = 0; x < stream->len; x++, dsp_stream_next_position(stream, pos)) {
         double dist = 0.0;
         for(d = 0; d < stream->dims; d++) {
             dist += pow(stream->sizes[d]/2.0-pos[d], 2);
         }
-        free(pos);
         dist = sqrt(dist);
         dist *= M_PI/radius;
         if(dist<Frequency)
             stream->magnitude->buf[x] = 0.0;
     }
+    free(pos);
     dsp_fourier_idft(stream);
 }
 
@@ -92,18 +92,18 @@ void dsp_filter_bandreject(dsp_stream_p stream, double LowFrequency, double High
     }
     radius = sqrt(radius);
     dsp_fourier_dft(stream, 1);
-    for(x = 0; x < stream->len; x++) {
-        int* pos = dsp_stream_get_position(stream, x);
+    int* pos = (int*)calloc(stream->dims, sizeof(int));
+    for(x = 0; x < stream->len; x++, dsp_stream_next_position(stream, pos)) {
         double dist = 0.0;
         for(d = 0; d < stream->dims; d++) {
             dist += pow(stream->sizes[d]/2.0-pos[d], 2);
         }
-        free(pos);
         dist = sqrt(dist);
         dist *= M_PI/radius;
         if(dist<HighFrequency&&dist>LowFrequency)
             stream->magnitude->buf[x] = 0.0;
     }
+    free(pos);
     dsp_fourier_idft(stream);
 }
 
@@ -116,17 +116,17 @@ void dsp_filter_bandpass(dsp_stream_p stream, double LowFrequency, double HighFr
     }
     radius = sqrt(radius);
     dsp_fourier_dft(stream, 1);
-    for(x = 0; x < stream->len; x++) {
-        int* pos = dsp_stream_get_position(stream, x);
+    int* pos = (int*)calloc(stream->dims, sizeof(int));
+    for(x = 0; x < stream->len; x++, dsp_stream_next_position(stream, pos)) {
         double dist = 0.0;
         for(d = 0; d < stream->dims; d++) {
             dist += pow(stream->sizes[d]/2.0-pos[d], 2);
         }
-        free(pos);
         dist = sqrt(dist);
         dist *= M_PI/radius;
         if(dist>HighFrequency||dist<LowFrequency)
             stream->magnitude->buf[x] = 0.0;
     }
+    free(pos);
     dsp_fourier_idft(stream);
 }
@@ -0,0 +1,153 @@
+/*
+*   DSP API - a digital signal processing library for astronomy usage
+*   Copyright © 2026  INDI Library contributors
+*
+*   This program is free software; you can redistribute it and/or
+*   modify it under the terms of the GNU Lesser General Public
+*   License as published by the Free Software Foundation; either
+*   version 3 of the License, or (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*   Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program; if not, write to the Free Software Foundation,
+*   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "dsp.h"
+#include <stdatomic.h>
+
+/*
+ * The pool starts with the first parallel job and keeps dsp_max_threads - 1 threads waiting for
+ * the next one, the calling thread works as the first of them. Jobs are split in parts handed out
+ * through an atomic counter. One job runs at a time: a job started from inside another one, or while
+ * another thread owns the pool, runs entirely on the calling thread.
+ */
+static pthread_mutex_t dsp_parallel_owner = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t dsp_parallel_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dsp_parallel_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t dsp_parallel_done = PTHREAD_COND_INITIALIZER;
+static pthread_t *dsp_parallel_threads = NULL;
+static int dsp_parallel_size = 0;
+static int dsp_parallel_running = 0;
+static int dsp_parallel_quit = 0;
+static unsigned long dsp_parallel_generation = 0;
+
+static struct {
+    dsp_parallel_func func;
+    void *arg;
+    int count;
+    int chunk;
+    int parts;
+    atomic_int next;
+} dsp_parallel_job;
+
+static void dsp_parallel_run(int worker)
+{
+    int part;
+    while((part = atomic_fetch_add(&dsp_parallel_job.next, 1)) < dsp_parallel_job.parts) {
+        int start, end;
+        if(dsp_parallel_job.chunk > 0) {
+            start = part * dsp_parallel_job.chunk;
+            end = Min(dsp_parallel_job.count, start + dsp_parallel_job.chunk);
+        } else {
+            start = (int)((long)part * dsp_parallel_job.count / dsp_parallel_job.parts);
+            end = (int)((long)(part + 1) * dsp_parallel_job.count / dsp_parallel_job.parts);
+        }
+        if(start < end)
+            dsp_parallel_job.func(dsp_parallel_job.arg, start, end, worker);
+    }
+}
+
+static void* dsp_parallel_worker(void* arg)
+{
+    int worker = (int)(intptr_t)arg;
+    unsigned long generation = 0;
+    pthread_mutex_lock(&dsp_parallel_mutex);
+    for(;;) {
+        while(!dsp_parallel_quit && generation == dsp_parallel_generation)
+            pthread_cond_wait(&dsp_parallel_start, &dsp_parallel_mutex);
+        if(dsp_parallel_quit)
+            break;
+        generation = dsp_parallel_generation;
+        pthread_mutex_unlock(&dsp_parallel_mutex);
+        dsp_parallel_run(worker);
+        pthread_mutex_lock(&dsp_parallel_mutex);
+        if(--dsp_parallel_running == 0)
+            pthread_cond_signal(&dsp_parallel_done);
+    }
+    pthread_mutex_unlock(&dsp_parallel_mutex);
+    return NULL;
+}
+
+/* Called by the owner of the pool, between jobs. */
+static void dsp_parallel_resize(int size)
+{
+    int y;
+    if(size == dsp_parallel_size)
+        return;
+    pthread_mutex_lock(&dsp_parallel_mutex);
+    dsp_parallel_quit = 1;
+    pthread_cond_broadcast(&dsp_parallel_start);
+    pthread_mutex_unlock(&dsp_parallel_mutex);
+    for(y = 0; y < dsp_parallel_size; y++)
+        pthread_join(dsp_parallel_threads[y], NULL);
+    free(dsp_parallel_threads);
+    dsp_parallel_threads = NULL;
+    dsp_parallel_size = 0;
+    dsp_parallel_quit = 0;
+    dsp_parallel_generation = 0;
+    if(size < 1)
+        return;
+    dsp_parallel_threads = (pthread_t*)malloc(sizeof(pthread_t)*(size_t)size);
+    if(dsp_parallel_threads == NULL)
+        return;
+    for(y = 0; y < size; y++) {
+        if(pthread_create(&dsp_parallel_threads[y], NULL, dsp_parallel_worker, (void*)(intptr_t)(y + 1)))
+            break;
+        dsp_parallel_size++;
+    }
+}
+
+void dsp_parallel_for(int count, int chunk, dsp_parallel_func func, void *arg)
+{
+    if(count < 1 || func == NULL)
+        return;
+    int threads = (int)dsp_max_threads(0);
+    if(threads < 2 || count < 2 || pthread_mutex_trylock(&dsp_parallel_owner)) {
+        func(arg, 0, count, 0);
+        return;
+    }
+    dsp_parallel_resize(threads - 1);
+    if(dsp_parallel_size < 1) {
+        pthread_mutex_unlock(&dsp_parallel_owner);
+        func(arg, 0, count, 0);
+        return;
+    }
+    dsp_parallel_job.func = func;
+    dsp_parallel_job.arg = arg;
+    dsp_parallel_job.count = count;
+    dsp_parallel_job.chunk = chunk;
+    if(chunk > 0)
+        dsp_parallel_job.parts = (int)(((long)count + chunk - 1) / chunk);
+    else
+        dsp_parallel_job.parts = Min(count, dsp_parallel_size + 1);
+    atomic_store(&dsp_parallel_job.next, 0);
+
+    pthread_mutex_lock(&dsp_parallel_mutex);
+    dsp_parallel_running = dsp_parallel_size;
+    dsp_parallel_generation++;
+    pthread_cond_broadcast(&dsp_parallel_start);
+    pthread_mutex_unlock(&dsp_parallel_mutex);
+
+    dsp_parallel_run(0);
+
+    pthread_mutex_lock(&dsp_parallel_mutex);
+    while(dsp_parallel_running > 0)
+        pthread_cond_wait(&dsp_parallel_done, &dsp_parallel_mutex);
+    pthread_mutex_unlock(&dsp_parallel_mutex);
+    pthread_mutex_unlock(&dsp_parallel_owner);
+}
@@ -42,3 +42,80 @@ double* dsp_stats_histogram(dsp_stream_p stream, int size)
         dsp_buffer_stretch(out, size, 0, size);
     return out;
 }
+
+static dsp_t dsp_stats_select(dsp_t *buf, int len, int k)
+{
+    int lo = 0, hi = len - 1;
+    while(lo < hi) {
+        dsp_t pivot = buf[(lo + hi) / 2];
+        int i = lo, j = hi;
+        while(i <= j) {
+            while(buf[i] < pivot) i++;
+            while(buf[j] > pivot) j--;
+            if(i <= j) {
+                dsp_t t = buf[i];
+                buf[i] = buf[j];
+                buf[j] = t;
+                i++;
+                j--;
+            }
+        }
+        if(k <= j)
+            hi = j;
+        else if(k >= i)
+            lo = i;
+        else
+            break;
+    }
+    return buf[k];
+}
+
+struct dsp_stats_background_job {
+    int tile_size;
+    dsp_stream_p stream;
+    dsp_t *background;
+    dsp_t *noise;
+};
+
+static void dsp_stats_background_range(void* arg, int start, int end, int worker)
+{
+    (void)worker;
+    struct dsp_stats_background_job *job = arg;
+    dsp_stream_p stream = job->stream;
+    int tile_size = job->tile_size;
+    int width = stream->sizes[0];
+    int height = stream->sizes[1];
+    int tiles_x = (width + tile_size - 1) / tile_size;
+    dsp_t *samples = (dsp_t*)malloc(sizeof(dsp_t) * tile_size * tile_size);
+    int t, x, y;
+    for(t = start; t < end; t++) {
+        int x0 = (t % tiles_x) * tile_size;
+        int y0 = (t / tiles_x) * tile_size;
+        int x1 = Min(x0 + tile_size, width);
+        int y1 = Min(y0 + tile_size, height);
+        int len = 0;
+        for(y = y0; y < y1; y++) {
+            dsp_t *row = &stream->buf[y * width];
+            for(x = x0; x < x1; x++)
+                samples[len++] = row[x];
+        }
+        dsp_t median = dsp_stats_select(samples, len, len / 2);
+        for(x = 0; x < len; x++)
+            samples[x] = fabs(samples[x] - median);
+        // Median absolute deviation scaled to the standard deviation of a normal distribution
+        dsp_t mad = dsp_stats_select(samples, len, len / 2);
+        job->background[t] = median;
+        job->noise[t] = mad * 1.4826;
+    }
+    free(samples);
+}
+
+void dsp_stats_background(dsp_stream_p stream, int tile_size, dsp_t *background, dsp_t *noise)
+{
+    if(stream == NULL || stream->dims < 2 || tile_size < 1)
+        return;
+    int tiles_x = (stream->sizes[0] + tile_size - 1) / tile_size;
+    int tiles_y = (stream->sizes[1] + tile_size - 1) / tile_size;
+    struct dsp_stats_background_job job = { tile_size, stream, background, noise };
+    dsp_parallel_for(tiles_x * tiles_y, 0, dsp_stats_background_range, &job);
+}
@@ -343,6 +343,7 @@ void dsp_stream_add_star(dsp_stream_p stream, dsp_star star)
     stream->stars[stream->stars_count].peak = star.peak;
     stream->stars[stream->stars_count].flux = star.flux;
     stream->stars[stream->stars_count].theta = star.theta;
+    stream->stars[stream->stars_count].hfr = star.hfr;
     stream->stars[stream->stars_count].center.dims = star.center.dims;
     stream->stars[stream->stars_count].center.location = (double*)malloc(sizeof(double)*star.center.dims);
     for(d = 0; d < star.center.dims; d++)
@@ -399,6 +400,7 @@ void dsp_stream_add_triangle(dsp_stream_p stream, dsp_triangle triangle)
         stream->triangles[stream->triangles_count].stars[s].peak = triangle.stars[s].peak;
         stream->triangles[stream->triangles_count].stars[s].flux = triangle.stars[s].flux;
         stream->triangles[stream->triangles_count].stars[s].theta = triangle.stars[s].theta;
+        stream->triangles[stream->triangles_count].stars[s].hfr = triangle.stars[s].hfr;
         stream->triangles[stream->triangles_count].stars[s].center.location = (double*)malloc(sizeof(double)*stream->dims);
         for(d = 0; d < triangle.stars[s].center.dims; d++) {
             stream->triangles[stream->triangles_count].stars[s].center.location[d] = triangle.stars[s].center.location[d];
@@ -449,17 +451,37 @@ void dsp_stream_del_triangle(dsp_stream_p stream, int index)
  * @return
  */
 int* dsp_stream_get_position(dsp_stream_p stream, int index) {
-    int dim = 0;
-    int y = 0;
-    int m = 1;
     int* pos = (int*)malloc(sizeof(int) * stream->dims);
+    dsp_stream_fill_position(stream, index, pos);
+    return pos;
+}
+
+/**
+ * @brief dsp_stream_fill_position
+ * @param stream
+ * @param index
+ * @param pos
+ */
+void dsp_stream_fill_position(dsp_stream_p stream, int index, int* pos) {
+    int dim;
     for (dim = 0; dim < stream->dims; dim++) {
-        y = index / m;
-        y %= stream->sizes[dim];
-        m *= stream->sizes[dim];
-        pos[dim] = y;
+        pos[dim] = index % stream->sizes[dim];
+        index /= stream->sizes[dim];
+    }
+}
+
+/**
+ * @brief dsp_stream_next_position
+ * @param stream
+ * @param pos
+ */
+void dsp_stream_next_position(dsp_stream_p stream, int* pos) {
+    int dim;
+    for (dim = 0; dim < stream->dims; dim++) {
+        if(++pos[dim] < stream->sizes[dim])
+            return;
+        pos[dim] = 0;
     }
-    return pos;
 }
 
 /**
@@ -479,48 +501,96 @@ int dsp_stream_set_position(dsp_stream_p stream, int* pos) {
     return index;
 }
 
-static void* dsp_stream_align_th(void* arg)
+/*
+ * The per element kernels below keep the arithmetic of the original code, including the truncation
+ * of the coordinates to integers after each step, so their results are unchanged. Positions are
+ * moved along the stream instead of being allocated and divided out for each element. On 2D streams
+ * the terms that only depend on the column are computed once per range, and those of the row once
+ * per row.
+ */
+static void dsp_stream_align_range(void* arg, int start, int end, int worker)
 {
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } *arguments = arg;
-    dsp_stream_p stream = arguments->stream;
+    (void)worker;
+    dsp_stream_p stream = arg;
     dsp_stream_p in = stream->parent;
-    int cur_th = arguments->cur_th;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
-    int y;
-    for(y = start; y < end; y++)
+    double *center = stream->align_info.center;
+    double *offset = stream->align_info.offset;
+    double *factor = stream->align_info.factor;
+    double *radians = stream->align_info.radians;
+    int y, dim;
+    if(stream->dims == 2) {
+        int width = stream->sizes[0];
+        int *columns = (int*)malloc(sizeof(int) * width);
+        int col, line;
+        for(col = 0; col < width; col++) {
+            int column = col;
+            column -= center[0];
+            column += offset[0];
+            columns[col] = column;
+        }
+        col = start % width;
+        line = start / width;
+        double r1 = radians[0], yr = 0;
+        for(y = start; y < end; y++, col++)
+        {
+            if(col == width) {
+                col = 0;
+                line++;
+            }
+            if(y == start || col == 0) {
+                int row = line;
+                row -= center[1];
+                row += offset[1];
+                yr = row;
+            }
+            double xr = columns[col];
+            double h = pow(pow(xr, 2)+pow(yr, 2), 0.5);
+            double r2 = acos(xr/h);
+            if(yr < 0)
+                r2 = - r2;
+            int pos1 = sin(r2-r1)*h;
+            int pos0 = cos(r2-r1)*h;
+            pos1 /= factor[1];
+            pos0 /= factor[0];
+            pos1 += center[1];
+            pos0 += center[0];
+            int x = pos0 + in->sizes[0] * pos1;
+            if(x >= 0 && x < in->len)
+                stream->buf[y] = in->buf[x];
+        }
+        free(columns);
+        return;
+    }
+    int *pos = (int*)malloc(sizeof(int) * stream->dims * 2);
+    int *out = pos + stream->dims;
+    dsp_stream_fill_position(stream, start, pos);
+    for(y = start; y < end; y++, dsp_stream_next_position(stream, pos))
     {
-        int *pos = dsp_stream_get_position(stream, y);
-        int dim;
+        memcpy(out, pos, sizeof(int) * stream->dims);
         for (dim = 1; dim < stream->dims; dim++) {
-            pos[dim] -= stream->align_info.center[dim];
-            pos[dim-1] -= stream->align_info.center[dim-1];
-            pos[dim] += stream->align_info.offset[dim];
-            pos[dim-1] += stream->align_info.offset[dim-1];
-            double r1 = stream->align_info.radians[dim-1];
-            double x = pos[dim-1];
-            double y = pos[dim];
-            double h = pow(pow(x, 2)+pow(y, 2), 0.5);
-            double r2 = acos(x/h);
-            if(y < 0)
+            out[dim] -= center[dim];
+            out[dim-1] -= center[dim-1];
+            out[dim] += offset[dim];
+            out[dim-1] += offset[dim-1];
+            double r1 = radians[dim-1];
+            double xr = out[dim-1];
+            double yr = out[dim];
+            double h = pow(pow(xr, 2)+pow(yr, 2), 0.5);
+            double r2 = acos(xr/h);
+            if(yr < 0)
                 r2 = - r2;
-            pos[dim] = sin(r2-r1)*h;
-            pos[dim-1] = cos(r2-r1)*h;
-            pos[dim] /= stream->align_info.factor[dim];
-            pos[dim-1] /= stream->align_info.factor[dim-1];
-            pos[dim] += stream->align_info.center[dim];
-            pos[dim-1] += stream->align_info.center[dim-1];
+            out[dim] = sin(r2-r1)*h;
+            out[dim-1] = cos(r2-r1)*h;
+            out[dim] /= factor[dim];
+            out[dim-1] /= factor[dim-1];
+            out[dim] += center[dim];
+            out[dim-1] += center[dim-1];
         }
-        int x = dsp_stream_set_position(in, pos);
-        free(pos);
+        int x = dsp_stream_set_position(in, out);
         if(x >= 0 && x < in->len)
             stream->buf[y] = in->buf[x];
     }
-    return NULL;
+    free(pos);
 }
 
 void dsp_stream_align(dsp_stream_p in)
@@ -528,20 +598,7 @@ void dsp_stream_align(dsp_stream_p in)
     dsp_stream_p stream = dsp_stream_copy(in);
     dsp_buffer_set(stream->buf, stream->len, 0);
     stream->parent = in;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        pthread_create(&th[y], NULL, dsp_stream_align_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_parallel_for(stream->len, 0, dsp_stream_align_range, stream);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
@@ -552,38 +609,32 @@ void dsp_stream_align(dsp_stream_p in)
  * @param in
  */
 
-static void* dsp_stream_crop_th(void* arg)
+static void dsp_stream_crop_range(void* arg, int start, int end, int worker)
 {
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } *arguments = arg;
-    dsp_stream_p stream = arguments->stream;
+    (void)worker;
+    dsp_stream_p stream = arg;
     dsp_stream_p in = stream->parent;
-    int cur_th = arguments->cur_th;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
+    int *pos = (int*)malloc(sizeof(int) * stream->dims * 2);
+    int *out = pos + stream->dims;
     int y;
-    for(y = start; y < end; y++)
+    dsp_stream_fill_position(stream, start, pos);
+    for(y = start; y < end; y++, dsp_stream_next_position(stream, pos))
     {
-        int *pos = dsp_stream_get_position(stream, y);
         int dim;
         int allow = 1;
         for (dim = 0; dim < stream->dims; dim++) {
-            pos[dim] += in->ROI[dim].start;
-            if(pos[dim] < in->ROI[dim].start || pos[dim] > in->ROI[dim].start + in->ROI[dim].len || pos[dim] < 0 || pos[dim] >= in->sizes[dim])
+            out[dim] = pos[dim] + in->ROI[dim].start;
+            if(out[dim] < in->ROI[dim].start || out[dim] > in->ROI[dim].start + in->ROI[dim].len || out[dim] < 0 || out[dim] >= in->sizes[dim])
                 allow &= 0;
         }
         if(allow) {
-            int x = dsp_stream_set_position(in, pos);
+            int x = dsp_stream_set_position(in, out);
             stream->buf[y] = in->buf[x];
         }
         else
             stream->buf[y] = 0;
-        free(pos);
     }
-    return NULL;
+    free(pos);
 }
 
 void dsp_stream_crop(dsp_stream_p in)
@@ -591,20 +642,7 @@ void dsp_stream_crop(dsp_stream_p in)
     dsp_stream_p stream = dsp_stream_copy(in);
     dsp_buffer_set(stream->buf, stream->len, 0);
     stream->parent = in;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        pthread_create(&th[y], NULL, dsp_stream_crop_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_parallel_for(stream->len, 0, dsp_stream_crop_range, stream);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
@@ -630,40 +668,72 @@ void dsp_stream_translate(dsp_stream_p in)
 }
 
 /**
- * @brief dsp_stream_scale_th
+ * @brief dsp_stream_scale_range
  * @param arg
- * @return
+ * @param start
+ * @param end
+ * @param worker
  */
-static void* dsp_stream_scale_th(void* arg)
+static void dsp_stream_scale_range(void* arg, int start, int end, int worker)
 {
-    struct {
-        int cur_th;
-        dsp_stream_p stream;
-     } *arguments = arg;
-    dsp_stream_p stream = arguments->stream;
+    (void)worker;
+    dsp_stream_p stream = arg;
     dsp_stream_p in = stream->parent;
-    int cur_th = arguments->cur_th;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
+    double *center = stream->align_info.center;
     int y, d;
-    for(y = start; y < end; y++)
+    double factor = 0.0;
+    for(d = 0; d < stream->dims; d++)
+        factor += pow(stream->align_info.factor[d], 2);
+    factor = sqrt(factor);
+    double weight = factor*stream->dims;
+    if(stream->dims == 2) {
+        int width = stream->sizes[0];
+        int *columns = (int*)malloc(sizeof(int) * width);
+        int col, line, row = 0;
+        for(col = 0; col < width; col++) {
+            int column = col;
+            column -= center[0];
+            column /= stream->align_info.factor[0];
+            column += center[0];
+            columns[col] = column;
+        }
+        col = start % width;
+        line = start / width;
+        for(y = start; y < end; y++, col++)
+        {
+            if(col == width) {
+                col = 0;
+                line++;
+            }
+            if(y == start || col == 0) {
+                row = line;
+                row -= center[1];
+                row /= stream->align_info.factor[1];
+                row += center[1];
+            }
+            int x = columns[col] + in->sizes[0] * row;
+            if(x >= 0 && x < in->len)
+                stream->buf[y] += in->buf[x]/weight;
+        }
+        free(columns);
+        return;
+    }
+    int *pos = (int*)malloc(sizeof(int) * stream->dims * 2);
+    int *out = pos + stream->dims;
+    dsp_stream_fill_position(stream, start, pos);
+    for(y = start; y < end; y++, dsp_stream_next_position(stream, pos))
     {
-        int* pos = dsp_stream_get_position(stream, y);
-        double factor = 0.0;
         for(d = 0; d < stream->dims; d++) {
-            pos[d] -= stream->align_info.center[d];
-            pos[d] /= stream->align_info.factor[d];
-            pos[d] += stream->align_info.center[d];
-            factor += pow(stream->align_info.factor[d], 2);
+            out[d] = pos[d];
+            out[d] -= center[d];
+            out[d] /= stream->align_info.factor[d];
+            out[d] += center[d];
         }
-        factor = sqrt(factor);
-        int x = dsp_stream_set_position(in, pos);
+        int x = dsp_stream_set_position(in, out);
         if(x >= 0 && x < in->len)
-            stream->buf[y] += in->buf[x]/(factor*stream->dims);
-        free(pos);
+            stream->buf[y] += in->buf[x]/weight;
     }
-    return NULL;
+    free(pos);
 }
 
 void dsp_stream_scale(dsp_stream_p in)
@@ -671,61 +741,85 @@ void dsp_stream_scale(dsp_stream_p in)
     dsp_stream_p stream = dsp_stream_copy(in);
     dsp_buffer_set(stream->buf, stream->len, 0);
     stream->parent = in;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        pthread_create(&th[y], NULL, dsp_stream_scale_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_parallel_for(stream->len, 0, dsp_stream_scale_range, stream);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
 }
 
-static void* dsp_stream_rotate_th(void* arg)
+static void dsp_stream_rotate_range(void* arg, int start, int end, int worker)
 {
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } *arguments = arg;
-    dsp_stream_p stream = arguments->stream;
+    (void)worker;
+    dsp_stream_p stream = arg;
     dsp_stream_p in = stream->parent;
-    int cur_th = arguments->cur_th;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
-    int y;
-    for(y = start; y < end; y++)
+    double *center = stream->align_info.center;
+    int y, dim;
+    if(stream->dims == 2) {
+        // The rotated column terms are truncated before the row terms are added, they are tabulated.
+        double r = stream->align_info.radians[0];
+        double sin_r = sin(r), cos_r = cos(r);
+        int width = stream->sizes[0];
+        int *columns = (int*)malloc(sizeof(int) * width * 2);
+        int col, line;
+        double row_sin = 0, row_cos = 0;
+        for(col = 0; col < width; col++) {
+            int column = col;
+            column -= center[0];
+            double x = column;
+            columns[col * 2] = x*-sin_r;
+            columns[col * 2 + 1] = x*cos_r;
+        }
+        col = start % width;
+        line = start / width;
+        for(y = start; y < end; y++, col++)
+        {
+            if(col == width) {
+                col = 0;
+                line++;
+            }
+            if(y == start || col == 0) {
+                int row = line;
+                row -= center[1];
+                row_cos = row*cos_r;
+                row_sin = row*sin_r;
+            }
+            int pos1 = columns[col * 2];
+            int pos0 = columns[col * 2 + 1];
+            pos1 += row_cos;
+            pos0 += row_sin;
+            pos1 += center[1];
+            pos0 += center[0];
+            int x = pos0 + in->sizes[0] * pos1;
+            if(x >= 0 && x < in->len)
+                stream->buf[y] = in->buf[x];
+        }
+        free(columns);
+        return;
+    }
+    int *pos = (int*)malloc(sizeof(int) * stream->dims * 2);
+    int *out = pos + stream->dims;
+    dsp_stream_fill_position(stream, start, pos);
+    for(y = start; y < end; y++, dsp_stream_next_position(stream, pos))
     {
-        int *pos = dsp_stream_get_position(stream, y);
-        int dim;
+        memcpy(out, pos, sizeof(int) * stream->dims);
         for (dim = 1; dim < stream->dims; dim++) {
-            pos[dim] -= stream->align_info.center[dim];
-            pos[dim-1] -= stream->align_info.center[dim-1];
+            out[dim] -= center[dim];
+            out[dim-1] -= center[dim-1];
             double r = stream->align_info.radians[dim-1];
-            double x = pos[dim-1];
-            double y = pos[dim];
-            pos[dim] = x*-sin(r);
-            pos[dim-1] = x*cos(r);
-            pos[dim] += y*cos(r);
-            pos[dim-1] += y*sin(r);
-            pos[dim] += stream->align_info.center[dim];
-            pos[dim-1] += stream->align_info.center[dim-1];
+            double xr = out[dim-1];
+            double yr = out[dim];
+            out[dim] = xr*-sin(r);
+            out[dim-1] = xr*cos(r);
+            out[dim] += yr*cos(r);
+            out[dim-1] += yr*sin(r);
+            out[dim] += center[dim];
+            out[dim-1] += center[dim-1];
         }
-        int x = dsp_stream_set_position(in, pos);
-        free(pos);
+        int x = dsp_stream_set_position(in, out);
         if(x >= 0 && x < in->len)
             stream->buf[y] = in->buf[x];
     }
-    return NULL;
+    free(pos);
 }
 
 void dsp_stream_rotate(dsp_stream_p in)
@@ -733,20 +827,7 @@ void dsp_stream_rotate(dsp_stream_p in)
     dsp_stream_p stream = dsp_stream_copy(in);
     dsp_buffer_set(stream->buf, stream->len, 0);
     stream->parent = in;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        pthread_create(&th[y], NULL, dsp_stream_rotate_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_parallel_for(stream->len, 0, dsp_stream_rotate_range, stream);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
@@ -767,52 +848,36 @@ static double stack_delegate_subtraction(double x, double y)
     return fmax(0.0, x - y);
 }
 
-static void* dsp_stream_stack_th(void* arg)
+struct dsp_stream_stack_job {
+    dsp_stream_p stream;
+    double(*delegate)(double, double);
+};
+
+static void dsp_stream_stack_range(void* arg, int start, int end, int worker)
 {
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-       double(*delegate)(double, double);
-    } *arguments = arg;
-    double(*delegate)(double, double) = arguments->delegate;
-    dsp_stream_p stream = arguments->stream;
+    (void)worker;
+    struct dsp_stream_stack_job *job = arg;
+    double(*delegate)(double, double) = job->delegate;
+    dsp_stream_p stream = job->stream;
     dsp_stream_p in = stream->parent;
-    int cur_th = arguments->cur_th;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
+    int *pos = (int*)malloc(sizeof(int) * stream->dims);
     int y;
-    for(y = start; y < end; y++)
+    dsp_stream_fill_position(stream, start, pos);
+    for(y = start; y < end; y++, dsp_stream_next_position(stream, pos))
     {
-        int *pos = dsp_stream_get_position(stream, y);
         int x = dsp_stream_set_position(in, pos);
-        free(pos);
         if(x >= 0 && x < in->len)
             stream->buf[y] = delegate(stream->buf[y], in->buf[x]);
     }
-    return NULL;
+    free(pos);
 }
 
 void dsp_stream_sum(dsp_stream_p in, dsp_stream_p str)
 {
     dsp_stream_p stream = dsp_stream_copy(in);
     stream->parent = str;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-       double(*delegate)(double, double);
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        thread_arguments[y].delegate = stack_delegate_sum;
-        pthread_create(&th[y], NULL, dsp_stream_stack_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    struct dsp_stream_stack_job job = { stream, stack_delegate_sum };
+    dsp_parallel_for(stream->len, 0, dsp_stream_stack_range, &job);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
@@ -822,22 +887,8 @@ void dsp_stream_multiply(dsp_stream_p in, dsp_stream_p str)
 {
     dsp_stream_p stream = dsp_stream_copy(in);
     stream->parent = str;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-       double(*delegate)(double, double);
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        thread_arguments[y].delegate = stack_delegate_multiply;
-        pthread_create(&th[y], NULL, dsp_stream_stack_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    struct dsp_stream_stack_job job = { stream, stack_delegate_multiply };
+    dsp_parallel_for(stream->len, 0, dsp_stream_stack_range, &job);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
@@ -847,22 +898,8 @@ void dsp_stream_subtract(dsp_stream_p in, dsp_stream_p str)
 {
     dsp_stream_p stream = dsp_stream_copy(in);
     stream->parent = str;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-       double(*delegate)(double, double);
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        thread_arguments[y].delegate = stack_delegate_subtraction;
-        pthread_create(&th[y], NULL, dsp_stream_stack_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    struct dsp_stream_stack_job job = { stream, stack_delegate_subtraction };
+    dsp_parallel_for(stream->len, 0, dsp_stream_stack_range, &job);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
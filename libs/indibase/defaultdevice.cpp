@@ -117,6 +117,7 @@ extern void (*WeakIDSetLightVA)(const ILightVectorProperty *, const char *, va_l
 extern void (*WeakIDDefLightVA)(const ILightVectorProperty *, const char *, va_list);
 extern void (*WeakIDSetBLOBVA)(const IBLOBVectorProperty *, const char *, va_list);
 extern void (*WeakIDDefBLOBVA)(const IBLOBVectorProperty *, const char *, va_list);
+extern void (*WeakIDSetBLOBChunk)(const IBLOBVectorProperty *, int, unsigned int, unsigned int);
 extern int (*WeakIUUpdateText)(ITextVectorProperty *, char *[], char *[], int);
 extern int (*WeakIUUpdateNumber)(INumberVectorProperty *, double[], char *[], int n);
 extern int (*WeakIUUpdateSwitch)(ISwitchVectorProperty *, ISState *, char *[], int n);
@@ -137,6 +138,7 @@ static struct WeakIDLoader
         WeakIDDefLightVA = IDDefLightVA;
         WeakIDSetBLOBVA = IDSetBLOBVA;
         WeakIDDefBLOBVA = IDDefBLOBVA;
+        WeakIDSetBLOBChunk = IDSetBLOBChunk;
         WeakIUUpdateText = IUUpdateText;
         WeakIUUpdateNumber = IUUpdateNumber;
         WeakIUUpdateSwitch = IUUpdateSwitch;
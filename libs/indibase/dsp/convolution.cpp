@@ -93,8 +93,6 @@ bool Convolution::processBLOB(uint8_t *buf, uint32_t dims, int *sizes, int bits_
     if(!PluginActive) return false;
     if(!matrix_loaded) return false;
     setStream(buf, dims, sizes, bits_per_sample);
-    dsp_fourier_dft(stream, 1);
-    dsp_fourier_dft(matrix, 1);
     dsp_convolution_convolution(stream, matrix);
     return Interface::processBLOB(getStream(), stream->dims, stream->sizes, bits_per_sample);
 }
@@ -162,8 +160,6 @@ bool Wavelets::processBLOB(uint8_t *buf, uint32_t dims, int *sizes, int bits_per
                                             (y) * M_PI / static_cast<double>(size));
             }
         }
-        dsp_fourier_dft(tmp, 1);
-        dsp_fourier_dft(matrix, 1);
         dsp_convolution_convolution(tmp, matrix);
         dsp_buffer_sub(tmp, matrix->buf, matrix->len);
         dsp_buffer_mul1(tmp, WaveletsNP.np[i].value / 8.0);
@@ -33,6 +33,20 @@ namespace DSP
 {
 Manager::Manager(INDI::DefaultDevice *dev)
 {
+    // FFTW plans measured by previous runs are reused, wisdom is not shared between precisions
+#ifdef DSP_SINGLE_PRECISION
+    const char *wisdomName = "fftwf_wisdom";
+#else
+    const char *wisdomName = "fftw_wisdom";
+#endif
+    const char *home = getenv("HOME");
+    if (home != nullptr)
+    {
+        char wisdom[MAXRBUF];
+        snprintf(wisdom, MAXRBUF, "%s/.indi/%s", home, wisdomName);
+        dsp_fourier_set_wisdom_file(wisdom);
+    }
+
     convolution = new Convolution(dev);
     dft = new FourierTransform(dev);
     idft = new InverseFourierTransform(dev);
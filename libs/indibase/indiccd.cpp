@@ -28,11 +28,15 @@
 #define _FILE_OFFSET_BITS 64
 
 #include "indiccd.h"
+#include "indiimagesaver.h"
+#include "indiimagepreview.h"
+#include "stream/encoder/mjpegencoder.h"
 
 #include "fpack/fpack.h"
 #include "indicom.h"
 #include "locale_compat.h"
 #include "indiutility.h"
+#include "dsp.h"
 
 #ifdef HAVE_XISF
 #include <libxisf.h>
@@ -48,12 +52,13 @@
 #include <libastro.h>
 
 #include <iomanip>
+#include <sstream>
+#include <algorithm>
 #include <cmath>
 #include <regex>
 #include <iterator>
 #include <variant>
 
-#include <dirent.h>
 #include <cerrno>
 #include <cstdlib>
 #include <zlib.h>
@@ -127,10 +132,26 @@ CCD::CCD()
 
     exposureStartTime[0] = 0;
     exposureDuration = 0.0;
+
+    m_ImageSaver.reset(new ImageSaver());
+    m_ImageSaver->setCallback([this](const std::string &fileName, int error)
+    {
+        std::lock_guard<std::mutex> lock(m_SavedImagesLock);
+        m_SavedImages.emplace_back(fileName, error);
+    });
+    m_SavedImagesTimer.setInterval(100);
+    m_SavedImagesTimer.callOnTimeout(std::bind(&CCD::reportSavedImages, this));
+
+    m_ImagePreview.reset(new ImagePreview());
+    m_PreviewEncoder.reset(new MJPEGEncoder());
+    m_PreviewEncoder->init(this);
 }
 
 CCD::~CCD()
 {
+    // Make sure all queued images hit the disk before the device goes away.
+    m_ImageSaver.reset();
+
     // Only update if index is different.
     if (m_ConfigFastExposureIndex != IUFindOnSwitchIndex(&FastExposureToggleSP))
         saveConfig(true, FastExposureToggleSP.name);
@@ -396,6 +417,13 @@ bool CCD::initProperties()
     IUFillTextVector(&UploadSettingsTP, UploadSettingsT, 2, getDeviceName(), "UPLOAD_SETTINGS", "Upload Settings",
                      OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
 
+    // Upload Direct I/O
+    UploadDirectIOSP[INDI_ENABLED].fill("INDI_ENABLED", "Enabled", ISS_OFF);
+    UploadDirectIOSP[INDI_DISABLED].fill("INDI_DISABLED", "Disabled", ISS_ON);
+    UploadDirectIOSP.fill(getDeviceName(), "UPLOAD_DIRECT_IO", "Direct I/O", OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    UploadDirectIOSP.load();
+    m_ImageSaver->setDirectIO(UploadDirectIOSP[INDI_ENABLED].getState() == ISS_ON);
+
     // Upload File Path
     IUFillText(&FileNameT[0], "FILE_PATH", "Path", "");
     IUFillTextVector(&FileNameTP, FileNameT, 1, getDeviceName(), "CCD_FILE_PATH", "Filename", IMAGE_INFO_TAB, IP_RO, 60,
@@ -410,6 +438,57 @@ bool CCD::initProperties()
     FITSHeaderTP[KEYWORD_COMMENT].fill("KEYWORD_COMMENT", "Comment", nullptr);
     FITSHeaderTP.fill(getDeviceName(), "FITS_HEADER", "FITS Header", INFO_TAB, IP_WO, 60, IPS_IDLE);
 
+    /**********************************************/
+    /****************** Star Detection ************/
+    /**********************************************/
+
+    StarDetectionSP[INDI_ENABLED].fill("INDI_ENABLED", "Enabled", ISS_OFF);
+    StarDetectionSP[INDI_DISABLED].fill("INDI_DISABLED", "Disabled", ISS_ON);
+    StarDetectionSP.fill(getDeviceName(), "CCD_STAR_DETECTION", "Star Detection", IMAGE_SETTINGS_TAB, IP_RW, ISR_1OFMANY, 60,
+                         IPS_IDLE);
+    StarDetectionSP.load();
+
+    StarDetectionSettingsNP[STAR_DETECTION_THRESHOLD].fill("THRESHOLD", "Threshold (sigma)", "%.1f", 1, 100, 1, 5);
+    StarDetectionSettingsNP[STAR_DETECTION_MAX_STARS].fill("MAX_STARS", "Max stars", "%.f", 1, 1000, 10, 50);
+    StarDetectionSettingsNP[STAR_DETECTION_TILE_SIZE].fill("TILE_SIZE", "Background tile (px)", "%.f", 16, 1024, 16, 64);
+    StarDetectionSettingsNP.fill(getDeviceName(), "CCD_STAR_DETECTION_SETTINGS", "Star Detection", IMAGE_SETTINGS_TAB, IP_RW, 60,
+                                 IPS_IDLE);
+    StarDetectionSettingsNP.load();
+
+    StarStatsNP[STAR_STATS_COUNT].fill("STARS", "Stars", "%.f", 0, 100000, 0, 0);
+    StarStatsNP[STAR_STATS_HFR].fill("HFR", "Median HFR (px)", "%.2f", 0, 1000, 0, 0);
+    StarStatsNP[STAR_STATS_FWHM].fill("FWHM", "Median FWHM (px)", "%.2f", 0, 1000, 0, 0);
+    StarStatsNP.fill(getDeviceName(), "CCD_STAR_STATS", "Star Stats", IMAGE_INFO_TAB, IP_RO, 60, IPS_IDLE);
+
+    StarListTP[0].fill("STARS", "Stars", nullptr);
+    StarListTP.fill(getDeviceName(), "CCD_STAR_LIST", "Star List", IMAGE_INFO_TAB, IP_RO, 60, IPS_IDLE);
+
+    /**********************************************/
+    /****************** Preview *******************/
+    /**********************************************/
+
+    PreviewSP[INDI_ENABLED].fill("INDI_ENABLED", "Enabled", ISS_OFF);
+    PreviewSP[INDI_DISABLED].fill("INDI_DISABLED", "Disabled", ISS_ON);
+    PreviewSP.fill(getDeviceName(), "CCD_PREVIEW", "Preview", IMAGE_SETTINGS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    PreviewSP.load();
+
+    PreviewWidthNP[0].fill("WIDTH", "Width (px)", "%.f", 64, 4096, 64, 640);
+    PreviewWidthNP.fill(getDeviceName(), "CCD_PREVIEW_WIDTH", "Preview", IMAGE_SETTINGS_TAB, IP_RW, 60, IPS_IDLE);
+    PreviewWidthNP.load();
+
+    PreviewBP[0].fill("PREVIEW", "Preview", "");
+    PreviewBP.fill(getDeviceName(), "CCD_PREVIEW_IMAGE", "Preview", IMAGE_INFO_TAB, IP_RO, 60, IPS_IDLE);
+
+    /**********************************************/
+    /****************** Raw ROI *******************/
+    /**********************************************/
+
+    RawROISP[RAW_ROI_OFF].fill("RAW_ROI_OFF", "Off", ISS_ON);
+    RawROISP[RAW_ROI_RAW].fill("RAW_ROI_RAW", "Raw", ISS_OFF);
+    RawROISP[RAW_ROI_DELTA].fill("RAW_ROI_DELTA", "Delta", ISS_OFF);
+    RawROISP.fill(getDeviceName(), "CCD_RAW_ROI", "Subframe Upload", IMAGE_SETTINGS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    RawROISP.load();
+
     /**********************************************/
     /****************** Exposure Looping **********/
     /***************** Primary CCD Only ***********/
@@ -617,6 +696,21 @@ bool CCD::updateProperties()
         if (UploadSettingsT[UPLOAD_DIR].text == nullptr)
             IUSaveText(&UploadSettingsT[UPLOAD_DIR], getenv("HOME"));
         defineProperty(&UploadSettingsTP);
+        defineProperty(UploadDirectIOSP);
+
+        defineProperty(StarDetectionSP);
+        defineProperty(StarDetectionSettingsNP);
+        if (StarDetectionSP[INDI_ENABLED].getState() == ISS_ON)
+        {
+            defineProperty(StarStatsNP);
+            defineProperty(StarListTP);
+        }
+
+        defineProperty(PreviewSP);
+        defineProperty(PreviewWidthNP);
+        if (PreviewSP[INDI_ENABLED].getState() == ISS_ON)
+            defineProperty(PreviewBP);
+        defineProperty(RawROISP);
 
 #ifdef HAVE_WEBSOCKET
         if (HasWebSocket())
@@ -702,6 +796,21 @@ bool CCD::updateProperties()
         deleteProperty(WorldCoordSP.name);
         deleteProperty(UploadSP.name);
         deleteProperty(UploadSettingsTP.name);
+        deleteProperty(UploadDirectIOSP);
+
+        deleteProperty(StarDetectionSP);
+        deleteProperty(StarDetectionSettingsNP);
+        if (StarDetectionSP[INDI_ENABLED].getState() == ISS_ON)
+        {
+            deleteProperty(StarStatsNP);
+            deleteProperty(StarListTP);
+        }
+
+        deleteProperty(PreviewSP);
+        deleteProperty(PreviewWidthNP);
+        if (PreviewSP[INDI_ENABLED].getState() == ISS_ON)
+            deleteProperty(PreviewBP);
+        deleteProperty(RawROISP);
 
 #ifdef HAVE_WEBSOCKET
         if (HasWebSocket())
@@ -1052,6 +1161,10 @@ bool CCD::ISNewText(const char * dev, const char * name, char * texts[], char *
 
         if (!strcmp(name, UploadSettingsTP.name))
         {
+            // Images already queued keep their names, the next ones rescan the directory.
+            m_ImageSaver->flush();
+            reportSavedImages();
+            m_ImageSaver->clearIndexCache();
             IUUpdateText(&UploadSettingsTP, texts, names, n);
             UploadSettingsTP.s = IPS_OK;
             IDSetText(&UploadSettingsTP, nullptr);
@@ -1235,6 +1348,26 @@ bool CCD::ISNewNumber(const char * dev, const char * name, double values[], char
             return true;
         }
 
+        // Star Detection Settings
+        if (StarDetectionSettingsNP.isNameMatch(name))
+        {
+            StarDetectionSettingsNP.update(values, names, n);
+            StarDetectionSettingsNP.setState(IPS_OK);
+            StarDetectionSettingsNP.apply();
+            saveConfig(true, StarDetectionSettingsNP.getName());
+            return true;
+        }
+
+        // Preview Width
+        if (PreviewWidthNP.isNameMatch(name))
+        {
+            PreviewWidthNP.update(values, names, n);
+            PreviewWidthNP.setState(IPS_OK);
+            PreviewWidthNP.apply();
+            saveConfig(true, PreviewWidthNP.getName());
+            return true;
+        }
+
         if (!strcmp(name, "CCD_FRAME"))
         {
             int x = -1, y = -1, w = -1, h = -1;
@@ -1460,6 +1593,9 @@ bool CCD::ISNewSwitch(const char * dev, const char * name, ISState * states, cha
         if (!strcmp(name, UploadSP.name))
         {
             int prevMode = IUFindOnSwitchIndex(&UploadSP);
+            // Report the pending images before the file name property may be deleted.
+            m_ImageSaver->flush();
+            reportSavedImages();
             IUUpdateSwitch(&UploadSP, states, names, n);
 
             if (UpdateCCDUploadMode(static_cast<CCD_UPLOAD_MODE>(IUFindOnSwitchIndex(&UploadSP))))
@@ -1495,6 +1631,68 @@ bool CCD::ISNewSwitch(const char * dev, const char * name, ISState * states, cha
             return true;
         }
 
+        // Upload Direct I/O
+        if (UploadDirectIOSP.isNameMatch(name))
+        {
+            UploadDirectIOSP.update(states, names, n);
+            m_ImageSaver->setDirectIO(UploadDirectIOSP[INDI_ENABLED].getState() == ISS_ON);
+            UploadDirectIOSP.setState(IPS_OK);
+            UploadDirectIOSP.apply();
+            saveConfig(true, UploadDirectIOSP.getName());
+            return true;
+        }
+
+        // Star Detection
+        if (StarDetectionSP.isNameMatch(name))
+        {
+            bool wasEnabled = StarDetectionSP[INDI_ENABLED].getState() == ISS_ON;
+            StarDetectionSP.update(states, names, n);
+            bool enabled = StarDetectionSP[INDI_ENABLED].getState() == ISS_ON;
+            if (enabled && !wasEnabled)
+            {
+                defineProperty(StarStatsNP);
+                defineProperty(StarListTP);
+            }
+            else if (!enabled && wasEnabled)
+            {
+                deleteProperty(StarStatsNP);
+                deleteProperty(StarListTP);
+            }
+            StarDetectionSP.setState(IPS_OK);
+            StarDetectionSP.apply();
+            saveConfig(true, StarDetectionSP.getName());
+            return true;
+        }
+
+        // Preview
+        if (PreviewSP.isNameMatch(name))
+        {
+            bool wasEnabled = PreviewSP[INDI_ENABLED].getState() == ISS_ON;
+            PreviewSP.update(states, names, n);
+            bool enabled = PreviewSP[INDI_ENABLED].getState() == ISS_ON;
+            if (enabled && !wasEnabled)
+                defineProperty(PreviewBP);
+            else if (!enabled && wasEnabled)
+                deleteProperty(PreviewBP);
+            PreviewSP.setState(IPS_OK);
+            PreviewSP.apply();
+            saveConfig(true, PreviewSP.getName());
+            return true;
+        }
+
+        // Raw ROI
+        if (RawROISP.isNameMatch(name))
+        {
+            RawROISP.update(states, names, n);
+            // Start over with key frames.
+            m_PrimaryROIEncoder.reset();
+            m_GuideROIEncoder.reset();
+            RawROISP.setState(IPS_OK);
+            RawROISP.apply();
+            saveConfig(true, RawROISP.getName());
+            return true;
+        }
+
         // Fast Exposure Toggle
         if (!strcmp(name, FastExposureToggleSP.name))
         {
@@ -2261,6 +2459,9 @@ bool CCD::ExposureCompletePrivate(CCDChip * targetChip)
     if (processFastExposure(targetChip) == false)
         return false;
 
+    if (StarDetectionSP[INDI_ENABLED].getState() == ISS_ON)
+        detectStars(targetChip);
+
     bool sendImage = (UploadS[UPLOAD_CLIENT].s == ISS_ON || UploadS[UPLOAD_BOTH].s == ISS_ON);
     bool saveImage = (UploadS[UPLOAD_LOCAL].s == ISS_ON || UploadS[UPLOAD_BOTH].s == ISS_ON);
 
@@ -2268,6 +2469,21 @@ bool CCD::ExposureCompletePrivate(CCDChip * targetChip)
     if (targetChip->getFrameBufferSize() == 0)
         sendImage = saveImage = false;
 
+    // The preview goes out first so clients can display something while the full frame is encoded.
+    if (sendImage && targetChip == &PrimaryCCD && PreviewSP[INDI_ENABLED].getState() == ISS_ON)
+        uploadPreview(targetChip);
+
+    // Subframes sent in the raw ROI format skip the FITS encoder, it is only used to save the image.
+    if (sendImage && useRawROI(targetChip))
+    {
+        if (uploadRawROI(targetChip) == false)
+        {
+            targetChip->setExposureFailed();
+            return false;
+        }
+        sendImage = false;
+    }
+
     if (sendImage || saveImage)
     {
         if (EncodeFormatSP[FORMAT_FITS].getState() == ISS_ON)
@@ -2530,68 +2746,18 @@ bool CCD::uploadFile(CCDChip * targetChip, const void * fitsData, size_t totalBy
 
     if (saveImage)
     {
-        targetChip->FitsB.blob    = const_cast<void *>(fitsData);
-        targetChip->FitsB.bloblen = totalBytes;
-        snprintf(targetChip->FitsB.format, MAXINDIBLOBFMT, ".%s", targetChip->getImageExtension());
-
-        FILE * fp = nullptr;
-        char imageFileName[MAXRBUF];
-
-        std::string prefix = UploadSettingsT[UPLOAD_PREFIX].text;
-        int maxIndex       = getFileIndex(UploadSettingsT[UPLOAD_DIR].text, UploadSettingsT[UPLOAD_PREFIX].text,
-                                          targetChip->FitsB.format);
-
-        if (maxIndex < 0)
-        {
-            LOGF_ERROR("Error iterating directory %s. %s", UploadSettingsT[0].text,
-                       strerror(errno));
-            return false;
-        }
-
-        if (maxIndex > 0)
-        {
-            auto now = std::chrono::system_clock::now();
-            std::time_t time = std::chrono::system_clock::to_time_t(now);
-            std::tm* now_tm = std::localtime(&time);
-            long long timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
-
-            std::stringstream stream;
-            // JM 2023.08.31 Make timestamps OS friendly (Windows)
-            stream    << std::setfill('0')
-                      << std::put_time(now_tm, "%FT%H-%M-")
-                      << std::setw(2) << (timestamp / 1000) % 60 << '.'
-                      << std::setw(3) << timestamp % 1000;
-
-            prefix = std::regex_replace(prefix, std::regex("ISO8601"), stream.str());
-
-            char indexString[8];
-            snprintf(indexString, 8, "%03d", maxIndex);
-            std::string prefixIndex = indexString;
-            //prefix.replace(prefix.find("XXX"), std::string::npos, prefixIndex);
-            prefix = std::regex_replace(prefix, std::regex("XXX"), prefixIndex);
-        }
+        char extension[MAXINDIBLOBFMT];
+        snprintf(extension, MAXINDIBLOBFMT, ".%s", targetChip->getImageExtension());
 
-        snprintf(imageFileName, MAXRBUF, "%s/%s%s", UploadSettingsT[0].text, prefix.c_str(), targetChip->FitsB.format);
-
-        fp = fopen(imageFileName, "w");
-        if (fp == nullptr)
+        // Disk I/O runs in the image saver thread, the path is reported via FileNameTP once written.
+        if (m_ImageSaver->save(UploadSettingsT[UPLOAD_DIR].text, UploadSettingsT[UPLOAD_PREFIX].text, extension,
+                               fitsData, totalBytes) == false)
         {
-            LOGF_ERROR("Unable to save image file (%s). %s", imageFileName, strerror(errno));
+            LOG_ERROR("Error: Ran out of memory queuing image for saving");
             return false;
         }
-
-        int n = 0;
-        for (int nr = 0; nr < targetChip->FitsB.bloblen; nr += n)
-            n = fwrite((static_cast<char *>(targetChip->FitsB.blob) + nr), 1, targetChip->FitsB.bloblen - nr, fp);
-
-        fclose(fp);
-
-        // Save image file path
-        IUSaveText(&FileNameT[0], imageFileName);
-
-        DEBUGF(Logger::DBG_SESSION, "Image saved to %s", imageFileName);
-        FileNameTP.s = IPS_OK;
-        IDSetText(&FileNameTP, nullptr);
+        if (m_SavedImagesTimer.isActive() == false)
+            m_SavedImagesTimer.start();
     }
 
     if (targetChip->SendCompressed && EncodeFormatSP[FORMAT_XISF].getState() != ISS_ON)
@@ -2779,6 +2945,12 @@ bool CCD::saveConfigItems(FILE * fp)
     IUSaveConfigText(fp, &ActiveDeviceTP);
     IUSaveConfigSwitch(fp, &UploadSP);
     IUSaveConfigText(fp, &UploadSettingsTP);
+    UploadDirectIOSP.save(fp);
+    StarDetectionSP.save(fp);
+    StarDetectionSettingsNP.save(fp);
+    PreviewSP.save(fp);
+    PreviewWidthNP.save(fp);
+    RawROISP.save(fp);
     IUSaveConfigSwitch(fp, &FastExposureToggleSP);
 
     IUSaveConfigSwitch(fp, &PrimaryCCD.CompressSP);
@@ -2910,76 +3082,216 @@ void CCD::getMinMax(double * min, double * max, CCDChip * targetChip)
     *max = lmax;
 }
 
-std::string regex_replace_compat(const std::string &input, const std::string &pattern, const std::string &replace)
+void CCD::reportSavedImages()
 {
-    std::stringstream s;
-    std::regex_replace(std::ostreambuf_iterator<char>(s), input.begin(), input.end(), std::regex(pattern), replace);
-    return s.str();
+    // Nothing is left to write once no save is pending, the queue then holds all the results.
+    bool done = m_ImageSaver->pending() == 0;
+    std::deque<std::pair<std::string, int>> saved;
+    {
+        std::lock_guard<std::mutex> lock(m_SavedImagesLock);
+        saved.swap(m_SavedImages);
+    }
+    for (const auto &image : saved)
+        imageSaved(image.first, image.second);
+    if (done)
+        m_SavedImagesTimer.stop();
 }
 
-int CCD::getFileIndex(const char * dir, const char * prefix, const char * ext)
+void CCD::imageSaved(const std::string &fileName, int error)
 {
-    INDI_UNUSED(ext);
+    if (error)
+    {
+        LOGF_ERROR("Unable to save image file (%s). %s", fileName.c_str(), strerror(error));
+        FileNameTP.s = IPS_ALERT;
+        IDSetText(&FileNameTP, nullptr);
+        return;
+    }
 
-    DIR * dpdf = nullptr;
-    struct dirent * epdf = nullptr;
-    std::vector<std::string> files = std::vector<std::string>();
+    // Save image file path
+    IUSaveText(&FileNameT[0], fileName.c_str());
 
-    std::string prefixIndex = prefix;
-    prefixIndex             = regex_replace_compat(prefixIndex, "_ISO8601", "");
-    prefixIndex             = regex_replace_compat(prefixIndex, "_XXX", "");
+    DEBUGF(Logger::DBG_SESSION, "Image saved to %s", fileName.c_str());
+    FileNameTP.s = IPS_OK;
+    IDSetText(&FileNameTP, nullptr);
+}
 
-    // Create directory if does not exist
-    struct stat st;
+void CCD::detectStars(CCDChip * targetChip)
+{
+    // Only monochrome or raw bayer frames are measured.
+    if (targetChip->getNAxis() != 2)
+        return;
+
+    int width  = targetChip->getSubW() / targetChip->getBinX();
+    int height = targetChip->getSubH() / targetChip->getBinY();
+    int bpp    = targetChip->getBPP();
+    size_t size = static_cast<size_t>(width) * height * (bpp / 8);
+    if (width < 3 || height < 3 || size > static_cast<size_t>(targetChip->getFrameBufferSize()))
+        return;
+
+    dsp_stream_p stream = dsp_stream_new();
+    dsp_stream_add_dim(stream, width);
+    dsp_stream_add_dim(stream, height);
+    dsp_stream_alloc_buffer(stream, stream->len);
 
-    if (stat(dir, &st) == -1)
     {
-        if (errno == ENOENT)
-        {
-            DEBUGF(Logger::DBG_DEBUG, "Creating directory %s...", dir);
-            if (INDI::mkpath(dir, 0755) == -1)
-                LOGF_ERROR("Error creating directory %s (%s)", dir, strerror(errno));
-        }
-        else
+        std::unique_lock<std::mutex> guard(ccdBufferLock);
+        switch (bpp)
         {
-            LOGF_ERROR("Couldn't stat directory %s: %s", dir, strerror(errno));
-            return -1;
+            case 8:
+                dsp_buffer_copy(targetChip->getFrameBuffer(), stream->buf, stream->len);
+                break;
+            case 16:
+                dsp_buffer_copy(reinterpret_cast<uint16_t *>(targetChip->getFrameBuffer()), stream->buf, stream->len);
+                break;
+            case 32:
+                dsp_buffer_copy(reinterpret_cast<uint32_t *>(targetChip->getFrameBuffer()), stream->buf, stream->len);
+                break;
+            default:
+                dsp_stream_free_buffer(stream);
+                dsp_stream_free(stream);
+                return;
         }
     }
 
-    dpdf = opendir(dir);
-    if (dpdf != nullptr)
+    int count = dsp_align_find_stars(stream, static_cast<int>(StarDetectionSettingsNP[STAR_DETECTION_TILE_SIZE].getValue()),
+                                     StarDetectionSettingsNP[STAR_DETECTION_THRESHOLD].getValue(),
+                                     static_cast<int>(StarDetectionSettingsNP[STAR_DETECTION_MAX_STARS].getValue()));
+
+    std::vector<double> hfr(count), fwhm(count);
+    std::ostringstream list;
+    list << std::fixed << std::setprecision(2);
+    for (int i = 0; i < count; i++)
     {
-        while ((epdf = readdir(dpdf)))
+        const dsp_star &star = stream->stars[i];
+        hfr[i]  = star.hfr;
+        fwhm[i] = star.diameter;
+        if (i > 0)
+            list << ';';
+        list << star.center.location[0] << ',' << star.center.location[1] << ',' << star.hfr << ',' << star.diameter << ','
+             << star.flux;
+        free(star.center.location);
+    }
+
+    dsp_stream_free_buffer(stream);
+    dsp_stream_free(stream);
+
+    auto median = [](std::vector<double> &values)
+    {
+        if (values.empty())
+            return 0.0;
+        auto middle = values.begin() + values.size() / 2;
+        std::nth_element(values.begin(), middle, values.end());
+        return *middle;
+    };
+
+    StarStatsNP[STAR_STATS_COUNT].setValue(count);
+    StarStatsNP[STAR_STATS_HFR].setValue(median(hfr));
+    StarStatsNP[STAR_STATS_FWHM].setValue(median(fwhm));
+    StarStatsNP.setState(count > 0 ? IPS_OK : IPS_ALERT);
+    StarStatsNP.apply();
+
+    StarListTP[0].setText(list.str());
+    StarListTP.setState(count > 0 ? IPS_OK : IPS_ALERT);
+    StarListTP.apply();
+
+    LOGF_DEBUG("Detected %d stars, median HFR %.2f FWHM %.2f", count, StarStatsNP[STAR_STATS_HFR].getValue(),
+               StarStatsNP[STAR_STATS_FWHM].getValue());
+}
+
+void CCD::uploadPreview(CCDChip * targetChip)
+{
+    uint32_t width    = targetChip->getSubW() / targetChip->getBinX();
+    uint32_t height   = targetChip->getSubH() / targetChip->getBinY();
+    uint8_t channels  = targetChip->getNAxis() == 3 ? 3 : 1;
+    size_t size       = static_cast<size_t>(width) * height * channels * (targetChip->getBPP() / 8);
+    if (size > static_cast<size_t>(targetChip->getFrameBufferSize()))
+        return;
+
+    std::lock_guard<std::mutex> previewGuard(m_PreviewLock);
+    auto start = std::chrono::high_resolution_clock::now();
+
+    {
+        std::unique_lock<std::mutex> guard(ccdBufferLock);
+        if (m_ImagePreview->generate(targetChip->getFrameBuffer(), width, height, targetChip->getBPP(), channels,
+                                     static_cast<uint32_t>(PreviewWidthNP[0].getValue())) == false)
         {
-            if (strstr(epdf->d_name, prefixIndex.c_str()))
-                files.push_back(epdf->d_name);
+            LOGF_DEBUG("Preview is not supported for %d bits per pixel.", targetChip->getBPP());
+            return;
         }
     }
-    else
+
+    m_PreviewEncoder->setPixelFormat(channels == 3 ? INDI_RGB : INDI_MONO, 8);
+    m_PreviewEncoder->setSize(m_ImagePreview->width(), m_ImagePreview->height());
+    if (m_PreviewEncoder->upload(&PreviewBP[0], m_ImagePreview->data(), m_ImagePreview->size()) == false)
     {
-        closedir(dpdf);
-        return -1;
+        PreviewBP.setState(IPS_ALERT);
+        PreviewBP.apply();
+        return;
     }
-    int maxIndex = 0;
 
-    for (uint32_t i = 0; i < files.size(); i++)
+    PreviewBP[0].setFormat(".jpg");
+    PreviewBP.setState(IPS_OK);
+    PreviewBP.apply();
+
+    std::chrono::duration<double> diff = std::chrono::high_resolution_clock::now() - start;
+    LOGF_DEBUG("Preview %dx%d sent in %g seconds", m_ImagePreview->width(), m_ImagePreview->height(), diff.count());
+}
+
+bool CCD::useRawROI(CCDChip * targetChip)
+{
+    if (RawROISP[RAW_ROI_OFF].getState() == ISS_ON || targetChip->getBPP() > 16)
+        return false;
+
+    // Full frames keep using the selected encoding format.
+    return targetChip->getSubW() < targetChip->getXRes() || targetChip->getSubH() < targetChip->getYRes();
+}
+
+bool CCD::uploadRawROI(CCDChip * targetChip)
+{
+    RawROIEncoder &encoder = (targetChip == &PrimaryCCD) ? m_PrimaryROIEncoder : m_GuideROIEncoder;
+
+    RawROIHeader header;
+    header.x        = targetChip->getSubX();
+    header.y        = targetChip->getSubY();
+    header.width    = targetChip->getSubW() / targetChip->getBinX();
+    header.height   = targetChip->getSubH() / targetChip->getBinY();
+    header.binX     = targetChip->getBinX();
+    header.binY     = targetChip->getBinY();
+    header.bpp      = targetChip->getBPP();
+    header.channels = targetChip->getNAxis() == 3 ? 3 : 1;
+    header.exposure = targetChip->getExposureDuration();
+
+    size_t size = static_cast<size_t>(header.width) * header.height * header.channels * (header.bpp / 8);
+    if (size > static_cast<size_t>(targetChip->getFrameBufferSize()))
     {
-        int index = -1;
+        LOG_ERROR("Error: Frame buffer is smaller than the subframe");
+        return false;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
 
-        std::string file  = files.at(i);
-        std::size_t start = file.find_last_of("_");
-        std::size_t end   = file.find_last_of(".");
-        if (start != std::string::npos)
+    encoder.setDelta(RawROISP[RAW_ROI_DELTA].getState() == ISS_ON);
+    encoder.setCompression(targetChip->SendCompressed);
+    {
+        std::unique_lock<std::mutex> guard(ccdBufferLock);
+        if (encoder.encode(targetChip->getFrameBuffer(), header) == false)
         {
-            index = atoi(file.substr(start + 1, end).c_str());
-            if (index > maxIndex)
-                maxIndex = index;
+            LOG_ERROR("Error: Failed to encode raw ROI frame");
+            return false;
         }
     }
 
-    closedir(dpdf);
-    return (maxIndex + 1);
+    targetChip->FitsB.blob    = const_cast<uint8_t *>(encoder.data());
+    targetChip->FitsB.bloblen = encoder.size();
+    targetChip->FitsB.size    = encoder.size();
+    snprintf(targetChip->FitsB.format, MAXINDIBLOBFMT, ".roi");
+    targetChip->FitsBP.s = IPS_OK;
+    IDSetBLOB(&targetChip->FitsBP, nullptr);
+
+    std::chrono::duration<double> diff = std::chrono::high_resolution_clock::now() - start;
+    LOGF_DEBUG("Raw ROI %dx%d (%d bytes) sent in %g seconds", header.width, header.height, static_cast<int>(encoder.size()),
+               diff.count());
+    return true;
 }
 
 void CCD::GuideComplete(INDI_EQ_AXIS axis)
@@ -34,6 +34,7 @@
 #include "inditimer.h"
 #include "indielapsedtimer.h"
 #include "fitskeyword.h"
+#include "indirawroi.h"
 #include "dsp/manager.h"
 #include "stream/streammanager.h"
 
@@ -44,6 +45,8 @@
 #include <fitsio.h>
 
 #include <map>
+#include <deque>
+#include <memory>
 #include <cstring>
 #include <chrono>
 #include <stdint.h>
@@ -64,6 +67,9 @@ namespace INDI
 
 class StreamManager;
 class XISFWrapper;
+class ImageSaver;
+class ImagePreview;
+class MJPEGEncoder;
 
 /**
  * \class CCD
@@ -724,6 +730,9 @@ class CCD : public DefaultDevice, GuiderInterface
             UPLOAD_PREFIX
         };
 
+        /// Bypass the page cache (O_DIRECT) when saving images locally.
+        INDI::PropertySwitch UploadDirectIOSP {2};
+
         // Telescope Information
         INDI::PropertyNumber ScopeInfoNP {2};
         enum
@@ -776,6 +785,43 @@ class CCD : public DefaultDevice, GuiderInterface
             KEYWORD_COMMENT,
         };
 
+        /// Detect stars and measure HFR/FWHM on every captured frame.
+        INDI::PropertySwitch StarDetectionSP {2};
+
+        INDI::PropertyNumber StarDetectionSettingsNP {3};
+        enum
+        {
+            STAR_DETECTION_THRESHOLD,
+            STAR_DETECTION_MAX_STARS,
+            STAR_DETECTION_TILE_SIZE
+        };
+
+        /// Results of star detection on the last frame.
+        INDI::PropertyNumber StarStatsNP {3};
+        enum
+        {
+            STAR_STATS_COUNT,
+            STAR_STATS_HFR,
+            STAR_STATS_FWHM
+        };
+
+        /// Detected stars as x,y,hfr,fwhm,flux tuples separated by semicolons, brightest first.
+        INDI::PropertyText StarListTP {1};
+
+        /// Send a small stretched JPEG preview before the full resolution image.
+        INDI::PropertySwitch PreviewSP {2};
+        INDI::PropertyNumber PreviewWidthNP {1};
+        INDI::PropertyBlob PreviewBP {1};
+
+        /// Send subframes in the raw ROI format instead of FITS, optionally delta encoded.
+        INDI::PropertySwitch RawROISP {3};
+        enum
+        {
+            RAW_ROI_OFF,
+            RAW_ROI_RAW,
+            RAW_ROI_DELTA
+        };
+
     private:
         uint32_t capability;
 
@@ -786,12 +832,33 @@ class CCD : public DefaultDevice, GuiderInterface
 
         std::map<std::string, FITSRecord> m_CustomFITSKeywords;
 
+        /// Writes locally saved images in a dedicated I/O thread.
+        std::unique_ptr<ImageSaver> m_ImageSaver;
+        /// Results of the I/O thread, reported from the main thread while saves are pending.
+        std::deque<std::pair<std::string, int>> m_SavedImages;
+        std::mutex m_SavedImagesLock;
+        INDI::Timer m_SavedImagesTimer;
+
+        /// Generates and encodes the preview image.
+        std::unique_ptr<ImagePreview> m_ImagePreview;
+        std::unique_ptr<MJPEGEncoder> m_PreviewEncoder;
+        std::mutex m_PreviewLock;
+
+        /// Raw ROI encoders keep the previous frame of each chip for delta encoding.
+        RawROIEncoder m_PrimaryROIEncoder;
+        RawROIEncoder m_GuideROIEncoder;
+
         ///////////////////////////////////////////////////////////////////////////////
         /// Utility Functions
         ///////////////////////////////////////////////////////////////////////////////
         bool uploadFile(CCDChip * targetChip, const void * fitsData, size_t totalBytes, bool sendImage, bool saveImage);
         void getMinMax(double * min, double * max, CCDChip * targetChip);
-        int getFileIndex(const char * dir, const char * prefix, const char * ext);
+        void imageSaved(const std::string &fileName, int error);
+        void reportSavedImages();
+        void detectStars(CCDChip * targetChip);
+        void uploadPreview(CCDChip * targetChip);
+        bool useRawROI(CCDChip * targetChip);
+        bool uploadRawROI(CCDChip * targetChip);
         bool ExposureCompletePrivate(CCDChip * targetChip);
 
         // Threading for Websocket
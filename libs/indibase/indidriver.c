@@ -1316,6 +1316,47 @@ void IDSetBLOB(const IBLOBVectorProperty *bvp, const char *fmt, ...)
     va_end(ap);
 }
 
+/* tell client to update part of an element of an existing BLOB vector property */
+void IDSetBLOBChunk(const IBLOBVectorProperty *bvp, int index, unsigned int offset, unsigned int length)
+{
+    char buffer[64];
+
+    if (index < 0 || index >= bvp->nbp)
+        return;
+
+    const IBLOB *bp = &bvp->bp[index];
+    if (length == 0 || offset > (unsigned int)bp->bloblen || length > (unsigned int)bp->bloblen - offset)
+        return;
+
+    // Throttle once per BLOB, not per chunk, so chunks of the same BLOB are never delayed.
+    if (offset == 0 && lastBlobPingUid) {
+        snprintf(buffer, 64, BLOB_PING_PATTERN, lastBlobPingUid);
+        waitPingReply(buffer);
+    }
+
+    // Each chunk is sent from its own buffer: attaching the element's blob would seal it while the
+    // driver is still writing the following chunks into it.
+    void *chunk = IDSharedBlobAlloc(length);
+    if (chunk == NULL)
+        return;
+    memcpy(chunk, (const char *)bp->blob + offset, length);
+
+    driverio io;
+    driverio_init(&io);
+
+    userio_xmlv1(&io.userio, io.user);
+    IUUserIOSetBLOBChunk(&io.userio, io.user, bvp, bp, offset, length, chunk);
+
+    if (offset + length == (unsigned int)bp->bloblen) {
+        lastBlobPingUid++;
+        snprintf(buffer, 64, BLOB_PING_PATTERN, lastBlobPingUid);
+        IUUserIOPingRequest(&io.userio, io.user, buffer);
+    }
+
+    driverio_finish(&io);
+    IDSharedBlobFree(chunk);
+}
+
 /* tell client to update min/max elements of an existing number vector property */
 void IUUpdateMinMax(const INumberVectorProperty *nvp)
 {
@@ -0,0 +1,187 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ Downscaled and stretched image previews.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "indiimagepreview.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace INDI
+{
+
+// Midtones transfer function, maps m to 0.5 keeping 0 and 1 fixed.
+static double mtf(double m, double x)
+{
+    if (x <= 0)
+        return 0;
+    if (x >= 1)
+        return 1;
+    return ((m - 1) * x) / ((2 * m - 1) * x - m);
+}
+
+bool ImagePreview::generate(const uint8_t *buffer, uint32_t width, uint32_t height, uint8_t bpp, uint8_t channels,
+                            uint32_t targetWidth)
+{
+    if (buffer == nullptr || (bpp != 8 && bpp != 16 && bpp != 32) || (channels != 1 && channels != 3) || targetWidth == 0)
+        return false;
+
+    uint32_t factor = std::max<uint32_t>(1, (width + targetWidth - 1) / targetWidth);
+    uint32_t outWidth  = width / factor;
+    uint32_t outHeight = height / factor;
+    if (outWidth == 0 || outHeight == 0 || outWidth > UINT16_MAX || outHeight > UINT16_MAX)
+        return false;
+
+    m_Width    = outWidth;
+    m_Height   = outHeight;
+    m_Channels = channels;
+
+    size_t pixels = static_cast<size_t>(outWidth) * outHeight;
+    size_t planeBytes = static_cast<size_t>(width) * height * (bpp / 8);
+    m_Samples.resize(pixels * channels);
+    m_Histogram.assign(bpp == 8 ? 256 : 65536, 0);
+
+    for (uint8_t c = 0; c < channels; c++)
+    {
+        const uint8_t *plane = buffer + c * planeBytes;
+        uint16_t *out = m_Samples.data() + c * pixels;
+        switch (bpp)
+        {
+            case 8:
+                downsample(plane, width, factor, 0, out);
+                break;
+            case 16:
+                downsample(reinterpret_cast<const uint16_t *>(plane), width, factor, 0, out);
+                break;
+            case 32:
+                downsample(reinterpret_cast<const uint32_t *>(plane), width, factor, 16, out);
+                break;
+        }
+    }
+
+    buildLut();
+
+    m_Preview.resize(pixels * channels);
+    if (channels == 1)
+    {
+        for (size_t i = 0; i < pixels; i++)
+            m_Preview[i] = m_Lut[m_Samples[i]];
+    }
+    else
+    {
+        const uint16_t *r = m_Samples.data();
+        const uint16_t *g = r + pixels;
+        const uint16_t *b = g + pixels;
+        for (size_t i = 0; i < pixels; i++)
+        {
+            m_Preview[i * 3]     = m_Lut[r[i]];
+            m_Preview[i * 3 + 1] = m_Lut[g[i]];
+            m_Preview[i * 3 + 2] = m_Lut[b[i]];
+        }
+    }
+
+    return true;
+}
+
+template <typename T>
+void ImagePreview::downsample(const T *plane, uint32_t width, uint32_t factor, int shift, uint16_t *out)
+{
+    uint32_t outWidth  = m_Width;
+    uint32_t outHeight = m_Height;
+    uint32_t span = outWidth * factor;
+    uint64_t area = static_cast<uint64_t>(factor) * factor;
+    uint32_t *histogram = m_Histogram.data();
+
+    m_RowSums.resize(span);
+    uint64_t *sums = m_RowSums.data();
+
+    for (uint32_t y = 0; y < outHeight; y++)
+    {
+        // Sum the block rows column by column first, this loop is trivially vectorized.
+        std::fill(sums, sums + span, 0);
+        for (uint32_t r = 0; r < factor; r++)
+        {
+            const T *row = plane + static_cast<size_t>(y * factor + r) * width;
+            for (uint32_t x = 0; x < span; x++)
+                sums[x] += row[x];
+        }
+
+        uint16_t *outRow = out + static_cast<size_t>(y) * outWidth;
+        for (uint32_t x = 0; x < outWidth; x++)
+        {
+            uint64_t sum = 0;
+            for (uint32_t k = 0; k < factor; k++)
+                sum += sums[x * factor + k];
+            uint16_t value = static_cast<uint16_t>((sum / area) >> shift);
+            outRow[x] = value;
+            histogram[value]++;
+        }
+    }
+}
+
+void ImagePreview::buildLut()
+{
+    const size_t levels = m_Histogram.size();
+    std::vector<uint64_t> cumulative(levels);
+    uint64_t total = 0;
+    for (size_t i = 0; i < levels; i++)
+    {
+        total += m_Histogram[i];
+        cumulative[i] = total;
+    }
+
+    auto countBelow = [&](int64_t level) -> uint64_t
+    {
+        if (level < 0)
+            return 0;
+        return cumulative[std::min<int64_t>(level, levels - 1)];
+    };
+
+    int64_t median = std::lower_bound(cumulative.begin(), cumulative.end(), (total + 1) / 2) - cumulative.begin();
+    int64_t white  = std::lower_bound(cumulative.begin(), cumulative.end(), total) - cumulative.begin();
+
+    // Median absolute deviation: smallest distance around the median holding half of the pixels.
+    int64_t low = 0, high = levels - 1;
+    while (low < high)
+    {
+        int64_t mid = (low + high) / 2;
+        if (countBelow(median + mid) - countBelow(median - mid - 1) >= (total + 1) / 2)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+    double mad = std::max<double>(low, 1) * 1.4826;
+
+    double black = std::max(0.0, median + SHADOWS_CLIPPING * mad);
+    double range = white - black;
+
+    m_Lut.resize(levels);
+    if (range <= 0)
+    {
+        for (size_t i = 0; i < levels; i++)
+            m_Lut[i] = i > black ? 255 : 0;
+        return;
+    }
+
+    double midtones = std::min(std::max(mtf(TARGET_BACKGROUND, (median - black) / range), 0.0001), 0.9999);
+    for (size_t i = 0; i < levels; i++)
+        m_Lut[i] = static_cast<uint8_t>(std::lround(255 * mtf(midtones, (i - black) / range)));
+}
+
+}
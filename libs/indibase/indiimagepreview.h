@@ -0,0 +1,104 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ Downscaled and stretched image previews.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace INDI
+{
+
+/**
+ * \class ImagePreview
+ * \brief Builds a small 8-bit preview of a camera frame.
+ *
+ * The frame is downsampled by an integer factor using area averaging so that it is no wider than
+ * the requested width. The histogram of the downsampled pixels is collected in the same pass and
+ * used to auto-stretch the preview: the black point is placed a few MADs below the median and a
+ * midtones transfer function brings the median to a fixed background level.
+ *
+ * Mono frames produce a grayscale preview. Planar RGB frames (NAxis = 3) produce an interleaved RGB
+ * preview stretched with the statistics of all channels combined.
+ */
+class ImagePreview
+{
+    public:
+        /**
+         * @brief generate Downsample and stretch a frame.
+         * @param buffer Frame data, planar if channels is 3.
+         * @param width Frame width in pixels.
+         * @param height Frame height in pixels.
+         * @param bpp Bits per pixel, 8, 16 or 32.
+         * @param channels 1 for mono frames, 3 for planar RGB frames.
+         * @param targetWidth Maximum width of the preview.
+         * @return True if the preview is generated, false if the frame format is not supported.
+         */
+        bool generate(const uint8_t *buffer, uint32_t width, uint32_t height, uint8_t bpp, uint8_t channels,
+                      uint32_t targetWidth);
+
+        /// @return Preview pixels, interleaved if RGB.
+        const uint8_t *data() const
+        {
+            return m_Preview.data();
+        }
+        /// @return Preview size in bytes.
+        uint32_t size() const
+        {
+            return m_Preview.size();
+        }
+        uint16_t width() const
+        {
+            return m_Width;
+        }
+        uint16_t height() const
+        {
+            return m_Height;
+        }
+        uint8_t channels() const
+        {
+            return m_Channels;
+        }
+
+    public:
+        /// Target normalized level of the median after stretching.
+        static constexpr double TARGET_BACKGROUND = 0.25;
+        /// Black point distance below the median, in normalized MAD units.
+        static constexpr double SHADOWS_CLIPPING  = -2.8;
+
+    private:
+        template <typename T>
+        void downsample(const T *plane, uint32_t width, uint32_t factor, int shift, uint16_t *out);
+        void buildLut();
+
+    private:
+        uint16_t m_Width {0};
+        uint16_t m_Height {0};
+        uint8_t m_Channels {1};
+
+        // Downsampled planes and their combined histogram.
+        std::vector<uint16_t> m_Samples;
+        std::vector<uint32_t> m_Histogram;
+        std::vector<uint64_t> m_RowSums;
+        std::vector<uint8_t> m_Lut;
+        std::vector<uint8_t> m_Preview;
+};
+
+}
@@ -0,0 +1,432 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ Asynchronous local image saving.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+// use 64-bit values when calling stat()
+#define _FILE_OFFSET_BITS 64
+
+#include "indiimagesaver.h"
+#include "indiutility.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <ctime>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace INDI
+{
+
+ImageSaver::ImageSaver()
+{
+    m_Thread = std::thread(&ImageSaver::run, this);
+}
+
+ImageSaver::~ImageSaver()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Quit = true;
+    }
+    m_Increase.notify_all();
+
+    if (m_Thread.joinable())
+        m_Thread.join();
+}
+
+void ImageSaver::setCallback(const Callback &callback)
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+    m_Callback = callback;
+}
+
+void ImageSaver::setDirectIO(bool enabled)
+{
+    m_DirectIO = enabled;
+}
+
+bool ImageSaver::save(const std::string &directory, const std::string &prefix, const std::string &extension,
+                      const void *data, size_t size)
+{
+    Job job;
+    job.directory = directory;
+    job.prefix    = prefix;
+    job.extension = extension;
+    job.timestamp = std::chrono::system_clock::now();
+    job.size      = size;
+
+    // Round up so the last chunk can be written with O_DIRECT as well.
+    size_t capacity = (size + BUFFER_ALIGNMENT - 1) / BUFFER_ALIGNMENT * BUFFER_ALIGNMENT;
+    void *buffer = nullptr;
+    if (posix_memalign(&buffer, BUFFER_ALIGNMENT, std::max<size_t>(capacity, BUFFER_ALIGNMENT)) != 0)
+        return false;
+
+    job.data = static_cast<uint8_t *>(buffer);
+    memcpy(job.data, data, size);
+    memset(job.data + size, 0, capacity - size);
+
+    std::unique_lock<std::mutex> lock(m_Lock);
+    // Apply back pressure if the disk cannot keep up, but always accept at least one image.
+    m_Decrease.wait(lock, [&]()
+    {
+        return m_Queue.empty() || m_PendingBytes + size <= MAX_PENDING_BYTES;
+    });
+    m_PendingBytes += size;
+    m_Queue.push_back(std::move(job));
+    m_Increase.notify_one();
+    return true;
+}
+
+void ImageSaver::flush()
+{
+    std::unique_lock<std::mutex> lock(m_Lock);
+    m_Decrease.wait(lock, [this]()
+    {
+        return m_Queue.empty() && m_Busy == false;
+    });
+}
+
+void ImageSaver::clearIndexCache()
+{
+    m_ClearIndexes = true;
+}
+
+size_t ImageSaver::pending() const
+{
+    std::lock_guard<std::mutex> lock(m_Lock);
+    return m_Queue.size() + (m_Busy ? 1 : 0);
+}
+
+void ImageSaver::run()
+{
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_Lock);
+            if (m_Queue.empty())
+            {
+                // Queue drained, this is the right time to flush everything written so far.
+                if (!m_Unsynced.empty())
+                {
+                    m_Busy = true;
+                    lock.unlock();
+                    syncPending();
+                    lock.lock();
+                }
+                m_Busy = false;
+                m_Decrease.notify_all();
+                m_Increase.wait(lock, [this]()
+                {
+                    return m_Quit || !m_Queue.empty();
+                });
+            }
+
+            if (m_Queue.empty())
+                break;
+
+            job = std::move(m_Queue.front());
+            m_Queue.pop_front();
+            m_Busy = true;
+        }
+
+        write(job);
+
+        free(job.data);
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            m_PendingBytes -= job.size;
+        }
+        m_Decrease.notify_all();
+
+        if (m_Unsynced.size() >= MAX_UNSYNCED)
+            syncPending();
+    }
+
+    syncPending();
+}
+
+const ImageSaver::NameTemplate &ImageSaver::nameTemplate(const std::string &prefix)
+{
+    auto it = m_Templates.find(prefix);
+    if (it != m_Templates.end())
+        return it->second;
+
+    NameTemplate pattern;
+    size_t start = 0;
+    while (start < prefix.size())
+    {
+        size_t timestamp = prefix.find("ISO8601", start);
+        size_t index     = prefix.find("XXX", start);
+        size_t next      = std::min(timestamp, index);
+        if (next == std::string::npos)
+        {
+            pattern.parts.push_back({NameTemplate::LITERAL, prefix.substr(start)});
+            break;
+        }
+
+        if (next > start)
+            pattern.parts.push_back({NameTemplate::LITERAL, prefix.substr(start, next - start)});
+
+        if (next == timestamp)
+        {
+            pattern.parts.push_back({NameTemplate::TIMESTAMP, std::string()});
+            start = next + 7;
+        }
+        else
+        {
+            pattern.parts.push_back({NameTemplate::INDEX, std::string()});
+            pattern.hasIndex = true;
+            start = next + 3;
+        }
+    }
+
+    // Files belonging to this prefix are found by the prefix without its placeholders.
+    pattern.scanKey = prefix;
+    for (const char *token : {"_ISO8601", "_XXX"})
+    {
+        size_t pos;
+        while ((pos = pattern.scanKey.find(token)) != std::string::npos)
+            pattern.scanKey.erase(pos, strlen(token));
+    }
+
+    return m_Templates.emplace(prefix, std::move(pattern)).first->second;
+}
+
+int ImageSaver::scanIndex(const std::string &directory, const std::string &scanKey)
+{
+    struct stat st;
+    if (stat(directory.c_str(), &st) == -1)
+    {
+        if (errno != ENOENT)
+            return -1;
+
+        if (INDI::mkpath(directory, 0755) == -1)
+            return -1;
+
+        return 1;
+    }
+
+    DIR *dpdf = opendir(directory.c_str());
+    if (dpdf == nullptr)
+        return -1;
+
+    int maxIndex = 0;
+    struct dirent *epdf = nullptr;
+    while ((epdf = readdir(dpdf)))
+    {
+        if (strstr(epdf->d_name, scanKey.c_str()) == nullptr)
+            continue;
+
+        const char *start = strrchr(epdf->d_name, '_');
+        if (start == nullptr)
+            continue;
+
+        int index = atoi(start + 1);
+        if (index > maxIndex)
+            maxIndex = index;
+    }
+    closedir(dpdf);
+
+    return maxIndex + 1;
+}
+
+int ImageSaver::nextIndex(const std::string &directory, const NameTemplate &pattern)
+{
+    if (m_ClearIndexes.exchange(false))
+        m_Indexes.clear();
+
+    std::string key = directory + '\0' + pattern.scanKey;
+    auto it = m_Indexes.find(key);
+    if (it != m_Indexes.end())
+        return it->second++;
+
+    int index = scanIndex(directory, pattern.scanKey);
+    if (index < 0)
+        return index;
+
+    m_Indexes[key] = index + 1;
+    return index;
+}
+
+std::string ImageSaver::buildName(const NameTemplate &pattern, const Job &job, int index) const
+{
+    std::string name = job.directory + "/";
+
+    for (const auto &part : pattern.parts)
+    {
+        switch (part.first)
+        {
+            case NameTemplate::LITERAL:
+                name += part.second;
+                break;
+
+            case NameTemplate::TIMESTAMP:
+            {
+                std::time_t time = std::chrono::system_clock::to_time_t(job.timestamp);
+                std::tm now_tm;
+                localtime_r(&time, &now_tm);
+                long long timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(job.timestamp.time_since_epoch()).count();
+
+                std::stringstream stream;
+                // JM 2023.08.31 Make timestamps OS friendly (Windows)
+                stream << std::setfill('0')
+                       << std::put_time(&now_tm, "%FT%H-%M-")
+                       << std::setw(2) << (timestamp / 1000) % 60 << '.'
+                       << std::setw(3) << timestamp % 1000;
+                name += stream.str();
+            }
+            break;
+
+            case NameTemplate::INDEX:
+            {
+                char indexString[16];
+                snprintf(indexString, sizeof(indexString), "%03d", index);
+                name += indexString;
+            }
+            break;
+        }
+    }
+
+    return name + job.extension;
+}
+
+int ImageSaver::openFile(const std::string &fileName, bool exclusive, bool &direct)
+{
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (exclusive ? O_EXCL : O_TRUNC);
+#ifdef O_DIRECT
+    if (direct)
+    {
+        int fd = open(fileName.c_str(), flags | O_DIRECT, 0644);
+        // Filesystems such as tmpfs do not support direct I/O.
+        if (fd >= 0 || errno != EINVAL)
+            return fd;
+    }
+#endif
+    direct = false;
+    return open(fileName.c_str(), flags, 0644);
+}
+
+bool ImageSaver::write(const Job &job)
+{
+    Callback callback;
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        callback = m_Callback;
+    }
+
+    const NameTemplate &pattern = nameTemplate(job.prefix);
+    std::string fileName;
+    bool direct = m_DirectIO;
+    int fd = -1;
+
+    // If another process created a file with our index, skip to the next one.
+    for (int attempt = 0; attempt < 100 && fd < 0; attempt++)
+    {
+        int index = 0;
+        if (pattern.hasIndex)
+        {
+            index = nextIndex(job.directory, pattern);
+            if (index < 0)
+                break;
+        }
+
+        fileName = buildName(pattern, job, index);
+        fd = openFile(fileName, pattern.hasIndex, direct);
+
+        if (fd < 0 && errno == ENOENT)
+        {
+            // Directory was removed since it was last scanned.
+            m_Indexes.erase(job.directory + '\0' + pattern.scanKey);
+            if (INDI::mkpath(job.directory, 0755) == -1)
+                break;
+        }
+        else if (fd < 0 && errno != EEXIST)
+            break;
+    }
+
+    if (fd < 0)
+    {
+        int error = errno;
+        if (callback)
+            callback(fileName.empty() ? job.directory : fileName, error ? error : EIO);
+        return false;
+    }
+
+#ifdef __linux__
+    // Reserve the space up front so the filesystem can allocate contiguous extents.
+    // Unlike posix_fallocate, this never falls back to writing zeros when unsupported.
+    if (job.size > 0)
+        fallocate(fd, 0, 0, job.size);
+#endif
+
+    size_t total = direct ? (job.size + BUFFER_ALIGNMENT - 1) / BUFFER_ALIGNMENT * BUFFER_ALIGNMENT : job.size;
+    size_t offset = 0;
+    int error = 0;
+    while (offset < total)
+    {
+        ssize_t n = ::write(fd, job.data + offset, std::min(WRITE_CHUNK_SIZE, total - offset));
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            error = errno;
+            break;
+        }
+        offset += n;
+    }
+
+    // Direct I/O writes whole blocks, trim the padding.
+    if (error == 0 && total != job.size && ftruncate(fd, job.size) != 0)
+        error = errno;
+
+    if (error)
+    {
+        close(fd);
+        if (callback)
+            callback(fileName, error);
+        return false;
+    }
+
+    m_Unsynced.push_back(fd);
+
+    if (callback)
+        callback(fileName, 0);
+
+    return true;
+}
+
+void ImageSaver::syncPending()
+{
+    for (int fd : m_Unsynced)
+    {
+        fdatasync(fd);
+        close(fd);
+    }
+    m_Unsynced.clear();
+}
+
+}
@@ -0,0 +1,159 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ Asynchronous local image saving.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+
+namespace INDI
+{
+
+/**
+ * \class ImageSaver
+ * \brief Writes captured images to the local disk in a dedicated I/O thread.
+ *
+ * Images are copied into an aligned buffer and queued so that the exposure completion path never
+ * blocks on the disk. File names are built from the upload prefix where ISO8601 is replaced by the
+ * timestamp of the save request and XXX by a running index. The index is found by scanning the
+ * directory only once per directory and prefix, then it is incremented in memory.
+ *
+ * Files are preallocated before writing and written in large chunks, optionally bypassing the page
+ * cache (O_DIRECT). Written files are synced in batches when the queue drains instead of one by one.
+ *
+ * The completion callback is invoked from the I/O thread with the final file name and an errno value
+ * (0 on success).
+ */
+class ImageSaver
+{
+    public:
+        typedef std::function<void(const std::string &fileName, int error)> Callback;
+
+        ImageSaver();
+        ~ImageSaver();
+
+        /**
+         * @brief setCallback Set function to be called once an image is written to disk.
+         */
+        void setCallback(const Callback &callback);
+
+        /**
+         * @brief setDirectIO Bypass the page cache when writing images if supported by the filesystem.
+         */
+        void setDirectIO(bool enabled);
+
+        /**
+         * @brief save Queue image data to be saved.
+         * @param directory Target directory, created if it does not exist.
+         * @param prefix File name prefix, may contain ISO8601 and XXX placeholders.
+         * @param extension File extension including the leading dot (e.g. .fits)
+         * @param data image data, copied before the function returns.
+         * @param size size of data in bytes.
+         * @return True if image is queued, false if memory could not be allocated.
+         * @note If too much data is pending, this function blocks until the I/O thread catches up.
+         */
+        bool save(const std::string &directory, const std::string &prefix, const std::string &extension,
+                  const void *data, size_t size);
+
+        /**
+         * @brief flush Wait until all queued images are written and synced.
+         */
+        void flush();
+
+        /**
+         * @brief clearIndexCache Forget cached file indexes so the next save rescans the directory.
+         */
+        void clearIndexCache();
+
+        /**
+         * @return Number of images waiting to be written.
+         */
+        size_t pending() const;
+
+    public:
+        /// Maximum amount of image data waiting in the queue before save() blocks.
+        static constexpr size_t MAX_PENDING_BYTES = 512 * 1024 * 1024;
+        /// Size of a single write call.
+        static constexpr size_t WRITE_CHUNK_SIZE  = 8 * 1024 * 1024;
+        /// Buffer alignment required for direct I/O.
+        static constexpr size_t BUFFER_ALIGNMENT  = 4096;
+        /// Maximum number of written files waiting to be synced.
+        static constexpr size_t MAX_UNSYNCED      = 16;
+
+    private:
+        struct Job
+        {
+            std::string directory;
+            std::string prefix;
+            std::string extension;
+            std::chrono::system_clock::time_point timestamp;
+            uint8_t *data {nullptr};
+            size_t size {0};
+        };
+
+        /// Prefix split on ISO8601 and XXX placeholders.
+        struct NameTemplate
+        {
+            enum Token { LITERAL, TIMESTAMP, INDEX };
+            std::vector<std::pair<Token, std::string>> parts;
+            std::string scanKey;
+            bool hasIndex {false};
+        };
+
+        void run();
+        bool write(const Job &job);
+        const NameTemplate &nameTemplate(const std::string &prefix);
+        int nextIndex(const std::string &directory, const NameTemplate &pattern);
+        int scanIndex(const std::string &directory, const std::string &scanKey);
+        std::string buildName(const NameTemplate &pattern, const Job &job, int index) const;
+        int openFile(const std::string &fileName, bool exclusive, bool &direct);
+        void syncPending();
+
+    private:
+        Callback m_Callback;
+        std::atomic_bool m_DirectIO {false};
+
+        std::deque<Job> m_Queue;
+        size_t m_PendingBytes {0};
+        bool m_Busy {false};
+        bool m_Quit {false};
+        mutable std::mutex m_Lock;
+        std::condition_variable m_Increase;
+        std::condition_variable m_Decrease;
+
+        // Only accessed from the I/O thread.
+        std::map<std::string, NameTemplate> m_Templates;
+        std::map<std::string, int> m_Indexes;
+        std::atomic_bool m_ClearIndexes {false};
+        std::vector<int> m_Unsynced;
+
+        std::thread m_Thread;
+};
+
+}
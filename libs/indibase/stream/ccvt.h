@@ -105,6 +105,11 @@ void ccvt_yuyv_rgb24(int width, int height, const void *src, void *dst);
 /** 4:2:2 YUYV interlaced to 4:2:0 YUV planar */
 void ccvt_yuyv_420p(int width, int height, const void *src, void *dsty, void *dstu, void *dstv);
 
+/**
+ * 16-bit grey to 8-bit grey. Pixels hold depth significant bits in native byte order, dst may be src.
+ */
+void ccvt_y16_y8(int count, const void *src, void *dst, int depth);
+
 /* RGB/BGR to 4:2:0 YUV interlaced */
 
 /** RGB/BGR to 4:2:0 YUV planar     */
@@ -112,6 +117,16 @@ void ccvt_rgb24_420p(int width, int height, const void *src, void *dsty, void *d
 /** RGB/BGR to 4:2:0 YUV planar     */
 void ccvt_bgr24_420p(int width, int height, const void *src, void *dsty, void *dstu, void *dstv);
 
+/**
+ * RGB/BGR to 4:2:0 YUV planar with line sizes in bytes, negative line sizes flip the image.
+ * Odd widths and heights are supported, the chroma of the last column or row is computed from it alone.
+ */
+void ccvt_rgb24_420p_stride(int width, int height, const void *src, int srcStride,
+                            void *dsty, int yStride, void *dstu, void *dstv, int uvStride);
+/** RGB/BGR to 4:2:0 YUV planar with line sizes in bytes */
+void ccvt_bgr24_420p_stride(int width, int height, const void *src, int srcStride,
+                            void *dsty, int yStride, void *dstu, void *dstv, int uvStride);
+
 /** RGB/BGR to RGB/BGR */
 void ccvt_bgr24_bgr32(int width, int height, const void *const src, void *const dst);
 /** RGB/BGR to RGB/BGR */
@@ -58,6 +58,7 @@
  */
 
 #include "ccvt.h"
+#include "dsp.h"
 #include "ccvt_types.h"
 //#include "indidevapi.h"
 #include "jpegutils.h"
@@ -71,651 +72,108 @@ static float RGBYUV04187[256], RGBYUV00813[256];
 
 void InitLookupTable(void);
 
-/* YUYV: two Y's and one U/V */
-#if 0
-void ccvt_yuyv_rgb32(int width, int height, const void *src, void *dst)
-{    
-}
-#endif
+#define CCVT_BLOCK 256
 
-void ccvt_yuyv_bgr32(int width, int height, const void *src, void *dst)
+/* YUYV to 4:2:0 planar, for a pair of rows of n pixels, chroma is the average of both rows */
+CCVT_INLINE void yuyv_420p_rows(const unsigned char *restrict s1, const unsigned char *restrict s2,
+                                unsigned char *restrict y1, unsigned char *restrict y2, unsigned char *restrict u,
+                                unsigned char *restrict v, int n)
 {
-    const unsigned char *s;
-    PIXTYPE_bgr32 *d;
-    int l, c;
-    int r, g, b, cr, cg, cb, y1, y2;
-
-    l = height;
-    s = src;
-    d = dst;
-    while (l--)
-    {
-        c = width >> 1;
-        while (c--)
-        {
-            y1 = *s++;
-            cb = ((*s - 128) * 454) >> 8;
-            cg = (*s++ - 128) * 88;
-            y2 = *s++;
-            cr = ((*s - 128) * 359) >> 8;
-            cg = (cg + (*s++ - 128) * 183) >> 8;
-
-            r = y1 + cr;
-            b = y1 + cb;
-            g = y1 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->b = b;
-            d->g = g;
-            d->r = r;
-            d++;
-            r = y2 + cr;
-            b = y2 + cb;
-            g = y2 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->b = b;
-            d->g = g;
-            d->r = r;
-            d++;
-        }
-    }
-}
-
-void ccvt_yuyv_bgr24(int width, int height, const void *src, void *dst)
-{
-    const unsigned char *s;
-    PIXTYPE_bgr24 *d;
-    int l, c;
-    int r, g, b, cr, cg, cb, y1, y2;
-
-    l = height;
-    s = src;
-    d = dst;
-    while (l--)
-    {
-        c = width >> 1;
-        while (c--)
-        {
-            y1 = *s++;
-            cb = ((*s - 128) * 454) >> 8;
-            cg = (*s++ - 128) * 88;
-            y2 = *s++;
-            cr = ((*s - 128) * 359) >> 8;
-            cg = (cg + (*s++ - 128) * 183) >> 8;
-
-            r = y1 + cr;
-            b = y1 + cb;
-            g = y1 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->b = b;
-            d->g = g;
-            d->r = r;
-            d++;
-            r = y2 + cr;
-            b = y2 + cb;
-            g = y2 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->b = b;
-            d->g = g;
-            d->r = r;
-            d++;
-        }
-    }
-}
+    int i;
 
-void ccvt_yuyv_rgb24(int width, int height, const void *src, void *dst)
-{
-    const unsigned char *s;
-    PIXTYPE_rgb24 *d;
-    int l, c;
-    int r, g, b, cr, cg, cb, y1, y2;
-
-    l = height;
-    s = src;
-    d = dst;
-    while (l--)
+    for (i = 0; i < n / 2; i++)
     {
-        c = width >> 1;
-        while (c--)
-        {
-            y1 = *s++;
-            cb = ((*s - 128) * 454) >> 8;
-            cg = (*s++ - 128) * 88;
-            y2 = *s++;
-            cr = ((*s - 128) * 359) >> 8;
-            cg = (cg + (*s++ - 128) * 183) >> 8;
-
-            r = y1 + cr;
-            b = y1 + cb;
-            g = y1 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->r = r;
-            d->g = g;
-            d->b = b;
-            d++;
-            r = y2 + cr;
-            b = y2 + cb;
-            g = y2 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->r = r;
-            d->g = g;
-            d->b = b;
-            d++;
-        }
+        y1[2 * i]     = s1[4 * i + 0];
+        y1[2 * i + 1] = s1[4 * i + 2];
+        y2[2 * i]     = s2[4 * i + 0];
+        y2[2 * i + 1] = s2[4 * i + 2];
+        u[i]          = (s1[4 * i + 1] + s2[4 * i + 1]) / 2;
+        v[i]          = (s1[4 * i + 3] + s2[4 * i + 3]) / 2;
     }
 }
 
+CCVT_DISPATCH
 void ccvt_yuyv_420p(int width, int height, const void *src, void *dsty, void *dstu, void *dstv)
 {
-    int n, l, j;
-    const unsigned char *s1, *s2;
-    unsigned char *dy, *du, *dv;
+    const unsigned char *s = (const unsigned char *)src;
+    unsigned char *dy      = (unsigned char *)dsty;
+    unsigned char *du      = (unsigned char *)dstu;
+    unsigned char *dv      = (unsigned char *)dstv;
+    int l, x0;
 
     /* Disregard last column/line if width/height is odd */
     width -= width % 2;
-    height -= height %2;
-
-    dy = (unsigned char *)dsty;
-    du = (unsigned char *)dstu;
-    dv = (unsigned char *)dstv;
-    s1 = (unsigned char *)src;
-    s2 = s1; /* keep pointer */
-    n  = width * height;
-    for (; n > 0; n--)
-    {
-        *dy = *s1;
-        dy++;
-        s1 += 2;
-    }
+    height -= height % 2;
 
-    /* Two options here: average U/V values, or skip every second row */
-    s1 = s2; /* restore pointer */
-    s1++;    /* point to U */
     for (l = 0; l < height; l += 2)
     {
-        s2 = s1 + width * 2; /* odd line */
-        for (j = 0; j < width; j += 2)
+        const unsigned char *s1 = s + (long)l * width * 2;
+        const unsigned char *s2 = s1 + width * 2;
+        unsigned char *y1       = dy + (long)l * width;
+        unsigned char *y2       = y1 + width;
+        unsigned char *u        = du + (long)(l / 2) * (width / 2);
+        unsigned char *v        = dv + (long)(l / 2) * (width / 2);
+
+        for (x0 = 0; x0 < width; x0 += CCVT_BLOCK)
         {
-            *du = (*s1 + *s2) / 2;
-            du++;
-            s1 += 2;
-            s2 += 2;
-            *dv = (*s1 + *s2) / 2;
-            dv++;
-            s1 += 2;
-            s2 += 2;
+            if (width - x0 >= CCVT_BLOCK)
+                yuyv_420p_rows(s1 + 2 * x0, s2 + 2 * x0, y1 + x0, y2 + x0, u + x0 / 2, v + x0 / 2, CCVT_BLOCK);
+            else
+                yuyv_420p_rows(s1 + 2 * x0, s2 + 2 * x0, y1 + x0, y2 + x0, u + x0 / 2, v + x0 / 2, width - x0);
         }
-        s1 = s2;
     }
 }
 
-void bayer2rgb24(unsigned char *dst, unsigned char *src, long int WIDTH, long int HEIGHT)
+CCVT_INLINE void y16_y8_block(const unsigned short *restrict s, unsigned char *restrict d, int n, int shift)
 {
-    long int i;
-    unsigned char *rawpt, *scanpt;
-    long int size;
-
-    rawpt  = src;
-    scanpt = dst;
-    size   = WIDTH * HEIGHT;
+    int i;
 
-    for (i = 0; i < size; i++)
-    {
-        if ((i / WIDTH) % 2 == 0)
-        {
-            if ((i % 2) == 0)
-            {
-                /* B */
-                if ((i > WIDTH) && ((i % WIDTH) > 0))
-                {
-                    *scanpt++ =
-                        (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
-                        4;                                                                               /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt + WIDTH) + *(rawpt - WIDTH)) / 4; /* G */
-                    *scanpt++ = *rawpt;                                                                  /* B */
-                }
-                else
-                {
-                    /* first line or left column */
-                    *scanpt++ = *(rawpt + WIDTH + 1);                  /* R */
-                    *scanpt++ = (*(rawpt + 1) + *(rawpt + WIDTH)) / 2; /* G */
-                    *scanpt++ = *rawpt;                                /* B */
-                }
-            }
-            else
-            {
-                /* (B)G */
-                if ((i > WIDTH) && ((i % WIDTH) < (WIDTH - 1)))
-                {
-                    *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* R */
-                    *scanpt++ = *rawpt;                                    /* G */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* B */
-                }
-                else
-                {
-                    /* first line or right column */
-                    *scanpt++ = *(rawpt + WIDTH); /* R */
-                    *scanpt++ = *rawpt;           /* G */
-                    *scanpt++ = *(rawpt - 1);     /* B */
-                }
-            }
-        }
-        else
-        {
-            if ((i % 2) == 0)
-            {
-                /* G(R) */
-                if ((i < (WIDTH * (HEIGHT - 1))) && ((i % WIDTH) > 0))
-                {
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* R */
-                    *scanpt++ = *rawpt;                                    /* G */
-                    *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* B */
-                }
-                else
-                {
-                    /* bottom line or left column */
-                    *scanpt++ = *(rawpt + 1);     /* R */
-                    *scanpt++ = *rawpt;           /* G */
-                    *scanpt++ = *(rawpt - WIDTH); /* B */
-                }
-            }
-            else
-            {
-                /* R */
-                if (i < (WIDTH * (HEIGHT - 1)) && ((i % WIDTH) < (WIDTH - 1)))
-                {
-                    *scanpt++ = *rawpt;                                                                  /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt - WIDTH) + *(rawpt + WIDTH)) / 4; /* G */
-                    *scanpt++ =
-                        (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
-                        4; /* B */
-                }
-                else
-                {
-                    /* bottom line or right column */
-                    *scanpt++ = *rawpt;                                /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt - WIDTH)) / 2; /* G */
-                    *scanpt++ = *(rawpt - WIDTH - 1);                  /* B */
-                }
-            }
-        }
-        rawpt++;
-    }
+    for (i = 0; i < n; i++)
+        d[i] = (unsigned char)(s[i] >> shift);
 }
 
-void bayer16_2_rgb24(unsigned short *dst, unsigned short *src, long int WIDTH, long int HEIGHT)
+/* Blocks are converted in a local buffer before being stored, so that the destination may be the source:
+   a block is stored below the source pixels of the next blocks. */
+CCVT_DISPATCH
+void ccvt_y16_y8(int count, const void *src, void *dst, int depth)
 {
-    long int i;
-    unsigned short *rawpt, *scanpt;
-    long int size;
+    const unsigned short *s = (const unsigned short *)src;
+    unsigned char *d        = (unsigned char *)dst;
+    const int shift         = depth > 8 ? depth - 8 : 0;
+    unsigned char block[CCVT_BLOCK];
+    int x0;
 
-    rawpt  = src;
-    scanpt = dst;
-    size   = WIDTH * HEIGHT;
-
-    for (i = 0; i < size; i++)
+    for (x0 = 0; x0 < count; x0 += CCVT_BLOCK)
     {
-        if ((i / WIDTH) % 2 == 0)
-        {
-            if ((i % 2) == 0)
-            {
-                /* B */
-                if ((i > WIDTH) && ((i % WIDTH) > 0))
-                {
-                    *scanpt++ =
-                        (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
-                        4;                                                                               /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt + WIDTH) + *(rawpt - WIDTH)) / 4; /* G */
-                    *scanpt++ = *rawpt;                                                                  /* B */
-                }
-                else
-                {
-                    /* first line or left column */
-                    *scanpt++ = *(rawpt + WIDTH + 1);                  /* R */
-                    *scanpt++ = (*(rawpt + 1) + *(rawpt + WIDTH)) / 2; /* G */
-                    *scanpt++ = *rawpt;                                /* B */
-                }
-            }
-            else
-            {
-                /* (B)G */
-                if ((i > WIDTH) && ((i % WIDTH) < (WIDTH - 1)))
-                {
-                    *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* R */
-                    *scanpt++ = *rawpt;                                    /* G */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* B */
-                }
-                else
-                {
-                    /* first line or right column */
-                    *scanpt++ = *(rawpt + WIDTH); /* R */
-                    *scanpt++ = *rawpt;           /* G */
-                    *scanpt++ = *(rawpt - 1);     /* B */
-                }
-            }
-        }
+        const int n = (count - x0 < CCVT_BLOCK) ? count - x0 : CCVT_BLOCK;
+
+        if (n == CCVT_BLOCK)
+            y16_y8_block(s + x0, block, CCVT_BLOCK, shift);
         else
-        {
-            if ((i % 2) == 0)
-            {
-                /* G(R) */
-                if ((i < (WIDTH * (HEIGHT - 1))) && ((i % WIDTH) > 0))
-                {
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* R */
-                    *scanpt++ = *rawpt;                                    /* G */
-                    *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* B */
-                }
-                else
-                {
-                    /* bottom line or left column */
-                    *scanpt++ = *(rawpt + 1);     /* R */
-                    *scanpt++ = *rawpt;           /* G */
-                    *scanpt++ = *(rawpt - WIDTH); /* B */
-                }
-            }
-            else
-            {
-                /* R */
-                if (i < (WIDTH * (HEIGHT - 1)) && ((i % WIDTH) < (WIDTH - 1)))
-                {
-                    *scanpt++ = *rawpt;                                                                  /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt - WIDTH) + *(rawpt + WIDTH)) / 4; /* G */
-                    *scanpt++ =
-                        (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
-                        4; /* B */
-                }
-                else
-                {
-                    /* bottom line or right column */
-                    *scanpt++ = *rawpt;                                /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt - WIDTH)) / 2; /* G */
-                    *scanpt++ = *(rawpt - WIDTH - 1);                  /* B */
-                }
-            }
-        }
-        rawpt++;
+            y16_y8_block(s + x0, block, n, shift);
+        memcpy(d + x0, block, n);
     }
 }
 
-void bayer_rggb_2rgb24(unsigned char *dst, unsigned char *src, long int WIDTH, long int HEIGHT)
+/* The Bayer conversions are kept for compatibility, they run the bilinear kernels of the DSP library. */
+void bayer2rgb24(unsigned char *dst, unsigned char *src, long int WIDTH, long int HEIGHT)
 {
-    long int i;
-    unsigned char *rawpt, *scanpt;
-    long int size;
+    dsp_demosaic_8(src, WIDTH, dst, 3 * WIDTH, WIDTH, HEIGHT, DSP_BAYER_BGGR, DSP_DEMOSAIC_BILINEAR, 1);
+}
 
-    rawpt  = src;
-    scanpt = dst;
-    size   = WIDTH * HEIGHT;
+void bayer16_2_rgb24(unsigned short *dst, unsigned short *src, long int WIDTH, long int HEIGHT)
+{
+    dsp_demosaic_16(src, WIDTH, dst, 3 * WIDTH, WIDTH, HEIGHT, DSP_BAYER_BGGR, DSP_DEMOSAIC_BILINEAR, 1);
+}
 
-    for (i = 0; i < size; i++)
-    {
-        if ((i / WIDTH) % 2 == 0) //wenn zeile grade
-        {
-            if ((i % 2) == 0) //spalte gerade
-            {
-                /* B */
-                if ((i > WIDTH) && ((i % WIDTH) > 0)) // wenn nicht erste zeile oder linke spalte
-                {
-                    *scanpt++ = *rawpt;                                                                  /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt + WIDTH) + *(rawpt - WIDTH)) / 4; /* G */
-                    *scanpt++ =
-                        (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
-                        4; /* B */
-                }
-                else
-                {
-                    /* first line or left column */
-                    *scanpt++ = *rawpt;                                /* R */
-                    *scanpt++ = (*(rawpt + 1) + *(rawpt + WIDTH)) / 2; /* G */
-                    *scanpt++ = *(rawpt + WIDTH + 1);                  /* B */
-                }
-            }
-            else
-            {
-                /* (B)G */
-                if ((i > WIDTH) && ((i % WIDTH) < (WIDTH - 1)))
-                {
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* R */
-                    *scanpt++ = *rawpt;                                    /* G */
-                    *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* B */
-                }
-                else
-                {
-                    /* first line or right column */
-                    *scanpt++ = *(rawpt - 1);     /* R */
-                    *scanpt++ = *rawpt;           /* G */
-                    *scanpt++ = *(rawpt + WIDTH); /* B */
-                }
-            }
-        }
-        else
-        {
-            if ((i % 2) == 0)
-            {
-                /* G(R) */
-                if ((i < (WIDTH * (HEIGHT - 1))) && ((i % WIDTH) > 0))
-                {
-                    *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* R */
-                    *scanpt++ = *rawpt;                                    /* G */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* B */
-                }
-                else
-                {
-                    /* bottom line or left column */
-                    *scanpt++ = *(rawpt - WIDTH); /* R */
-                    *scanpt++ = *rawpt;           /* G */
-                    *scanpt++ = *(rawpt + 1);     /* B */
-                }
-            }
-            else
-            {
-                /* R */
-                if (i < (WIDTH * (HEIGHT - 1)) && ((i % WIDTH) < (WIDTH - 1)))
-                {
-                    *scanpt++ =
-                        (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
-                        4;                                                                               /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt - WIDTH) + *(rawpt + WIDTH)) / 4; /* G */
-                    *scanpt++ = *rawpt;                                                                  /* B */
-                }
-                else
-                {
-                    /* bottom line or right column */
-                    *scanpt++ = *(rawpt - WIDTH - 1);                  /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt - WIDTH)) / 2; /* G */
-                    *scanpt++ = *rawpt;                                /* B */
-                }
-            }
-        }
-        rawpt++;
-    }
+void bayer_rggb_2rgb24(unsigned char *dst, unsigned char *src, long int WIDTH, long int HEIGHT)
+{
+    dsp_demosaic_8(src, WIDTH, dst, 3 * WIDTH, WIDTH, HEIGHT, DSP_BAYER_RGGB, DSP_DEMOSAIC_BILINEAR, 1);
 }
 
 void bayer_grbg_to_rgb24(unsigned char *dst, unsigned char *src, long int WIDTH, long int HEIGHT)
 {
-	//Format is
-	// GRGRGRGRGR row width = width,  
-	// BGBGBGBGBG this interpolates it as simply as possible
-	// GRGRGRGRGR 
-	// BGBGBGBGBG
-	
-	// Output is
-	// RGBRGBRGBRGBRGB row width = 3x width
-	// RGBRGBRGBRGBRGB each pixel = 3 bytes
-	
-	long int row;
-	long int col;
-	long int width=WIDTH;
-	int RED = 0;
-	int GREEN = 1;
-	int BLUE = 2;
-	for (row = 0; row < HEIGHT; row++) {
-		for (col = 0; col < WIDTH; col++) {
-			//General case:
-			if(row % 2 == 0) { //GRGRGR Row
-				if(col % 2 == 0) {//Over Green
-					//TODO: Double check 1st/last row
-					if (col != 0 && col != WIDTH -1) { // NORMAL
-					dst[(row*width+col)*3+RED]=(src[row*width+col+1]+src[row*width+col-1])/2; // Reds are to L/R
-					} else { //EDGE
-						if (col == 0) { dst[(row*width+col)*3+RED]=src[row*width+col+1];}
-						if (col == WIDTH -1 ) { dst[(row*width+col)*3+RED]=src[row*width+col-1]; }
-					}
-					dst[(row*width+col)*3+GREEN]=src[row*width+col];
-					if (row !=0 && row !=HEIGHT-1) { // NORMAL
-					dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col]+src[(row-1)*width+col])/2; //Blues are above and below.
-					} else { // EDGE
-						if (row == 0) {dst[(row*width+col)*3+BLUE]=src[(row+1)*width+col];}
-						if (row == WIDTH -1) {dst[(row*width+col)*3+BLUE]=src[(row-1)*width+col];}
-					}
-				} else { // Over RED
-					dst[(row*width+col)*3+RED]=src[row*width+col]; 
-					if (col != WIDTH -1 && row !=0 ) { // NORMAL (Left side and bottom count as normal
-					dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
-					dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4; //Blues are caddy corner and below.
-					} else { // EDGE
-						if (col != WIDTH -1 && row == 0) {
-							//Corner && Side: 
-							//     
-							//,G*G.
-							//,BGB.
-							//,....
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row)*width+col+1]+src[(row)*width+col+1])/3;
-							dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row+1)*width+col-1])/2;
-						} 
-
-						if (col == WIDTH -1 && row !=0 ) {
-							//Side
-							//...
-							//.BG
-							//.GR
-							//.BG
-							//...
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row)*width+col-1])/3;
-							dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/2;
-							
-						}
-						if (col == WIDTH -1 && row ==0) {
-							//Corner (col=max, row=0)
-							//
-							//.G*
-							//.BG
-							//...
-							dst[(row*width+col)*3+GREEN]=(src[(row-1)*width+col]+src[(row+0)*width+col-1]+src[(row+1)*width+col])/3;
-							dst[(row*width+col)*3+BLUE]=src[(row+1)*width+col-1];
-						}
-						if (col == 1 && row !=0) { //Unnecessary Left here to explain why 
-							//Side && Corner (col=1, row=max)
-							// .....
-							// BGBG..
-							// G*GR
-							// BGBG..
-							// ,,,,,, 
-							// NORMAL
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
-							dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4; //Blues are caddy corner and below.
-						}
-						if (row == HEIGHT -1) {//Unnecessary Left here to explain why 
-							//Bottom row (would actually be HEIGHT -2 it still looks like a normal pixel for us
-							// ,.....
-							// ,.BGBG..
-							// ,.G*RG..
-							// ,.BGBG..
-							//        
-							// NORMAL
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
-							dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4; //Blues are caddy corner and below.
-							
-						}
-					}
-				}
-			} else { //BRBRBR Row
-				//if (col != 0 && col != WIDTH -1 && row != 0 && row != HEIGHT-1) {
-				if (col % 2 == 0) {//Over Blue
-					dst[(row*width+col)*3+BLUE]=src[row*width+col];
-					if ( col != 0 && row != HEIGHT -1) { //Normal 
-						// Enough clearance to use this:
-						// RGR
-						// G*G
-						// RGR
-						dst[(row*width+col)*3+RED]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4;//Reds are caddy corner and below.
-						dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
-					} else { // EDGE CASES over blue
-						if (col == 0 && row != HEIGHT -1) {
-							//  ,,,,,,,
-							//  GRGRGR.
-							//  *GBGBG.
-							//  GRGRGR.
-							//  .......
-							dst[(row*width+col)*3+RED]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1])/2;
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/3;
-						}
-						if (row == HEIGHT -1 && col !=0) {
-							//  ........
-							//  .GRGRGR.
-							//  .BG*GBG.
-							dst[(row*width+col)*3+RED]=(src[(row-1)*width+col+1]+src[(row-1)*width+col-1])/2;
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/3;
-						}
-						if (row == HEIGHT -1 && col ==0) {
-							//  .....
-							//  GRGR.
-							//  *GBG.
-							dst[(row*width+col)*3+RED]=(src[(row-1)*width+col+1]+src[(row-1)*width+col-1])/2;
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/3;
-						}
-						
-					}
-				} else { // Over Green
-					dst[(row*width+col)*3+GREEN]=src[row*width+col]; // Over Green Pixel
-					if (col != WIDTH -1 && row != HEIGHT -1) { //NORMAL 
-						// Enough clearance to use this:
-						// GRG
-						// B*B
-						// GRG
-						
-						dst[(row*width+col)*3+RED]=(src[(row+1)*width+col]+src[(row-1)*width+col])/2; // Reds are above/below
-						dst[(row*width+col)*3+BLUE]=(src[row*width+col+1]+src[row*width+col-1])/2; //Blues are left/right
-					} else {
-						if (col == WIDTH -1 && row != HEIGHT -1) {
-							// ,,,,,
-							// .GRGR
-							// .BGB*
-							// .GRGR
-							// .....
-							dst[(row*width+col)*3+RED]=(src[(row+1)*width+col]+src[(row-1)*width+col])/2; // Reds are above/below
-							dst[(row*width+col)*3+BLUE]=src[row*width+col-1]; //Blue is left
-						}
-						if (row == HEIGHT -1 && col != WIDTH -1) {
-							// .....
-							// .GRGR
-							// .B*BG
-							dst[(row*width+col)*3+RED]=src[(row-1)*width+col]; // Red is above
-							dst[(row*width+col)*3+BLUE]=(src[row*width+col+1]+src[row*width+col-1])/2; //Blues are left/right
-						}
-						if (row == HEIGHT -1 && col == WIDTH -1) {
-							// ...
-							// .GR
-							// .B*
-							dst[(row*width+col)*3+RED]=src[(row-1)*width+col]; // Red is above
-							dst[(row*width+col)*3+BLUE]=src[row*width+col-1]; //Blue is left
-						}
-					}
-				}
-			}
-		}
-	}
+    dsp_demosaic_8(src, WIDTH, dst, 3 * WIDTH, WIDTH, HEIGHT, DSP_BAYER_GRBG, DSP_DEMOSAIC_BILINEAR, 1);
 }
 
 int mjpegtoyuv420p(unsigned char *map, unsigned char *cap_map, int width, int height, unsigned int size)
@@ -1000,6 +458,105 @@ int BGR2YUV(int x_dim, int y_dim, void *bmp, void *y_out, void *u_out, void *v_o
     return 0;
 }
 
+/* RGB/BGR to 4:2:0 YUV planar, strided
+ *
+ * Rows are processed in pairs and split in blocks of CCVT_BLOCK pixels. A block is first
+ * deinterleaved into R, G and B planes, then luma and chroma are computed from the planes in
+ * fixed point into local rows that are copied to the output. The arithmetic loops always run
+ * over a whole block and never alias, so the compiler vectorizes them even at -O2. The
+ * deinterleave loop is vectorized where the target has structure loads (NEON, SSSE3).
+ */
+
+CCVT_INLINE void rgb24_420p_stride(int width, int height, const unsigned char *src, int srcStride,
+                              unsigned char *dsty, int yStride, unsigned char *dstu, unsigned char *dstv,
+                              int uvStride, int bgr)
+{
+    /* One spare pixel to duplicate the last column of odd widths. */
+    unsigned char p0[2][CCVT_BLOCK + 1] = {{0}}, p1[2][CCVT_BLOCK + 1] = {{0}}, p2[2][CCVT_BLOCK + 1] = {{0}};
+    unsigned char (*r)[CCVT_BLOCK + 1] = bgr ? p2 : p0;
+    unsigned char (*g)[CCVT_BLOCK + 1] = p1;
+    unsigned char (*b)[CCVT_BLOCK + 1] = bgr ? p0 : p2;
+    unsigned char luma[2][CCVT_BLOCK], cb[CCVT_BLOCK / 2], cr[CCVT_BLOCK / 2];
+    int x0, y, i, k;
+
+    for (y = 0; y < height; y += 2)
+    {
+        /* The last row of odd heights is its own pair. */
+        const int rows                 = (y + 1 < height) ? 2 : 1;
+        const unsigned char *input[2]  = { src + (long)y * srcStride, src + (long)(y + rows - 1) * srcStride };
+        unsigned char *outy[2]         = { dsty + (long)y * yStride, dsty + (long)(y + 1) * yStride };
+        unsigned char *outu            = dstu + (long)(y / 2) * uvStride;
+        unsigned char *outv            = dstv + (long)(y / 2) * uvStride;
+
+        for (x0 = 0; x0 < width; x0 += CCVT_BLOCK)
+        {
+            const int n = (width - x0 < CCVT_BLOCK) ? width - x0 : CCVT_BLOCK;
+
+            for (k = 0; k < 2; k++)
+            {
+                const unsigned char *in = input[k] + 3 * x0;
+                for (i = 0; i < n; i++)
+                {
+                    p0[k][i] = in[3 * i + 0];
+                    p1[k][i] = in[3 * i + 1];
+                    p2[k][i] = in[3 * i + 2];
+                }
+                p0[k][n] = p0[k][n - 1];
+                p1[k][n] = p1[k][n - 1];
+                p2[k][n] = p2[k][n - 1];
+            }
+
+            /* Y = 0.299 R + 0.587 G + 0.114 B */
+            for (k = 0; k < rows; k++)
+            {
+                for (i = 0; i < CCVT_BLOCK; i++)
+                    luma[k][i] = (unsigned char)((77 * r[k][i] + 150 * g[k][i] + 29 * b[k][i] + 128) >> 8);
+                memcpy(outy[k] + x0, luma[k], n);
+            }
+
+            /* Chroma of the 2x2 average, offset by 128 before shifting to stay positive. */
+            for (i = 0; i < CCVT_BLOCK / 2; i++)
+            {
+                int rs = r[0][2 * i] + r[0][2 * i + 1] + r[1][2 * i] + r[1][2 * i + 1];
+                int gs = g[0][2 * i] + g[0][2 * i + 1] + g[1][2 * i] + g[1][2 * i + 1];
+                int bs = b[0][2 * i] + b[0][2 * i + 1] + b[1][2 * i] + b[1][2 * i + 1];
+                int u  = (-43 * rs - 85 * gs + 128 * bs + (128 << 10) + 512) >> 10;
+                int v  = (128 * rs - 107 * gs - 21 * bs + (128 << 10) + 512) >> 10;
+                cb[i]  = (unsigned char)(u > 255 ? 255 : u);
+                cr[i]  = (unsigned char)(v > 255 ? 255 : v);
+            }
+            memcpy(outu + x0 / 2, cb, (n + 1) / 2);
+            memcpy(outv + x0 / 2, cr, (n + 1) / 2);
+        }
+    }
+}
+
+CCVT_DISPATCH
+void ccvt_rgb24_420p_stride(int width, int height, const void *src, int srcStride,
+                            void *dsty, int yStride, void *dstu, void *dstv, int uvStride)
+{
+    rgb24_420p_stride(width, height, src, srcStride, dsty, yStride, dstu, dstv, uvStride, 0);
+}
+
+CCVT_DISPATCH
+void ccvt_bgr24_420p_stride(int width, int height, const void *src, int srcStride,
+                            void *dsty, int yStride, void *dstu, void *dstv, int uvStride)
+{
+    rgb24_420p_stride(width, height, src, srcStride, dsty, yStride, dstu, dstv, uvStride, 1);
+}
+
+CCVT_DISPATCH
+void ccvt_rgb24_420p(int width, int height, const void *src, void *dsty, void *dstu, void *dstv)
+{
+    rgb24_420p_stride(width, height, src, 3 * width, dsty, width, dstu, dstv, (width + 1) / 2, 0);
+}
+
+CCVT_DISPATCH
+void ccvt_bgr24_420p(int width, int height, const void *src, void *dsty, void *dstu, void *dstv)
+{
+    rgb24_420p_stride(width, height, src, 3 * width, dsty, width, dstu, dstv, (width + 1) / 2, 1);
+}
+
 void InitLookupTable()
 {
     int i;
@@ -22,6 +22,24 @@
 
 #pragma once
 
+#include <stdint.h>
+
+/* Conversion kernels are fixed length loops over blocks of pixels, which the compiler vectorizes.
+   On x86-64 with GNU libc, the entry points are also compiled for AVX2 and the version matching the
+   CPU is selected when the library is loaded. NEON is part of the aarch64 baseline. Helpers are
+   always inlined so that they are compiled for the target of their caller. */
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 6 && defined(__GLIBC__)
+#define CCVT_DISPATCH __attribute__((target_clones("avx2", "default")))
+#else
+#define CCVT_DISPATCH
+#endif
+
+#if defined(__GNUC__)
+#define CCVT_INLINE static inline __attribute__((always_inline))
+#else
+#define CCVT_INLINE static inline
+#endif
+
 typedef struct
 {
     unsigned char b;
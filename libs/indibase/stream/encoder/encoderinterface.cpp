@@ -50,6 +50,16 @@ bool EncoderInterface::setSize(uint16_t width, uint16_t height)
     return true;
 }
 
+bool EncoderInterface::upload(INDI::WidgetViewBlob *bp, const FrameView &frame, bool isCompressed)
+{
+    if (frame.isContiguous())
+        return upload(bp, frame.data, frame.size(), isCompressed);
+
+    packedFrame.resize(frame.size());
+    frame.copyTo(packedFrame.data());
+    return upload(bp, packedFrame.data(), packedFrame.size(), isCompressed);
+}
+
 bool EncoderInterface::setPixelFormat(INDI_PIXEL_FORMAT pixelFormat, uint8_t pixelDepth)
 {
     this->pixelFormat = pixelFormat;
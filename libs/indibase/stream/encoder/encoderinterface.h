@@ -24,6 +24,7 @@
 #include "indidevapi.h"
 #include "indibasetypes.h"
 #include "indiwidgetview.h"
+#include "stream/frameview.h"
 
 #include <stdio.h>
 #include <cstdlib>
@@ -55,6 +56,12 @@ class EncoderInterface
 
         virtual bool upload(INDI::WidgetViewBlob *bp, const uint8_t *buffer, uint32_t nbytes, bool isCompressed = false) = 0;
 
+        /**
+         * @brief upload Encode a frame given as a view, a region of interest is read in place.
+         * The default implementation packs the rows of strided frames and calls the buffer variant.
+         */
+        virtual bool upload(INDI::WidgetViewBlob *bp, const FrameView &frame, bool isCompressed = false);
+
         const char *getName();
 
     protected:
@@ -63,6 +70,8 @@ class EncoderInterface
         INDI_PIXEL_FORMAT pixelFormat;            // INDI Pixel Format
         uint8_t pixelDepth = 8;                   // Bits per Pixels
         uint16_t rawWidth, rawHeight;
+        // Rows of strided frames for encoders that need contiguous pixels.
+        std::vector<uint8_t> packedFrame;
 };
 
 }
@@ -22,32 +22,179 @@
 #include "mjpegencoder.h"
 #include "stream/streammanager.h"
 #include "indiccd.h"
-#include <cmath>
-#include <zlib.h>
+#include "indisinglethreadpool.h"
+#include "dsp.h"
+
+#include <algorithm>
+#include <csetjmp>
+#include <thread>
+
 #include <jpeglib.h>
 #include <jerror.h>
 
-static void init_destination(j_compress_ptr cinfo)
+namespace INDI
 {
-    INDI_UNUSED(cinfo);
-    /* No work necessary here */
-}
 
-static boolean empty_output_buffer(j_compress_ptr cinfo)
+/*
+Based on: https://svn.csail.mit.edu/rrg_pods/jpeg-utils/
+
+Name:         jpeg-utils
+Maintainers:  Albert Huang <albert@csail.mit.edu>
+Summary:      Wrapper functions around libjpeg to simplify JPEG compression and
+              decompression with in-memory buffers.
+
+  For faster performance, install libjpeg-turbo, an SSE-accelerated
+  library that is ABI compatible with libjpeg62.
+*/
+
+/**
+ * @brief Compressor keeps a libjpeg context and its output buffer between frames.
+ */
+struct MJPEGEncoder::Compressor
 {
-    INDI_UNUSED(cinfo);
-    /* No work necessary here */
-    return TRUE;
-}
+    struct ErrorManager
+    {
+        jpeg_error_mgr pub;
+        jmp_buf setjmpBuffer;
+    };
+
+    jpeg_compress_struct cinfo;
+    ErrorManager jerr;
+    jpeg_destination_mgr jdest;
+    std::vector<uint8_t> output;
+    size_t outputSize {0};
+
+    // Parameters of the previous frame, defaults are only set again when they change.
+    JDIMENSION width {0}, height {0};
+    int components {0}, quality {0}, restartRows {-1};
+
+    Compressor()
+    {
+        cinfo.err = jpeg_std_error(&jerr.pub);
+        jerr.pub.error_exit = errorExit;
+        jpeg_create_compress(&cinfo);
+
+        jdest.init_destination    = initDestination;
+        jdest.empty_output_buffer = emptyOutputBuffer;
+        jdest.term_destination    = termDestination;
+        cinfo.dest = &jdest;
+        cinfo.client_data = this;
+    }
+
+    ~Compressor()
+    {
+        jpeg_destroy_compress(&cinfo);
+    }
 
-static void term_destination(j_compress_ptr cinfo)
+    static void errorExit(j_common_ptr cinfo)
+    {
+        longjmp(reinterpret_cast<ErrorManager *>(cinfo->err)->setjmpBuffer, 1);
+    }
+
+    static void initDestination(j_compress_ptr cinfo)
+    {
+        auto self = static_cast<Compressor *>(cinfo->client_data);
+        // Raw size is plenty for any reasonable quality, the buffer grows otherwise.
+        self->output.resize(std::max<size_t>(self->output.size(), cinfo->image_width * cinfo->image_height * cinfo->input_components));
+        self->jdest.next_output_byte = self->output.data();
+        self->jdest.free_in_buffer   = self->output.size();
+    }
+
+    static boolean emptyOutputBuffer(j_compress_ptr cinfo)
+    {
+        auto self = static_cast<Compressor *>(cinfo->client_data);
+        size_t used = self->output.size();
+        self->output.resize(used * 2);
+        self->jdest.next_output_byte = self->output.data() + used;
+        self->jdest.free_in_buffer   = self->output.size() - used;
+        return TRUE;
+    }
+
+    static void termDestination(j_compress_ptr cinfo)
+    {
+        auto self = static_cast<Compressor *>(cinfo->client_data);
+        self->outputSize = self->output.size() - self->jdest.free_in_buffer;
+    }
+
+    bool encode(const uint8_t *src, size_t stride, JDIMENSION w, JDIMENSION h, int nComponents, int q, int restart)
+    {
+        if (setjmp(jerr.setjmpBuffer))
+        {
+            jpeg_abort_compress(&cinfo);
+            width = 0;
+            return false;
+        }
+
+        if (w != width || h != height || nComponents != components || q != quality || restart != restartRows)
+        {
+            cinfo.image_width      = w;
+            cinfo.image_height     = h;
+            cinfo.input_components = nComponents;
+            cinfo.in_color_space   = nComponents == 3 ? JCS_RGB : JCS_GRAYSCALE;
+            jpeg_set_defaults(&cinfo);
+            jpeg_set_quality(&cinfo, q, TRUE);
+            cinfo.restart_in_rows = restart;
+#if JPEG_LIB_VERSION >= 70
+            // Faster DCT, the difference is not visible in a preview.
+            cinfo.dct_method = JDCT_IFAST;
+#endif
+            width = w;
+            height = h;
+            components = nComponents;
+            quality = q;
+            restartRows = restart;
+        }
+
+        jpeg_start_compress(&cinfo, TRUE);
+        while (cinfo.next_scanline < h)
+        {
+            JSAMPROW rows[16];
+            JDIMENSION count = std::min<JDIMENSION>(16, h - cinfo.next_scanline);
+            for (JDIMENSION i = 0; i < count; i++)
+                rows[i] = const_cast<JSAMPROW>(src + (cinfo.next_scanline + i) * stride);
+            jpeg_write_scanlines(&cinfo, rows, count);
+        }
+        jpeg_finish_compress(&cinfo);
+        return true;
+    }
+};
+
+// Locate the frame header and the beginning of the entropy coded data of a JPEG produced by libjpeg.
+static bool findSegments(const uint8_t *data, size_t size, size_t &sofOffset, size_t &scanOffset)
 {
-    INDI_UNUSED(cinfo);
-    /* no work necessary here */
+    sofOffset = 0;
+    size_t offset = 2;
+    while (offset + 4 <= size && data[offset] == 0xFF)
+    {
+        uint8_t marker = data[offset + 1];
+        size_t length = (data[offset + 2] << 8) | data[offset + 3];
+        if (marker == 0xC0 || marker == 0xC1)
+            sofOffset = offset;
+        if (marker == 0xDA)
+        {
+            scanOffset = offset + 2 + length;
+            return sofOffset != 0 && scanOffset + 2 <= size;
+        }
+        offset += 2 + length;
+    }
+    return false;
 }
 
-namespace INDI
+// Append entropy coded data, renumbering its restart markers so that they follow the previous strips.
+static void appendScan(std::vector<uint8_t> &out, const uint8_t *data, size_t size, uint32_t &restartCount)
 {
+    size_t begin = out.size();
+    out.insert(out.end(), data, data + size);
+    uint8_t *p = out.data() + begin;
+    for (size_t i = 0; i + 1 < size; i++)
+    {
+        if (p[i] == 0xFF && p[i + 1] >= 0xD0 && p[i + 1] <= 0xD7)
+        {
+            p[i + 1] = 0xD0 + (restartCount++ & 7);
+            i++;
+        }
+    }
+}
 
 MJPEGEncoder::MJPEGEncoder()
 {
@@ -56,7 +203,8 @@ MJPEGEncoder::MJPEGEncoder()
 
 MJPEGEncoder::~MJPEGEncoder()
 {
-    delete [] jpegBuffer;
+    for (auto &worker : workers)
+        worker->quit();
 }
 
 const char *MJPEGEncoder::getDeviceName()
@@ -64,7 +212,36 @@ const char *MJPEGEncoder::getDeviceName()
     return currentDevice->getDeviceName();
 }
 
+void MJPEGEncoder::setQuality(int value)
+{
+    quality = std::min(std::max(value, 1), 100);
+}
+
+void MJPEGEncoder::setTargetWidth(uint16_t width)
+{
+    targetWidth = width;
+}
+
+void MJPEGEncoder::setThreads(uint8_t value)
+{
+    threads = std::min(value, MAX_STRIPS);
+}
+
 bool MJPEGEncoder::upload(INDI::WidgetViewBlob *bp, const uint8_t *buffer, uint32_t nbytes, bool isCompressed)
+{
+    INDI_UNUSED(nbytes);
+    int components = (pixelFormat == INDI_RGB) ? 3 : 1;
+
+    FrameView frame;
+    frame.data = buffer;
+    frame.width = rawWidth;
+    frame.height = rawHeight;
+    frame.bytesPerPixel = components;
+    frame.stride = frame.lineSize();
+    return upload(bp, frame, isCompressed);
+}
+
+bool MJPEGEncoder::upload(INDI::WidgetViewBlob *bp, const FrameView &frame, bool isCompressed)
 {
     // We do not support compression
     if (isCompressed)
@@ -73,134 +250,190 @@ bool MJPEGEncoder::upload(INDI::WidgetViewBlob *bp, const uint8_t *buffer, uint3
         return false;
     }
 
-    INDI_UNUSED(nbytes);
-    int bufsize = rawWidth * rawHeight * ((pixelFormat == INDI_RGB) ? 3 : 1);
-    if (bufsize != jpegBufferSize)
+    int components = (pixelFormat == INDI_RGB) ? 3 : 1;
+    uint16_t width = frame.width, height = frame.height;
+    size_t stride = frame.stride;
+    const uint8_t *source = frame.data;
+
+    // Show Bayer frames in color instead of the filter pattern, workers already encode frames in parallel.
+    if (pixelFormat >= INDI_BAYER_RGGB && pixelFormat <= INDI_BAYER_BGGR)
     {
-        delete [] jpegBuffer;
-        jpegBuffer = new uint8_t[bufsize];
-        jpegBufferSize = bufsize;
+        colorBuffer.resize(3 * width * height);
+        dsp_demosaic_8(source, stride, colorBuffer.data(), 3 * width, width, height,
+                       static_cast<dsp_bayer_pattern>(pixelFormat - INDI_BAYER_RGGB), DSP_DEMOSAIC_BILINEAR, 1);
+        source = colorBuffer.data();
+        stride = 3 * width;
+        components = 3;
     }
 
-    // Scale image DOWN by this factor
-    // 640 is now selected arbitrary to test mpeg streaming performance
-    int scale = std::max(1, static_cast<int>(std::floor(rawWidth / SCALE_WIDTH)));
-    if (pixelFormat == INDI_RGB)
-        jpeg_compress_8u_rgb(buffer, rawWidth, rawHeight, rawWidth * 3, scale, jpegBuffer, &bufsize, 85);
-    else
-        jpeg_compress_8u_gray(buffer, rawWidth, rawHeight, rawWidth, scale, jpegBuffer, &bufsize, 85);
+    source = downscale(source, stride, width, height, components);
+    if (compress(source, stride, width, height, components) == false)
+    {
+        LOG_ERROR("Failed to encode JPEG frame.");
+        return false;
+    }
 
-    bp->setBlob(jpegBuffer);
-    bp->setBlobLen(bufsize);
-    bp->setSize(bufsize);
+    bp->setBlob(jpegBuffer.data());
+    bp->setBlobLen(jpegBuffer.size());
+    bp->setSize(jpegBuffer.size());
     bp->setFormat(".stream_jpg");
 
     return true;
 }
 
-/*
-FROM: https://svn.csail.mit.edu/rrg_pods/jpeg-utils/
-
-Name:         jpeg-utils
-Maintainers:  Albert Huang <albert@csail.mit.edu>
-Summary:      Wrapper functions around libjpeg to simplify JPEG compression and
-              decompression with in-memory buffers.
-Description:
-  note: This is a simple enough library that you could just copy the .c
-  and .h files in to your own programs.
-
-  To use the library, link against -ljpeg-utils, or use
-  pkg-config --cflags --libs jpeg-utils
-
-Requirements:
-  libjpeg62
+const uint8_t *MJPEGEncoder::downscale(const uint8_t *buffer, size_t &stride, uint16_t &width, uint16_t &height,
+                                       int components)
+{
+    uint16_t target = targetWidth;
+    if (target == 0 || width <= target)
+        return buffer;
+
+    // Integer factor so that each output pixel averages a whole block of input pixels.
+    const size_t factor = (width + target - 1) / target;
+    const size_t inWidth = width, outWidth = width / factor, outHeight = height / factor;
+    const size_t inLength = inWidth * components;
+    const size_t inStride = stride;
+    const size_t outStride = outWidth * components;
+    if (outWidth == 0 || outHeight == 0)
+        return buffer;
+
+    // Fixed point reciprocal of the block area, the error is below one level.
+    const uint32_t area = factor * factor;
+    const uint32_t reciprocal = ((1 << 16) + area / 2) / area;
+
+    rowSums.resize(inLength);
+    scaledBuffer.resize(outStride * outHeight);
+
+    for (size_t y = 0; y < outHeight; y++)
+    {
+        // Vertical sums over whole rows, this loop is vectorized by the compiler.
+        const uint8_t *in = buffer + y * factor * inStride;
+        uint32_t *sums = rowSums.data();
+        for (size_t i = 0; i < inLength; i++)
+            sums[i] = in[i];
+        for (size_t row = 1; row < factor; row++)
+        {
+            in += inStride;
+            for (size_t i = 0; i < inLength; i++)
+                sums[i] += in[i];
+        }
+
+        // Horizontal sums of each block.
+        uint8_t *out = scaledBuffer.data() + y * outStride;
+        for (size_t x = 0; x < outWidth; x++)
+        {
+            const uint32_t *block = sums + x * factor * components;
+            for (int c = 0; c < components; c++)
+            {
+                uint32_t sum = 0;
+                for (size_t i = 0; i < factor; i++)
+                    sum += block[i * components + c];
+                out[x * components + c] = static_cast<uint8_t>((sum * reciprocal + (1 << 15)) >> 16);
+            }
+        }
+    }
 
-  For faster performance, install libjpeg-turbo, an SSE-accelerated
-  library that is ABI compatible with libjpeg62.
-*/
+    width = outWidth;
+    height = outHeight;
+    stride = outStride;
+    return scaledBuffer.data();
+}
 
-int MJPEGEncoder::jpeg_compress_8u_gray (const uint8_t * src, uint16_t width, uint16_t height, int stride, int scale,
-        uint8_t * dest,
-        int * destsize, int quality)
+bool MJPEGEncoder::compress(const uint8_t *src, size_t stride, uint16_t width, uint16_t height, int components)
 {
-    struct jpeg_compress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    struct jpeg_destination_mgr jdest;
-    int out_size = *destsize;
-
-    cinfo.err = jpeg_std_error (&jerr);
-    jpeg_create_compress (&cinfo);
-    jdest.next_output_byte = dest;
-    jdest.free_in_buffer = out_size;
-    jdest.init_destination = init_destination;
-    jdest.empty_output_buffer = empty_output_buffer;
-    jdest.term_destination = term_destination;
-    cinfo.dest = &jdest;
-
-    cinfo.image_width = width;
-    cinfo.image_height = height;
-#if JPEG_LIB_VERSION >= 70
-    cinfo.scale_denom = scale;
-#else
-    INDI_UNUSED(scale);
-#endif
-    cinfo.input_components = 1;
-    cinfo.in_color_space = JCS_GRAYSCALE;
-    jpeg_set_defaults (&cinfo);
-    jpeg_set_quality (&cinfo, quality, TRUE);
+    size_t strips = threads;
+    if (strips == 0)
+        strips = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), 4);
+    if (static_cast<uint32_t>(width) * height < STRIP_THRESHOLD)
+        strips = 1;
+
+    // Strips hold whole MCU rows, they must not exceed the frame.
+    size_t stripHeight = (height + strips - 1) / strips;
+    stripHeight = (stripHeight + STRIP_ALIGN - 1) / STRIP_ALIGN * STRIP_ALIGN;
+    strips = (height + stripHeight - 1) / stripHeight;
+
+    while (compressors.size() < strips)
+        compressors.emplace_back(new Compressor());
+    while (workers.size() + 1 < strips)
+        workers.emplace_back(new SingleThreadPool());
+
+    const int q = quality;
+    if (strips == 1)
+    {
+        Compressor &compressor = *compressors[0];
+        if (compressor.encode(src, stride, width, height, components, q, 0) == false)
+            return false;
+        jpegBuffer.assign(compressor.output.data(), compressor.output.data() + compressor.outputSize);
+        return true;
+    }
 
-    jpeg_start_compress (&cinfo, TRUE);
-    while (cinfo.next_scanline < height)
+    // Each strip is a complete JPEG with a restart marker after every MCU row. Restart markers reset the
+    // DC predictors, so the scans can be joined with a marker between strips.
+    std::vector<bool> results(strips, false);
+    auto encodeStrip = [&](size_t i)
     {
-        JSAMPROW row = (JSAMPROW)(src + cinfo.next_scanline * stride);
-        jpeg_write_scanlines (&cinfo, &row, 1);
+        size_t y = i * stripHeight;
+        size_t h = std::min<size_t>(stripHeight, height - y);
+        return compressors[i]->encode(src + y * stride, stride, width, h, components, q, 1);
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(stripMutex);
+        stripsPending = strips - 1;
+    }
+    for (size_t i = 1; i < strips; i++)
+    {
+        workers[i - 1]->start([&, i](const std::atomic_bool &)
+        {
+            bool result = encodeStrip(i);
+            std::lock_guard<std::mutex> lock(stripMutex);
+            results[i] = result;
+            if (--stripsPending == 0)
+                stripDone.notify_one();
+        });
+    }
+    results[0] = encodeStrip(0);
+    {
+        std::unique_lock<std::mutex> lock(stripMutex);
+        stripDone.wait(lock, [this]()
+        {
+            return stripsPending == 0;
+        });
     }
 
-    jpeg_finish_compress (&cinfo);
-    *destsize = out_size - jdest.free_in_buffer;
-    jpeg_destroy_compress (&cinfo);
-    return 0;
-}
+    if (std::find(results.begin(), results.end(), false) != results.end())
+        return false;
 
-int MJPEGEncoder::jpeg_compress_8u_rgb (const uint8_t * src, uint16_t width, uint16_t height, int stride, int scale,
-                                        uint8_t * dest, int * destsize, int quality)
-{
-    struct jpeg_compress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    struct jpeg_destination_mgr jdest;
-    int out_size = *destsize;
-
-    cinfo.err = jpeg_std_error (&jerr);
-    jpeg_create_compress (&cinfo);
-    jdest.next_output_byte = dest;
-    jdest.free_in_buffer = out_size;
-    jdest.init_destination = init_destination;
-    jdest.empty_output_buffer = empty_output_buffer;
-    jdest.term_destination = term_destination;
-    cinfo.dest = &jdest;
-
-    cinfo.image_width = width;
-    cinfo.image_height = height;
-#if JPEG_LIB_VERSION >= 70
-    cinfo.scale_denom = scale;
-#else
-    INDI_UNUSED(scale);
-#endif
-    cinfo.input_components = 3;
-    cinfo.in_color_space = JCS_RGB;
-    jpeg_set_defaults (&cinfo);
-    jpeg_set_quality (&cinfo, quality, TRUE);
+    // Headers of the first strip, with the height of the whole frame.
+    const Compressor &first = *compressors[0];
+    size_t sofOffset, scanOffset;
+    if (findSegments(first.output.data(), first.outputSize, sofOffset, scanOffset) == false)
+        return false;
 
-    jpeg_start_compress (&cinfo, TRUE);
-    while (cinfo.next_scanline < height)
+    jpegBuffer.assign(first.output.data(), first.output.data() + scanOffset);
+    jpegBuffer[sofOffset + 5] = height >> 8;
+    jpegBuffer[sofOffset + 6] = height & 0xFF;
+
+    uint32_t restartCount = 0;
+    for (size_t i = 0; i < strips; i++)
     {
-        JSAMPROW row = (JSAMPROW)(src + cinfo.next_scanline * stride);
-        jpeg_write_scanlines (&cinfo, &row, 1);
+        const Compressor &strip = *compressors[i];
+        size_t stripSof, stripScan;
+        if (findSegments(strip.output.data(), strip.outputSize, stripSof, stripScan) == false)
+            return false;
+
+        if (i > 0)
+        {
+            jpegBuffer.push_back(0xFF);
+            jpegBuffer.push_back(0xD0 + (restartCount++ & 7));
+        }
+        // Skip the EOI marker of the strip.
+        appendScan(jpegBuffer, strip.output.data() + stripScan, strip.outputSize - stripScan - 2, restartCount);
     }
-    jpeg_finish_compress (&cinfo);
-    *destsize = out_size - jdest.free_in_buffer;
-    jpeg_destroy_compress (&cinfo);
-    return 0;
+
+    jpegBuffer.push_back(0xFF);
+    jpegBuffer.push_back(0xD9);
+    return true;
 }
 
 }
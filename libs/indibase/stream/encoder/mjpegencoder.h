@@ -23,13 +23,23 @@
 
 #include "encoderinterface.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
 namespace INDI
 {
 
+class SingleThreadPool;
+
 /**
  * @brief The MJPEGEncoder class encodes frames in JPEG format before transmitting them to the client.
  *
- * The quality is now hard-coded at 70 when encoding the JPEG image. Further compression is not supported.
+ * The compressor state is kept between frames. Bayer frames are interpolated to color. Frames wider
+ * than the target width are reduced by an integer factor with a box filter before encoding. Large
+ * frames are cut in horizontal strips encoded in parallel with restart markers, then joined in a
+ * single baseline JPEG.
  */
 class MJPEGEncoder : public EncoderInterface
 {
@@ -38,18 +48,46 @@ class MJPEGEncoder : public EncoderInterface
         ~MJPEGEncoder();
 
         virtual bool upload(INDI::WidgetViewBlob *bp, const uint8_t *buffer, uint32_t nbytes, bool isCompressed = false) override;
+        /** @brief Rows of a region of interest are read in place. */
+        virtual bool upload(INDI::WidgetViewBlob *bp, const FrameView &frame, bool isCompressed = false) override;
+
+        /** @brief JPEG quality, 1 to 100. */
+        void setQuality(int value);
+        /** @brief Frames wider than width are downscaled, 0 keeps the native resolution. */
+        void setTargetWidth(uint16_t width);
+        /** @brief Number of strips encoded in parallel for large frames, 0 selects it from the number of cores. */
+        void setThreads(uint8_t value);
 
     private:
+        struct Compressor;
+
         const char *getDeviceName();
-        int jpeg_compress_8u_gray (const uint8_t * src, uint16_t width, uint16_t height, int stride, int scale, uint8_t * dest,
-                                   int * destsize, int quality);
-        int jpeg_compress_8u_rgb (const uint8_t * src, uint16_t width, uint16_t height, int stride, int scale, uint8_t * dest,
-                                  int * destsize, int quality);
-        uint8_t *jpegBuffer = nullptr;
-        uint16_t jpegBufferSize = 1;
 
-        static const int SCALE_WIDTH = 640;
+        // Rows of the source are stride bytes apart, stride is updated when the frame is downscaled.
+        const uint8_t *downscale(const uint8_t *buffer, size_t &stride, uint16_t &width, uint16_t &height, int components);
+        bool compress(const uint8_t *src, size_t stride, uint16_t width, uint16_t height, int components);
+
+    private:
+        std::vector<std::unique_ptr<Compressor>> compressors;
+        std::vector<std::unique_ptr<SingleThreadPool>> workers;
+        std::mutex stripMutex;
+        std::condition_variable stripDone;
+        size_t stripsPending {0};
+
+        std::vector<uint8_t> colorBuffer;
+        std::vector<uint32_t> rowSums;
+        std::vector<uint8_t> scaledBuffer;
+        std::vector<uint8_t> jpegBuffer;
+
+        std::atomic<int> quality {85};
+        std::atomic<uint16_t> targetWidth {0};
+        std::atomic<uint8_t> threads {0};
 
+        // Frames smaller than this are encoded in one piece.
+        static constexpr uint32_t STRIP_THRESHOLD = 1 << 21;
+        // Strip height is a multiple of the largest MCU (4:2:0 color).
+        static constexpr uint16_t STRIP_ALIGN = 16;
+        static constexpr uint8_t MAX_STRIPS = 16;
 };
 
 }
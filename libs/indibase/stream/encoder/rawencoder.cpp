@@ -24,6 +24,7 @@
 #include "indiccd.h"
 
 #include <zlib.h>
+#include <cstring>
 
 namespace INDI
 {
@@ -76,4 +77,47 @@ bool RawEncoder::upload(INDI::WidgetViewBlob *bp, const uint8_t *buffer, uint32_
 
     return true;
 }
+
+bool RawEncoder::upload(INDI::WidgetViewBlob *bp, const FrameView &frame, bool isCompressed)
+{
+    if (isCompressed == false || frame.isContiguous())
+        return EncoderInterface::upload(bp, frame, isCompressed);
+
+    // Feed the rows to zlib one at a time, the stream is identical to compressing the packed frame.
+    const size_t nbytes = frame.size();
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    int ret = deflateInit(&stream, 4);
+    if (ret != Z_OK)
+    {
+        LOGF_ERROR("internal error - compression failed: %d", ret);
+        return false;
+    }
+
+    compressedFrame.resize(deflateBound(&stream, nbytes));
+    stream.next_out  = compressedFrame.data();
+    stream.avail_out = compressedFrame.size();
+
+    for (uint32_t y = 0; y < frame.height && ret == Z_OK; ++y)
+    {
+        stream.next_in  = const_cast<Bytef *>(frame.line(y));
+        stream.avail_in = frame.lineSize();
+        ret = deflate(&stream, y + 1 == frame.height ? Z_FINISH : Z_NO_FLUSH);
+    }
+    uLongf compressedBytes = stream.total_out;
+    deflateEnd(&stream);
+
+    if (ret != Z_STREAM_END)
+    {
+        // this should NEVER happen
+        LOGF_ERROR("internal error - compression failed: %d", ret);
+        return false;
+    }
+
+    bp->setBlob(compressedFrame.data());
+    bp->setBlobLen(compressedBytes);
+    bp->setSize(nbytes);
+    bp->setFormat(".stream.z");
+    return true;
+}
 }
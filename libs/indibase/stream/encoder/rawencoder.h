@@ -38,6 +38,8 @@ class RawEncoder : public EncoderInterface
         ~RawEncoder();
 
         virtual bool upload(INDI::WidgetViewBlob *bp, const uint8_t *buffer, uint32_t nbytes, bool isCompressed = false) override;
+        /** @brief Rows of a region of interest are compressed in place, uncompressed ones are packed. */
+        virtual bool upload(INDI::WidgetViewBlob *bp, const FrameView &frame, bool isCompressed = false) override;
 
     private:
         const char *getDeviceName();
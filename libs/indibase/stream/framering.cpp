@@ -0,0 +1,123 @@
+/*
+    Copyright (C) 2026 by the INDI Library contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "framering.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace INDI
+{
+
+FrameRing::FrameRing(size_t maxSlots)
+    : slots(std::max<size_t>(maxSlots, 2))
+{ }
+
+FrameRing::Frame *FrameRing::acquire(size_t nbytes, size_t maxBytes)
+{
+    uint64_t currentHead = head.load(std::memory_order_relaxed);
+    uint64_t currentTail = tail.load(std::memory_order_acquire);
+    size_t queued = currentHead - currentTail;
+
+    // The consumer does not touch any slot while the ring is empty, it is safe to resize the pool.
+    if (queued == 0)
+    {
+        size_t wanted = std::min(std::max<size_t>(maxBytes / std::max<size_t>(nbytes, 1), 2), slots.size());
+        if (wanted != capacity)
+        {
+            for (size_t i = wanted; i < capacity; ++i)
+                std::vector<uint8_t>().swap(slots[i].data);
+            capacity = wanted;
+        }
+    }
+
+    // Always accept at least one frame, even if it is larger than the limit.
+    if (queued >= capacity || (queued > 0 && (queued + 1) * nbytes > maxBytes))
+        return nullptr;
+
+    Frame *frame = &slots[currentHead % capacity];
+    frame->data.resize(nbytes);
+    return frame;
+}
+
+void FrameRing::publish()
+{
+    // Sequentially consistent, pairs with the consumer setting consumerWaiting before checking head.
+    head.fetch_add(1);
+
+    if (consumerWaiting.load())
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        increase.notify_one();
+    }
+}
+
+FrameRing::Frame *FrameRing::front(uint32_t msecs)
+{
+    auto isReady = [this]()
+    {
+        return aborted.load() || head.load() != tail.load(std::memory_order_relaxed);
+    };
+
+    if (!isReady())
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        consumerWaiting = true;
+        increase.wait_for(lock, std::chrono::milliseconds(msecs), isReady);
+        consumerWaiting = false;
+    }
+
+    if (aborted || head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed))
+        return nullptr;
+
+    return &slots[tail.load(std::memory_order_relaxed) % capacity];
+}
+
+void FrameRing::release()
+{
+    tail.fetch_add(1);
+
+    if (producerWaiting.load())
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        decrease.notify_all();
+    }
+}
+
+void FrameRing::waitForEmpty() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    producerWaiting = true;
+    decrease.wait(lock, [this]()
+    {
+        return aborted.load() || head.load() == tail.load();
+    });
+    producerWaiting = false;
+}
+
+void FrameRing::abort()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    aborted = true;
+    increase.notify_all();
+    decrease.notify_all();
+}
+
+size_t FrameRing::size() const
+{
+    return head.load() - tail.load();
+}
+
+}
@@ -0,0 +1,112 @@
+/*
+    Copyright (C) 2026 by the INDI Library contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+
+namespace INDI
+{
+
+/**
+ * \class FrameRing
+ * \brief The FrameRing class is a pool of recycled frame buffers passed from one producer to one consumer.
+ *
+ * The producer (camera thread) copies a frame into the next free slot and publishes it, the consumer
+ * (stream thread) processes slots in order and releases them. Slot buffers keep their capacity, so once
+ * every slot held a frame of the current size no memory is allocated anymore.
+ *
+ * Only the producer writes the head counter and only the consumer writes the tail counter, so pushing
+ * and popping never block each other. The consumer sleeps on a condition variable only while the ring is
+ * empty.
+ *
+ * The number of slots in use is derived from the memory limit and the frame size. It is adjusted only when
+ * the ring is empty, unused slots are freed at that time.
+ */
+class FrameRing
+{
+    public:
+        struct Frame
+        {
+            double time {0};
+            uint64_t timestamp {0};
+            std::vector<uint8_t> data;
+        };
+
+    public:
+        explicit FrameRing(size_t maxSlots = 256);
+
+    public:
+        /**
+         * @brief Producer: get the next free slot for a frame of nbytes.
+         * @param nbytes size of the frame
+         * @param maxBytes memory limit of all queued frames
+         * @return slot with data resized to nbytes, nullptr if the ring is full
+         */
+        Frame *acquire(size_t nbytes, size_t maxBytes);
+
+        /**
+         * @brief Producer: make the slot returned by acquire visible to the consumer.
+         */
+        void publish();
+
+        /**
+         * @brief Consumer: get the oldest published frame.
+         * @param msecs maximum time to wait for a frame
+         * @return frame or nullptr if timeout or the abort function was called
+         */
+        Frame *front(uint32_t msecs);
+
+        /**
+         * @brief Consumer: return the frame obtained by front to the pool.
+         */
+        void release();
+
+        /**
+         * @brief Wait until the consumer released all frames.
+         */
+        void waitForEmpty() const;
+
+        /**
+         * @brief Drop queued frames and wake up the consumer.
+         */
+        void abort();
+
+        /**
+         * @return Number of published frames not yet released.
+         */
+        size_t size() const;
+
+    protected:
+        std::vector<Frame> slots;
+        size_t capacity {2};
+
+        std::atomic<uint64_t> head {0};
+        std::atomic<uint64_t> tail {0};
+        std::atomic<bool> aborted {false};
+
+        std::atomic<bool> consumerWaiting {false};
+        mutable std::atomic<bool> producerWaiting {false};
+        mutable std::mutex mutex;
+        mutable std::condition_variable increase;
+        mutable std::condition_variable decrease;
+};
+
+}
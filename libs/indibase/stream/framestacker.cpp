@@ -0,0 +1,645 @@
+/*
+    Copyright (C) 2026 by the INDI Library contributors
+
+    Live frame stacking
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "framestacker.h"
+#include "indisinglethreadpool.h"
+#include "dsp.h"
+
+#include <fftw3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+namespace INDI
+{
+
+// Number of partial results of every band.
+static constexpr size_t PARTIAL_STRIDE = 5;
+
+struct FrameStacker::PhaseCorrelation
+{
+    size_t size {0};
+    // Origin of the region in the luminance image.
+    size_t x {0}, y {0};
+    double *real {nullptr};
+    fftw_complex *spectrum {nullptr};
+    fftw_complex *reference {nullptr};
+    fftw_plan forward {nullptr};
+    fftw_plan backward {nullptr};
+    std::vector<double> window;
+
+    PhaseCorrelation(size_t size, size_t lumaWidth, size_t lumaHeight)
+        : size(size)
+        , x((lumaWidth - size) / 2)
+        , y((lumaHeight - size) / 2)
+        , window(size)
+    {
+        const size_t spectrumSize = size * (size / 2 + 1);
+        real      = static_cast<double *>(fftw_malloc(sizeof(double) * size * size));
+        spectrum  = static_cast<fftw_complex *>(fftw_malloc(sizeof(fftw_complex) * spectrumSize));
+        reference = static_cast<fftw_complex *>(fftw_malloc(sizeof(fftw_complex) * spectrumSize));
+
+        // The FFTW planner is shared with the DSP plug-ins and is not thread safe.
+        dsp_fourier_planner_lock();
+        forward  = fftw_plan_dft_r2c_2d(size, size, real, spectrum, FFTW_ESTIMATE);
+        backward = fftw_plan_dft_c2r_2d(size, size, spectrum, real, FFTW_ESTIMATE);
+        dsp_fourier_planner_unlock();
+
+        // Hann window, the region edges would otherwise correlate better than the stars.
+        for (size_t i = 0; i < size; ++i)
+            window[i] = 0.5 - 0.5 * std::cos(2 * M_PI * i / size);
+    }
+
+    ~PhaseCorrelation()
+    {
+        dsp_fourier_planner_lock();
+        fftw_destroy_plan(forward);
+        fftw_destroy_plan(backward);
+        dsp_fourier_planner_unlock();
+        fftw_free(real);
+        fftw_free(spectrum);
+        fftw_free(reference);
+    }
+
+    void transform(const float *luma, size_t lumaWidth)
+    {
+        double mean = 0;
+        for (size_t i = 0; i < size; ++i)
+        {
+            const float *row = luma + (y + i) * lumaWidth + x;
+            for (size_t j = 0; j < size; ++j)
+                mean += row[j];
+        }
+        mean /= size * size;
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            const float *row = luma + (y + i) * lumaWidth + x;
+            double *out = real + i * size;
+            for (size_t j = 0; j < size; ++j)
+                out[j] = (row[j] - mean) * window[i] * window[j];
+        }
+        fftw_execute(forward);
+    }
+
+    void setReference()
+    {
+        memcpy(reference, spectrum, sizeof(fftw_complex) * size * (size / 2 + 1));
+    }
+
+    // Displacement to apply to the transformed region to align it with the reference.
+    void correlate(int &shiftX, int &shiftY)
+    {
+        const size_t spectrumSize = size * (size / 2 + 1);
+        for (size_t i = 0; i < spectrumSize; ++i)
+        {
+            // Cross power spectrum, reference times the conjugate of the frame. It is only partially
+            // whitened, with a flat spectrum the noise at high frequencies biases the peak when the
+            // seeing changes between frames.
+            double re = reference[i][0] * spectrum[i][0] + reference[i][1] * spectrum[i][1];
+            double im = reference[i][1] * spectrum[i][0] - reference[i][0] * spectrum[i][1];
+            double magnitude = std::sqrt(std::sqrt(re * re + im * im));
+            if (magnitude > 1e-12)
+            {
+                spectrum[i][0] = re / magnitude;
+                spectrum[i][1] = im / magnitude;
+            }
+            else
+            {
+                spectrum[i][0] = 0;
+                spectrum[i][1] = 0;
+            }
+        }
+        fftw_execute(backward);
+
+        size_t peak = std::max_element(real, real + size * size) - real;
+        shiftX = static_cast<int>(peak % size);
+        shiftY = static_cast<int>(peak / size);
+        if (shiftX > static_cast<int>(size / 2))
+            shiftX -= size;
+        if (shiftY > static_cast<int>(size / 2))
+            shiftY -= size;
+    }
+};
+
+FrameStacker::FrameStacker()
+{ }
+
+FrameStacker::~FrameStacker()
+{ }
+
+void FrameStacker::setKeepFraction(double fraction)
+{
+    m_KeepFraction = std::min(std::max(fraction, 0.0), 1.0);
+}
+
+void FrameStacker::setRegistration(Registration registration)
+{
+    m_Registration = registration;
+}
+
+void FrameStacker::setThreads(size_t threads)
+{
+    m_Threads = threads;
+}
+
+void FrameStacker::reset()
+{
+    m_ResetRequested = true;
+}
+
+void FrameStacker::clear()
+{
+    std::fill(m_Sum.begin(), m_Sum.end(), 0.0f);
+    std::fill(m_Weight.begin(), m_Weight.end(), 0.0f);
+    m_Scores.clear();
+    m_NextScore = 0;
+    m_HasReference = false;
+    m_Stacked = 0;
+    m_Rejected = 0;
+    m_ShiftX = 0;
+    m_ShiftY = 0;
+}
+
+bool FrameStacker::setFormat(uint32_t width, uint32_t height, INDI_PIXEL_FORMAT format, uint8_t depth)
+{
+    uint32_t channels, bin;
+    switch (format)
+    {
+        case INDI_MONO:
+            channels = 1;
+            bin = 1;
+            break;
+        case INDI_BAYER_RGGB:
+        case INDI_BAYER_GRBG:
+        case INDI_BAYER_GBRG:
+        case INDI_BAYER_BGGR:
+            channels = 1;
+            bin = 2;
+            break;
+        case INDI_RGB:
+        case INDI_BGR:
+            channels = 3;
+            bin = 1;
+            break;
+        default:
+            return false;
+    }
+
+    if (width < 2 * bin || height < 2 * bin || depth == 0 || depth > 16)
+        return false;
+
+    if (width == m_Width && height == m_Height && format == m_Format && depth == m_Depth)
+        return true;
+
+    m_Width    = width;
+    m_Height   = height;
+    m_Format   = format;
+    m_Depth    = depth;
+    m_Channels = channels;
+    m_Bin      = bin;
+
+    m_LumaWidth  = width / bin;
+    m_LumaHeight = height / bin;
+    m_Luma.resize(m_LumaWidth * m_LumaHeight);
+    m_Sum.assign(static_cast<size_t>(width) * height * channels, 0.0f);
+    m_Weight.assign(static_cast<size_t>(width) * height, 0.0f);
+    m_Phase.reset();
+
+    clear();
+    return true;
+}
+
+size_t FrameStacker::parallel(size_t rows, size_t pixels, const std::function<void(size_t, size_t, size_t)> &function)
+{
+    if (rows == 0)
+        return 0;
+
+    size_t bands = m_Threads;
+    if (bands == 0)
+        bands = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), 4);
+    if (pixels < PARALLEL_THRESHOLD)
+        bands = 1;
+    bands = std::min(bands, rows);
+
+    size_t bandRows = (rows + bands - 1) / bands;
+    bands = (rows + bandRows - 1) / bandRows;
+
+    m_Partial.assign(bands * PARTIAL_STRIDE, 0.0);
+    while (m_Workers.size() + 1 < bands)
+        m_Workers.emplace_back(new SingleThreadPool());
+
+    auto runBand = [&](size_t band)
+    {
+        function(band * bandRows, std::min(rows, (band + 1) * bandRows), band);
+    };
+
+    if (bands == 1)
+    {
+        runBand(0);
+        return 1;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_BandMutex);
+        m_BandsPending = bands - 1;
+    }
+    for (size_t band = 1; band < bands; ++band)
+    {
+        m_Workers[band - 1]->start([&, band](const std::atomic_bool &)
+        {
+            runBand(band);
+            std::lock_guard<std::mutex> lock(m_BandMutex);
+            if (--m_BandsPending == 0)
+                m_BandDone.notify_one();
+        });
+    }
+    runBand(0);
+
+    std::unique_lock<std::mutex> lock(m_BandMutex);
+    m_BandDone.wait(lock, [this]()
+    {
+        return m_BandsPending == 0;
+    });
+    return bands;
+}
+
+template <typename T>
+void FrameStacker::buildLuma(const FrameView &frame)
+{
+    const size_t lumaWidth = m_LumaWidth;
+    float *luma = m_Luma.data();
+
+    parallel(m_LumaHeight, m_Luma.size(), [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t y = begin; y < end; ++y)
+        {
+            float *out = luma + y * lumaWidth;
+            if (m_Bin == 2)
+            {
+                // Every 2x2 cell holds one red, one blue and two green pixels.
+                const T *top = reinterpret_cast<const T *>(frame.line(2 * y));
+                const T *bottom = reinterpret_cast<const T *>(frame.line(2 * y + 1));
+                for (size_t x = 0; x < lumaWidth; ++x)
+                    out[x] = 0.25f * (float(top[2 * x]) + float(top[2 * x + 1]) + float(bottom[2 * x]) + float(bottom[2 * x + 1]));
+            }
+            else if (m_Channels == 3)
+            {
+                const T *in = reinterpret_cast<const T *>(frame.line(y));
+                for (size_t x = 0; x < lumaWidth; ++x)
+                    out[x] = (1.0f / 3) * (float(in[3 * x]) + float(in[3 * x + 1]) + float(in[3 * x + 2]));
+            }
+            else
+            {
+                const T *in = reinterpret_cast<const T *>(frame.line(y));
+                for (size_t x = 0; x < lumaWidth; ++x)
+                    out[x] = in[x];
+            }
+        }
+    });
+}
+
+double FrameStacker::score()
+{
+    const size_t width = m_LumaWidth, height = m_LumaHeight;
+    const float *luma = m_Luma.data();
+
+    size_t bands = parallel(height, m_Luma.size(), [&](size_t begin, size_t end, size_t band)
+    {
+        double sum = 0, squares = 0, brightness = 0;
+        float brightest = 0;
+        for (size_t y = begin; y < end; ++y)
+        {
+            const float *row = luma + y * width;
+            for (size_t x = 0; x < width; ++x)
+            {
+                brightness += row[x];
+                brightest = std::max(brightest, row[x]);
+            }
+
+            if (y == 0 || y + 1 == height)
+                continue;
+
+            const float *up = row - width, *down = row + width;
+            float rowSum = 0, rowSquares = 0;
+            for (size_t x = 1; x + 1 < width; ++x)
+            {
+                float laplacian = 4 * row[x] - row[x - 1] - row[x + 1] - up[x] - down[x];
+                rowSum += laplacian;
+                rowSquares += laplacian * laplacian;
+            }
+            sum += rowSum;
+            squares += rowSquares;
+        }
+
+        double *partial = m_Partial.data() + band * PARTIAL_STRIDE;
+        partial[0] = sum;
+        partial[1] = squares;
+        partial[2] = brightness;
+        partial[3] = brightest;
+    });
+
+    double sum = 0, squares = 0, brightness = 0, brightest = 0;
+    for (size_t band = 0; band < bands; ++band)
+    {
+        const double *partial = m_Partial.data() + band * PARTIAL_STRIDE;
+        sum += partial[0];
+        squares += partial[1];
+        brightness += partial[2];
+        brightest = std::max(brightest, partial[3]);
+    }
+
+    m_LumaMean = brightness / m_Luma.size();
+    m_LumaMax  = brightest;
+
+    // Variance of the Laplacian relative to the brightness, clouds passing by do not look sharper or blurrier.
+    const double count = (width - 2) * (height - 2);
+    double variance = squares / count - (sum / count) * (sum / count);
+    return variance / std::max(m_LumaMean * m_LumaMean, 1.0);
+}
+
+bool FrameStacker::keep(double value)
+{
+    if (m_Scores.size() < SCORE_WINDOW)
+        m_Scores.push_back(value);
+    else
+        m_Scores[m_NextScore] = value;
+    m_NextScore = (m_NextScore + 1) % SCORE_WINDOW;
+
+    const double fraction = m_KeepFraction;
+    if (m_Scores.size() < SCORE_WARMUP || fraction >= 1)
+        return true;
+
+    // Threshold at the quantile of the recent scores, following changes of seeing and focus.
+    m_SortedScores = m_Scores;
+    size_t index = std::min(static_cast<size_t>((1 - fraction) * m_SortedScores.size()), m_SortedScores.size() - 1);
+    std::nth_element(m_SortedScores.begin(), m_SortedScores.begin() + index, m_SortedScores.end());
+    return value >= m_SortedScores[index];
+}
+
+bool FrameStacker::centroid(double &x, double &y)
+{
+    const size_t width = m_LumaWidth;
+    const float *luma = m_Luma.data();
+    // Only the bright pixels, the background would pull the centroid toward the center of the frame.
+    const float threshold = m_LumaMean + 0.25 * (m_LumaMax - m_LumaMean);
+
+    size_t bands = parallel(m_LumaHeight, m_Luma.size(), [&](size_t begin, size_t end, size_t band)
+    {
+        double weights = 0, sumX = 0, sumY = 0;
+        for (size_t row = begin; row < end; ++row)
+        {
+            const float *in = luma + row * width;
+            float rowWeights = 0, rowX = 0;
+            for (size_t column = 0; column < width; ++column)
+            {
+                float weight = std::max(in[column] - threshold, 0.0f);
+                rowWeights += weight;
+                rowX += weight * column;
+            }
+            weights += rowWeights;
+            sumX += rowX;
+            sumY += static_cast<double>(rowWeights) * row;
+        }
+
+        double *partial = m_Partial.data() + band * PARTIAL_STRIDE;
+        partial[0] = weights;
+        partial[1] = sumX;
+        partial[2] = sumY;
+    });
+
+    double weights = 0, sumX = 0, sumY = 0;
+    for (size_t band = 0; band < bands; ++band)
+    {
+        const double *partial = m_Partial.data() + band * PARTIAL_STRIDE;
+        weights += partial[0];
+        sumX += partial[1];
+        sumY += partial[2];
+    }
+
+    if (weights <= 0)
+        return false;
+
+    x = sumX / weights;
+    y = sumY / weights;
+    return true;
+}
+
+bool FrameStacker::registerFrame(int &shiftX, int &shiftY)
+{
+    shiftX = shiftY = 0;
+
+    int lumaShiftX = 0, lumaShiftY = 0;
+    switch (m_ActiveRegistration)
+    {
+        case REGISTRATION_CENTROID:
+        {
+            double x, y;
+            if (centroid(x, y) == false)
+                return false;
+            if (m_HasReference == false)
+            {
+                m_ReferenceX = x;
+                m_ReferenceY = y;
+                m_HasReference = true;
+            }
+            lumaShiftX = static_cast<int>(std::lround(m_ReferenceX - x));
+            lumaShiftY = static_cast<int>(std::lround(m_ReferenceY - y));
+            break;
+        }
+
+        case REGISTRATION_PHASE:
+        {
+            size_t size = 16;
+            while (size * 2 <= std::min({m_LumaWidth, m_LumaHeight, PHASE_SIZE}))
+                size *= 2;
+            // Too small to correlate.
+            if (size > std::min(m_LumaWidth, m_LumaHeight))
+                break;
+
+            if (m_Phase == nullptr || m_Phase->size != size)
+            {
+                m_Phase.reset(new PhaseCorrelation(size, m_LumaWidth, m_LumaHeight));
+                m_HasReference = false;
+            }
+
+            m_Phase->transform(m_Luma.data(), m_LumaWidth);
+            if (m_HasReference == false)
+            {
+                m_Phase->setReference();
+                m_HasReference = true;
+            }
+            else
+                m_Phase->correlate(lumaShiftX, lumaShiftY);
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    // Whole CFA cells for Bayer frames.
+    shiftX = lumaShiftX * static_cast<int>(m_Bin);
+    shiftY = lumaShiftY * static_cast<int>(m_Bin);
+    return std::abs(shiftX) < static_cast<int>(m_Width) && std::abs(shiftY) < static_cast<int>(m_Height);
+}
+
+template <typename T>
+void FrameStacker::accumulate(const FrameView &frame, int shiftX, int shiftY)
+{
+    const int width = m_Width, height = m_Height;
+    const size_t channels = m_Channels;
+
+    // Destination area covered by the shifted frame.
+    const int x0 = std::max(0, shiftX), x1 = std::min(width, width + shiftX);
+    const int y0 = std::max(0, shiftY), y1 = std::min(height, height + shiftY);
+    const size_t columns = x1 - x0;
+
+    float *sum = m_Sum.data();
+    float *weight = m_Weight.data();
+
+    parallel(y1 - y0, (y1 - y0) * columns, [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t row = begin; row < end; ++row)
+        {
+            const int y = y0 + row;
+            const T *in = reinterpret_cast<const T *>(frame.line(y - shiftY)) + (x0 - shiftX) * channels;
+            float *out = sum + (static_cast<size_t>(y) * width + x0) * channels;
+            for (size_t i = 0; i < columns * channels; ++i)
+                out[i] += in[i];
+
+            float *count = weight + static_cast<size_t>(y) * width + x0;
+            for (size_t i = 0; i < columns; ++i)
+                count[i] += 1;
+        }
+    });
+}
+
+bool FrameStacker::addFrame(const uint8_t *buffer, size_t nbytes, uint32_t width, uint32_t height,
+                            INDI_PIXEL_FORMAT format, uint8_t depth)
+{
+    FrameView frame(buffer, width, height, format, depth);
+    if (nbytes != frame.size())
+        return false;
+
+    return addFrame(frame);
+}
+
+bool FrameStacker::addFrame(const FrameView &frame)
+{
+    const uint8_t depth = frame.pixelDepth;
+    if (frame.data == nullptr || setFormat(frame.width, frame.height, frame.pixelFormat, depth) == false)
+        return false;
+
+    if (frame.bytesPerPixel != m_Channels * (depth > 8 ? 2 : 1))
+        return false;
+
+    const int registration = m_Registration;
+    if (m_ResetRequested.exchange(false) || registration != m_ActiveRegistration)
+    {
+        m_ActiveRegistration = registration;
+        clear();
+    }
+
+    if (depth > 8)
+        buildLuma<uint16_t>(frame);
+    else
+        buildLuma<uint8_t>(frame);
+
+    const double value = score();
+    m_LastScore = value;
+
+    int shiftX, shiftY;
+    if (keep(value) == false || registerFrame(shiftX, shiftY) == false)
+    {
+        m_Rejected++;
+        return false;
+    }
+
+    if (depth > 8)
+        accumulate<uint16_t>(frame, shiftX, shiftY);
+    else
+        accumulate<uint8_t>(frame, shiftX, shiftY);
+
+    m_ShiftX = shiftX;
+    m_ShiftY = shiftY;
+    m_Stacked++;
+    return true;
+}
+
+template <typename T>
+void FrameStacker::renderAs(T *output)
+{
+    const size_t width = m_Width, channels = m_Channels;
+    const float maximum = m_Depth > 8 ? 65535.0f : 255.0f;
+    const float *sum = m_Sum.data();
+    const float *weight = m_Weight.data();
+
+    parallel(m_Height, m_Weight.size(), [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t i = begin * width; i < end * width; ++i)
+        {
+            const float scale = weight[i] > 0 ? 1.0f / weight[i] : 0.0f;
+            for (size_t k = 0; k < channels; ++k)
+                output[i * channels + k] = static_cast<T>(std::min(sum[i * channels + k] * scale + 0.5f, maximum));
+        }
+    });
+}
+
+bool FrameStacker::render(std::vector<uint8_t> &output)
+{
+    if (m_Stacked == 0 || m_ResetRequested)
+        return false;
+
+    output.resize(m_Sum.size() * (m_Depth > 8 ? 2 : 1));
+    if (m_Depth > 8)
+        renderAs(reinterpret_cast<uint16_t *>(output.data()));
+    else
+        renderAs(output.data());
+    return true;
+}
+
+bool FrameStacker::average(std::vector<float> &output, bool planar)
+{
+    if (m_Stacked == 0 || m_ResetRequested)
+        return false;
+
+    const size_t width = m_Width, channels = m_Channels, pixels = m_Weight.size();
+    output.resize(m_Sum.size());
+    float *out = output.data();
+    const float *sum = m_Sum.data();
+    const float *weight = m_Weight.data();
+
+    parallel(m_Height, pixels, [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t i = begin * width; i < end * width; ++i)
+        {
+            const float scale = weight[i] > 0 ? 1.0f / weight[i] : 0.0f;
+            for (size_t k = 0; k < channels; ++k)
+                out[planar ? k * pixels + i : i * channels + k] = sum[i * channels + k] * scale;
+        }
+    });
+    return true;
+}
+
+}
@@ -0,0 +1,221 @@
+/*
+    Copyright (C) 2026 by the INDI Library contributors
+
+    Live frame stacking
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#pragma once
+
+#include "indibasetypes.h"
+#include "frameview.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace INDI
+{
+
+class SingleThreadPool;
+
+/**
+ * @brief The FrameStacker class averages the best frames of a stream after aligning them.
+ *
+ * Every frame is reduced to a luminance image (2x2 binned for Bayer frames so that registration moves
+ * frames by whole CFA cells). Its sharpness is scored by the variance of the Laplacian relative to the
+ * brightness, and only frames scoring in the best fraction of the recent ones are kept. Kept frames are
+ * registered against the first one, either by the centroid of the bright pixels (planets, Moon) or by phase correlation of the central
+ * region (deep sky), and summed in a floating point stack.
+ *
+ * Every pass splits the rows of the frame over a set of worker threads, inner loops run over contiguous
+ * rows so that they can be vectorized by the compiler.
+ *
+ * Frames must be added and rendered from a single thread. Settings, statistics and reset can be used
+ * from any thread, they take effect with the next frame.
+ */
+class FrameStacker
+{
+    public:
+        enum Registration
+        {
+            REGISTRATION_NONE,
+            REGISTRATION_CENTROID,
+            REGISTRATION_PHASE
+        };
+
+    public:
+        FrameStacker();
+        ~FrameStacker();
+
+        FrameStacker(const FrameStacker &) = delete;
+        FrameStacker &operator=(const FrameStacker &) = delete;
+
+        /** @brief Fraction of the frames kept, from 0 to 1. */
+        void setKeepFraction(double fraction);
+        void setRegistration(Registration registration);
+        /** @brief Number of threads, 0 selects it from the number of cores. */
+        void setThreads(size_t threads);
+
+        /** @brief Drop the stack and the reference frame before the next frame. */
+        void reset();
+
+        /**
+         * @brief addFrame Score, register and accumulate a frame.
+         * @param buffer pixels, 16 bit pixels in host byte order, RGB and BGR interleaved
+         * @param nbytes size of the buffer
+         * @param format mono, Bayer, RGB or BGR
+         * @param depth bits per pixel, 8 or up to 16
+         * @return True if the frame is stacked, false if it is rejected, the format is not supported or the
+         * size does not match.
+         * The stack is reset when the size or the format changes.
+         */
+        bool addFrame(const uint8_t *buffer, size_t nbytes, uint32_t width, uint32_t height, INDI_PIXEL_FORMAT format, uint8_t depth);
+
+        /** @brief Score, register and accumulate a frame, rows of a region of interest are read in place. */
+        bool addFrame(const FrameView &frame);
+
+        /**
+         * @brief render Average of the stacked frames in the format of the input frames.
+         * @return False if no frame is stacked yet.
+         */
+        bool render(std::vector<uint8_t> &output);
+
+        /**
+         * @brief average Average of the stacked frames as floating point values.
+         * @param planar store color frames as planes, as expected by FITS, instead of interleaved pixels
+         * @return False if no frame is stacked yet.
+         */
+        bool average(std::vector<float> &output, bool planar);
+
+        uint32_t width() const
+        {
+            return m_Width;
+        }
+        uint32_t height() const
+        {
+            return m_Height;
+        }
+        uint32_t channels() const
+        {
+            return m_Channels;
+        }
+
+        uint64_t stackedFrames() const
+        {
+            return m_Stacked;
+        }
+        uint64_t rejectedFrames() const
+        {
+            return m_Rejected;
+        }
+        /** @return Sharpness score of the last frame. */
+        double lastScore() const
+        {
+            return m_LastScore;
+        }
+
+        /** @return Shift applied to the last stacked frame in pixels. */
+        int shiftX() const
+        {
+            return m_ShiftX;
+        }
+        int shiftY() const
+        {
+            return m_ShiftY;
+        }
+
+        /// Number of recent scores the threshold of the kept fraction is computed from.
+        static constexpr size_t SCORE_WINDOW = 100;
+        /// Frames are stacked unconditionally until this number of scores is known.
+        static constexpr size_t SCORE_WARMUP = 10;
+        /// Largest side of the region used for phase correlation.
+        static constexpr size_t PHASE_SIZE = 256;
+        /// Frames smaller than this number of pixels are processed by a single thread.
+        static constexpr size_t PARALLEL_THRESHOLD = 1 << 16;
+
+    private:
+        struct PhaseCorrelation;
+
+        void clear();
+        bool setFormat(uint32_t width, uint32_t height, INDI_PIXEL_FORMAT format, uint8_t depth);
+
+        // Run function(begin, end, band) over row bands on the workers and the calling thread.
+        size_t parallel(size_t rows, size_t pixels, const std::function<void(size_t, size_t, size_t)> &function);
+
+        template <typename T>
+        void buildLuma(const FrameView &frame);
+        double score();
+        bool keep(double score);
+
+        bool centroid(double &x, double &y);
+        bool registerFrame(int &shiftX, int &shiftY);
+
+        template <typename T>
+        void accumulate(const FrameView &frame, int shiftX, int shiftY);
+        template <typename T>
+        void renderAs(T *output);
+
+    private:
+        std::atomic<double> m_KeepFraction {0.5};
+        std::atomic<int> m_Registration {REGISTRATION_PHASE};
+        int m_ActiveRegistration {REGISTRATION_PHASE};
+        std::atomic<size_t> m_Threads {0};
+        std::atomic<bool> m_ResetRequested {false};
+
+        uint32_t m_Width {0}, m_Height {0};
+        uint32_t m_Channels {1};
+        uint8_t m_Depth {8};
+        INDI_PIXEL_FORMAT m_Format {INDI_MONO};
+
+        // Luminance image used for scoring and registration.
+        uint32_t m_Bin {1};
+        size_t m_LumaWidth {0}, m_LumaHeight {0};
+        std::vector<float> m_Luma;
+        double m_LumaMean {0}, m_LumaMax {0};
+
+        std::vector<float> m_Sum;
+        std::vector<float> m_Weight;
+
+        std::vector<double> m_Scores;
+        size_t m_NextScore {0};
+        std::vector<double> m_SortedScores;
+
+        bool m_HasReference {false};
+        double m_ReferenceX {0}, m_ReferenceY {0};
+        std::unique_ptr<PhaseCorrelation> m_Phase;
+
+        // Partial results of the bands.
+        std::vector<double> m_Partial;
+
+        std::atomic<uint64_t> m_Stacked {0};
+        std::atomic<uint64_t> m_Rejected {0};
+        std::atomic<double> m_LastScore {0};
+        std::atomic<int> m_ShiftX {0}, m_ShiftY {0};
+
+        std::vector<std::unique_ptr<SingleThreadPool>> m_Workers;
+        std::mutex m_BandMutex;
+        std::condition_variable m_BandDone;
+        size_t m_BandsPending {0};
+};
+
+}
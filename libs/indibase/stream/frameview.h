@@ -0,0 +1,119 @@
+/*
+    Copyright (C) 2026 by the INDI Library contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include "indibasetypes.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace INDI
+{
+
+/**
+ * \struct FrameView
+ * \brief A FrameView describes pixels owned by someone else, rows may be further apart than their size.
+ *
+ * A region of interest of a frame is a view on the full frame with the stride of the full frame, so
+ * consumers read the region in place instead of receiving a copy. Encoded frames (JPEG) are a single
+ * row of bytes.
+ */
+struct FrameView
+{
+    const uint8_t *data {nullptr};
+    uint32_t width {0};             /*!< Width in pixels */
+    uint32_t height {0};            /*!< Number of rows */
+    size_t stride {0};              /*!< Bytes from the start of a row to the start of the next one */
+    size_t bytesPerPixel {1};       /*!< Bytes per pixel including all color components */
+    INDI_PIXEL_FORMAT pixelFormat {INDI_MONO};
+    uint8_t pixelDepth {8};
+
+    FrameView() = default;
+
+    /** @brief View on contiguous pixels. */
+    FrameView(const uint8_t *data, uint32_t width, uint32_t height, INDI_PIXEL_FORMAT pixelFormat, uint8_t pixelDepth)
+        : data(data)
+        , width(width)
+        , height(height)
+        , bytesPerPixel(((pixelFormat == INDI_RGB || pixelFormat == INDI_BGR) ? 3 : 1) * ((pixelDepth + 7) / 8))
+        , pixelFormat(pixelFormat)
+        , pixelDepth(pixelDepth)
+    {
+        stride = lineSize();
+    }
+
+    /** @brief View on a buffer of nbytes, for encoded frames or when the geometry is not known. */
+    static FrameView fromBuffer(const uint8_t *data, size_t nbytes, INDI_PIXEL_FORMAT pixelFormat = INDI_MONO,
+                                uint8_t pixelDepth = 8)
+    {
+        FrameView view;
+        view.data = data;
+        view.width = static_cast<uint32_t>(nbytes);
+        view.height = 1;
+        view.stride = nbytes;
+        view.pixelFormat = pixelFormat;
+        view.pixelDepth = pixelDepth;
+        return view;
+    }
+
+    size_t lineSize() const
+    {
+        return width * bytesPerPixel;
+    }
+
+    /** @return Size of the pixels without the gaps between rows. */
+    size_t size() const
+    {
+        return lineSize() * height;
+    }
+
+    bool isContiguous() const
+    {
+        return stride == lineSize() || height <= 1;
+    }
+
+    const uint8_t *line(uint32_t y) const
+    {
+        return data + y * stride;
+    }
+
+    /** @brief View on a region of this view, the region must be inside of it. */
+    FrameView region(uint32_t x, uint32_t y, uint32_t w, uint32_t h) const
+    {
+        FrameView view = *this;
+        view.data = data + y * stride + x * bytesPerPixel;
+        view.width = w;
+        view.height = h;
+        return view;
+    }
+
+    /** @brief Copy the rows to destination, which must hold size() bytes. */
+    void copyTo(uint8_t *destination) const
+    {
+        if (isContiguous())
+        {
+            memcpy(destination, data, size());
+            return;
+        }
+
+        const size_t length = lineSize();
+        for (uint32_t y = 0; y < height; ++y, destination += length)
+            memcpy(destination, line(y), length);
+    }
+};
+
+}
@@ -21,23 +21,101 @@
 
 */
 #include "gammalut16.h"
+#include "dsp.h"
+
+#include <algorithm>
 #include <cmath>
 
-GammaLut16::GammaLut16(double gamma, double a, double b, double Ii)
+template <typename Function>
+void GammaLut16::buildTable(uint16_t black, uint16_t white, Function transfer)
 {
     mLookUpTable.resize(65536);
 
-    unsigned int i = 0;
-    for (auto &value : mLookUpTable)
+    double range = std::max<double>(white - black, 1);
+    for (size_t i = 0; i < mLookUpTable.size(); ++i)
+    {
+        double p = transfer(std::min(std::max((static_cast<double>(i) - black) / range, 0.0), 1.0));
+        mLookUpTable[i] = static_cast<uint8_t>(std::lround(255.0 * std::min(std::max(p, 0.0), 1.0)));
+    }
+}
+
+GammaLut16::GammaLut16(double gamma, double a, double b, double Ii)
+{
+    buildTable(0, 65535, [&](double I)
     {
-        double I = static_cast<double>(i++) / 65535.0;
-        double p;
         if (I <= Ii)
-            p = a * I;
+            return a * I;
         else
-            p = (1 + b) * powf(I, 1.0 / gamma) - b;
-        value = round(255.0 * p);
+            return (1 + b) * std::pow(I, 1.0 / gamma) - b;
+    });
+}
+
+void GammaLut16::setStretch(uint16_t black, uint16_t white, double midtones)
+{
+    buildTable(black, white, [&](double x)
+    {
+        if (x <= 0)
+            return 0.0;
+        if (x >= 1)
+            return 1.0;
+        return ((midtones - 1) * x) / ((2 * midtones - 1) * x - midtones);
+    });
+}
+
+void GammaLut16::autoStretch(const uint16_t *source, size_t count)
+{
+    autoStretch(source, count, 1, count);
+}
+
+void GammaLut16::autoStretch(const uint16_t *source, size_t width, size_t height, size_t stride)
+{
+    const size_t count = width * height;
+    if (count == 0)
+        return;
+
+    std::vector<uint32_t> histogram(65536, 0);
+    size_t step = std::max<size_t>(1, count / STRETCH_SAMPLES);
+    size_t samples = 0;
+    for (size_t i = 0; i < count; i += step, ++samples)
+        histogram[source[i / width * stride + i % width]]++;
+
+    // Median, median absolute deviation and a high percentile for the white point.
+    auto percentile = [&](double fraction)
+    {
+        size_t target = std::max<size_t>(1, static_cast<size_t>(samples * fraction));
+        size_t total = 0;
+        for (size_t value = 0; value < histogram.size(); ++value)
+        {
+            total += histogram[value];
+            if (total >= target)
+                return static_cast<int>(value);
+        }
+        return 65535;
+    };
+
+    int median = percentile(0.5);
+    int white  = percentile(0.9999);
+
+    std::vector<uint32_t> deviations(65536, 0);
+    for (size_t value = 0; value < histogram.size(); ++value)
+        deviations[std::abs(static_cast<int>(value) - median)] += histogram[value];
+    size_t total = 0, mad = 0;
+    for (; mad < deviations.size(); ++mad)
+    {
+        total += deviations[mad];
+        if (total >= (samples + 1) / 2)
+            break;
     }
+
+    double black = std::max(0.0, median - 2.8 * 1.4826 * std::max<size_t>(mad, 1));
+    white = std::max(white, median + 1);
+    double level = (median - black) / (white - black);
+
+    // Midtones balance bringing the median to a quarter of the output range.
+    const double target = 0.25;
+    double midtones = level <= 0 ? 0.5 : ((target - 1) * level) / ((2 * target - 1) * level - target);
+    setStretch(static_cast<uint16_t>(black), static_cast<uint16_t>(std::min(white, 65535)),
+               std::min(std::max(midtones, 0.0001), 0.9999));
 }
 
 void GammaLut16::apply(const uint16_t *source, size_t count, uint8_t *destination) const
@@ -45,11 +123,85 @@ void GammaLut16::apply(const uint16_t *source, size_t count, uint8_t *destinatio
     apply(source, source + count, destination);
 }
 
-
 void GammaLut16::apply(const uint16_t *first, const uint16_t *last, uint8_t *destination) const
+{
+    size_t count = last - first;
+    if (count < PARALLEL_THRESHOLD)
+    {
+        applyRange(first, last, destination);
+        return;
+    }
+
+    // Blocks of pixels are converted by the shared dsp thread pool, no thread is started per frame.
+    struct Job
+    {
+        const GammaLut16 *lut;
+        const uint16_t *first, *last;
+        uint8_t *destination;
+    } job = {this, first, last, destination};
+
+    dsp_parallel_for(static_cast<int>((count + PARALLEL_BLOCK - 1) / PARALLEL_BLOCK), 0, [](void *arg, int start, int end, int)
+    {
+        auto job = static_cast<Job *>(arg);
+        const uint16_t *begin = job->first + static_cast<size_t>(start) * PARALLEL_BLOCK;
+        const uint16_t *until = std::min(job->last, job->first + static_cast<size_t>(end) * PARALLEL_BLOCK);
+        job->lut->applyRange(begin, until, job->destination + (begin - job->first));
+    }, &job);
+}
+
+void GammaLut16::apply(const uint16_t *source, size_t width, size_t height, size_t stride, uint8_t *destination) const
+{
+    if (stride == width)
+    {
+        apply(source, width * height, destination);
+        return;
+    }
+
+    struct Job
+    {
+        const GammaLut16 *lut;
+        const uint16_t *source;
+        size_t width, stride;
+        uint8_t *destination;
+    } job = {this, source, width, stride, destination};
+
+    auto applyRows = [](void *arg, int start, int end, int)
+    {
+        auto job = static_cast<Job *>(arg);
+        for (size_t y = start; y < static_cast<size_t>(end); ++y)
+            job->lut->applyRange(job->source + y * job->stride, job->source + y * job->stride + job->width,
+                                 job->destination + y * job->width);
+    };
+
+    if (width * height < PARALLEL_THRESHOLD)
+    {
+        applyRows(&job, 0, static_cast<int>(height), 0);
+        return;
+    }
+
+    // Blocks of rows are converted by the shared dsp thread pool.
+    dsp_parallel_for(static_cast<int>(height), 0, applyRows, &job);
+}
+
+void GammaLut16::applyRange(const uint16_t *first, const uint16_t *last, uint8_t *destination) const
 {
     const uint8_t *lookUpTable = mLookUpTable.data();
 
+    // Independent lookups, unrolled so several loads are in flight.
+    while (last - first >= 8)
+    {
+        destination[0] = lookUpTable[first[0]];
+        destination[1] = lookUpTable[first[1]];
+        destination[2] = lookUpTable[first[2]];
+        destination[3] = lookUpTable[first[3]];
+        destination[4] = lookUpTable[first[4]];
+        destination[5] = lookUpTable[first[5]];
+        destination[6] = lookUpTable[first[6]];
+        destination[7] = lookUpTable[first[7]];
+        first += 8;
+        destination += 8;
+    }
+
     while (first != last)
         *destination++ = lookUpTable[*first++];
 }
@@ -26,6 +26,12 @@
 #include <cstdint>
 #include <cstddef>
 
+/**
+ * @brief The GammaLut16 class converts 16-bit pixels to 8-bit for streaming.
+ *
+ * Either a fixed gamma curve or a stretch between black and white points is precomputed in a table
+ * of all 65536 values. Large frames are split between the threads of the dsp pool, see dsp_max_threads().
+ */
 class GammaLut16
 {
     public:
@@ -34,6 +40,37 @@ class GammaLut16
     public:
         void apply(const uint16_t *source, size_t count, uint8_t *destination) const;
         void apply(const uint16_t *first, const uint16_t *last, uint8_t *destination) const;
+        /**
+         * @brief Convert a region of a frame, rows of the source are stride pixels apart.
+         * The destination receives width * height contiguous pixels.
+         */
+        void apply(const uint16_t *source, size_t width, size_t height, size_t stride, uint8_t *destination) const;
+
+        /**
+         * @brief Stretch the given range with a midtones transfer function instead of the gamma curve.
+         * @param midtones Midtones balance, 0.5 is a linear stretch.
+         */
+        void setStretch(uint16_t black, uint16_t white, double midtones);
+
+        /**
+         * @brief Compute the stretch from the histogram of a sample of the frame.
+         * The black point is placed below the median background and the midtones bring it to a fixed level.
+         */
+        void autoStretch(const uint16_t *source, size_t count);
+        void autoStretch(const uint16_t *source, size_t width, size_t height, size_t stride);
+
+    public:
+        /// Frames with more pixels are split between threads.
+        static constexpr size_t PARALLEL_THRESHOLD = 1 << 21;
+        /// Contiguous frames are split in blocks of this many pixels.
+        static constexpr size_t PARALLEL_BLOCK = 1 << 16;
+        /// Number of pixels sampled by autoStretch.
+        static constexpr size_t STRETCH_SAMPLES = 1 << 16;
+
+    protected:
+        template <typename Function>
+        void buildTable(uint16_t black, uint16_t white, Function transfer);
+        void applyRange(const uint16_t *first, const uint16_t *last, uint8_t *destination) const;
 
     protected:
         std::vector<uint8_t> mLookUpTable;
@@ -291,11 +291,12 @@ static void my_emit_message(j_common_ptr cinfo, int msg_level)
 #define MAX_LUMA_WIDTH   4096
 #define MAX_CHROMA_WIDTH 2048
 
-static unsigned char buf0[16][MAX_LUMA_WIDTH];
-static unsigned char buf1[8][MAX_CHROMA_WIDTH];
-static unsigned char buf2[8][MAX_CHROMA_WIDTH];
-static unsigned char chr1[8][MAX_CHROMA_WIDTH];
-static unsigned char chr2[8][MAX_CHROMA_WIDTH];
+/* Scratch rows are per thread, V4L2 frames may be decoded by several threads */
+static _Thread_local unsigned char buf0[16][MAX_LUMA_WIDTH];
+static _Thread_local unsigned char buf1[8][MAX_CHROMA_WIDTH];
+static _Thread_local unsigned char buf2[8][MAX_CHROMA_WIDTH];
+static _Thread_local unsigned char chr1[8][MAX_CHROMA_WIDTH];
+static _Thread_local unsigned char chr2[8][MAX_CHROMA_WIDTH];
 
 #if 1 /* generation of 'std' Huffman tables... */
 
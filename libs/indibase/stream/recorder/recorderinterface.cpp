@@ -34,4 +34,14 @@ const char *RecorderInterface::getName()
 {
     return name;
 }
+
+bool RecorderInterface::writeFrame(const FrameView &frame, uint64_t timestamp)
+{
+    if (frame.isContiguous())
+        return writeFrame(frame.data, frame.size(), timestamp);
+
+    m_PackedFrame.resize(frame.size());
+    frame.copyTo(m_PackedFrame.data());
+    return writeFrame(m_PackedFrame.data(), m_PackedFrame.size(), timestamp);
+}
 }
@@ -23,6 +23,7 @@
 
 #include "indidevapi.h"
 #include "indibasetypes.h"
+#include "stream/frameview.h"
 
 #include <stdio.h>
 #include <cstdlib>
@@ -75,14 +76,30 @@ class RecorderInterface
         virtual bool close()                                                           = 0;
         // when frame is in known encoding format
         virtual bool writeFrame(const uint8_t *frame, uint32_t nbytes, uint64_t timestamp) = 0;
+        // Frame given as a view, a region of interest is read in place. The default implementation
+        // packs the rows of strided frames and calls the buffer variant.
+        virtual bool writeFrame(const FrameView &frame, uint64_t timestamp);
         // If streaming is enabled, then any subframing is already done by the stream recorder
         // and no need to do any further subframing operations. Otherwise, subframing must be done.
         // This is to reduce process time and save memory for a dedicated subframe buffer
         virtual void setStreamEnabled(bool enable) = 0;
+        // Number of frames the recording is expected to contain, 0 if unknown.
+        // Recorders may use it to reserve storage up front.
+        virtual void setExpectedFrames(uint64_t frames)
+        {
+            INDI_UNUSED(frames);
+        }
+        // Frames discarded since the recorder was opened because the storage could not keep up.
+        virtual uint64_t getDroppedFrames() const
+        {
+            return 0;
+        }
 
     protected:
         const char *name;
         float m_FPS = 1;
+        // Rows of strided frames for recorders that need contiguous pixels.
+        std::vector<uint8_t> m_PackedFrame;
 };
 
 }
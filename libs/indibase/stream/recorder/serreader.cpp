@@ -0,0 +1,212 @@
+/*
+    Copyright (C) 2026 by the INDI Library contributors
+
+    SER Reader
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "serreader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ERRMSGSIZ 1024
+
+namespace INDI
+{
+
+static uint32_t get_int_le(const uint8_t *&in)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++)
+        value |= static_cast<uint32_t>(*in++) << (8 * i);
+    return value;
+}
+
+static uint64_t get_long_int_le(const uint8_t *in)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++)
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    return value;
+}
+
+SER_Reader::~SER_Reader()
+{
+    close();
+}
+
+bool SER_Reader::open(const char *filename, char *errmsg)
+{
+    close();
+
+    int fd = ::open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        snprintf(errmsg, ERRMSGSIZ, "reader open error %d, %s", errno, strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < SER_Recorder::HEADER_SIZE)
+    {
+        snprintf(errmsg, ERRMSGSIZ, "reader open error, %s is not a SER file", filename);
+        ::close(fd);
+        return false;
+    }
+
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid once the descriptor is closed.
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        snprintf(errmsg, ERRMSGSIZ, "reader mmap error %d, %s", errno, strerror(errno));
+        return false;
+    }
+
+    m_Data = static_cast<uint8_t *>(data);
+    m_Size = st.st_size;
+
+    const uint8_t *in = m_Data;
+    memcpy(m_Header.FileID, in, 14);
+    in += 14;
+    m_Header.LuID         = get_int_le(in);
+    m_Header.ColorID      = get_int_le(in);
+    m_Header.LittleEndian = get_int_le(in);
+    m_Header.ImageWidth   = get_int_le(in);
+    m_Header.ImageHeight  = get_int_le(in);
+    m_Header.PixelDepth   = get_int_le(in);
+    m_Header.FrameCount   = get_int_le(in);
+    memcpy(m_Header.Observer, in, 40);
+    memcpy(m_Header.Instrume, in + 40, 40);
+    memcpy(m_Header.Telescope, in + 80, 40);
+    in += 120;
+    m_Header.DateTime     = get_long_int_le(in);
+    m_Header.DateTime_UTC = get_long_int_le(in + 8);
+
+    uint32_t planes = (m_Header.ColorID == SER_RGB || m_Header.ColorID == SER_BGR) ? 3 : 1;
+    m_FrameSize = static_cast<size_t>(m_Header.ImageWidth) * m_Header.ImageHeight * (m_Header.PixelDepth <= 8 ? 1 : 2) * planes;
+    if (m_FrameSize == 0 || m_Header.PixelDepth == 0 || m_Header.PixelDepth > 16)
+    {
+        snprintf(errmsg, ERRMSGSIZ, "reader open error, invalid SER header in %s", filename);
+        close();
+        return false;
+    }
+
+    size_t available = (m_Size - SER_Recorder::HEADER_SIZE) / m_FrameSize;
+    m_FrameCount = m_Header.FrameCount;
+    if (m_FrameCount == 0 || m_FrameCount > available)
+        m_FrameCount = available;
+
+    size_t trailer = SER_Recorder::HEADER_SIZE + m_FrameCount * m_FrameSize;
+    if (m_FrameCount > 0 && m_Size >= trailer + m_FrameCount * sizeof(uint64_t))
+        m_Timestamps = m_Data + trailer;
+
+    // Frames are usually read in order.
+    madvise(m_Data, m_Size, MADV_SEQUENTIAL);
+    return true;
+}
+
+void SER_Reader::close()
+{
+    if (m_Data)
+        munmap(m_Data, m_Size);
+
+    m_Data = nullptr;
+    m_Size = 0;
+    m_FrameCount = 0;
+    m_FrameSize = 0;
+    m_Timestamps = nullptr;
+}
+
+const uint8_t *SER_Reader::frame(uint32_t index) const
+{
+    if (index >= m_FrameCount)
+        return nullptr;
+
+    return m_Data + SER_Recorder::HEADER_SIZE + static_cast<size_t>(index) * m_FrameSize;
+}
+
+void SER_Reader::prefetch(uint32_t index, uint32_t count) const
+{
+    if (index >= m_FrameCount)
+        return;
+
+    count = std::min(count, m_FrameCount - index);
+
+    // madvise requires a page aligned address.
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t begin = SER_Recorder::HEADER_SIZE + static_cast<size_t>(index) * m_FrameSize;
+    size_t end   = begin + static_cast<size_t>(count) * m_FrameSize;
+    begin = begin / pageSize * pageSize;
+    madvise(m_Data + begin, end - begin, MADV_WILLNEED);
+}
+
+uint64_t SER_Reader::timestamp(uint32_t index) const
+{
+    if (m_Timestamps == nullptr || index >= m_FrameCount)
+        return 0;
+
+    return get_long_int_le(m_Timestamps + static_cast<size_t>(index) * sizeof(uint64_t));
+}
+
+uint32_t SER_Reader::findFrame(uint64_t value) const
+{
+    if (m_Timestamps == nullptr)
+        return 0;
+
+    // Timestamps are increasing, find the first frame after value.
+    uint32_t low = 0, high = m_FrameCount;
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        if (timestamp(middle) <= value)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low > 0 ? low - 1 : 0;
+}
+
+INDI_PIXEL_FORMAT SER_Reader::pixelFormat() const
+{
+    switch (m_Header.ColorID)
+    {
+        case SER_BAYER_RGGB:
+            return INDI_BAYER_RGGB;
+        case SER_BAYER_GRBG:
+            return INDI_BAYER_GRBG;
+        case SER_BAYER_GBRG:
+            return INDI_BAYER_GBRG;
+        case SER_BAYER_BGGR:
+            return INDI_BAYER_BGGR;
+        case SER_RGB:
+            return INDI_RGB;
+        case SER_BGR:
+            return INDI_BGR;
+        default:
+            return INDI_MONO;
+    }
+}
+
+}
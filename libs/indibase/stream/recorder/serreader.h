@@ -0,0 +1,115 @@
+/*
+    Copyright (C) 2026 by the INDI Library contributors
+
+    SER Reader
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#pragma once
+
+#include "serrecorder.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace INDI
+{
+
+/**
+ * @brief The SER_Reader class gives random access to the frames of a SER file.
+ *
+ * The file is mapped in memory, a frame is located from its index and the frame size given by the header,
+ * nothing is copied. Timestamps are read from the trailer when present.
+ *
+ * Recordings interrupted before the header was updated have a frame count of zero, the number of frames
+ * is then derived from the file size.
+ *
+ * Pixels are returned as stored. Files written by SER_Recorder hold 16 bit pixels in host byte order.
+ */
+class SER_Reader
+{
+    public:
+        SER_Reader() = default;
+        ~SER_Reader();
+
+        SER_Reader(const SER_Reader &) = delete;
+        SER_Reader &operator=(const SER_Reader &) = delete;
+
+        /**
+         * @brief open Map a SER file.
+         * @param filename path of the file
+         * @param errmsg buffer of MAXRBUF characters receiving the error
+         * @return True if the file is a valid SER file.
+         */
+        bool open(const char *filename, char *errmsg);
+        void close();
+
+        bool isOpen() const
+        {
+            return m_Data != nullptr;
+        }
+
+        const ser_header &header() const
+        {
+            return m_Header;
+        }
+
+        uint32_t frameCount() const
+        {
+            return m_FrameCount;
+        }
+
+        /** @return Size of a frame in bytes. */
+        size_t frameSize() const
+        {
+            return m_FrameSize;
+        }
+
+        /** @return Pointer to the pixels of frame index, nullptr if out of range. */
+        const uint8_t *frame(uint32_t index) const;
+
+        /** @brief Hint the kernel that frames from index on are read soon. */
+        void prefetch(uint32_t index, uint32_t count = 1) const;
+
+        bool hasTimestamps() const
+        {
+            return m_Timestamps != nullptr;
+        }
+
+        /** @return UTC timestamp of frame index in SER units (100 ns since January 1st, year 1), 0 if unknown. */
+        uint64_t timestamp(uint32_t index) const;
+
+        /**
+         * @brief findFrame Find the last frame captured at or before a time.
+         * @param timestamp time in SER units
+         * @return Index of the frame, 0 if there is no timestamp or the time is before the first frame.
+         */
+        uint32_t findFrame(uint64_t timestamp) const;
+
+        /** @return Pixel format matching the color ID of the header. */
+        INDI_PIXEL_FORMAT pixelFormat() const;
+
+    private:
+        ser_header m_Header;
+        uint8_t *m_Data {nullptr};
+        size_t m_Size {0};
+        uint32_t m_FrameCount {0};
+        size_t m_FrameSize {0};
+        const uint8_t *m_Timestamps {nullptr};
+};
+
+}
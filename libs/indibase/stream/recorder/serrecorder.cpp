@@ -28,9 +28,13 @@
 #include "serrecorder.h"
 #include "jpegutils.h"
 
+#include <algorithm>
 #include <ctime>
 #include <cerrno>
+#include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/time.h>
 
 
@@ -39,6 +43,19 @@
 namespace INDI
 {
 
+// SER fields are little endian whatever the host is.
+static void put_int_le(uint8_t *&out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        *out++ = static_cast<uint8_t>(value >> (8 * i));
+}
+
+static void put_long_int_le(uint8_t *&out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        *out++ = static_cast<uint8_t>(value >> (8 * i));
+}
+
 SER_Recorder::SER_Recorder()
 {
     name = "SER";
@@ -53,66 +70,34 @@ SER_Recorder::SER_Recorder()
     // always default to. LITTLE_ENDIAN appears to be ignored by them leading to garbled data.
     serh.LittleEndian = SER_BIG_ENDIAN;
     isRecordingActive = false;
-    f = nullptr;
 
     jpegBuffer = static_cast<uint8_t*>(malloc(1));
 }
 
 SER_Recorder::~SER_Recorder()
 {
+    close();
     free(jpegBuffer);
+    free(m_Buffer);
 }
 
-bool SER_Recorder::is_little_endian()
-{
-    unsigned int magic        = 0x00000001;
-    unsigned char black_magic = *(unsigned char *)&magic;
-    return black_magic == 0x01;
-}
-
-void SER_Recorder::write_int_le(uint32_t *i)
-{
-    if (is_little_endian())
-        fwrite((i), sizeof(uint32_t), 1, f);
-    else
-    {
-        unsigned char *c = (unsigned char *)i;
-        fwrite((c + 3), sizeof(char), 1, f);
-        fwrite((c + 2), sizeof(char), 1, f);
-        fwrite((c + 1), sizeof(char), 1, f);
-        fwrite((c), sizeof(char), 1, f);
-    }
-}
-
-void SER_Recorder::write_long_int_le(uint64_t *i)
-{
-    if (is_little_endian())
-    {
-        fwrite(((uint32_t *)i), sizeof(int), 1, f);
-        fwrite(((uint32_t *)(i) + 1), sizeof(int), 1, f);
-    }
-    else
-    {
-        write_int_le((uint32_t *)(i) + 1);
-        write_int_le((uint32_t *)(i));
-    }
-}
-
-void SER_Recorder::write_header(ser_header *s)
+void SER_Recorder::write_header(const ser_header *s, uint8_t *out)
 {
-    fwrite((s->FileID), sizeof(char), 14, f);
-    write_int_le(&(s->LuID));
-    write_int_le(&(s->ColorID));
-    write_int_le(&(s->LittleEndian));
-    write_int_le(&(s->ImageWidth));
-    write_int_le(&(s->ImageHeight));
-    write_int_le(&(s->PixelDepth));
-    write_int_le(&(s->FrameCount));
-    fwrite((s->Observer), sizeof(char), 40, f);
-    fwrite((s->Instrume), sizeof(char), 40, f);
-    fwrite((s->Telescope), sizeof(char), 40, f);
-    write_long_int_le(&(s->DateTime));
-    write_long_int_le(&(s->DateTime_UTC));
+    memcpy(out, s->FileID, 14);
+    out += 14;
+    put_int_le(out, s->LuID);
+    put_int_le(out, s->ColorID);
+    put_int_le(out, s->LittleEndian);
+    put_int_le(out, s->ImageWidth);
+    put_int_le(out, s->ImageHeight);
+    put_int_le(out, s->PixelDepth);
+    put_int_le(out, s->FrameCount);
+    memcpy(out, s->Observer, 40);
+    memcpy(out + 40, s->Instrume, 40);
+    memcpy(out + 80, s->Telescope, 40);
+    out += 120;
+    put_long_int_le(out, s->DateTime);
+    put_long_int_le(out, s->DateTime_UTC);
 }
 
 bool SER_Recorder::setPixelFormat(INDI_PIXEL_FORMAT pixelFormat, uint8_t pixelDepth)
@@ -175,7 +160,31 @@ bool SER_Recorder::open(const char *filename, char *errmsg)
     if (isRecordingActive)
         return false;
     serh.FrameCount = 0;
-    if ((f = fopen(filename, "w")) == nullptr)
+
+    if (m_Buffer == nullptr && posix_memalign(reinterpret_cast<void **>(&m_Buffer), BUFFER_ALIGNMENT, WRITE_CHUNK_SIZE) != 0)
+    {
+        m_Buffer = nullptr;
+        snprintf(errmsg, ERRMSGSIZ, "recorder open error, cannot allocate write buffer\n");
+        return false;
+    }
+
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    m_Direct = m_DirectIO;
+    m_FD = -1;
+#ifdef O_DIRECT
+    if (m_Direct)
+    {
+        m_FD = ::open(filename, flags | O_DIRECT, 0644);
+        // Filesystems such as tmpfs do not support direct I/O.
+        if (m_FD < 0 && errno == EINVAL)
+            m_Direct = false;
+    }
+#else
+    m_Direct = false;
+#endif
+    if (m_FD < 0 && m_Direct == false)
+        m_FD = ::open(filename, flags, 0644);
+    if (m_FD < 0)
     {
         snprintf(errmsg, ERRMSGSIZ, "recorder open error %d, %s\n", errno, strerror(errno));
         return false;
@@ -183,100 +192,232 @@ bool SER_Recorder::open(const char *filename, char *errmsg)
 
     serh.DateTime     = getLocalTimeStamp();
     serh.DateTime_UTC = getUTCTimeStamp();
-    write_header(&serh);
     frame_size        = serh.ImageWidth * serh.ImageHeight * (serh.PixelDepth <= 8 ? 1 : 2) * number_of_planes;
-    isRecordingActive = true;
+
+#ifdef __linux__
+    // Reserve the space up front so the filesystem can allocate contiguous extents, the file is trimmed on close.
+    if (m_ExpectedFrames > 0 && m_PixelFormat != INDI_JPG)
+        fallocate(m_FD, 0, 0, HEADER_SIZE + m_ExpectedFrames * (frame_size + sizeof(uint64_t)));
+#endif
 
     frameStamps.clear();
+    frameStamps.reserve(m_ExpectedFrames);
+
+    // The header is written again with the frame count on close.
+    m_BufferUsed = 0;
+    m_FileSize   = 0;
+    uint8_t header[HEADER_SIZE];
+    write_header(&serh, header);
+    append(header, HEADER_SIZE);
+
+    m_DroppedFrames = 0;
+    m_WriteError = false;
+    m_Closing = false;
+    isRecordingActive = true;
+    m_Writer = std::thread(&SER_Recorder::run, this);
 
     return true;
 }
 
 bool SER_Recorder::close()
 {
-    if (f)
+    bool ok = true;
+    if (m_FD >= 0)
     {
+        // Write the remaining frames.
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            m_Closing = true;
+        }
+        m_Increase.notify_one();
+        if (m_Writer.joinable())
+            m_Writer.join();
+
         // Write all timestamps
+        std::vector<uint8_t> trailer(frameStamps.size() * sizeof(uint64_t));
+        uint8_t *out = trailer.data();
         for (auto value : frameStamps)
-            write_long_int_le(&value);
-
+            put_long_int_le(out, value);
         frameStamps.clear();
 
-        fseek(f, 0L, SEEK_SET);
-        write_header(&serh);
-        fclose(f);
-        f = nullptr;
+        ok = m_WriteError == false && append(trailer.data(), trailer.size());
+
+        // Direct I/O writes whole blocks, the padding and the preallocated space are trimmed.
+        uint64_t fileSize = m_FileSize + m_BufferUsed;
+        if (ok)
+        {
+            size_t tail = m_BufferUsed;
+            if (m_Direct)
+                tail = (tail + BUFFER_ALIGNMENT - 1) / BUFFER_ALIGNMENT * BUFFER_ALIGNMENT;
+            memset(m_Buffer + m_BufferUsed, 0, tail - m_BufferUsed);
+            ok = writeBuffer(tail);
+        }
+        if (ftruncate(m_FD, ok ? fileSize : m_FileSize) != 0)
+            ok = false;
+
+#ifdef O_DIRECT
+        // The header is not a whole block.
+        if (m_Direct)
+            fcntl(m_FD, F_SETFL, fcntl(m_FD, F_GETFL) & ~O_DIRECT);
+#endif
+        uint8_t header[HEADER_SIZE];
+        write_header(&serh, header);
+        if (pwrite(m_FD, header, HEADER_SIZE, 0) != static_cast<ssize_t>(HEADER_SIZE))
+            ok = false;
+
+        ::close(m_FD);
+        m_FD = -1;
+
+        std::lock_guard<std::mutex> lock(m_Lock);
+        for (auto &frame : m_Queue)
+            m_FreeBuffers.push_back(std::move(frame.data));
+        m_Queue.clear();
+        m_QueuedBytes = 0;
     }
 
     isRecordingActive = false;
-    return true;
+    return ok;
 }
 
 bool SER_Recorder::writeFrame(const uint8_t *frame, uint32_t nbytes, uint64_t timestamp)
 {
-    if (!isRecordingActive)
+    return writeFrame(FrameView::fromBuffer(frame, nbytes), timestamp);
+}
+
+bool SER_Recorder::writeFrame(const FrameView &frame, uint64_t timestamp)
+{
+    if (!isRecordingActive || m_WriteError)
         return false;
 
-#if 0
-    if (serh.ColorID == SER_MONO)
+    const size_t nbytes = frame.size();
+
+    QueuedFrame queued;
+    if(timestamp)
+        queued.timestamp = timestamp * m_sepaseconds_per_microsecond;
+    else
+        queued.timestamp = getUTCTimeStamp();
+
     {
-        if (isStreamingActive == false &&
-                (offsetX > 0 || offsetY > 0 || serh.ImageWidth != rawWidth || serh.ImageHeight != rawHeight))
+        std::lock_guard<std::mutex> lock(m_Lock);
+        // Always accept at least one frame, even if it is larger than the limit.
+        if (!m_Queue.empty() && m_QueuedBytes + nbytes > MAX_QUEUED_BYTES)
         {
-            int offset = ((rawWidth * offsetY) + offsetX);
-
-            uint8_t *srcBuffer  = frame + offset;
-            uint8_t *destBuffer = frame;
-            int imageWidth      = serh.ImageWidth;
-            int imageHeight     = serh.ImageHeight;
+            m_DroppedFrames++;
+            return true;
+        }
 
-            for (int i = 0; i < imageHeight; i++)
-                memcpy(destBuffer + i * imageWidth, srcBuffer + rawWidth * i, imageWidth);
+        if (!m_FreeBuffers.empty())
+        {
+            queued.data.swap(m_FreeBuffers.back());
+            m_FreeBuffers.pop_back();
         }
+        m_QueuedBytes += nbytes;
     }
-    else
+
+    // Copy outside of the lock, the writer thread keeps going meanwhile. Rows of a region of interest
+    // are gathered here, this is the only copy of the frame.
+    queued.data.resize(nbytes);
+    frame.copyTo(queued.data.data());
+
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Queue.push_back(std::move(queued));
+    }
+    m_Increase.notify_one();
+    return true;
+}
+
+void SER_Recorder::run()
+{
+    std::unique_lock<std::mutex> lock(m_Lock);
+    for (;;)
     {
-        if (isStreamingActive == false &&
-                (offsetX > 0 || offsetY > 0 || serh.ImageWidth != rawWidth || serh.ImageHeight != rawHeight))
+        m_Increase.wait(lock, [this]()
         {
-            int offset = ((rawWidth * offsetY) + offsetX);
+            return !m_Queue.empty() || m_Closing;
+        });
 
-            uint8_t *srcBuffer  = frame + offset * 3;
-            uint8_t *destBuffer = frame;
-            int imageWidth      = serh.ImageWidth;
-            int imageHeight     = serh.ImageHeight;
+        if (m_Queue.empty())
+            break;
 
-            // RGB
-            for (int i = 0; i < imageHeight; i++)
-                memcpy(destBuffer + i * imageWidth * 3, srcBuffer + rawWidth * 3 * i, imageWidth * 3);
-        }
+        QueuedFrame frame = std::move(m_Queue.front());
+        m_Queue.pop_front();
+        lock.unlock();
+
+        // After an error, the queue is only drained.
+        if (m_WriteError == false && writeQueuedFrame(frame) == false)
+            m_WriteError = true;
+
+        lock.lock();
+        m_QueuedBytes -= frame.data.size();
+        m_FreeBuffers.push_back(std::move(frame.data));
     }
-#endif
+}
 
-    if(timestamp)
-        frameStamps.push_back(timestamp * m_sepaseconds_per_microsecond);
-    else
-        frameStamps.push_back(getUTCTimeStamp());
+bool SER_Recorder::writeQueuedFrame(const QueuedFrame &frame)
+{
+    const uint8_t *data = frame.data.data();
+    size_t size = frame.data.size();
 
     // Not technically pixel format, but let's use this for now.
     if (m_PixelFormat == INDI_JPG)
     {
         int w = 0, h = 0, naxis = 1;
         size_t memsize = 0;
-        if (decode_jpeg_rgb(const_cast<uint8_t *>(frame), nbytes, &jpegBuffer, &memsize, &naxis, &w, &h) < 0)
+        if (decode_jpeg_rgb(const_cast<uint8_t *>(data), size, &jpegBuffer, &memsize, &naxis, &w, &h) < 0)
             return false;
 
         serh.ImageWidth = w;
         serh.ImageHeight = h;
         serh.ColorID = (naxis == 3) ? SER_RGB : SER_MONO;
-        fwrite(jpegBuffer, 1, memsize, f);
+        data = jpegBuffer;
+        size = memsize;
     }
-    else
-        fwrite(frame, 1, nbytes, f);
+
+    if (append(data, size) == false)
+        return false;
+
+    frameStamps.push_back(frame.timestamp);
     serh.FrameCount += 1;
     return true;
 }
 
+bool SER_Recorder::append(const uint8_t *data, size_t size)
+{
+    while (size > 0)
+    {
+        size_t n = std::min(size, WRITE_CHUNK_SIZE - m_BufferUsed);
+        memcpy(m_Buffer + m_BufferUsed, data, n);
+        m_BufferUsed += n;
+        data += n;
+        size -= n;
+
+        if (m_BufferUsed == WRITE_CHUNK_SIZE && writeBuffer(WRITE_CHUNK_SIZE) == false)
+            return false;
+    }
+    return true;
+}
+
+bool SER_Recorder::writeBuffer(size_t size)
+{
+    size_t offset = 0;
+    while (offset < size)
+    {
+        ssize_t n = ::write(m_FD, m_Buffer + offset, size - offset);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        offset += n;
+    }
+
+    m_FileSize += size;
+    m_BufferUsed = 0;
+    return true;
+}
+
 // Copyright (C) 2015 Chris Garry
 //
 
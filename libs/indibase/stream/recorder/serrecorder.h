@@ -23,7 +23,12 @@
 
 #include "recorderinterface.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include <stdio.h>
 
 typedef struct ser_header
@@ -66,6 +71,14 @@ namespace INDI
 
 /**
  * @brief The SER_Recorder class implements recording of video streams in SER format.
+ *
+ * Frames are copied to a bounded queue and written by a dedicated thread, so the stream thread never
+ * waits for the disk. If the queue is full, the frame is dropped and counted. JPEG frames are decoded
+ * by the writer thread as well.
+ *
+ * The writer assembles the file in a large aligned buffer written in whole chunks, optionally
+ * bypassing the page cache (O_DIRECT). When the expected number of frames is known, the file is
+ * preallocated when opened.
  */
 class SER_Recorder : public RecorderInterface
 {
@@ -83,29 +96,81 @@ class SER_Recorder : public RecorderInterface
         virtual bool close();
         /** timestamp is microseconds from SER epoch Jan 1, 1 AD. If it is zero then system time is used. */
         virtual bool writeFrame(const uint8_t *frame, uint32_t nbytes, uint64_t timestamp);
+        virtual bool writeFrame(const FrameView &frame, uint64_t timestamp);
         virtual void setStreamEnabled(bool enable)
         {
             isStreamingActive = enable;
         }
+        virtual void setExpectedFrames(uint64_t frames)
+        {
+            m_ExpectedFrames = frames;
+        }
+        virtual uint64_t getDroppedFrames() const
+        {
+            return m_DroppedFrames;
+        }
+
+        /** @brief Bypass the page cache when writing if supported by the filesystem. Applies to the next recording. */
+        void setDirectIO(bool enabled)
+        {
+            m_DirectIO = enabled;
+        }
 
         // Public constants
         static const uint64_t C_SEPASECONDS_PER_SECOND = 10000000;
+        /// Size of the SER header at the beginning of the file.
+        static constexpr size_t HEADER_SIZE = 178;
+        /// Maximum amount of frame data waiting for the writer thread.
+        static constexpr size_t MAX_QUEUED_BYTES = 256 * 1024 * 1024;
+        /// Size of a single write call.
+        static constexpr size_t WRITE_CHUNK_SIZE = 8 * 1024 * 1024;
+        /// Buffer alignment required for direct I/O.
+        static constexpr size_t BUFFER_ALIGNMENT = 4096;
 
     protected:
         uint64_t utcTo64BitTS();
-        bool is_little_endian();
-        void write_int_le(uint32_t *i);
-        void write_long_int_le(uint64_t *i);
-        void write_header(ser_header *s);
+        void write_header(const ser_header *s, uint8_t *out);
         ser_header serh;
         bool isRecordingActive = false, isStreamingActive = false;
-        FILE *f;
         uint32_t frame_size;
         uint32_t number_of_planes;
         uint16_t rawWidth = 0, rawHeight = 0;
         std::vector<uint64_t> frameStamps;
 
     private:
+        struct QueuedFrame
+        {
+            std::vector<uint8_t> data;
+            uint64_t timestamp {0};
+        };
+
+        // Writer thread
+        void run();
+        bool writeQueuedFrame(const QueuedFrame &frame);
+        // Append to the aligned buffer, full chunks are written to the file.
+        bool append(const uint8_t *data, size_t size);
+        bool writeBuffer(size_t size);
+
+        int m_FD {-1};
+        bool m_Direct {false};
+        std::atomic_bool m_DirectIO {false};
+        uint64_t m_ExpectedFrames {0};
+
+        std::deque<QueuedFrame> m_Queue;
+        std::vector<std::vector<uint8_t>> m_FreeBuffers;
+        size_t m_QueuedBytes {0};
+        bool m_Closing {false};
+        std::mutex m_Lock;
+        std::condition_variable m_Increase;
+        std::atomic<uint64_t> m_DroppedFrames {0};
+        std::atomic_bool m_WriteError {false};
+        std::thread m_Writer;
+
+        // Only accessed from the writer thread while recording.
+        uint8_t *m_Buffer {nullptr};
+        size_t m_BufferUsed {0};
+        uint64_t m_FileSize {0};
+
         // From pipp_timestamp.h
         // Copyright (C) 2015 Chris Garry
 
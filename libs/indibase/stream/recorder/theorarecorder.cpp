@@ -25,6 +25,7 @@
 
 #define _FILE_OFFSET_BITS 64
 
+#include <algorithm>
 #include <ctime>
 #include <cerrno>
 #include <cstring>
@@ -50,14 +51,12 @@ TheoraRecorder::TheoraRecorder()
     ycbcr[0].data = nullptr;
     ycbcr[1].data = nullptr;
     ycbcr[2].data = nullptr;
+    ycbcr[0].width = ycbcr[0].height = 0;
 }
 
 TheoraRecorder::~TheoraRecorder()
 {
-    delete [] ycbcr[0].data;
-    delete [] ycbcr[1].data;
-    delete [] ycbcr[2].data;
-
+    stopEncoder();
     th_encode_free(td);
 }
 
@@ -86,48 +85,21 @@ bool TheoraRecorder::allocateBuffers()
     /* Must hold: yuv_h >= h */
     uint16_t yuv_h = (rawHeight + 15) & ~15;
 
-    /* Do we need to allocate a buffer */
-    if (!ycbcr[0].data || yuv_w != ycbcr[0].width || yuv_h != ycbcr[0].height)
+    /* Queued frames hold the three planes, buffers are resized when they are reused */
+    if (yuv_w != ycbcr[0].width || yuv_h != ycbcr[0].height)
     {
         ycbcr[0].width = yuv_w;
         ycbcr[0].height = yuv_h;
         ycbcr[0].stride = yuv_w;
-#if 0
-        if (m_PixelFormat == INDI_MONO)
-        {
-            ycbcr[1].width = 0;
-            ycbcr[1].stride = 0;
-            ycbcr[1].height = 0;
-            ycbcr[2].width = 0;
-            ycbcr[2].stride = 0;
-            ycbcr[2].height = 0;
-        }
-        else
-        {
-#endif
-            ycbcr[1].width = (chroma_format == TH_PF_444) ? yuv_w : (yuv_w >> 1);
-            ycbcr[1].stride = ycbcr[1].width;
-            ycbcr[1].height = (chroma_format == TH_PF_420) ? (yuv_h >> 1) : yuv_h;
-            ycbcr[2].width = ycbcr[1].width;
-            ycbcr[2].stride = ycbcr[1].stride;
-            ycbcr[2].height = ycbcr[1].height;
-#if 0
-        }
-#endif
-
-        delete [] ycbcr[0].data;
-        delete [] ycbcr[1].data;
-        delete [] ycbcr[2].data;
-
-        ycbcr[0].data = new uint8_t[ycbcr[0].stride * ycbcr[0].height];
-        ycbcr[1].data = new uint8_t[ycbcr[1].stride * ycbcr[1].height];
-        ycbcr[2].data = new uint8_t[ycbcr[2].stride * ycbcr[2].height];
-
-#if 0
-        ycbcr[0].data = new uint8_t[ycbcr[0].stride * ycbcr[0].height];
-        ycbcr[1].data = (m_PixelFormat == INDI_MONO) ? 0 : new uint8_t[ycbcr[1].stride * ycbcr[1].height];
-        ycbcr[2].data = (m_PixelFormat == INDI_MONO) ? 0 : new uint8_t[ycbcr[2].stride * ycbcr[2].height];
-#endif
+        ycbcr[1].width = (chroma_format == TH_PF_444) ? yuv_w : (yuv_w >> 1);
+        ycbcr[1].stride = ycbcr[1].width;
+        ycbcr[1].height = (chroma_format == TH_PF_420) ? (yuv_h >> 1) : yuv_h;
+        ycbcr[2].width = ycbcr[1].width;
+        ycbcr[2].stride = ycbcr[1].stride;
+        ycbcr[2].height = ycbcr[1].height;
+
+        m_PlanesSize = ycbcr[0].stride * ycbcr[0].height + 2 * ycbcr[1].stride * ycbcr[1].height;
+        m_FreeBuffers.clear();
     }
 
     return true;
@@ -356,14 +328,18 @@ bool TheoraRecorder::open(const char *filename, char *errmsg)
         }
     }
 
+    m_DroppedFrames = 0;
+    m_Closing = false;
     isRecordingActive = true;
+    m_Encoder = std::thread(&TheoraRecorder::run, this);
 
     return true;
 }
 
 bool TheoraRecorder::close()
 {
-    theora_write_frame(1);
+    // The encoder thread encodes the remaining frames, the last one ends the stream.
+    stopEncoder();
 
     if(passno == 1)
     {
@@ -415,35 +391,164 @@ bool TheoraRecorder::close()
     return true;
 }
 
-bool TheoraRecorder::writeFrame(const uint8_t *frame, uint32_t nbytes, uint64_t)
+bool TheoraRecorder::writeFrame(const uint8_t *frame, uint32_t nbytes, uint64_t timestamp)
+{
+    if (m_PixelFormat == INDI_JPG)
+        return writeFrame(FrameView::fromBuffer(frame, nbytes, INDI_JPG), timestamp);
+
+    FrameView view(frame, rawWidth, rawHeight, m_PixelFormat, m_PixelDepth);
+    if (nbytes < view.size())
+        return false;
+
+    return writeFrame(view, timestamp);
+}
+
+bool TheoraRecorder::writeFrame(const FrameView &frame, uint64_t)
 {
     if (!isRecordingActive)
         return false;
 
-    if (m_PixelFormat == INDI_MONO)
-    {
-        memcpy(ycbcr[0].data, frame, ycbcr[0].stride * ycbcr[0].height);
-        // Cb and Cr values to 0x80 (128) for grayscale image
-        memset(ycbcr[1].data, 0x80, ycbcr[1].stride * ycbcr[1].height);
-        memset(ycbcr[2].data, 0x80, ycbcr[2].stride * ycbcr[2].height);
-    }
-    else if (m_PixelFormat == INDI_RGB)
+    if (m_PixelFormat != INDI_MONO && m_PixelFormat != INDI_RGB && m_PixelFormat != INDI_JPG)
+        return false;
+
+    QueuedFrame queued;
     {
-        BGR2YUV(rawWidth, rawHeight, const_cast<uint8_t*>(frame), ycbcr[0].data, ycbcr[1].data, ycbcr[2].data, 0);
+        std::lock_guard<std::mutex> lock(m_Lock);
+        if (m_Queue.size() >= MAX_QUEUED_FRAMES)
+        {
+            m_DroppedFrames++;
+            return true;
+        }
+
+        if (!m_FreeBuffers.empty())
+        {
+            queued.data.swap(m_FreeBuffers.back());
+            m_FreeBuffers.pop_back();
+        }
     }
-    else if (m_PixelFormat == INDI_JPG)
+
+    // Convert outside of the lock, the encoder thread keeps going meanwhile. This is the only pass
+    // over the pixels of the frame on this thread.
+    if (m_PixelFormat == INDI_JPG)
     {
-        decode_jpeg_raw((const_cast<uint8_t *>(frame)), nbytes, 0, 0, rawWidth, rawHeight, ycbcr[0].data, ycbcr[1].data,
-                        ycbcr[2].data );
+        queued.isJPEG = true;
+        queued.data.resize(frame.size());
+        frame.copyTo(queued.data.data());
     }
     else
-        return false;
+    {
+        queued.data.resize(m_PlanesSize);
+        uint8_t *y  = queued.data.data();
+        uint8_t *cb = y + ycbcr[0].stride * ycbcr[0].height;
+        uint8_t *cr = cb + ycbcr[1].stride * ycbcr[1].height;
+        const uint32_t width  = std::min<uint32_t>(frame.width, rawWidth);
+        const uint32_t height = std::min<uint32_t>(frame.height, rawHeight);
 
-    theora_write_frame(0);
+        if (m_PixelFormat == INDI_MONO)
+        {
+            for (uint32_t row = 0; row < height; ++row)
+                memcpy(y + row * ycbcr[0].stride, frame.line(row), width);
+            // Cb and Cr values to 0x80 (128) for grayscale image
+            memset(cb, 0x80, 2 * ycbcr[1].stride * ycbcr[1].height);
+        }
+        else
+        {
+            ccvt_rgb24_420p_stride(width, height, frame.data, static_cast<int>(frame.stride),
+                                   y, ycbcr[0].stride, cb, cr, ycbcr[1].stride);
+        }
+    }
 
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Queue.push_back(std::move(queued));
+    }
+    m_Increase.notify_one();
     return true;
 }
 
+void TheoraRecorder::setPlanes(uint8_t *planes)
+{
+    ycbcr[0].data = planes;
+    ycbcr[1].data = ycbcr[0].data + ycbcr[0].stride * ycbcr[0].height;
+    ycbcr[2].data = ycbcr[1].data + ycbcr[1].stride * ycbcr[1].height;
+}
+
+void TheoraRecorder::run()
+{
+    // A frame is encoded once the next one arrives, so the last frame of the recording is
+    // flagged as such without encoding it twice.
+    std::vector<uint8_t> current;
+    bool hasCurrent = false;
+
+    std::unique_lock<std::mutex> lock(m_Lock);
+    for (;;)
+    {
+        m_Increase.wait(lock, [this]()
+        {
+            return !m_Queue.empty() || m_Closing;
+        });
+
+        if (m_Queue.empty())
+            break;
+
+        QueuedFrame frame = std::move(m_Queue.front());
+        m_Queue.pop_front();
+
+        std::vector<uint8_t> planes;
+        if (frame.isJPEG && !m_FreeBuffers.empty())
+        {
+            planes.swap(m_FreeBuffers.back());
+            m_FreeBuffers.pop_back();
+        }
+        lock.unlock();
+
+        if (frame.isJPEG)
+        {
+            planes.resize(m_PlanesSize);
+            setPlanes(planes.data());
+            decode_jpeg_raw(frame.data.data(), frame.data.size(), 0, 0, rawWidth, rawHeight,
+                            ycbcr[0].data, ycbcr[1].data, ycbcr[2].data);
+        }
+        else
+            planes.swap(frame.data);
+
+        if (hasCurrent)
+        {
+            setPlanes(current.data());
+            theora_write_frame(0);
+        }
+        current.swap(planes);
+        hasCurrent = true;
+
+        lock.lock();
+        // Return both the previous frame and the JPEG data.
+        m_FreeBuffers.push_back(std::move(planes));
+        if (frame.isJPEG)
+            m_FreeBuffers.push_back(std::move(frame.data));
+    }
+    lock.unlock();
+
+    if (hasCurrent)
+    {
+        setPlanes(current.data());
+        theora_write_frame(1);
+    }
+
+    lock.lock();
+    m_FreeBuffers.push_back(std::move(current));
+}
+
+void TheoraRecorder::stopEncoder()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Closing = true;
+    }
+    m_Increase.notify_one();
+    if (m_Encoder.joinable())
+        m_Encoder.join();
+}
+
 # if 0
 bool TheoraRecorder::writeFrameMono(uint8_t *frame)
 {
@@ -26,7 +26,12 @@
 #include <ogg/ogg.h>
 #include <theora/theoraenc.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include <stdio.h>
 
 namespace INDI
@@ -34,6 +39,10 @@ namespace INDI
 
 /**
  * @brief The TheoraRecorder class implemented recording of video streaming data in a libtheora OGV file.
+ *
+ * Frames are converted to YCbCr 4:2:0 on the calling thread, straight from the rows of the frame, and
+ * encoded by a dedicated thread. At most MAX_QUEUED_FRAMES frames wait for the encoder, further frames
+ * are dropped and counted. JPEG frames are queued as they are and decoded by the encoder thread.
  */
 class TheoraRecorder : public RecorderInterface
 {
@@ -50,10 +59,18 @@ class TheoraRecorder : public RecorderInterface
         virtual bool open(const char *filename, char *errmsg);
         virtual bool close();
         virtual bool writeFrame(const uint8_t *frame, uint32_t nbytes, uint64_t timestamp);
+        virtual bool writeFrame(const FrameView &frame, uint64_t timestamp);
         virtual void setStreamEnabled(bool enable)
         {
             isStreamingActive = enable;
         }
+        virtual uint64_t getDroppedFrames() const
+        {
+            return m_DroppedFrames;
+        }
+
+        /// Maximum number of frames waiting for the encoder thread.
+        static constexpr size_t MAX_QUEUED_FRAMES = 8;
 
     protected:
         bool isRecordingActive = false, isStreamingActive = false;
@@ -64,12 +81,35 @@ class TheoraRecorder : public RecorderInterface
         uint8_t m_PixelDepth = 8;
 
     private:
+        struct QueuedFrame
+        {
+            // Y, Cb and Cr planes one after the other, or a JPEG image.
+            std::vector<uint8_t> data;
+            bool isJPEG {false};
+        };
+
+        // Encoder thread
+        void run();
+        // Point ycbcr to the planes of the frame.
+        void setPlanes(uint8_t *planes);
+        void stopEncoder();
+
         bool allocateBuffers();
         //int theora_write_frame(th_ycbcr_buffer ycbcr, int last);
         int theora_write_frame(int last);
         bool frac(double fps, uint32_t &num, uint32_t &den);
 
         th_ycbcr_buffer ycbcr;
+        size_t m_PlanesSize {0};
+
+        std::deque<QueuedFrame> m_Queue;
+        std::vector<std::vector<uint8_t>> m_FreeBuffers;
+        bool m_Closing {false};
+        std::mutex m_Lock;
+        std::condition_variable m_Increase;
+        std::atomic<uint64_t> m_DroppedFrames {0};
+        std::thread m_Encoder;
+
         ogg_uint32_t video_fps_numerator = 24;
         ogg_uint32_t video_fps_denominator = 1;
         ogg_uint32_t video_aspect_numerator = 0;
@@ -0,0 +1,175 @@
+/*
+    Copyright (C) 2026 by the INDI Library contributors
+
+    SER Playback
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "serplayback.h"
+#include "streammanager.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace INDI
+{
+
+SER_Playback::SER_Playback(StreamManager *streamManager)
+    : m_StreamManager(streamManager)
+{ }
+
+SER_Playback::~SER_Playback()
+{
+    stop();
+}
+
+bool SER_Playback::open(const char *filename, char *errmsg)
+{
+    stop();
+
+    if (m_Reader.open(filename, errmsg) == false)
+        return false;
+
+    const ser_header &header = m_Reader.header();
+    m_StreamManager->setPixelFormat(m_Reader.pixelFormat(), header.PixelDepth);
+    m_StreamManager->setSize(header.ImageWidth, header.ImageHeight);
+    m_Position = 0;
+    return true;
+}
+
+void SER_Playback::close()
+{
+    stop();
+    m_Reader.close();
+}
+
+void SER_Playback::setSpeed(double speed)
+{
+    m_Speed = std::max(speed, 0.0);
+    m_Seeked = true;
+    m_Wake.notify_one();
+}
+
+void SER_Playback::setFrameRate(double fps)
+{
+    if (fps > 0)
+        m_FrameRate = fps;
+}
+
+void SER_Playback::setLoop(bool enabled)
+{
+    m_Loop = enabled;
+}
+
+void SER_Playback::seek(uint32_t index)
+{
+    m_Position = std::min(index, m_Reader.frameCount());
+    m_Seeked = true;
+    m_Wake.notify_one();
+}
+
+bool SER_Playback::start()
+{
+    if (m_Running || m_Reader.isOpen() == false || m_Reader.frameCount() == 0)
+        return false;
+
+    if (m_Thread.joinable())
+        m_Thread.join();
+
+    m_Stop = false;
+    m_Seeked = true;
+    m_Running = true;
+    m_Thread = std::thread(&SER_Playback::run, this);
+    return true;
+}
+
+void SER_Playback::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Wake.notify_one();
+
+    if (m_Thread.joinable())
+        m_Thread.join();
+}
+
+void SER_Playback::run()
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Frame index and time it is due, all later frames are scheduled relative to them.
+    Clock::time_point startTime;
+    uint32_t startIndex = 0;
+    uint64_t startStamp = 0;
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (m_Stop == false)
+    {
+        uint32_t index = m_Position;
+        if (index >= m_Reader.frameCount())
+        {
+            if (m_Loop == false)
+                break;
+            index = 0;
+            m_Position = 0;
+            m_Seeked = true;
+        }
+
+        const double speed = m_Speed;
+        if (m_Seeked.exchange(false))
+        {
+            startTime  = Clock::now();
+            startIndex = index;
+            startStamp = m_Reader.timestamp(index);
+        }
+
+        if (speed > 0)
+        {
+            // Seconds between the reference frame and this one in the capture.
+            double offset;
+            if (m_Reader.hasTimestamps())
+            {
+                uint64_t stamp = m_Reader.timestamp(index);
+                offset = stamp > startStamp ? double(stamp - startStamp) / SER_Recorder::C_SEPASECONDS_PER_SECOND : 0;
+            }
+            else
+                offset = (index - startIndex) / m_FrameRate.load();
+
+            auto due = startTime + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(offset / speed));
+            if (m_Wake.wait_until(lock, due, [this] { return m_Stop || m_Seeked.load(); }))
+                continue;
+        }
+
+        lock.unlock();
+
+        m_Reader.prefetch(index + 1);
+        // The stream manager expects microseconds, SER timestamps are in units of 100 ns.
+        m_StreamManager->newFrame(m_Reader.frame(index), m_Reader.frameSize(), m_Reader.timestamp(index) / 10);
+
+        // A concurrent seek wins over the increment.
+        uint32_t expected = index;
+        m_Position.compare_exchange_strong(expected, index + 1);
+
+        lock.lock();
+    }
+
+    m_Running = false;
+}
+
+}
@@ -0,0 +1,113 @@
+/*
+    Copyright (C) 2026 by the INDI Library contributors
+
+    SER Playback
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#pragma once
+
+#include "recorder/serreader.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace INDI
+{
+
+class StreamManager;
+
+/**
+ * @brief The SER_Playback class feeds the frames of a SER file to a StreamManager.
+ *
+ * Frames are passed to StreamManager::newFrame with their original timestamps, at the pace they were
+ * captured, scaled by the playback speed. Files without timestamps are played at a fixed frame rate.
+ * This lets drivers, simulators and tests replay real captures through the streaming, recording and
+ * preview pipeline.
+ */
+class SER_Playback
+{
+    public:
+        explicit SER_Playback(StreamManager *streamManager);
+        ~SER_Playback();
+
+        /**
+         * @brief open Open a SER file and configure the pixel format and size of the stream.
+         * @param filename path of the file
+         * @param errmsg buffer of MAXRBUF characters receiving the error
+         */
+        bool open(const char *filename, char *errmsg);
+        void close();
+
+        /**
+         * @brief setSpeed Set the playback speed.
+         * @param speed 1 plays at the original pace, 2 twice as fast, 0 as fast as the stream accepts frames.
+         */
+        void setSpeed(double speed);
+
+        /** @brief Frame rate used when the file has no timestamps. */
+        void setFrameRate(double fps);
+
+        /** @brief Restart from the first frame after the last one. */
+        void setLoop(bool enabled);
+
+        /** @brief Set the next frame to play. */
+        void seek(uint32_t index);
+
+        bool start();
+        void stop();
+
+        bool isRunning() const
+        {
+            return m_Running;
+        }
+
+        /** @return Index of the next frame to play. */
+        uint32_t position() const
+        {
+            return m_Position;
+        }
+
+        const SER_Reader &reader() const
+        {
+            return m_Reader;
+        }
+
+    private:
+        void run();
+
+    private:
+        StreamManager *m_StreamManager {nullptr};
+        SER_Reader m_Reader;
+
+        std::atomic<double> m_Speed {1};
+        std::atomic<double> m_FrameRate {30};
+        std::atomic<bool> m_Loop {false};
+        std::atomic<uint32_t> m_Position {0};
+        // Set by seek, the player resynchronizes its clock.
+        std::atomic<bool> m_Seeked {false};
+
+        std::atomic<bool> m_Running {false};
+        bool m_Stop {false};
+        std::mutex m_Mutex;
+        std::condition_variable m_Wake;
+        std::thread m_Thread;
+};
+
+}
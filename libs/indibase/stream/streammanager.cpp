@@ -30,8 +30,11 @@
 #include "indiutility.h"
 #include "indisinglethreadpool.h"
 #include "indielapsedtimer.h"
+#include "encoder/mjpegencoder.h"
+#include "recorder/serrecorder.h"
 
 #include <cerrno>
+#include <fitsio.h>
 #include <sys/stat.h>
 
 #include <algorithm>
@@ -55,13 +58,10 @@ StreamManagerPrivate::StreamManagerPrivate(DefaultDevice *defaultDevice)
 
     LOGF_DEBUG("Using default recorder (%s)", recorder->getName());
 
-    encoder = encoderManager.getDefaultEncoder();
-
-    encoder->init(currentDevice);
-
-    LOGF_DEBUG("Using default encoder (%s)", encoder->getName());
-
     framesThread = std::thread(&StreamManagerPrivate::asyncStreamThread, this);
+
+    telemetryTimer.setInterval(1000);
+    telemetryTimer.callOnTimeout(std::bind(&StreamManagerPrivate::publishTelemetry, this));
 }
 
 StreamManagerPrivate::~StreamManagerPrivate()
@@ -72,6 +72,10 @@ StreamManagerPrivate::~StreamManagerPrivate()
         framesIncoming.abort();
         framesThread.join();
     }
+
+    // Wait for the running previews before the members they use are destroyed.
+    std::lock_guard<std::mutex> lock(previewWorkersMutex);
+    previewWorkers.clear();
 }
 
 StreamManager::StreamManager(DefaultDevice *mainDevice)
@@ -116,6 +120,16 @@ bool StreamManagerPrivate::initProperties()
     FpsNP[FPS_AVERAGE].fill("AVG_FPS", "Average (1 sec.)", "%.2f", 0.0, 999.0, 0.0, 30);
     FpsNP.fill(getDeviceName(), "FPS", "FPS", STREAM_TAB, IP_RO, 60, IPS_IDLE);
 
+    /* Pipeline statistics */
+    StreamStatsNP[STATS_QUEUE      ].fill("QUEUED_FRAMES",  "Queued frames", "%.f",   0, 1e6, 0, 0);
+    StreamStatsNP[STATS_DROPPED    ].fill("DROPPED_FRAMES", "Dropped frames", "%.f",  0, 1e12, 0, 0);
+    StreamStatsNP[STATS_ENCODE     ].fill("ENCODE_TIME",    "Encode (ms)",   "%.2f",  0, 1e6, 0, 0);
+    StreamStatsNP[STATS_UPLOAD     ].fill("UPLOAD_TIME",    "Upload (ms)",   "%.2f",  0, 1e6, 0, 0);
+    StreamStatsNP[STATS_RECORD_RATE].fill("RECORD_RATE",    "Record (MB/s)", "%.2f",  0, 1e6, 0, 0);
+    StreamStatsNP[STATS_CONVERT    ].fill("CONVERT_TIME",   "Convert (ms)",  "%.2f",  0, 1e6, 0, 0);
+    StreamStatsNP[STATS_SKIPPED    ].fill("SKIPPED_PREVIEWS", "Skipped previews", "%.f", 0, 1e12, 0, 0);
+    StreamStatsNP.fill(getDeviceName(), "STREAM_STATS", "Statistics", STREAM_TAB, IP_RO, 60, IPS_IDLE);
+
     /* Record Frames */
     /* File */
     std::string defaultDirectory = std::string(getenv("HOME")) + std::string("/indi__D_");
@@ -130,6 +144,11 @@ bool StreamManagerPrivate::initProperties()
     RecordOptionsNP.fill(getDeviceName(), "RECORD_OPTIONS",
                          "Record Options", STREAM_TAB, IP_RW, 60, IPS_IDLE);
 
+    /* Record Direct I/O */
+    RecordDirectIOSP[DefaultDevice::INDI_ENABLED ].fill("INDI_ENABLED",  "Enabled",  ISS_OFF);
+    RecordDirectIOSP[DefaultDevice::INDI_DISABLED].fill("INDI_DISABLED", "Disabled", ISS_ON);
+    RecordDirectIOSP.fill(getDeviceName(), "RECORD_DIRECT_IO", "Record Direct I/O", STREAM_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+
     /* Record Switch */
     RecordStreamSP[RECORD_ON   ].fill("RECORD_ON",          "Record On",         ISS_OFF);
     RecordStreamSP[RECORD_TIME ].fill("RECORD_DURATION_ON", "Record (Duration)", ISS_OFF);
@@ -156,6 +175,42 @@ bool StreamManagerPrivate::initProperties()
     else
         EncoderSP.fill(getDeviceName(), "CCD_STREAM_ENCODER",    "Encoder", STREAM_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
 
+    // Stretch Selection
+    StretchSP[STRETCH_GAMMA].fill("STRETCH_GAMMA", "Gamma", ISS_ON);
+    StretchSP[STRETCH_AUTO ].fill("STRETCH_AUTO",  "Auto",  ISS_OFF);
+    StretchSP.fill(getDeviceName(), "STREAM_STRETCH", "Stretch", STREAM_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
+    // Live Stacking
+    StackSP[DefaultDevice::INDI_ENABLED ].fill("INDI_ENABLED",  "Enabled",  ISS_OFF);
+    StackSP[DefaultDevice::INDI_DISABLED].fill("INDI_DISABLED", "Disabled", ISS_ON);
+    StackSP.fill(getDeviceName(), "STREAM_STACK", "Live Stack", STREAM_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
+    StackRegistrationSP[FrameStacker::REGISTRATION_NONE    ].fill("REGISTRATION_NONE",     "None",      ISS_OFF);
+    StackRegistrationSP[FrameStacker::REGISTRATION_CENTROID].fill("REGISTRATION_CENTROID", "Planetary", ISS_OFF);
+    StackRegistrationSP[FrameStacker::REGISTRATION_PHASE   ].fill("REGISTRATION_PHASE",    "Deep Sky",  ISS_ON);
+    StackRegistrationSP.fill(getDeviceName(), "STREAM_STACK_REGISTRATION", "Registration", STREAM_TAB, IP_RW, ISR_1OFMANY, 0,
+                             IPS_IDLE);
+
+    StackResetSP[0].fill("STACK_RESET", "Reset", ISS_OFF);
+    StackResetSP.fill(getDeviceName(), "STREAM_STACK_RESET", "Stack", STREAM_TAB, IP_RW, ISR_ATMOST1, 0, IPS_IDLE);
+
+    StackOptionsNP[STACK_KEEP         ].fill("STACK_KEEP",          "Keep best (%)",          "%.0f", 1, 100,  5,  50);
+    StackOptionsNP[STACK_FITS_INTERVAL].fill("STACK_FITS_INTERVAL", "FITS every (s, 0 = off)", "%.0f", 0, 3600, 10, 0);
+    StackOptionsNP[STACK_THREADS      ].fill("STACK_THREADS",       "Threads (0 = auto)",     "%.0f", 0, 16,   1,  0);
+    StackOptionsNP.fill(getDeviceName(), "STREAM_STACK_OPTIONS", "Stacking", STREAM_TAB, IP_RW, 60, IPS_IDLE);
+
+    StackStatsNP[STACK_STACKED ].fill("STACKED_FRAMES",  "Stacked",   "%.f",   0, 1e12, 0, 0);
+    StackStatsNP[STACK_REJECTED].fill("REJECTED_FRAMES", "Rejected",  "%.f",   0, 1e12, 0, 0);
+    StackStatsNP[STACK_SCORE   ].fill("SHARPNESS",       "Sharpness", "%.4f",  0, 1e12, 0, 0);
+    StackStatsNP[STACK_TIME    ].fill("STACK_TIME",      "Stack (ms)", "%.2f", 0, 1e6,  0, 0);
+    StackStatsNP.fill(getDeviceName(), "STREAM_STACK_STATS", "Stack", STREAM_TAB, IP_RO, 60, IPS_IDLE);
+
+    // MJPEG Options
+    MJPEGOptionsNP[MJPEG_WIDTH  ].fill("MJPEG_WIDTH",   "Width (0 = native)",    "%.0f", 0, 16384, 16, 0);
+    MJPEGOptionsNP[MJPEG_QUALITY].fill("MJPEG_QUALITY", "Quality",               "%.0f", 1, 100,   5,  85);
+    MJPEGOptionsNP[MJPEG_THREADS].fill("MJPEG_THREADS", "Threads (0 = auto)",    "%.0f", 0, 16,    1,  0);
+    MJPEGOptionsNP.fill(getDeviceName(), "STREAM_MJPEG_OPTIONS", "MJPEG", STREAM_TAB, IP_RW, 60, IPS_IDLE);
+
     // Recorder Selector
     RecorderSP[RECORDER_RAW].fill("SER", "SER", ISS_ON);
     RecorderSP[RECORDER_OGV].fill("OGV", "OGV", ISS_OFF);
@@ -172,10 +227,97 @@ bool StreamManagerPrivate::initProperties()
     // Limits
     LimitsNP[LIMITS_BUFFER_MAX ].fill("LIMITS_BUFFER_MAX",  "Maximum Buffer Size (MB)", "%.0f", 1, 1024 * 64, 1, 512);
     LimitsNP[LIMITS_PREVIEW_FPS].fill("LIMITS_PREVIEW_FPS", "Maximum Preview FPS",      "%.0f", 1, 120,     1,  10);
+    LimitsNP[LIMITS_PREVIEW_WORKERS].fill("LIMITS_PREVIEW_WORKERS", "Preview Encoders", "%.0f", 1, 16, 1,
+                                          std::min(std::max(std::thread::hardware_concurrency(), 1u), 4u));
     LimitsNP.fill(getDeviceName(), "LIMITS", "Limits", STREAM_TAB, IP_RW, 0, IPS_IDLE);
+
+    setPreviewWorkers(LimitsNP[LIMITS_PREVIEW_WORKERS].getValue());
     return true;
 }
 
+void StreamManagerPrivate::applyMJPEGOptions()
+{
+    std::lock_guard<std::mutex> lock(previewWorkersMutex);
+    for (auto &worker : previewWorkers)
+    {
+        for (EncoderInterface * oneEncoder : worker->encoderManager.getEncoderList())
+        {
+            auto mjpegEncoder = dynamic_cast<MJPEGEncoder*>(oneEncoder);
+            if (mjpegEncoder == nullptr)
+                continue;
+
+            mjpegEncoder->setTargetWidth(static_cast<uint16_t>(MJPEGOptionsNP[MJPEG_WIDTH].getValue()));
+            mjpegEncoder->setQuality(static_cast<int>(MJPEGOptionsNP[MJPEG_QUALITY].getValue()));
+            mjpegEncoder->setThreads(static_cast<uint8_t>(MJPEGOptionsNP[MJPEG_THREADS].getValue()));
+        }
+    }
+}
+
+void StreamManagerPrivate::applyStackOptions()
+{
+    frameStacker.setKeepFraction(StackOptionsNP[STACK_KEEP].getValue() / 100);
+    frameStacker.setThreads(static_cast<size_t>(StackOptionsNP[STACK_THREADS].getValue()));
+    int registration = StackRegistrationSP.findOnSwitchIndex();
+    if (registration >= 0)
+        frameStacker.setRegistration(static_cast<FrameStacker::Registration>(registration));
+}
+
+void StreamManagerPrivate::configurePreviewWorker(PreviewWorker &worker)
+{
+    auto selectedEncoder = EncoderSP.findOnSwitch();
+
+    worker.encoder = worker.encoderManager.getDefaultEncoder();
+    for (EncoderInterface * oneEncoder : worker.encoderManager.getEncoderList())
+    {
+        oneEncoder->init(currentDevice);
+        oneEncoder->setSize(rawWidth, rawHeight);
+        if (selectedEncoder && !strcmp(selectedEncoder->getName(), oneEncoder->getName()))
+            worker.encoder = oneEncoder;
+
+        if (auto mjpegEncoder = dynamic_cast<MJPEGEncoder*>(oneEncoder))
+        {
+            mjpegEncoder->setTargetWidth(static_cast<uint16_t>(MJPEGOptionsNP[MJPEG_WIDTH].getValue()));
+            mjpegEncoder->setQuality(static_cast<int>(MJPEGOptionsNP[MJPEG_QUALITY].getValue()));
+            mjpegEncoder->setThreads(static_cast<uint8_t>(MJPEGOptionsNP[MJPEG_THREADS].getValue()));
+        }
+    }
+
+    worker.encoderManager.setEncoder(worker.encoder);
+    worker.encoder->setPixelFormat(PixelFormat, PixelDepth);
+}
+
+void StreamManagerPrivate::setPreviewWorkers(size_t count)
+{
+    count = std::max<size_t>(count, 1);
+
+    std::lock_guard<std::mutex> lock(previewWorkersMutex);
+    if (count == previewWorkers.size())
+        return;
+
+    // Removed workers finish their frame first.
+    while (previewWorkers.size() > count)
+        previewWorkers.pop_back();
+
+    while (previewWorkers.size() < count)
+    {
+        std::unique_ptr<PreviewWorker> worker(new PreviewWorker());
+        configurePreviewWorker(*worker);
+        previewWorkers.push_back(std::move(worker));
+    }
+
+    LOGF_DEBUG("Using %zu %s preview encoder(s)", count, previewWorkers.front()->encoder->getName());
+}
+
+StreamManagerPrivate::PreviewWorker *StreamManagerPrivate::getIdlePreviewWorker()
+{
+    for (auto &worker : previewWorkers)
+    {
+        if (!worker->busy)
+            return worker.get();
+    }
+    return nullptr;
+}
+
 bool StreamManager::initProperties()
 {
     D_PTR(StreamManager);
@@ -193,11 +335,20 @@ void StreamManagerPrivate::ISGetProperties(const char *dev)
         if (hasStreamingExposure)
             currentDevice->defineProperty(StreamExposureNP);
         currentDevice->defineProperty(FpsNP);
+        currentDevice->defineProperty(StreamStatsNP);
         currentDevice->defineProperty(RecordStreamSP);
         currentDevice->defineProperty(RecordFileTP);
         currentDevice->defineProperty(RecordOptionsNP);
+        currentDevice->defineProperty(RecordDirectIOSP);
         currentDevice->defineProperty(StreamFrameNP);
         currentDevice->defineProperty(EncoderSP);
+        currentDevice->defineProperty(MJPEGOptionsNP);
+        currentDevice->defineProperty(StretchSP);
+        currentDevice->defineProperty(StackSP);
+        currentDevice->defineProperty(StackRegistrationSP);
+        currentDevice->defineProperty(StackResetSP);
+        currentDevice->defineProperty(StackOptionsNP);
+        currentDevice->defineProperty(StackStatsNP);
         currentDevice->defineProperty(RecorderSP);
         currentDevice->defineProperty(LimitsNP);
     }
@@ -227,13 +378,24 @@ bool StreamManagerPrivate::updateProperties()
         if (hasStreamingExposure)
             currentDevice->defineProperty(StreamExposureNP);
         currentDevice->defineProperty(FpsNP);
+        currentDevice->defineProperty(StreamStatsNP);
         currentDevice->defineProperty(RecordStreamSP);
         currentDevice->defineProperty(RecordFileTP);
         currentDevice->defineProperty(RecordOptionsNP);
+        currentDevice->defineProperty(RecordDirectIOSP);
         currentDevice->defineProperty(StreamFrameNP);
         currentDevice->defineProperty(EncoderSP);
+        currentDevice->defineProperty(MJPEGOptionsNP);
+        currentDevice->defineProperty(StretchSP);
+        currentDevice->defineProperty(StackSP);
+        currentDevice->defineProperty(StackRegistrationSP);
+        currentDevice->defineProperty(StackResetSP);
+        currentDevice->defineProperty(StackOptionsNP);
+        currentDevice->defineProperty(StackStatsNP);
         currentDevice->defineProperty(RecorderSP);
         currentDevice->defineProperty(LimitsNP);
+
+        telemetryTimer.start();
     }
     else
     {
@@ -242,11 +404,21 @@ bool StreamManagerPrivate::updateProperties()
         if (hasStreamingExposure)
             currentDevice->deleteProperty(StreamExposureNP.getName());
         currentDevice->deleteProperty(FpsNP.getName());
+        currentDevice->deleteProperty(StreamStatsNP.getName());
+        telemetryTimer.stop();
         currentDevice->deleteProperty(RecordFileTP.getName());
         currentDevice->deleteProperty(RecordStreamSP.getName());
         currentDevice->deleteProperty(RecordOptionsNP.getName());
+        currentDevice->deleteProperty(RecordDirectIOSP.getName());
         currentDevice->deleteProperty(StreamFrameNP.getName());
         currentDevice->deleteProperty(EncoderSP.getName());
+        currentDevice->deleteProperty(MJPEGOptionsNP.getName());
+        currentDevice->deleteProperty(StretchSP.getName());
+        currentDevice->deleteProperty(StackSP.getName());
+        currentDevice->deleteProperty(StackRegistrationSP.getName());
+        currentDevice->deleteProperty(StackResetSP.getName());
+        currentDevice->deleteProperty(StackOptionsNP.getName());
+        currentDevice->deleteProperty(StackStatsNP.getName());
         currentDevice->deleteProperty(RecorderSP.getName());
         currentDevice->deleteProperty(LimitsNP.getName());
     }
@@ -287,34 +459,29 @@ void StreamManagerPrivate::newFrame(const uint8_t * buffer, uint32_t nbytes, uin
         return;
     }
 
+    // Published to clients by the telemetry timer.
     if (FPSAverage.newFrame())
-    {
-        FpsNP[1].setValue(FPSAverage.framesPerSecond());
-    }
+        fpsAverage = FPSAverage.framesPerSecond();
 
     if (FPSFast.newFrame())
-    {
-        FpsNP[0].setValue(FPSFast.framesPerSecond());
-        if (fastFPSUpdate.try_lock()) // don't block stream thread / record thread
-            std::thread([&]()
-        {
-            FpsNP.apply();
-            fastFPSUpdate.unlock();
-        }).detach();
-    }
+        fpsInstant = FPSFast.framesPerSecond();
 
     if (isStreaming || (isRecording && !isRecordingAboutToClose))
     {
-        size_t allocatedSize = nbytes * framesIncoming.size() / 1024 / 1024; // allocated size in MB
-        if (allocatedSize > LimitsNP[LIMITS_BUFFER_MAX].getValue())
+        size_t maxBytes = static_cast<size_t>(LimitsNP[LIMITS_BUFFER_MAX].getValue()) * 1024 * 1024;
+        FrameRing::Frame *frame = framesIncoming.acquire(nbytes, maxBytes); // recycled buffer
+        if (frame == nullptr)
         {
-            LOG_WARN("Frame buffer is full, skipping frame...");
+            // Only warn about the first dropped frame, the count is published by the telemetry timer.
+            if (droppedFrames++ == 0)
+                LOG_WARN("Frame buffer is full, skipping frame...");
             return;
         }
 
-        std::vector<uint8_t> copyBuffer(buffer, buffer + nbytes); // copy the frame
-
-        framesIncoming.push(TimeFrame{FPSFast.deltaTime(), timestamp, std::move(copyBuffer)}); // push it into the queue
+        memcpy(frame->data.data(), buffer, nbytes); // copy the frame
+        frame->time = FPSFast.deltaTime();
+        frame->timestamp = timestamp;
+        framesIncoming.publish(); // hand it over to the stream thread
     }
 
     if (isRecording && !isRecordingAboutToClose)
@@ -353,6 +520,67 @@ void StreamManager::newFrame(const uint8_t * buffer, uint32_t nbytes, uint64_t t
     d->newFrame(buffer, nbytes, timestamp);
 }
 
+void StreamManagerPrivate::resetTelemetry()
+{
+    fpsInstant    = 0;
+    fpsAverage    = 0;
+    droppedFrames = 0;
+    encodeNanos   = 0;
+    uploadNanos   = 0;
+    previewNanos  = 0;
+    convertNanos  = 0;
+    skippedPreviews = 0;
+    lastRecordedBytes = recordedBytes;
+    lastTelemetry = std::chrono::steady_clock::now();
+
+    FpsNP[FPS_INSTANT].setValue(0);
+    FpsNP[FPS_AVERAGE].setValue(0);
+}
+
+// Runs in the main thread, frame processing threads only update the atomic counters.
+void StreamManagerPrivate::publishTelemetry()
+{
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - lastTelemetry).count();
+    uint64_t bytes = recordedBytes;
+    double recordRate = elapsed > 0 ? (bytes - lastRecordedBytes) / elapsed / 1024 / 1024 : 0;
+    lastRecordedBytes = bytes;
+    lastTelemetry = now;
+
+    if (!isStreaming && !isRecording)
+        return;
+
+    FpsNP[FPS_INSTANT].setValue(fpsInstant);
+    FpsNP[FPS_AVERAGE].setValue(fpsAverage);
+    FpsNP.apply();
+
+    StreamStatsNP[STATS_QUEUE      ].setValue(framesIncoming.size());
+    StreamStatsNP[STATS_DROPPED    ].setValue(droppedFrames + (isRecording ? recorder->getDroppedFrames() : 0));
+    StreamStatsNP[STATS_ENCODE     ].setValue(encodeNanos / 1e6);
+    StreamStatsNP[STATS_UPLOAD     ].setValue(uploadNanos / 1e6);
+    StreamStatsNP[STATS_RECORD_RATE].setValue(isRecording ? recordRate : 0);
+    StreamStatsNP[STATS_CONVERT    ].setValue(convertNanos / 1e6);
+    StreamStatsNP[STATS_SKIPPED    ].setValue(skippedPreviews);
+    StreamStatsNP.setState(StreamStatsNP[STATS_DROPPED].getValue() > 0 ? IPS_ALERT : IPS_OK);
+    StreamStatsNP.apply();
+
+    if (isStacking)
+    {
+        StackStatsNP[STACK_STACKED ].setValue(frameStacker.stackedFrames());
+        StackStatsNP[STACK_REJECTED].setValue(frameStacker.rejectedFrames());
+        StackStatsNP[STACK_SCORE   ].setValue(frameStacker.lastScore());
+        StackStatsNP[STACK_TIME    ].setValue(stackNanos / 1e6);
+        StackStatsNP.setState(IPS_BUSY);
+        StackStatsNP.apply();
+    }
+
+    if (isStreaming)
+    {
+        StreamTimeNP[0].setValue(previewNanos / 1e9);
+        StreamTimeNP.apply();
+    }
+}
+
 
 StreamManagerPrivate::FrameInfo StreamManagerPrivate::updateSourceFrameInfo()
 {
@@ -392,65 +620,37 @@ StreamManagerPrivate::FrameInfo StreamManagerPrivate::updateSourceFrameInfo()
     return srcFrameInfo;
 }
 
-void StreamManagerPrivate::subframe(
-    const uint8_t *srcBuffer,
-    const FrameInfo &srcFrameInfo,
-    uint8_t *dstBuffer,
-    const FrameInfo &dstFrameInfo
-)
-{
-    size_t   srcOffset = srcFrameInfo.bytesPerColor * (dstFrameInfo.y * srcFrameInfo.w + dstFrameInfo.x);
-    uint32_t srcStride = srcFrameInfo.lineSize();
-    uint32_t dstStride = dstFrameInfo.lineSize();
-
-    srcBuffer += srcOffset;
-
-    // Copy line-by-line
-    for (size_t i = 0; i < dstFrameInfo.h; ++i)
-    {
-        memcpy(dstBuffer, srcBuffer, dstStride);
-        dstBuffer += dstStride;
-        srcBuffer += srcStride;
-    }
-}
-
 void StreamManagerPrivate::asyncStreamThread()
 {
-    TimeFrame sourceTimeFrame;
-    sourceTimeFrame.time = 0;
-
-    std::vector<uint8_t> subframeBuffer;  // Subframe buffer for recording/streaming
-    std::vector<uint8_t> downscaleBuffer; // Downscale buffer for streaming
-
-    INDI::SingleThreadPool previewThreadPool;
-    INDI::ElapsedTimer previewElapsed;
+    INDI::ElapsedTimer convertElapsed;
 
     while(!framesThreadTerminate)
     {
-        if (framesIncoming.pop(sourceTimeFrame) == false)
+        FrameRing::Frame *sourceTimeFrame = framesIncoming.front(100);
+        if (sourceTimeFrame == nullptr)
             continue;
 
         FrameInfo srcFrameInfo = updateSourceFrameInfo();
 
-        std::vector<uint8_t> *sourceBuffer = &sourceTimeFrame.frame;
+        std::vector<uint8_t> &sourceBuffer = sourceTimeFrame->data;
 
-        if (PixelFormat != INDI_JPG && sourceBuffer->size() != srcFrameInfo.totalSize())
+        if (PixelFormat != INDI_JPG && sourceBuffer.size() != srcFrameInfo.totalSize())
         {
             LOG_ERROR("Invalid source buffer size, skipping frame...");
+            framesIncoming.release();
             continue;
         }
 
-        // Check if we need to subframe
-        if (
-            PixelFormat != INDI_JPG &&
-            dstFrameInfo.pixels() != 0 &&
-            dstFrameInfo != srcFrameInfo
-        )
+        // Consumers read the subframe in place, only the final encoder or writer copies the pixels.
+        FrameView frame = FrameView::fromBuffer(sourceBuffer.data(), sourceBuffer.size(), PixelFormat, PixelDepth);
+        if (PixelFormat != INDI_JPG)
         {
-            subframeBuffer.resize(dstFrameInfo.totalSize());
-            subframe(sourceBuffer->data(), srcFrameInfo, subframeBuffer.data(), dstFrameInfo);
+            frame = FrameView(sourceBuffer.data(), srcFrameInfo.w, srcFrameInfo.h, PixelFormat, PixelDepth);
+            frame.bytesPerPixel = srcFrameInfo.bytesPerColor;
+            frame.stride = srcFrameInfo.lineSize();
 
-            sourceBuffer = &subframeBuffer;
+            if (dstFrameInfo.pixels() != 0 && dstFrameInfo != srcFrameInfo)
+                frame = frame.region(dstFrameInfo.x, dstFrameInfo.y, dstFrameInfo.w, dstFrameInfo.h);
         }
 
         // For recording, save immediately.
@@ -458,7 +658,7 @@ void StreamManagerPrivate::asyncStreamThread()
             std::lock_guard<std::mutex> lock(recordMutex);
             if (
                 isRecording && !isRecordingAboutToClose &&
-                recordStream(sourceBuffer->data(), sourceBuffer->size(), sourceTimeFrame.time, sourceTimeFrame.timestamp) == false
+                recordStream(frame, sourceTimeFrame->time, sourceTimeFrame->timestamp) == false
             )
             {
                 LOG_ERROR("Recording failed.");
@@ -466,38 +666,109 @@ void StreamManagerPrivate::asyncStreamThread()
             }
         }
 
+        // Stack after recording, the recording keeps every frame.
+        bool isStacked = false;
+        if (isStacking && PixelFormat != INDI_JPG)
+        {
+            INDI::ElapsedTimer stackElapsed;
+            frameStacker.addFrame(frame);
+            stackNanos = stackElapsed.nsecsElapsed();
+
+            double interval = StackOptionsNP[STACK_FITS_INTERVAL].getValue();
+            auto now = std::chrono::steady_clock::now();
+            if (interval > 0 && std::chrono::duration<double>(now - lastStackPublish).count() >= interval)
+            {
+                lastStackPublish = now;
+                publishStack();
+            }
+
+            // The preview shows the stack instead of the last frame.
+            isStacked = isStreaming && frameStacker.render(stackBuffer);
+        }
+
         // For streaming, downscale to 8bit if higher than 8bit to reduce bandwidth
         // You can reduce the number of frames by setting a frame limit.
         if (isStreaming && FPSPreview.newFrame())
         {
+            // Workers are not removed while one of them is being prepared.
+            std::unique_lock<std::mutex> workersLock(previewWorkersMutex);
+            PreviewWorker *worker = getIdlePreviewWorker();
+            if (worker == nullptr)
+            {
+                // All encoders are busy, the frame would be stale once one of them is free.
+                skippedPreviews++;
+                framesIncoming.release();
+                continue;
+            }
+
+            convertElapsed.start();
+
+            if (isStacked)
+            {
+                FrameView stacked(stackBuffer.data(), frame.width, frame.height, PixelFormat, PixelDepth);
+                stacked.bytesPerPixel = frame.bytesPerPixel;
+                stacked.stride = stacked.lineSize();
+                frame = stacked;
+            }
+
             // Downscale to 8bit always for streaming to reduce bandwidth
             if (PixelFormat != INDI_JPG && PixelDepth > 8)
             {
-                // Allocale new buffer if size changes
-                downscaleBuffer.resize(dstFrameInfo.pixels());
+                // Convert straight into the idle worker buffer, rows of the subframe are read in place.
+                const size_t samples = frame.lineSize() / 2;
+                worker->frame.resize(samples * frame.height);
 
-                // Apply gamma
-                gammaLut16.apply(
-                    reinterpret_cast<const uint16_t*>(sourceBuffer->data()),
-                    downscaleBuffer.size(),
-                    downscaleBuffer.data()
-                );
+                const uint16_t *pixels = reinterpret_cast<const uint16_t*>(frame.data);
+                const size_t stride = frame.stride / 2;
 
-                sourceBuffer = &downscaleBuffer;
+                if (StretchSP[STRETCH_AUTO].getState() == ISS_ON)
+                {
+                    // Follow changes of the sky background without paying for a histogram on every frame.
+                    if (stretchReset.exchange(false) || ++stretchFrames >= STRETCH_INTERVAL)
+                    {
+                        stretchLut16.autoStretch(pixels, samples, frame.height, stride);
+                        stretchFrames = 0;
+                    }
+                    stretchLut16.apply(pixels, samples, frame.height, stride, worker->frame.data());
+                }
+                else
+                {
+                    // Apply gamma
+                    gammaLut16.apply(pixels, samples, frame.height, stride, worker->frame.data());
+                }
+            }
+            else if (isStacked)
+            {
+                worker->frame.swap(stackBuffer);
+            }
+            else if (frame.data == sourceBuffer.data() && frame.size() == sourceBuffer.size())
+            {
+                // Hand the whole frame over by swapping, the slot gets the previous frame of the idle worker.
+                worker->frame.swap(sourceBuffer);
+            }
+            else
+            {
+                worker->frame.resize(frame.size());
+                frame.copyTo(worker->frame.data());
             }
 
-            //uploadStream(sourceBuffer->data(), sourceBuffer->size());
-            previewThreadPool.start(std::bind([this, &previewElapsed](const std::atomic_bool & isAboutToQuit,
-                                              std::vector<uint8_t> frame)
+            convertNanos = convertElapsed.nsecsElapsed();
+
+            worker->sequence = ++previewSequence;
+            worker->busy = true;
+
+            worker->thread.start([this, worker](const std::atomic_bool & isAboutToQuit)
             {
                 INDI_UNUSED(isAboutToQuit);
-                previewElapsed.start();
-                uploadStream(frame.data(), frame.size());
-                StreamTimeNP[0].setValue(previewElapsed.nsecsElapsed() / 1000000000.0);
-                StreamTimeNP.apply();
-
-            }, std::placeholders::_1, std::move(*sourceBuffer)));
+                INDI::ElapsedTimer previewElapsed;
+                if (uploadStream(*worker))
+                    previewNanos = previewElapsed.nsecsElapsed();
+                worker->busy = false;
+            });
         }
+
+        // Give the slot back to the camera thread.
+        framesIncoming.release();
     }
 }
 
@@ -533,8 +804,12 @@ void StreamManagerPrivate::setSize(uint16_t width, uint16_t height)
     rawWidth = width;
     rawHeight = height;
 
-    for (EncoderInterface * oneEncoder : encoderManager.getEncoderList())
-        oneEncoder->setSize(rawWidth, rawHeight);
+    {
+        std::lock_guard<std::mutex> lock(previewWorkersMutex);
+        for (auto &worker : previewWorkers)
+            for (EncoderInterface * oneEncoder : worker->encoderManager.getEncoderList())
+                oneEncoder->setSize(rawWidth, rawHeight);
+    }
     for (RecorderInterface * oneRecorder : recorderManager.getRecorderList())
         oneRecorder->setSize(rawWidth, rawHeight);
 }
@@ -560,14 +835,24 @@ bool StreamManagerPrivate::setPixelFormat(INDI_PIXEL_FORMAT pixelFormat, uint8_t
     {
         LOGF_DEBUG("Pixel format %d is supported by %s recorder.", pixelFormat, recorder->getName());
     }
-    bool encoderOK = encoder->setPixelFormat(pixelFormat, pixelDepth);
-    if (encoderOK == false)
     {
-        LOGF_ERROR("Pixel format %d is not supported by %s encoder.", pixelFormat, encoder->getName());
-    }
-    else
-    {
-        LOGF_DEBUG("Pixel format %d is supported by %s encoder.", pixelFormat, encoder->getName());
+        std::lock_guard<std::mutex> lock(previewWorkersMutex);
+        for (auto &worker : previewWorkers)
+        {
+            bool encoderOK = worker->encoder->setPixelFormat(pixelFormat, pixelDepth);
+            // All workers use the same encoder, report only once.
+            if (worker != previewWorkers.front())
+                continue;
+
+            if (encoderOK == false)
+            {
+                LOGF_ERROR("Pixel format %d is not supported by %s encoder.", pixelFormat, worker->encoder->getName());
+            }
+            else
+            {
+                LOGF_DEBUG("Pixel format %d is supported by %s encoder.", pixelFormat, worker->encoder->getName());
+            }
+        }
     }
 
     PixelFormat = pixelFormat;
@@ -588,13 +873,86 @@ void StreamManager::setSize(uint16_t width, uint16_t height)
     d->setSize(width, height);
 }
 
-bool StreamManagerPrivate::recordStream(const uint8_t * buffer, uint32_t nbytes, double deltams, uint64_t timestamp)
+bool StreamManagerPrivate::publishStack()
+{
+    const bool isColor = frameStacker.channels() == 3;
+    if (frameStacker.average(stackAverage, true) == false)
+        return false;
+
+    // FITS planes are red, green and blue.
+    if (PixelFormat == INDI_BGR)
+    {
+        size_t pixels = stackAverage.size() / 3;
+        std::swap_ranges(stackAverage.begin(), stackAverage.begin() + pixels, stackAverage.begin() + 2 * pixels);
+    }
+
+    long naxes[3] = { static_cast<long>(frameStacker.width()), static_cast<long>(frameStacker.height()), 3 };
+    int naxis = isColor ? 3 : 2;
+    int status = 0;
+    char error_status[MAXRBUF];
+
+    // 8640 = 2880 * 3 which is sufficient for the header.
+    size_t memorySize = 8640 + stackAverage.size() * sizeof(float);
+    void *memory = malloc(memorySize);
+    if (memory == nullptr)
+    {
+        LOG_ERROR("Failed to allocate memory for the stack FITS file.");
+        return false;
+    }
+
+    fitsfile *fptr = nullptr;
+    fits_create_memfile(&fptr, &memory, &memorySize, 2880, realloc, &status);
+    fits_create_img(fptr, FLOAT_IMG, naxis, naxes, &status);
+
+    long frames = static_cast<long>(frameStacker.stackedFrames());
+    fits_update_key_lng(fptr, "STACKCNT", frames, "Number of stacked frames", &status);
+    if (PixelFormat >= INDI_BAYER_RGGB && PixelFormat <= INDI_BAYER_BGGR)
+    {
+        const char *patterns[] = { "RGGB", "GRBG", "GBRG", "BGGR" };
+        fits_update_key_str(fptr, "BAYERPAT", patterns[PixelFormat - INDI_BAYER_RGGB], "Bayer color pattern", &status);
+        fits_update_key_lng(fptr, "XBAYROFF", 0, "X offset of Bayer array", &status);
+        fits_update_key_lng(fptr, "YBAYROFF", 0, "Y offset of Bayer array", &status);
+    }
+
+    fits_write_img(fptr, TFLOAT, 1, stackAverage.size(), stackAverage.data(), &status);
+    fits_flush_file(fptr, &status);
+    fits_close_file(fptr, &status);
+
+    if (status)
+    {
+        fits_get_errstatus(status, error_status);
+        LOGF_ERROR("Stack FITS Error: %s", error_status);
+        free(memory);
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(publishMutex);
+        imageBP[0].setBlob(memory);
+        imageBP[0].setBlobLen(memorySize);
+        imageBP[0].setSize(memorySize);
+        imageBP[0].setFormat(".fits");
+        imageBP.setState(IPS_OK);
+        imageBP.apply();
+        imageBP[0].setBlob(nullptr);
+        imageBP[0].setBlobLen(0);
+    }
+
+    free(memory);
+    return true;
+}
+
+bool StreamManagerPrivate::recordStream(const FrameView &frame, double deltams, uint64_t timestamp)
 {
     INDI_UNUSED(deltams);
     if (!isRecording)
         return false;
 
-    return recorder->writeFrame(buffer, nbytes, timestamp);
+    if (recorder->writeFrame(frame, timestamp) == false)
+        return false;
+
+    recordedBytes += frame.size();
+    return true;
 }
 
 std::string StreamManagerPrivate::expand(const std::string &fname, const std::map<std::string, std::string> &patterns)
@@ -645,6 +1003,14 @@ bool StreamManagerPrivate::startRecording()
 
     recorder->setFPS(FpsNP[FPS_AVERAGE].getValue());
 
+    // Let the recorder reserve space for limited recordings.
+    if (RecordStreamSP[RECORD_FRAME].getState() == ISS_ON)
+        recorder->setExpectedFrames(RecordOptionsNP[1].getValue());
+    else if (RecordStreamSP[RECORD_TIME].getState() == ISS_ON)
+        recorder->setExpectedFrames(RecordOptionsNP[0].getValue() * fpsAverage);
+    else
+        recorder->setExpectedFrames(0);
+
     /* pattern substitution */
     recordfiledir.assign(RecordFileTP[0].getText());
     expfiledir = expand(recordfiledir, patterns);
@@ -749,12 +1115,17 @@ bool StreamManagerPrivate::stopRecording(bool force)
 
     {
         std::lock_guard<std::mutex> lock(recordMutex);
-        recorder->close();
+        if (recorder->close() == false)
+            LOG_ERROR("Failed to write the end of the record file.");
     }
 
     if (force)
         return false;
 
+    if (recorder->getDroppedFrames() > 0)
+        LOGF_WARN("Recorder dropped %llu frames, the storage is too slow.",
+                  static_cast<unsigned long long>(recorder->getDroppedFrames()));
+
     LOGF_INFO(
         "Record Duration: %g millisec / %d frames",
         FPSRecorder.totalTime(),
@@ -832,8 +1203,7 @@ bool StreamManagerPrivate::ISNewSwitch(const char * dev, const char * name, ISSt
         {
             RecordStreamSP.setState(IPS_IDLE);
             Format.clear();
-            FpsNP[FPS_INSTANT].setValue(0);
-            FpsNP[FPS_AVERAGE].setValue(0);
+            resetTelemetry();
             if (isRecording)
             {
                 LOG_INFO("Recording stream has been disabled. Closing the stream...");
@@ -853,23 +1223,85 @@ bool StreamManagerPrivate::ISNewSwitch(const char * dev, const char * name, ISSt
 
         const char * selectedEncoder = EncoderSP.findOnSwitch()->getName();
 
-        for (EncoderInterface * oneEncoder : encoderManager.getEncoderList())
+        std::lock_guard<std::mutex> lock(previewWorkersMutex);
+        for (auto &worker : previewWorkers)
         {
-            if (!strcmp(selectedEncoder, oneEncoder->getName()))
+            for (EncoderInterface * oneEncoder : worker->encoderManager.getEncoderList())
             {
-                encoderManager.setEncoder(oneEncoder);
+                if (!strcmp(selectedEncoder, oneEncoder->getName()))
+                {
+                    worker->encoderManager.setEncoder(oneEncoder);
 
-                oneEncoder->setPixelFormat(PixelFormat, PixelDepth);
+                    oneEncoder->setPixelFormat(PixelFormat, PixelDepth);
 
-                encoder = oneEncoder;
+                    worker->encoder = oneEncoder;
 
-                EncoderSP.setState(IPS_OK);
+                    EncoderSP.setState(IPS_OK);
+                }
             }
         }
         EncoderSP.apply();
         return true;
     }
 
+    // Stretch Selection
+    if (StretchSP.isNameMatch(name))
+    {
+        StretchSP.update(states, names, n);
+        StretchSP.setState(IPS_OK);
+        StretchSP.apply();
+        stretchReset = true;
+        return true;
+    }
+
+    // Live Stacking
+    if (StackSP.isNameMatch(name))
+    {
+        StackSP.update(states, names, n);
+        bool enabled = StackSP[DefaultDevice::INDI_ENABLED].getState() == ISS_ON;
+        if (enabled && !isStacking)
+        {
+            frameStacker.reset();
+            lastStackPublish = std::chrono::steady_clock::now();
+        }
+        isStacking = enabled;
+        StackSP.setState(enabled ? IPS_BUSY : IPS_IDLE);
+        StackSP.apply();
+        return true;
+    }
+
+    if (StackRegistrationSP.isNameMatch(name))
+    {
+        StackRegistrationSP.update(states, names, n);
+        applyStackOptions();
+        StackRegistrationSP.setState(IPS_OK);
+        StackRegistrationSP.apply();
+        return true;
+    }
+
+    if (StackResetSP.isNameMatch(name))
+    {
+        frameStacker.reset();
+        StackResetSP.reset();
+        StackResetSP.setState(IPS_OK);
+        StackResetSP.apply();
+        return true;
+    }
+
+    // Record Direct I/O
+    if (RecordDirectIOSP.isNameMatch(name))
+    {
+        RecordDirectIOSP.update(states, names, n);
+        for (RecorderInterface * oneRecorder : recorderManager.getRecorderList())
+        {
+            if (auto serRecorder = dynamic_cast<SER_Recorder*>(oneRecorder))
+                serRecorder->setDirectIO(RecordDirectIOSP[DefaultDevice::INDI_ENABLED].getState() == ISS_ON);
+        }
+        RecordDirectIOSP.setState(IPS_OK);
+        RecordDirectIOSP.apply();
+        return true;
+    }
+
     // Recorder Selection
     if (RecorderSP.isNameMatch(name))
     {
@@ -957,11 +1389,33 @@ bool StreamManagerPrivate::ISNewNumber(const char * dev, const char * name, doub
         FPSPreview.setTimeWindow(1000.0 / LimitsNP[LIMITS_PREVIEW_FPS].getValue());
         FPSPreview.reset();
 
+        setPreviewWorkers(LimitsNP[LIMITS_PREVIEW_WORKERS].getValue());
+
         LimitsNP.setState(IPS_OK);
         LimitsNP.apply();
         return true;
     }
 
+    /* MJPEG Options */
+    if (MJPEGOptionsNP.isNameMatch(name))
+    {
+        MJPEGOptionsNP.update(values, names, n);
+        applyMJPEGOptions();
+        MJPEGOptionsNP.setState(IPS_OK);
+        MJPEGOptionsNP.apply();
+        return true;
+    }
+
+    /* Stacking Options */
+    if (StackOptionsNP.isNameMatch(name))
+    {
+        StackOptionsNP.update(values, names, n);
+        applyStackOptions();
+        StackOptionsNP.setState(IPS_OK);
+        StackOptionsNP.apply();
+        return true;
+    }
+
     /* Record Options */
     if (RecordOptionsNP.isNameMatch(name))
     {
@@ -1072,8 +1526,7 @@ bool StreamManagerPrivate::setStream(bool enable)
             }
             isStreaming = true;
             Format.clear();
-            FpsNP[FPS_INSTANT].setValue(0);
-            FpsNP[FPS_AVERAGE].setValue(0);
+            resetTelemetry();
             StreamSP.reset();
             StreamSP[0].setState(ISS_ON);
             recorder->setStreamEnabled(true);
@@ -1083,8 +1536,7 @@ bool StreamManagerPrivate::setStream(bool enable)
     {
         StreamSP.setState(IPS_IDLE);
         Format.clear();
-        FpsNP[FPS_INSTANT].setValue(0);
-        FpsNP[FPS_AVERAGE].setValue(0);
+        resetTelemetry();
         if (isStreaming)
         {
             if (!isRecording)
@@ -1115,8 +1567,7 @@ bool StreamManagerPrivate::setStream(bool enable)
             StreamSP[1].setState(ISS_ON);
             isStreaming = false;
             Format.clear();
-            FpsNP[FPS_INSTANT].setValue(0);
-            FpsNP[FPS_AVERAGE].setValue(0);
+            resetTelemetry();
 
             recorder->setStreamEnabled(false);
         }
@@ -1136,8 +1587,13 @@ bool StreamManager::saveConfigItems(FILE * fp)
 {
     D_PTR(StreamManager);
     d->EncoderSP.save(fp);
+    d->MJPEGOptionsNP.save(fp);
+    d->StretchSP.save(fp);
+    d->StackRegistrationSP.save(fp);
+    d->StackOptionsNP.save(fp);
     d->RecordFileTP.save(fp);
     d->RecordOptionsNP.save(fp);
+    d->RecordDirectIOSP.save(fp);
     d->RecorderSP.save(fp);
     d->LimitsNP.save(fp);
     return true;
@@ -1170,82 +1626,88 @@ void StreamManager::getStreamFrame(uint16_t * x, uint16_t * y, uint16_t * w, uin
     d->getStreamFrame(x, y, w, h);
 }
 
-bool StreamManagerPrivate::uploadStream(const uint8_t * buffer, uint32_t nbytes)
+bool StreamManagerPrivate::uploadStream(PreviewWorker &worker)
 {
+    const uint8_t *buffer = worker.frame.data();
+    uint32_t nbytes = worker.frame.size();
+    const char *websocketFormat = ".stream";
+
+    INDI::ElapsedTimer encodeElapsed;
+
     // Send as is, already encoded.
     if (PixelFormat == INDI_JPG)
     {
-        // Upload to client now
-#ifdef HAVE_WEBSOCKET
-        if (dynamic_cast<INDI::CCD*>(currentDevice)->HasWebSocket()
-                && dynamic_cast<INDI::CCD*>(currentDevice)->WebSocketS[CCD::WEBSOCKET_ENABLED].s == ISS_ON)
+        worker.blob.setBlob(const_cast<uint8_t *>(buffer));
+        worker.blob.setBlobLen(nbytes);
+        worker.blob.setSize(nbytes);
+        worker.blob.setFormat(".stream_jpg");
+        websocketFormat = ".streajpg";
+    }
+    else
+    {
+        // Binning for grayscale frames only for now - REMOVE ME
+#if 0
+        if (dynamic_cast<INDI::CCD*>(currentDevice)->PrimaryCCD.getNAxis() == 2)
         {
-            if (Format != ".streajpg")
-            {
-                Format = ".streajpg";
-                dynamic_cast<INDI::CCD*>(currentDevice)->wsServer.send_text(Format);
-            }
-
-            dynamic_cast<INDI::CCD*>(currentDevice)->wsServer.send_binary(buffer, nbytes);
-            return true;
+            dynamic_cast<INDI::CCD*>(currentDevice)->PrimaryCCD.binFrame();
+            nbytes /= dynamic_cast<INDI::CCD*>(currentDevice)->PrimaryCCD.getBinX() * dynamic_cast<INDI::CCD*>
+                      (currentDevice)->PrimaryCCD.getBinY();
         }
 #endif
-        imageBP[0].setBlob(const_cast<uint8_t *>(buffer));
-        imageBP[0].setBlobLen(nbytes);
-        imageBP[0].setSize(nbytes);
-        imageBP[0].setFormat(".stream_jpg");
-        imageBP.setState(IPS_OK);
-        imageBP.apply();
-        return true;
+
+        bool isCompressed = false;
+        if(currentDevice->getDriverInterface() & INDI::DefaultDevice::CCD_INTERFACE)
+            isCompressed = dynamic_cast<INDI::CCD*>(currentDevice)->PrimaryCCD.isCompressed();
+        else if ((currentDevice->getDriverInterface() & INDI::DefaultDevice::SENSOR_INTERFACE) == 0)
+            return false;
+        //else isCompressed = dynamic_cast<INDI::SensorInterface*>(currentDevice)->isCompressed();
+
+        if (worker.encoder->upload(&worker.blob, buffer, nbytes, isCompressed) == false)
+            return false;
     }
 
-    // Binning for grayscale frames only for now - REMOVE ME
-#if 0
-    if (dynamic_cast<INDI::CCD*>(currentDevice)->PrimaryCCD.getNAxis() == 2)
+    encodeNanos = PixelFormat == INDI_JPG ? 0 : encodeElapsed.nsecsElapsed();
+
+    INDI::ElapsedTimer uploadElapsed;
+    std::lock_guard<std::mutex> lock(publishMutex);
+
+    // A worker that started later already sent a newer frame.
+    if (worker.sequence < publishedSequence)
     {
-        dynamic_cast<INDI::CCD*>(currentDevice)->PrimaryCCD.binFrame();
-        nbytes /= dynamic_cast<INDI::CCD*>(currentDevice)->PrimaryCCD.getBinX() * dynamic_cast<INDI::CCD*>
-                  (currentDevice)->PrimaryCCD.getBinY();
+        skippedPreviews++;
+        return false;
     }
-#endif
+    publishedSequence = worker.sequence;
 
-    if(currentDevice->getDriverInterface() & INDI::DefaultDevice::CCD_INTERFACE)
-    {
-        if (encoder->upload(&imageBP[0], buffer, nbytes, dynamic_cast<INDI::CCD*>(currentDevice)->PrimaryCCD.isCompressed()))
-        {
 #ifdef HAVE_WEBSOCKET
-            if (dynamic_cast<INDI::CCD*>(currentDevice)->HasWebSocket()
-                    && dynamic_cast<INDI::CCD*>(currentDevice)->WebSocketS[CCD::WEBSOCKET_ENABLED].s == ISS_ON)
-            {
-                if (Format != ".stream")
-                {
-                    Format = ".stream";
-                    dynamic_cast<INDI::CCD*>(currentDevice)->wsServer.send_text(Format);
-                }
-
-                dynamic_cast<INDI::CCD*>(currentDevice)->wsServer.send_binary(buffer, nbytes);
-                return true;
-            }
-#endif
-            // Upload to client now
-            imageBP.setState(IPS_OK);
-            imageBP.apply();
-            return true;
-        }
-    }
-    else if(currentDevice->getDriverInterface() & INDI::DefaultDevice::SENSOR_INTERFACE)
+    if ((currentDevice->getDriverInterface() & INDI::DefaultDevice::CCD_INTERFACE)
+            && dynamic_cast<INDI::CCD*>(currentDevice)->HasWebSocket()
+            && dynamic_cast<INDI::CCD*>(currentDevice)->WebSocketS[CCD::WEBSOCKET_ENABLED].s == ISS_ON)
     {
-        if (encoder->upload(&imageBP[0], buffer, nbytes,
-                            false))//dynamic_cast<INDI::SensorInterface*>(currentDevice)->isCompressed()))
+        if (Format != websocketFormat)
         {
-            // Upload to client now
-            imageBP.setState(IPS_OK);
-            imageBP.apply();
-            return true;
+            Format = websocketFormat;
+            dynamic_cast<INDI::CCD*>(currentDevice)->wsServer.send_text(Format);
         }
+
+        dynamic_cast<INDI::CCD*>(currentDevice)->wsServer.send_binary(buffer, nbytes);
+        uploadNanos = uploadElapsed.nsecsElapsed();
+        return true;
     }
+#else
+    INDI_UNUSED(websocketFormat);
+#endif
 
-    return false;
+    // Upload to client now
+    imageBP[0].setBlob(worker.blob.getBlob());
+    imageBP[0].setBlobLen(worker.blob.getBlobLen());
+    imageBP[0].setSize(worker.blob.getSize());
+    imageBP[0].setFormat(worker.blob.getFormat());
+    imageBP.setState(IPS_OK);
+    imageBP.apply();
+
+    uploadNanos = uploadElapsed.nsecsElapsed();
+    return true;
 }
 
 RecorderInterface *StreamManager::getRecorder() const
@@ -27,12 +27,19 @@
 #include "recorder/recordermanager.h"
 #include "encoder/encodermanager.h"
 #include "fpsmeter.h"
-#include "uniquequeue.h"
+#include "framering.h"
+#include "frameview.h"
 #include "gammalut16.h"
+#include "framestacker.h"
+#include "inditimer.h"
+#include "indisinglethreadpool.h"
 
 #include <atomic>
+#include <chrono>
 #include <string>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <thread>
 
 #include "indiccdchip.h"
@@ -98,6 +105,24 @@ class StreamManagerPrivate
                 return other.x != x || other.y != y || other.w != w || other.h != h;
             }
         };
+
+        /**
+         * @brief PreviewWorker encodes preview frames on its own thread.
+         *
+         * Encoders keep state between frames, so every worker owns a complete set of them.
+         */
+        struct PreviewWorker
+        {
+            EncoderManager encoderManager;
+            EncoderInterface *encoder = nullptr;
+            std::atomic<bool> busy {false};
+            uint64_t sequence {0};
+            std::vector<uint8_t> frame;
+            INDI::WidgetViewBlob blob;
+            // Destroyed first, it waits for the running frame.
+            INDI::SingleThreadPool thread;
+        };
+
     public:
         StreamManagerPrivate(DefaultDevice *defaultDevice);
         virtual ~StreamManagerPrivate();
@@ -118,6 +143,14 @@ class StreamManagerPrivate
         const char *getDeviceName() const;
 
         void setSize(uint16_t width, uint16_t height);
+        // Pass MJPEGOptionsNP to the MJPEG encoders.
+        void applyMJPEGOptions();
+
+        // Create or remove preview workers, new workers get the current encoder settings.
+        void setPreviewWorkers(size_t count);
+        void configurePreviewWorker(PreviewWorker &worker);
+        // Idle worker for the next preview frame, nullptr if all of them are busy. previewWorkersMutex must be locked.
+        PreviewWorker *getIdlePreviewWorker();
         bool setPixelFormat(INDI_PIXEL_FORMAT pixelFormat, uint8_t pixelDepth);
 
         /**
@@ -135,18 +168,28 @@ class StreamManagerPrivate
         bool stopRecording(bool force = false);
 
         /**
-         * @brief uploadStream Upload frame to client using the selected encoder
-         * @param buffer pointer to frame image buffer
-         * @param nbytes size of frame in bytes
+         * @brief uploadStream Encode the frame of a preview worker with its selected encoder and upload it to client.
+         * Frames are published in order, a frame finishing after a newer one is dropped.
+         * @param worker preview worker holding the frame
          * @return True if frame is encoded and sent to client, false otherwise.
          */
-        bool uploadStream(const uint8_t *buffer, uint32_t nbytes);
+        bool uploadStream(PreviewWorker &worker);
 
         /**
          * @brief recordStream Calls the backend recorder to record a single frame.
+         * @param frame frame or region of interest to record, read in place
          * @param deltams time in milliseconds since last frame
          */
-        bool recordStream(const uint8_t *buffer, uint32_t nbytes, double deltams, uint64_t timestamp);
+        bool recordStream(const FrameView &frame, double deltams, uint64_t timestamp);
+
+        // Pass StackOptionsNP and StackRegistrationSP to the stacker.
+        void applyStackOptions();
+
+        /**
+         * @brief publishStack Upload the average of the stacked frames to the client as a FITS image.
+         * @return True if the image is sent, false if nothing is stacked yet or FITS creation failed.
+         */
+        bool publishStack();
 
         void getStreamFrame(uint16_t * x, uint16_t * y, uint16_t * w, uint16_t * h) const;
         void setStreamFrame(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
@@ -154,13 +197,6 @@ class StreamManagerPrivate
 
         FrameInfo updateSourceFrameInfo();
 
-        static void subframe(
-            const uint8_t *srcBuffer,
-            const FrameInfo &srcFrameInfo,
-            uint8_t *dstBuffer,
-            const FrameInfo &dstFrameInfo
-        );
-
     public:
         DefaultDevice *currentDevice = nullptr;
 
@@ -195,9 +231,16 @@ class StreamManagerPrivate
         INDI::PropertyNumber FpsNP {2};
         enum { FPS_INSTANT, FPS_AVERAGE };
 
+        /* Pipeline statistics */
+        INDI::PropertyNumber StreamStatsNP {7};
+        enum { STATS_QUEUE, STATS_DROPPED, STATS_ENCODE, STATS_UPLOAD, STATS_RECORD_RATE, STATS_CONVERT, STATS_SKIPPED };
+
         /* Record Options */
         INDI::PropertyNumber RecordOptionsNP {2};
 
+        /* Bypass the page cache when recording */
+        INDI::PropertySwitch RecordDirectIOSP {2};
+
         // Stream Frame
         INDI::PropertyNumber StreamFrameNP {4};
 
@@ -208,13 +251,30 @@ class StreamManagerPrivate
         INDI::PropertySwitch EncoderSP {2};
         enum { ENCODER_RAW, ENCODER_MJPEG };
 
+        // MJPEG encoder settings
+        INDI::PropertyNumber MJPEGOptionsNP {3};
+        enum { MJPEG_WIDTH, MJPEG_QUALITY, MJPEG_THREADS };
+
+        // Conversion of frames deeper than 8 bits for streaming.
+        INDI::PropertySwitch StretchSP {2};
+        enum { STRETCH_GAMMA, STRETCH_AUTO };
+
+        // Live stacking of the stream, the stack replaces the frames in the preview.
+        INDI::PropertySwitch StackSP {2};
+        INDI::PropertySwitch StackRegistrationSP {3};
+        INDI::PropertySwitch StackResetSP {1};
+        INDI::PropertyNumber StackOptionsNP {3};
+        enum { STACK_KEEP, STACK_FITS_INTERVAL, STACK_THREADS };
+        INDI::PropertyNumber StackStatsNP {4};
+        enum { STACK_STACKED, STACK_REJECTED, STACK_SCORE, STACK_TIME };
+
         // Recorder Selector. Static but should be implmeneted as a dynamic plugin interface
         INDI::PropertySwitch RecorderSP {2};
         enum { RECORDER_RAW, RECORDER_OGV };
 
         // Limits. Maximum queue size for incoming frames. FPS Limit for preview
-        INDI::PropertyNumber LimitsNP {2};
-        enum { LIMITS_BUFFER_MAX, LIMITS_PREVIEW_FPS };
+        INDI::PropertyNumber LimitsNP {3};
+        enum { LIMITS_BUFFER_MAX, LIMITS_PREVIEW_FPS, LIMITS_PREVIEW_WORKERS };
 
         std::atomic<bool> isStreaming { false };
         std::atomic<bool> isRecording { false };
@@ -227,9 +287,14 @@ class StreamManagerPrivate
         bool direct_record = false;
         std::string recordfiledir, recordfilename; /* in case we should move it */
 
-        // Encoders
-        EncoderManager encoderManager;
-        EncoderInterface *encoder = nullptr;
+        // Encoders, one set per preview worker.
+        std::vector<std::unique_ptr<PreviewWorker>> previewWorkers;
+        std::mutex               previewWorkersMutex;
+        uint64_t                 previewSequence {0};
+
+        // Serializes uploads of the preview workers.
+        std::mutex               publishMutex;
+        uint64_t                 publishedSequence {0};
 
         // Measure FPS
         FPSMeter FPSAverage;
@@ -245,21 +310,44 @@ class StreamManagerPrivate
         std::string Format;
 
         // Processing for streaming
-        typedef struct
-        {
-            double time;
-            uint64_t timestamp;
-            std::vector<uint8_t> frame;
-        } TimeFrame;
-
         std::thread              framesThread;   // async incoming frames processing
         std::atomic<bool>        framesThreadTerminate {false};
-        UniqueQueue<TimeFrame>   framesIncoming;
+        FrameRing                framesIncoming;
 
-        std::mutex               fastFPSUpdate;
         std::mutex               recordMutex;
 
+        // Telemetry, updated by the camera, stream and preview threads and published by the timer.
+        void resetTelemetry();
+        void publishTelemetry();
+
+        INDI::Timer              telemetryTimer;
+        std::atomic<double>      fpsInstant {0};
+        std::atomic<double>      fpsAverage {0};
+        std::atomic<uint64_t>    droppedFrames {0};
+        std::atomic<uint64_t>    encodeNanos {0};
+        std::atomic<uint64_t>    uploadNanos {0};
+        std::atomic<uint64_t>    previewNanos {0};
+        std::atomic<uint64_t>    convertNanos {0};
+        std::atomic<uint64_t>    skippedPreviews {0};
+        std::atomic<uint64_t>    recordedBytes {0};
+        uint64_t                 lastRecordedBytes {0};
+        std::chrono::steady_clock::time_point lastTelemetry;
+
         GammaLut16               gammaLut16;
+        // Auto stretch table, only used by the stream thread.
+        GammaLut16               stretchLut16;
+        std::atomic<bool>        stretchReset {true};
+        uint32_t                 stretchFrames {0};
+        // Number of preview frames between stretch updates.
+        static constexpr uint32_t STRETCH_INTERVAL = 10;
+
+        // Live stacking, frames are added by the stream thread.
+        FrameStacker             frameStacker;
+        std::atomic<bool>        isStacking {false};
+        std::atomic<uint64_t>    stackNanos {0};
+        std::vector<uint8_t>     stackBuffer;
+        std::vector<float>       stackAverage;
+        std::chrono::steady_clock::time_point lastStackPublish;
 };
 
 }
@@ -32,6 +32,7 @@
 
 #include <iostream>
 
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -44,6 +45,8 @@
 #include <cstring>
 #include <ctime>
 #include <cmath>
+#include <cstdlib>
+#include <algorithm>
 #include <sys/time.h>
 
 #ifdef __linux__
@@ -158,7 +161,8 @@ V4L2_Base::V4L2_Base()
     v4l2_decode = new V4L2_Decode();
     decoder     = v4l2_decode->getDefaultDecoder();
     decoder->init();
-    dodecode = true;
+    dodecode       = true;
+    currentDecoder = decoder;
 
     bpp                                           = 8;
     has_ext_pix_format                            = false;
@@ -184,6 +188,7 @@ V4L2_Base::V4L2_Base()
 
 V4L2_Base::~V4L2_Base()
 {
+    stop_decoding();
     delete v4l2_decode;
 }
 
@@ -362,6 +367,51 @@ void V4L2_Base::doDecode(bool d)
     dodecode = d;
 }
 
+/* @brief Setting the number of buffers requested from the driver.
+ *
+ * More buffers let the driver keep capturing while frames are processed,
+ * at the cost of memory and latency. Buffers are allocated once per open,
+ * so the device is reopened with its current format if it already streamed.
+ * It must not be capturing.
+ *
+ * @param count is the number of buffers, clamped to [MIN_BUFFERS, MAX_BUFFERS].
+ * @param errmsg is the error message updated in case of error.
+ * @return 0 if successful, or -1 with error message updated.
+ */
+int V4L2_Base::setBufferCount(unsigned int count, char * errmsg)
+{
+    count = std::min(std::max(count, MIN_BUFFERS), MAX_BUFFERS);
+    if (count == m_BufferCount)
+        return 0;
+
+    m_BufferCount = count;
+    return streamedonce ? ioctl_set_format(fmt, errmsg) : 0;
+}
+
+/* @brief Selecting how frames are exchanged with the driver.
+ *
+ * Only the MMAP and USERPTR streaming methods are supported. If the driver
+ * does not support USERPTR, MMAP is used when buffers are allocated.
+ * Like setBufferCount, the device is reopened if it already streamed.
+ *
+ * @param method is the streaming i/o method.
+ * @param errmsg is the error message updated in case of error.
+ * @return 0 if successful, or -1 with error message updated.
+ */
+int V4L2_Base::setIOMethod(io_method method, char * errmsg)
+{
+    if (method == IO_METHOD_READ)
+    {
+        strncpy(errmsg, "Read i/o is not supported", ERRMSGSIZ);
+        return -1;
+    }
+    if (method == io)
+        return 0;
+
+    io = method;
+    return streamedonce ? ioctl_set_format(fmt, errmsg) : 0;
+}
+
 int V4L2_Base::connectCam(const char * devpath, char * errmsg, int pixelFormat, int width, int height)
 {
     INDI_UNUSED(pixelFormat);
@@ -454,14 +504,17 @@ bool V4L2_Base::isLXmodCapable()
  * the frame is known to be uncompressed but its length doesn't match the
  * expected size, the buffer is re-enqueued immediately.
  *
- * Although only the MMAP method is actually supported, two other methods
- * are also implemented:
- * - With the READ method, the frame is read directly from the device
+ * The USERPTR method processes frames the same way, the buffers being
+ * allocated in user space instead of mapped from the device.
+ *
+ * In both cases the buffer is requeued only after the callback returned,
+ * so that the decoder can read the frame in place instead of copying it.
+ * While capturing, the frame is handed over to the decode workers and this
+ * function returns at once, the buffer being requeued when it is delivered.
+ *
+ * With the READ method, the frame is read directly from the device
  * descriptor, using the first buffer characteristics are address and
  * length. But no processing is done actually.
- * - With the USERPTR method, the first available buffer is dequeued, then
- * verified against the buffer list. No processing is done actually, and
- * the buffer is immediately requeued.
  *
  * @param errmsg is the error messsage updated in case of error.
  * @return 0 if frame read is processed, or -1 with error message updated.
@@ -492,11 +545,13 @@ int V4L2_Base::read_frame(char * errmsg)
             break;
 
         case IO_METHOD_MMAP:
-            DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: using MMAP to recover frame buffer", __FUNCTION__);
+        case IO_METHOD_USERPTR:
+            DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: using %s to recover frame buffer", __FUNCTION__,
+                         io == IO_METHOD_MMAP ? "MMAP" : "USERPTR");
             CLEAR(buf);
 
             buf.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-            buf.memory = V4L2_MEMORY_MMAP;
+            buf.memory = (io == IO_METHOD_MMAP) ? V4L2_MEMORY_MMAP : V4L2_MEMORY_USERPTR;
 
             /* For debugging purposes */
             if (false)
@@ -514,7 +569,7 @@ int V4L2_Base::read_frame(char * errmsg)
                                 break;
 
                             default:
-                                return errno_exit("ReadFrame IO_METHOD_MMAP: VIDIOC_QUERYBUF", errmsg);
+                                return errno_exit("ReadFrame: VIDIOC_QUERYBUF", errmsg);
                         }
 
                     DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: " DBG_STR_BUF, __FUNCTION__, DBG_BUF(buf));
@@ -540,19 +595,26 @@ int V4L2_Base::read_frame(char * errmsg)
                     case EINVAL:
                     case EPIPE:
                     default:
-                        return errno_exit("ReadFrame IO_METHOD_MMAP: VIDIOC_DQBUF", errmsg);
+                        return errno_exit("ReadFrame: VIDIOC_DQBUF", errmsg);
                 }
 
             DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: buffer #%d dequeued from fd:%d\n", __FUNCTION__,
                          buf.index, fd);
 
+            /* Frames skipped by the device leave a gap in the sequence */
+            if (hasSequence && buf.sequence > lastSequence + 1)
+                m_DeviceDroppedFrames += buf.sequence - lastSequence - 1;
+            lastSequence = buf.sequence;
+            hasSequence  = true;
+
             if (buf.flags & V4L2_BUF_FLAG_ERROR)
             {
                 DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG,
                              "%s: recoverable error with DQBUF ioctl (BUF_FLAG_ERROR) - frame should be dropped",
                              __FUNCTION__);
+                m_DeviceDroppedFrames++;
                 if (-1 == XIOCTL(fd, VIDIOC_QBUF, &buf))
-                    return errno_exit("ReadFrame IO_METHOD_MMAP: VIDIOC_QBUF", errmsg);
+                    return errno_exit("ReadFrame: VIDIOC_QBUF", errmsg);
                 buf.bytesused = 0;
                 return 0;
             }
@@ -578,8 +640,9 @@ int V4L2_Base::read_frame(char * errmsg)
                     while ((b += 16) < end);
                 }
 
+                m_DeviceDroppedFrames++;
                 if (-1 == XIOCTL(fd, VIDIOC_QBUF, &buf))
-                    return errno_exit("ReadFrame IO_METHOD_MMAP: VIDIOC_QBUF", errmsg);
+                    return errno_exit("ReadFrame: VIDIOC_QBUF", errmsg);
                 buf.bytesused = 0;
                 return 0;
             }
@@ -629,72 +692,34 @@ int V4L2_Base::read_frame(char * errmsg)
             /* TODO: there is probably a better error handling than asserting the buffer index */
             assert(buf.index < n_buffers);
 
-            if (dodecode)
-            {
-                DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: [%p] decoding %d-byte buffer %p cropset %c",
-                             __FUNCTION__, decoder, buf.bytesused, buffers[buf.index].start, cropset ? 'Y' : 'N');
-                decoder->decode((unsigned char *)(buffers[buf.index].start), &buf, m_Native);
-            }
-
-            /*
-            if (dorecord)
-            {
-                DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: [%p] recording %d-byte buffer %p", __FUNCTION__,
-                             recorder, buf.bytesused, buffers[buf.index].start);
-                recorder->writeFrame((unsigned char *)(buffers[buf.index].start));
-            }
-            */
-
-            //DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG,"lxstate is %d, dropFrame %c\n", lxstate, (dropFrame?'Y':'N'));
-
-            /* Requeue buffer */
-            if (-1 == XIOCTL(fd, VIDIOC_QBUF, &buf))
-                return errno_exit("ReadFrame IO_METHOD_MMAP: VIDIOC_QBUF", errmsg);
-
-            if (lxstate == LX_ACTIVE)
             {
-                /* Call provided callback function if any */
-                //if (callback && !dorecord)
-                if (callback)
-                    (*callback)(uptr);
-            }
-
-            if (lxstate == LX_TRIGGERED)
-                lxstate = LX_ACTIVE;
-
-            break;
-
-        case IO_METHOD_USERPTR:
-            cerr << "in read Frame method userptr" << endl;
-            CLEAR(buf);
-
-            buf.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-            buf.memory = V4L2_MEMORY_USERPTR;
+                unsigned char *frame = (io == IO_METHOD_MMAP) ? (unsigned char *)(buffers[buf.index].start) :
+                                       (unsigned char *)(buf.m.userptr);
 
-            if (-1 == XIOCTL(fd, VIDIOC_DQBUF, &buf))
-            {
-                switch (errno)
+                /* The buffer is requeued once a worker decoded the frame and it was delivered */
+                if (decodeActive)
                 {
-                    case EAGAIN:
-                        return 0;
-                    case EIO:
-                    /* Could ignore EIO, see spec. */
-                    /* fall through */
-                    default:
-                        errno_exit("VIDIOC_DQBUF", errmsg);
+                    queue_frame(frame);
+                    break;
                 }
-            }
 
-            for (i = 0; i < n_buffers; ++i)
-                if (buf.m.userptr == (unsigned long)buffers[i].start && buf.length == buffers[i].length)
-                    break;
+                /* The decoder may keep referencing the frame until the buffer is requeued */
+                if (dodecode)
+                {
+                    DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: [%p] decoding %d-byte buffer %p cropset %c",
+                                 __FUNCTION__, decoder, buf.bytesused, frame, cropset ? 'Y' : 'N');
+                    decoder->decode(frame, &buf, m_Native);
+                }
 
-            assert(i < n_buffers);
+                deliver_frame(decoder);
 
-            //process_image ((void *) buf.m.userptr);
+                if (dodecode)
+                    decoder->release();
+            }
 
-            if (-1 == XIOCTL(fd, VIDIOC_QBUF, &buf))
-                errno_exit("ReadFrame IO_METHOD_USERPTR: VIDIOC_QBUF", errmsg);
+            /* Requeue buffer, unless the callback stopped the stream, in which case start_capturing queues all buffers */
+            if (streamactive && -1 == XIOCTL(fd, VIDIOC_QBUF, &buf))
+                return errno_exit("ReadFrame: VIDIOC_QBUF", errmsg);
 
             break;
     }
@@ -727,6 +752,7 @@ int V4L2_Base::stop_capturing(char * errmsg)
                 IERmCallback(selectCallBackID);
                 selectCallBackID = -1;
             }
+            stop_decoding();
             streamactive = false;
             if (-1 == XIOCTL(fd, VIDIOC_STREAMOFF, &type))
                 return errno_exit("VIDIOC_STREAMOFF", errmsg);
@@ -742,8 +768,12 @@ int V4L2_Base::start_capturing(char * errmsg)
     unsigned int i;
     enum v4l2_buf_type type;
 
-    if (!streamedonce)
-        init_device(errmsg);
+    if (!streamedonce && init_device(errmsg) != 0)
+        return -1;
+
+    hasSequence            = false;
+    m_DeviceDroppedFrames  = 0;
+    m_DecoderDroppedFrames = 0;
 
     switch (io)
     {
@@ -771,6 +801,12 @@ int V4L2_Base::start_capturing(char * errmsg)
             if (-1 == XIOCTL(fd, VIDIOC_STREAMON, &type))
                 return errno_exit("VIDIOC_STREAMON", errmsg);
 
+            if (dodecode && start_decoding(errmsg) < 0)
+            {
+                XIOCTL(fd, VIDIOC_STREAMOFF, &type);
+                return -1;
+            }
+
             selectCallBackID = IEAddCallback(fd, newFrame, this);
             streamactive     = true;
 
@@ -797,6 +833,15 @@ int V4L2_Base::start_capturing(char * errmsg)
             if (-1 == XIOCTL(fd, VIDIOC_STREAMON, &type))
                 return errno_exit("VIDIOC_STREAMON", errmsg);
 
+            if (dodecode && start_decoding(errmsg) < 0)
+            {
+                XIOCTL(fd, VIDIOC_STREAMOFF, &type);
+                return -1;
+            }
+
+            selectCallBackID = IEAddCallback(fd, newFrame, this);
+            streamactive     = true;
+
             break;
     }
     //if (dropFrameEnabled)
@@ -812,6 +857,250 @@ void V4L2_Base::newFrame(int /*fd*/, void * p)
     ((V4L2_Base *)(p))->read_frame(errmsg);
 }
 
+/* @brief Starting the decode stage.
+ *
+ * One worker thread is started per decoder. MJPEG frames are decompressed by
+ * up to m_DecoderCount decoders duplicated from the current one, other formats
+ * by the current decoder only, their conversions being cheap or done in place.
+ *
+ * @param errmsg is the error message updated in case of error.
+ * @return 0 if successful, or -1 with error message updated.
+ */
+int V4L2_Base::start_decoding(char * errmsg)
+{
+    decodedFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (decodedFd == -1)
+        return errno_exit("eventfd", errmsg);
+
+    unsigned int count = 1;
+    if (!m_Native && (fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_MJPEG || fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_JPEG))
+        count = m_DecoderCount;
+
+    std::vector<V4L2_Decoder *> workers {decoder};
+    while (workers.size() < count)
+    {
+        V4L2_Decoder *copy = decoder->clone();
+        if (copy == nullptr)
+            break;
+        parallelDecoders.push_back(copy);
+        workers.push_back(copy);
+    }
+
+    pendingFrames.clear();
+    decodedFrames.clear();
+    nextDecode     = 0;
+    nextDelivery   = 0;
+    decodeActive   = true;
+    currentDecoder = decoder;
+    decodeGeneration++;
+
+    for (auto worker : workers)
+        decodeThreads.emplace_back(&V4L2_Base::decode_frames, this, worker);
+
+    decodedCallBackID = IEAddCallback(decodedFd, decodedFrame, this);
+
+    DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: %zu decoder threads started", __FUNCTION__,
+                 workers.size());
+    return 0;
+}
+
+/* @brief Stopping the decode stage.
+ *
+ * Workers finish the frame they are decoding. Frames not delivered yet are
+ * dropped without being requeued, start_capturing queues all buffers again.
+ * This may be called by the callback while a frame is delivered.
+ */
+void V4L2_Base::stop_decoding()
+{
+    if (decodeThreads.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(decodeMutex);
+        decodeActive = false;
+    }
+    decodeCondition.notify_all();
+    for (auto &thread : decodeThreads)
+        thread.join();
+    decodeThreads.clear();
+
+    pendingFrames.clear();
+    decodedFrames.clear();
+    decoder->release();
+    /* The settings may have changed after the last frame of the decoder */
+    DecoderSettings initial;
+    apply_settings(decoder, initial);
+    for (auto copy : parallelDecoders)
+        delete copy;
+    parallelDecoders.clear();
+    currentDecoder = decoder;
+
+    if (decodedCallBackID != -1)
+    {
+        IERmCallback(decodedCallBackID);
+        decodedCallBackID = -1;
+    }
+    close(decodedFd);
+    decodedFd = -1;
+}
+
+/* @brief Handing the dequeued buffer over to the workers.
+ *
+ * At most one frame per worker waits for decoding. When decoding lags behind
+ * the device, the oldest waiting frame is dropped and its buffer requeued, so
+ * the device keeps buffers to capture in and the latest frame is decoded.
+ */
+void V4L2_Base::queue_frame(unsigned char * frame)
+{
+    DecodeJob dropped;
+    bool drop = false;
+    {
+        std::lock_guard<std::mutex> lock(decodeMutex);
+        if (pendingFrames.size() >= decodeThreads.size())
+        {
+            dropped = pendingFrames.front();
+            pendingFrames.pop_front();
+            drop = true;
+        }
+        pendingFrames.push_back({buf, frame, nullptr, 0});
+    }
+    decodeCondition.notify_all();
+
+    if (drop)
+    {
+        char errmsg[ERRMSGSIZ];
+        m_DecoderDroppedFrames++;
+        requeue_buffer(&dropped.buf, errmsg);
+    }
+}
+
+/* @brief Worker thread decoding the frames with its own decoder.
+ *
+ * The decoder keeps referencing its frame until it was delivered, only then
+ * the worker takes the next one. Settings changed in the meantime are applied
+ * to the decoder before it decodes that frame.
+ */
+void V4L2_Base::decode_frames(V4L2_Decoder * worker)
+{
+    std::unique_lock<std::mutex> lock(decodeMutex);
+    DecoderSettings applied = decoderSettings;
+    while (true)
+    {
+        decodeCondition.wait(lock, [this]()
+        {
+            return !decodeActive || !pendingFrames.empty();
+        });
+        if (!decodeActive)
+            return;
+
+        DecodeJob job = pendingFrames.front();
+        pendingFrames.pop_front();
+        job.decoder  = worker;
+        job.sequence = nextDecode++;
+        apply_settings(worker, applied);
+        lock.unlock();
+
+        worker->decode(job.frame, &job.buf, m_Native);
+
+        lock.lock();
+        decodedFrames.push_back(job);
+        uint64_t const one = 1;
+        if (write(decodedFd, &one, sizeof(one)) < 0)
+            IDLog("%s: unable to signal decoded frame (%s)\n", __FUNCTION__, strerror(errno));
+
+        decodeCondition.wait(lock, [this, &job]()
+        {
+            return !decodeActive || nextDelivery > job.sequence;
+        });
+    }
+}
+
+void V4L2_Base::decodedFrame(int /*fd*/, void * p)
+{
+    ((V4L2_Base *)(p))->deliver_frames();
+}
+
+/* @brief Delivering decoded frames in capture order, from the event loop. */
+void V4L2_Base::deliver_frames()
+{
+    uint64_t count = 0;
+    if (read(decodedFd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        return;
+
+    std::unique_lock<std::mutex> lock(decodeMutex);
+    unsigned int const generation = decodeGeneration;
+    while (decodeActive)
+    {
+        auto job = std::find_if(decodedFrames.begin(), decodedFrames.end(), [this](const DecodeJob & decoded)
+        {
+            return decoded.sequence == nextDelivery;
+        });
+        if (job == decodedFrames.end())
+            break;
+
+        DecodeJob frame = *job;
+        decodedFrames.erase(job);
+        lock.unlock();
+
+        deliver_frame(frame.decoder);
+
+        lock.lock();
+        /* The callback stopped the stream, stop_decoding released the frame */
+        if (!decodeActive || generation != decodeGeneration)
+            break;
+
+        frame.decoder->release();
+        nextDelivery++;
+        decodeCondition.notify_all();
+
+        lock.unlock();
+        char errmsg[ERRMSGSIZ];
+        if (requeue_buffer(&frame.buf, errmsg) < 0)
+            return;
+        lock.lock();
+    }
+}
+
+/* @brief Calling the frame callback with the accessors reading the decoder of the frame. */
+void V4L2_Base::deliver_frame(V4L2_Decoder * frameDecoder)
+{
+    //DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG,"lxstate is %d, dropFrame %c\n", lxstate, (dropFrame?'Y':'N'));
+
+    currentDecoder = frameDecoder;
+    frameBpp       = frameDecoder->getBpp();
+    if (lxstate == LX_ACTIVE)
+    {
+        /* Call provided callback function if any */
+        if (callback)
+            (*callback)(uptr);
+    }
+
+    if (lxstate == LX_TRIGGERED)
+        lxstate = LX_ACTIVE;
+    currentDecoder = decoder;
+    frameBpp       = 0;
+}
+
+/* @brief Applying the settings updated since the worker last applied them, with decodeMutex held or the workers stopped. */
+void V4L2_Base::apply_settings(V4L2_Decoder * worker, DecoderSettings &applied)
+{
+    if (applied.colorGeneration != decoderSettings.colorGeneration)
+    {
+        worker->setQuantization(decoderSettings.quantization);
+        worker->setLinearization(decoderSettings.linearization);
+    }
+    if (applied.demosaicGeneration != decoderSettings.demosaicGeneration)
+        worker->setEdgeAwareDemosaic(decoderSettings.edgeAwareDemosaic);
+    applied = decoderSettings;
+}
+
+int V4L2_Base::requeue_buffer(struct v4l2_buffer * b, char * errmsg)
+{
+    if (streamactive && -1 == XIOCTL(fd, VIDIOC_QBUF, b))
+        return errno_exit("ReadFrame: VIDIOC_QBUF", errmsg);
+    return 0;
+}
+
 int V4L2_Base::uninit_device(char * errmsg)
 {
     switch (io)
@@ -833,6 +1122,8 @@ int V4L2_Base::uninit_device(char * errmsg)
     }
 
     free(buffers);
+    buffers   = nullptr;
+    n_buffers = 0;
 
     return 0;
 }
@@ -863,8 +1154,7 @@ int V4L2_Base::init_mmap(char * errmsg)
 
     CLEAR(req);
 
-    req.count = 4;
-    //req.count               = 1;
+    req.count  = m_BufferCount;
     req.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     req.memory = V4L2_MEMORY_MMAP;
 
@@ -889,6 +1179,10 @@ int V4L2_Base::init_mmap(char * errmsg)
         return -1;
     }
 
+    if (req.count != m_BufferCount)
+        DEBUGFDEVICE(deviceName, INDI::Logger::DBG_DEBUG, "%s: driver allocated %d buffers instead of %d", __FUNCTION__,
+                     req.count, m_BufferCount);
+
     buffers = (buffer *)calloc(req.count, sizeof(*buffers));
 
     if (!buffers)
@@ -922,14 +1216,13 @@ int V4L2_Base::init_mmap(char * errmsg)
     return 0;
 }
 
-void V4L2_Base::init_userp(unsigned int buffer_size)
+int V4L2_Base::init_userp(unsigned int buffer_size, char * errmsg)
 {
     struct v4l2_requestbuffers req;
-    char errmsg[ERRMSGSIZ];
 
     CLEAR(req);
 
-    req.count  = 4;
+    req.count  = m_BufferCount;
     req.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     req.memory = V4L2_MEMORY_USERPTR;
 
@@ -937,34 +1230,43 @@ void V4L2_Base::init_userp(unsigned int buffer_size)
     {
         if (EINVAL == errno)
         {
-            fprintf(stderr, "%.*s does not support user pointer i/o\n", (int)sizeof(dev_name), dev_name);
-            exit(EXIT_FAILURE);
+            DEBUGFDEVICE(deviceName, INDI::Logger::DBG_WARNING,
+                         "%.*s does not support user pointer i/o, using memory mapping", (int)sizeof(dev_name), dev_name);
+            io = IO_METHOD_MMAP;
+            return init_mmap(errmsg);
         }
         else
         {
-            errno_exit("VIDIOC_REQBUFS", errmsg);
+            return errno_exit("VIDIOC_REQBUFS", errmsg);
         }
     }
 
-    buffers = (buffer *)calloc(4, sizeof(*buffers));
+    /* Some drivers only accept page aligned buffers covering whole pages */
+    size_t const page = sysconf(_SC_PAGESIZE);
+    size_t const length = (buffer_size + page - 1) / page * page;
+
+    buffers = (buffer *)calloc(m_BufferCount, sizeof(*buffers));
 
     if (!buffers)
     {
-        fprintf(stderr, "Out of memory\n");
-        exit(EXIT_FAILURE);
+        fprintf(stderr, "buffers. Out of memory\n");
+        strncpy(errmsg, "buffers. Out of memory\n", ERRMSGSIZ);
+        return -1;
     }
 
-    for (n_buffers = 0; n_buffers < 4; ++n_buffers)
+    for (n_buffers = 0; n_buffers < m_BufferCount; ++n_buffers)
     {
-        buffers[n_buffers].length = buffer_size;
-        buffers[n_buffers].start  = malloc(buffer_size);
+        buffers[n_buffers].length = length;
 
-        if (!buffers[n_buffers].start)
+        if (posix_memalign(&buffers[n_buffers].start, page, length) != 0)
         {
-            fprintf(stderr, "Out of memory\n");
-            exit(EXIT_FAILURE);
+            fprintf(stderr, "buffers. Out of memory\n");
+            strncpy(errmsg, "buffers. Out of memory\n", ERRMSGSIZ);
+            return -1;
         }
     }
+
+    return 0;
 }
 
 int V4L2_Base::check_device(char * errmsg)
@@ -1326,8 +1628,7 @@ int V4L2_Base::init_device(char * errmsg)
             break;
 
         case IO_METHOD_USERPTR:
-            init_userp(fmt.fmt.pix.sizeimage);
-            break;
+            return init_userp(fmt.fmt.pix.sizeimage, errmsg);
     }
     return 0;
 }
@@ -1824,7 +2125,7 @@ int V4L2_Base::getHeight()
 
 int V4L2_Base::getBpp()
 {
-    return bpp;
+    return frameBpp > 0 ? frameBpp : bpp;
 }
 
 int V4L2_Base::getFormat()
@@ -1935,39 +2236,70 @@ int V4L2_Base::setSize(int x, int y)
 void V4L2_Base::setColorProcessing(bool quantization, bool colorconvert, bool linearization)
 {
     INDI_UNUSED(colorconvert);
-    decoder->setQuantization(quantization);
-    decoder->setLinearization(linearization);
-    bpp = decoder->getBpp();
+    std::lock_guard<std::mutex> lock(decodeMutex);
+    decoderSettings.quantization  = quantization;
+    decoderSettings.linearization = linearization;
+    decoderSettings.colorGeneration++;
+    if (decodeThreads.empty())
+    {
+        decoder->setQuantization(quantization);
+        decoder->setLinearization(linearization);
+        bpp = decoder->getBpp();
+        return;
+    }
+
+    /* Workers may be decoding with the decoders, the depth of the next frames is read from a copy */
+    V4L2_Decoder *probe = decoder->clone();
+    if (probe != nullptr)
+    {
+        probe->setLinearization(linearization);
+        bpp = probe->getBpp();
+        delete probe;
+    }
+}
+
+void V4L2_Base::setEdgeAwareDemosaic(bool value)
+{
+    std::lock_guard<std::mutex> lock(decodeMutex);
+    decoderSettings.edgeAwareDemosaic = value;
+    decoderSettings.demosaicGeneration++;
+    if (decodeThreads.empty())
+        decoder->setEdgeAwareDemosaic(value);
+}
+
+void V4L2_Base::setDecoderCount(unsigned int count)
+{
+    m_DecoderCount = std::min(std::max(count, 1u), MAX_DECODERS);
 }
 
 unsigned char * V4L2_Base::getY()
 {
-    return decoder->getY();
+    return currentDecoder->getY();
 }
 
 unsigned char * V4L2_Base::getU()
 {
-    return decoder->getU();
+    return currentDecoder->getU();
 }
 
 unsigned char * V4L2_Base::getV()
 {
-    return decoder->getV();
+    return currentDecoder->getV();
 }
 
 unsigned char * V4L2_Base::getMJPEGBuffer(int &size)
 {
-    return decoder->getMJPEGBuffer(size);
+    return currentDecoder->getMJPEGBuffer(size);
 }
 
 unsigned char * V4L2_Base::getRGBBuffer()
 {
-    return decoder->getRGBBuffer();
+    return currentDecoder->getRGBBuffer();
 }
 
 float * V4L2_Base::getLinearY()
 {
-    return decoder->getLinearY();
+    return currentDecoder->getLinearY();
 }
 
 void V4L2_Base::registerCallback(WPF * fp, void * ud)
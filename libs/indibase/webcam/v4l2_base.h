@@ -35,8 +35,14 @@
 #include "stream/streammanager.h"
 
 #include <stdio.h>
+#include <atomic>
+#include <condition_variable>
 #include <cstdlib>
+#include <deque>
 #include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include <dirent.h>
 #include <linux/videodev2.h>
@@ -136,6 +142,8 @@ class V4L2_Base
         struct v4l2_rect getcroprect();
 
         void setColorProcessing(bool quantization, bool colorconvert, bool linearization);
+        /* Bayer frames are interpolated bilinearly unless edge aware */
+        void setEdgeAwareDemosaic(bool value);
 
         void setlxstate(short s)
         {
@@ -153,6 +161,39 @@ class V4L2_Base
 
         void doDecode(bool);
 
+        /* Capture buffers, applied when the device is reopened */
+        int setBufferCount(unsigned int count, char *errmsg);
+        unsigned int getBufferCount() const
+        {
+            return m_BufferCount;
+        }
+        int setIOMethod(io_method method, char *errmsg);
+        io_method getIOMethod() const
+        {
+            return io;
+        }
+
+        /* Decoders working in parallel on MJPEG frames, applied when capture starts */
+        void setDecoderCount(unsigned int count);
+        unsigned int getDecoderCount() const
+        {
+            return m_DecoderCount;
+        }
+
+        /* Frames lost since capture started, by the device or because decoding lagged behind */
+        uint32_t getDeviceDroppedFrames() const
+        {
+            return m_DeviceDroppedFrames;
+        }
+        uint32_t getDecoderDroppedFrames() const
+        {
+            return m_DecoderDroppedFrames;
+        }
+
+        static constexpr unsigned int MIN_BUFFERS = 2;
+        static constexpr unsigned int MAX_BUFFERS = 32;
+        static constexpr unsigned int MAX_DECODERS = 8;
+
     protected:
         int xioctl(int fd, int request, void *arg, char const *const request_str);
         int ioctl_set_format(struct v4l2_format new_fmt, char *errmsg);
@@ -166,11 +207,40 @@ class V4L2_Base
         int errno_exit(const char *s, char *errmsg);
 
         void close_device();
-        void init_userp(unsigned int buffer_size);
+        int init_userp(unsigned int buffer_size, char *errmsg);
         void init_read(unsigned int buffer_size);
 
         void findMinMax();
 
+        /* Decode stage */
+        struct DecodeJob
+        {
+            struct v4l2_buffer buf;
+            unsigned char *frame;
+            V4L2_Decoder *decoder; // holds the frame until it is delivered
+            uint64_t sequence;     // delivery order
+        };
+
+        /* Decoder settings, a generation changes with every update */
+        struct DecoderSettings
+        {
+            bool quantization {false};
+            bool linearization {false};
+            bool edgeAwareDemosaic {false};
+            unsigned int colorGeneration {0};
+            unsigned int demosaicGeneration {0};
+        };
+
+        int start_decoding(char *errmsg);
+        void stop_decoding();
+        void queue_frame(unsigned char *frame);
+        void decode_frames(V4L2_Decoder *worker);
+        void deliver_frames();
+        void deliver_frame(V4L2_Decoder *frameDecoder);
+        void apply_settings(V4L2_Decoder *worker, DecoderSettings &applied);
+        int requeue_buffer(struct v4l2_buffer *b, char *errmsg);
+        static void decodedFrame(int fd, void *p);
+
         int enumeratedInputs;
         int enumeratedCaptureFormats;
 
@@ -209,6 +279,7 @@ class V4L2_Base
         int fd;
         struct buffer *buffers;
         unsigned int n_buffers;
+        unsigned int m_BufferCount {4};
         bool reallocate_buffers;
         //int		dropFrame;
         //bool      dropFrameEnabled;
@@ -223,6 +294,33 @@ class V4L2_Base
         V4L2_Decoder *decoder;
         bool dodecode;
 
+        /* Frames are dequeued and requeued by the event loop and decoded by worker threads, each with
+         * its own decoder. Decoded frames are signaled on an eventfd and delivered to the callback in
+         * capture order from the event loop, the accessors then read the decoder of the frame. */
+        V4L2_Decoder *currentDecoder;
+        std::vector<V4L2_Decoder *> parallelDecoders;
+        std::vector<std::thread> decodeThreads;
+        std::mutex decodeMutex;
+        std::condition_variable decodeCondition;
+        std::deque<DecodeJob> pendingFrames;
+        std::deque<DecodeJob> decodedFrames;
+        uint64_t nextDecode {0};
+        uint64_t nextDelivery {0};
+        bool decodeActive {false};
+        unsigned int decodeGeneration {0};
+        /* Settings changed while decoding are applied by each worker before its next frame */
+        DecoderSettings decoderSettings;
+        /* Depth of the frame being delivered, it may differ from the settings just changed */
+        int frameBpp {0};
+        int decodedFd {-1};
+        int decodedCallBackID {-1};
+        unsigned int m_DecoderCount {1};
+
+        bool hasSequence {false};
+        uint32_t lastSequence {0};
+        std::atomic<uint32_t> m_DeviceDroppedFrames {0};
+        std::atomic<uint32_t> m_DecoderDroppedFrames {0};
+
         int bpp;
 
         friend class ::V4L2_Driver;
@@ -61,9 +61,12 @@
 
 //#include "indilogger.h"
 #include "ccvt.h"
+#include "dsp.h"
 #include "v4l2_colorspace.h"
 
+#include <algorithm>
 #include <cstring> // memcpy
+#include <thread>
 
 V4L2_Builtin_Decoder::V4L2_Builtin_Decoder()
 {
@@ -72,6 +75,7 @@ V4L2_Builtin_Decoder::V4L2_Builtin_Decoder()
     useSoftCrop    = false;
     doCrop         = false;
     doQuantization = false;
+    doLinearization = false;
     YBuf           = nullptr;
     UBuf           = nullptr;
     VBuf           = nullptr;
@@ -121,6 +125,67 @@ void V4L2_Builtin_Decoder::init()
 };
 
 void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf, bool native)
+{
+    // Packed frames in a format the driver publishes as is are not copied, accessors read the capture
+    // buffer directly and only conversions needing the decoder buffers copy it.
+    inPlaceFrame = nullptr;
+    if (canDecodeInPlace(buf, native))
+    {
+        inPlaceFrame  = frame;
+        inPlaceBuffer = *buf;
+        inPlaceNative = native;
+        m_Size        = buf->bytesused;
+        return;
+    }
+    decodeFrame(frame, buf, native);
+}
+
+void V4L2_Builtin_Decoder::release()
+{
+    inPlaceFrame = nullptr;
+}
+
+bool V4L2_Builtin_Decoder::canDecodeInPlace(const struct v4l2_buffer *buf, bool native) const
+{
+    if (useSoftCrop && doCrop)
+        return false;
+
+    unsigned int pixelBytes = 0;
+    switch (fmt.fmt.pix.pixelformat)
+    {
+        case V4L2_PIX_FMT_GREY:
+            pixelBytes = 1;
+            break;
+        case V4L2_PIX_FMT_Y16:
+        case V4L2_PIX_FMT_YUYV:
+            pixelBytes = 2;
+            break;
+        case V4L2_PIX_FMT_RGB24:
+            pixelBytes = 3;
+            break;
+        case V4L2_PIX_FMT_JPEG:
+        case V4L2_PIX_FMT_MJPEG:
+            return native;
+        default:
+            return false;
+    }
+
+    unsigned int const lineSize = pixelBytes * bufwidth;
+    return (fmt.fmt.pix.bytesperline == 0 || fmt.fmt.pix.bytesperline == lineSize) &&
+           buf->bytesused >= lineSize * bufheight;
+}
+
+void V4L2_Builtin_Decoder::materialize()
+{
+    if (inPlaceFrame == nullptr)
+        return;
+
+    unsigned char *frame = inPlaceFrame;
+    inPlaceFrame = nullptr;
+    decodeFrame(frame, &inPlaceBuffer, inPlaceNative);
+}
+
+void V4L2_Builtin_Decoder::decodeFrame(unsigned char *frame, struct v4l2_buffer *buf, bool native)
 {
     //LOG_INFO("Calling builtin decoder decode");
     //IDLog("Decoding buffer at %lx, len %d, bytesused %d, bytesperline %d, sequence %d, flag %x, field %x, use soft crop %c, do crop %c\n", frame, buf->length, buf->bytesused, fmt.fmt.pix.bytesperline, buf->sequence, buf->flags, buf->field, (useSoftCrop?'y':'n'), (doCrop?'y':'n'));
@@ -288,12 +353,13 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf,
                 for (unsigned int i = 0; i < bufheight / 2; i++)
                 {
                     s = src;
-                    //IDLog("NV12: converting UV line %d at %p, offset %d, pUbuf %p offset %d,  pVbuf %p offset %d\n", i, s, s- (frame + (fmt.fmt.pix.bytesperline * bufheight)), dest, dest-UBuf, destv, destv-VBuf);
-                    for (unsigned int j = 0; j < bufwidth; j += 2)
+                    for (unsigned int j = 0; j < bufwidth / 2; j++)
                     {
-                        *(dest++)  = *(s++);
-                        *(destv++) = *(s++);
+                        dest[j]  = s[2 * j];
+                        destv[j] = s[2 * j + 1];
                     }
+                    dest += bufwidth / 2;
+                    destv += bufwidth / 2;
                     src += fmt.fmt.pix.bytesperline;
                 }
             }
@@ -362,15 +428,12 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf,
                 }
                 for (int j = 0; j < (int)(bufwidth / 2); j++)
                 {
-                    *(dest++) = *(s1);
-                    *(dest++) = *(s2);
-                    *(dest++) = *(s3);
-                    *(dest++) = *(s4);
-                    s1 += 4;
-                    s2 += 4;
-                    s3 += 4;
-                    s4 += 4;
+                    dest[4 * j]     = s1[4 * j];
+                    dest[4 * j + 1] = s2[4 * j];
+                    dest[4 * j + 2] = s3[4 * j];
+                    dest[4 * j + 3] = s4[4 * j];
                 }
+                dest += 4 * (bufwidth / 2);
                 src += fmt.fmt.pix.bytesperline;
             }
         }
@@ -453,18 +516,18 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf,
         break;
 
         case V4L2_PIX_FMT_SBGGR8:
-            bayer2rgb24(rgb24_buffer, frame, fmt.fmt.pix.width, fmt.fmt.pix.height);
-            break;
-
-        case V4L2_PIX_FMT_SRGGB8:
-            bayer_rggb_2rgb24(rgb24_buffer, frame, fmt.fmt.pix.width, fmt.fmt.pix.height);
-            break;
+        case V4L2_PIX_FMT_SGBRG8:
         case V4L2_PIX_FMT_SGRBG8:
-            bayer_grbg_to_rgb24(rgb24_buffer, frame, fmt.fmt.pix.width, fmt.fmt.pix.height);
+        case V4L2_PIX_FMT_SRGGB8:
+            dsp_demosaic_8(frame, fmt.fmt.pix.bytesperline ? fmt.fmt.pix.bytesperline : fmt.fmt.pix.width, rgb24_buffer,
+                           3 * fmt.fmt.pix.width, fmt.fmt.pix.width, fmt.fmt.pix.height, bayerPattern(), demosaicMethod(),
+                           demosaicThreads());
             break;
         case V4L2_PIX_FMT_SBGGR16:
-            bayer16_2_rgb24((unsigned short *)rgb24_buffer, (unsigned short *)frame, fmt.fmt.pix.width,
-                            fmt.fmt.pix.height);
+            dsp_demosaic_16(reinterpret_cast<uint16_t *>(frame),
+                            fmt.fmt.pix.bytesperline ? fmt.fmt.pix.bytesperline / 2 : fmt.fmt.pix.width,
+                            reinterpret_cast<uint16_t *>(rgb24_buffer), 3 * fmt.fmt.pix.width, fmt.fmt.pix.width,
+                            fmt.fmt.pix.height, bayerPattern(), demosaicMethod(), demosaicThreads());
             break;
 
         case V4L2_PIX_FMT_JPEG:
@@ -547,6 +610,50 @@ void V4L2_Builtin_Decoder::setQuantization(bool doquantization)
 {
     doQuantization = doquantization;
 }
+void V4L2_Builtin_Decoder::setEdgeAwareDemosaic(bool value)
+{
+    doEdgeAwareDemosaic = value;
+}
+
+V4L2_Decoder *V4L2_Builtin_Decoder::clone()
+{
+    V4L2_Builtin_Decoder *copy = new V4L2_Builtin_Decoder();
+    copy->init();
+    copy->setformat(fmt, false);
+    copy->usesoftcrop(useSoftCrop);
+    if (doCrop)
+        copy->setcrop(crop);
+    copy->setQuantization(doQuantization);
+    copy->setLinearization(doLinearization);
+    copy->setEdgeAwareDemosaic(doEdgeAwareDemosaic);
+    return copy;
+}
+
+dsp_bayer_pattern V4L2_Builtin_Decoder::bayerPattern() const
+{
+    switch (fmt.fmt.pix.pixelformat)
+    {
+        case V4L2_PIX_FMT_SRGGB8:
+            return DSP_BAYER_RGGB;
+        case V4L2_PIX_FMT_SGRBG8:
+            return DSP_BAYER_GRBG;
+        case V4L2_PIX_FMT_SGBRG8:
+            return DSP_BAYER_GBRG;
+        default:
+            return DSP_BAYER_BGGR;
+    }
+}
+
+dsp_demosaic_method V4L2_Builtin_Decoder::demosaicMethod() const
+{
+    return doEdgeAwareDemosaic ? DSP_DEMOSAIC_MHC : DSP_DEMOSAIC_BILINEAR;
+}
+
+int V4L2_Builtin_Decoder::demosaicThreads() const
+{
+    return std::min(std::max(1u, std::thread::hardware_concurrency()), 4u);
+}
+
 void V4L2_Builtin_Decoder::setLinearization(bool dolinearization)
 {
     doLinearization = dolinearization;
@@ -618,6 +725,7 @@ void V4L2_Builtin_Decoder::allocBuffers()
         case V4L2_PIX_FMT_SBGGR8:
         case V4L2_PIX_FMT_SRGGB8:
         case V4L2_PIX_FMT_SGRBG8:
+        case V4L2_PIX_FMT_SGBRG8:
         case V4L2_PIX_FMT_SBGGR16:
             rgb24_buffer = new unsigned char[(bufwidth * bufheight) * (bpp / 8) * 3];
             break;
@@ -662,14 +770,23 @@ void V4L2_Builtin_Decoder::makeY()
         case V4L2_PIX_FMT_SBGGR8:
         case V4L2_PIX_FMT_SRGGB8:
         case V4L2_PIX_FMT_SGRBG8:
-            RGB2YUV(bufwidth, bufheight, rgb24_buffer, YBuf, UBuf, VBuf, 0);
+        case V4L2_PIX_FMT_SGBRG8:
+            // Same layout as RGB2YUV produced: bottom-up planes, the first byte of a pixel taken as blue.
+            if ((bufwidth % 2) == 0 && (bufheight % 2) == 0)
+                ccvt_bgr24_420p_stride(bufwidth, bufheight, source(rgb24_buffer), 3 * bufwidth,
+                                       YBuf + (bufheight - 1) * bufwidth, -static_cast<int>(bufwidth),
+                                       UBuf + (bufheight / 2 - 1) * (bufwidth / 2), VBuf + (bufheight / 2 - 1) * (bufwidth / 2),
+                                       -static_cast<int>(bufwidth / 2));
             break;
         case V4L2_PIX_FMT_YUYV:
         case V4L2_PIX_FMT_UYVY:
         case V4L2_PIX_FMT_VYUY:
         case V4L2_PIX_FMT_YVYU:
             // todo handcopy only Ybuf using an int, byfwidth should be even
-            ccvt_yuyv_420p(bufwidth, bufheight, yuyvBuffer, YBuf, UBuf, VBuf);
+            ccvt_yuyv_420p(bufwidth, bufheight, source(yuyvBuffer), YBuf, UBuf, VBuf);
+            break;
+        default:
+            materialize();
             break;
     }
 }
@@ -677,7 +794,10 @@ void V4L2_Builtin_Decoder::makeY()
 unsigned char *V4L2_Builtin_Decoder::getY()
 {
     if (fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_Y16)
-        return yuyvBuffer;
+        return source(yuyvBuffer);
+    if (fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_GREY && inPlaceFrame && !doLinearization &&
+            !(doQuantization && getQuantization(&fmt) == QUANTIZATION_LIM_RANGE))
+        return inPlaceFrame;
     makeY();
     if (doQuantization && getQuantization(&fmt) == QUANTIZATION_LIM_RANGE)
         rangeY8(YBuf, (bufwidth * bufheight));
@@ -804,7 +924,7 @@ unsigned char *V4L2_Builtin_Decoder::getMJPEGBuffer(int &size)
     if (fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_MJPEG)
     {
         size = m_Size;
-        return yuvBuffer;
+        return source(yuvBuffer);
     }
     else
         return nullptr;
@@ -815,6 +935,10 @@ unsigned char *V4L2_Builtin_Decoder::getRGBBuffer()
 {
     //cerr << "in get color buffer " << endl;
     //IDLog("Decoder geRGBBuffer %s\n", (doCrop?"true":"false"));
+    if (fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_RGB24)
+        return source(rgb24_buffer);
+    if (fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_YUYV)
+        materialize();
     if (!rgb24_buffer)
         rgb24_buffer = new unsigned char[(bufwidth * bufheight) * 3];
     switch (fmt.fmt.pix.pixelformat)
@@ -835,7 +959,7 @@ unsigned char *V4L2_Builtin_Decoder::getRGBBuffer()
             //if (!colorBuffer) colorBuffer = new unsigned char[(bufwidth * bufheight) * 4];
             //ccvt_yuyv_bgr32(bufwidth, bufheight, yuyvBuffer, rgb24_buffer);
             //ccvt_bgr32_rgb24(bufwidth, bufheight, colorBuffer, (void*)rgb24_buffer);
-            ccvt_yuyv_rgb24(bufwidth, bufheight, yuyvBuffer, (void *)rgb24_buffer);
+            ccvt_yuyv_rgb24(bufwidth, bufheight, source(yuyvBuffer), (void *)rgb24_buffer);
             break;
         case V4L2_PIX_FMT_RGB24:
         case V4L2_PIX_FMT_RGB555:
@@ -843,6 +967,7 @@ unsigned char *V4L2_Builtin_Decoder::getRGBBuffer()
         case V4L2_PIX_FMT_SBGGR8:
         case V4L2_PIX_FMT_SRGGB8:
         case V4L2_PIX_FMT_SGRBG8:
+        case V4L2_PIX_FMT_SGBRG8:
         case V4L2_PIX_FMT_SBGGR16:
             break;
         default:
@@ -972,6 +1097,8 @@ void V4L2_Builtin_Decoder::init_supported_formats()
     supported_formats.insert(
         std::make_pair(V4L2_PIX_FMT_SBGGR8, new V4L2_Builtin_Decoder::format(V4L2_PIX_FMT_SBGGR8, 8, false)));
     // V4L2_PIX_FMT_SGBRG8  , // v4l2_fourcc('G', 'B', 'R', 'G') /*  8  GBGB.. RGRG.. */
+    supported_formats.insert(
+        std::make_pair(V4L2_PIX_FMT_SGBRG8, new V4L2_Builtin_Decoder::format(V4L2_PIX_FMT_SGBRG8, 8, false)));
     // V4L2_PIX_FMT_SGRBG8  , // v4l2_fourcc('G', 'R', 'B', 'G') /*  8  GRGR.. BGBG.. */
     supported_formats.insert(
         std::make_pair(V4L2_PIX_FMT_SGRBG8, new V4L2_Builtin_Decoder::format(V4L2_PIX_FMT_SGRBG8, 8, false)));
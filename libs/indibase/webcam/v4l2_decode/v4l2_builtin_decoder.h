@@ -23,6 +23,7 @@
 #pragma once
 
 #include "v4l2_decode.h"
+#include "dsp.h"
 
 #include <map>
 
@@ -48,6 +49,7 @@ class V4L2_Builtin_Decoder : public V4L2_Decoder
         virtual bool issupportedformat(unsigned int format);
         virtual const std::vector<unsigned int> &getsupportedformats();
         virtual void decode(unsigned char *frame, struct v4l2_buffer *buf, bool native);
+        virtual void release();
         virtual unsigned char *getY();
         virtual unsigned char *getU();
         virtual unsigned char *getV();
@@ -57,6 +59,8 @@ class V4L2_Builtin_Decoder : public V4L2_Decoder
         virtual int getBpp();
         virtual void setQuantization(bool);
         virtual void setLinearization(bool);
+        virtual void setEdgeAwareDemosaic(bool);
+        virtual V4L2_Decoder *clone();
 
     protected:
         void init_supported_formats();
@@ -65,6 +69,16 @@ class V4L2_Builtin_Decoder : public V4L2_Decoder
         void allocBuffers();
         void makeY();
         void makeLinearY();
+        void decodeFrame(unsigned char *frame, struct v4l2_buffer *buf, bool native);
+        bool canDecodeInPlace(const struct v4l2_buffer *buf, bool native) const;
+        void materialize();
+        dsp_bayer_pattern bayerPattern() const;
+        dsp_demosaic_method demosaicMethod() const;
+        int demosaicThreads() const;
+        unsigned char *source(unsigned char *buffer) const
+        {
+            return inPlaceFrame ? inPlaceFrame : buffer;
+        }
 
         struct v4l2_crop crop;
         struct v4l2_format fmt;
@@ -72,6 +86,7 @@ class V4L2_Builtin_Decoder : public V4L2_Decoder
         bool doCrop;      // do software cropping when decoding frames
         bool doQuantization;
         bool doLinearization;
+        bool doEdgeAwareDemosaic {false};
 
         unsigned char *YBuf;
         unsigned char *UBuf;
@@ -88,4 +103,9 @@ class V4L2_Builtin_Decoder : public V4L2_Decoder
         char lut6[64];
         unsigned char bpp;
         int m_Size;
+
+        // Frame referenced in place by decode until it is released or copied by materialize
+        unsigned char *inPlaceFrame {nullptr};
+        struct v4l2_buffer inPlaceBuffer;
+        bool inPlaceNative {false};
 };
@@ -46,6 +46,8 @@ class V4L2_Decoder
         virtual bool issupportedformat(unsigned int format)                   = 0;
         virtual const std::vector<unsigned int> &getsupportedformats()        = 0;
         virtual void decode(unsigned char *frame, struct v4l2_buffer *buf, bool native)    = 0;
+        // The frame passed to decode stays valid until release is called, so a decoder may read it in place.
+        virtual void release() {}
         virtual unsigned char *getY()                                         = 0;
         virtual unsigned char *getU()                                         = 0;
         virtual unsigned char *getV()                                         = 0;
@@ -55,6 +57,14 @@ class V4L2_Decoder
         virtual int getBpp()                  = 0;
         virtual void setQuantization(bool)    = 0;
         virtual void setLinearization(bool)   = 0;
+        // Interpolate Bayer frames along edges instead of bilinearly.
+        virtual void setEdgeAwareDemosaic(bool) {}
+        // A new decoder with the same format and settings, to decode frames in parallel. Decoders that
+        // cannot be duplicated return nullptr.
+        virtual V4L2_Decoder *clone()
+        {
+            return nullptr;
+        }
 
     protected:
         const char *name;
@@ -733,6 +733,10 @@ int IUSnoopBLOB(XMLEle *root, IBLOBVectorProperty *bvp)
             if (bp == NULL)
                 return (-1);
 
+            /* BLOBs sent in chunks are not reassembled when snooping */
+            if (findXMLAtt(ep, "offset"))
+                continue;
+
             XMLAtt *fa = findXMLAtt(ep, "format");
             XMLAtt *sa = findXMLAtt(ep, "size");
             if (fa && sa)
@@ -223,6 +223,20 @@ extern void IDSetLightVA(const ILightVectorProperty *l, const char *msg, va_list
 extern void IDSetBLOB(const IBLOBVectorProperty *b, const char *msg, ...) ATTRIBUTE_FORMAT_PRINTF(2, 3);
 extern void IDSetBLOBVA(const IBLOBVectorProperty *b, const char *msg, va_list arg) ATTRIBUTE_FORMAT_PRINTF(2, 0);
 
+/** @brief Tell client to update a part of an existing BLOB element.
+ *
+ *  This allows sending a BLOB progressively, for example while a sensor is being read out. The
+ *  element's blob must point to a buffer of bloblen bytes holding the whole BLOB and the chunks are
+ *  expected to be sent in order, the first one at offset 0. Clients assemble the chunks and receive
+ *  the element once the last byte arrived. Chunks are never compressed. Each chunk is copied before it
+ *  is sent, the blob remains writable. INDI::CCD uploads send whole BLOBs, drivers call this explicitly.
+ *  @param b pointer to the vector BLOB property.
+ *  @param index index of the BLOB element within the vector.
+ *  @param offset offset in bytes of the chunk within the element's blob.
+ *  @param length length in bytes of the chunk.
+ */
+extern void IDSetBLOBChunk(const IBLOBVectorProperty *b, int index, unsigned int offset, unsigned int length);
+
 /* @} */
 
 /**
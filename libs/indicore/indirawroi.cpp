@@ -0,0 +1,281 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ Lightweight raw ROI image format.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "indirawroi.h"
+
+#include <cstring>
+#include <zlib.h>
+
+namespace INDI
+{
+
+constexpr char RawROIHeader::MAGIC[4];
+
+template <typename T>
+static void putLE(uint8_t *&out, T value)
+{
+    for (size_t i = 0; i < sizeof(T); i++)
+        *out++ = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i));
+}
+
+template <typename T>
+static T getLE(const uint8_t *&in)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); i++)
+        value |= static_cast<uint64_t>(*in++) << (8 * i);
+    return static_cast<T>(value);
+}
+
+void RawROIHeader::serialize(uint8_t *out) const
+{
+    memcpy(out, MAGIC, sizeof(MAGIC));
+    out += sizeof(MAGIC);
+    putLE(out, version);
+    putLE(out, flags);
+    putLE(out, bpp);
+    putLE(out, channels);
+    putLE(out, x);
+    putLE(out, y);
+    putLE(out, width);
+    putLE(out, height);
+    putLE(out, binX);
+    putLE(out, binY);
+    putLE(out, sequence);
+    putLE(out, reference);
+    uint64_t bits;
+    memcpy(&bits, &exposure, sizeof(bits));
+    putLE(out, bits);
+    putLE(out, pixelBytes);
+}
+
+bool RawROIHeader::deserialize(const uint8_t *data, size_t size)
+{
+    if (size < SIZE || memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+        return false;
+
+    data += sizeof(MAGIC);
+    version   = getLE<uint8_t>(data);
+    if (version != VERSION)
+        return false;
+    flags     = getLE<uint8_t>(data);
+    bpp       = getLE<uint8_t>(data);
+    channels  = getLE<uint8_t>(data);
+    x         = getLE<uint32_t>(data);
+    y         = getLE<uint32_t>(data);
+    width     = getLE<uint32_t>(data);
+    height    = getLE<uint32_t>(data);
+    binX      = getLE<uint16_t>(data);
+    binY      = getLE<uint16_t>(data);
+    sequence  = getLE<uint32_t>(data);
+    reference = getLE<uint32_t>(data);
+    uint64_t bits = getLE<uint64_t>(data);
+    memcpy(&exposure, &bits, sizeof(exposure));
+    pixelBytes = getLE<uint64_t>(data);
+
+    return (bpp == 8 || bpp == 16) && channels > 0 &&
+           pixelBytes == static_cast<uint64_t>(width) * height * channels * (bpp / 8);
+}
+
+bool RawROIHeader::isCompatible(const RawROIHeader &other) const
+{
+    return x == other.x && y == other.y && width == other.width && height == other.height &&
+           binX == other.binX && binY == other.binY && bpp == other.bpp && channels == other.channels;
+}
+
+// Difference or sum modulo 2^bpp, the direction depends on the sign.
+template <typename T>
+static void delta(const T *a, const T *b, T *out, size_t count, bool subtract)
+{
+    if (subtract)
+        for (size_t i = 0; i < count; i++)
+            out[i] = static_cast<T>(a[i] - b[i]);
+    else
+        for (size_t i = 0; i < count; i++)
+            out[i] = static_cast<T>(a[i] + b[i]);
+}
+
+// Split 16-bit pixels in a plane of low bytes followed by a plane of high bytes. Residuals are
+// small so the high byte plane is nearly constant and deflates very well.
+static void shuffle(const uint8_t *in, uint8_t *out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        out[i]         = in[2 * i];
+        out[count + i] = in[2 * i + 1];
+    }
+}
+
+static void unshuffle(const uint8_t *in, uint8_t *out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        out[2 * i]     = in[i];
+        out[2 * i + 1] = in[count + i];
+    }
+}
+
+void RawROIEncoder::setDelta(bool enabled)
+{
+    if (m_Delta != enabled)
+        reset();
+    m_Delta = enabled;
+}
+
+void RawROIEncoder::setCompression(bool enabled)
+{
+    m_Compression = enabled;
+}
+
+void RawROIEncoder::setKeyFrameInterval(uint32_t interval)
+{
+    m_KeyFrameInterval = interval;
+}
+
+void RawROIEncoder::reset()
+{
+    m_HasReference = false;
+}
+
+bool RawROIEncoder::encode(const uint8_t *buffer, const RawROIHeader &frame)
+{
+    if (buffer == nullptr || (frame.bpp != 8 && frame.bpp != 16) || frame.channels == 0)
+        return false;
+
+    RawROIHeader header = frame;
+    header.version    = RawROIHeader::VERSION;
+    header.flags      = 0;
+    header.sequence   = ++m_Sequence;
+    header.reference  = 0;
+    header.pixelBytes = static_cast<uint64_t>(header.width) * header.height * header.channels * (header.bpp / 8);
+
+    const size_t bytes = header.pixelBytes;
+    const size_t count = bytes / (header.bpp / 8);
+
+    bool useDelta = m_Delta && m_HasReference && m_Reference.isCompatible(header) &&
+                    m_SinceKeyFrame < m_KeyFrameInterval;
+
+    const uint8_t *payload = buffer;
+    if (useDelta)
+    {
+        header.flags    |= RawROIHeader::FLAG_DELTA;
+        header.reference = m_Reference.sequence;
+        m_Scratch.resize(bytes);
+        if (header.bpp == 8)
+            delta(buffer, m_ReferencePixels.data(), m_Scratch.data(), count, true);
+        else
+            delta(reinterpret_cast<const uint16_t *>(buffer), reinterpret_cast<const uint16_t *>(m_ReferencePixels.data()),
+                  reinterpret_cast<uint16_t *>(m_Scratch.data()), count, true);
+        payload = m_Scratch.data();
+        m_SinceKeyFrame++;
+    }
+    else
+        m_SinceKeyFrame = 0;
+
+    if (m_Delta)
+    {
+        m_Reference = header;
+        m_ReferencePixels.assign(buffer, buffer + bytes);
+        m_HasReference = true;
+    }
+
+    if (m_Compression)
+    {
+        if (header.bpp == 16)
+        {
+            m_Shuffled.resize(bytes);
+            shuffle(payload, m_Shuffled.data(), count);
+            payload = m_Shuffled.data();
+        }
+
+        header.flags |= RawROIHeader::FLAG_COMPRESSED;
+        uLongf compressedBytes = compressBound(bytes);
+        m_Output.resize(RawROIHeader::SIZE + compressedBytes);
+        // Favor speed, frames are sent at a high rate.
+        if (compress2(m_Output.data() + RawROIHeader::SIZE, &compressedBytes, payload, bytes, Z_BEST_SPEED) != Z_OK)
+            return false;
+        m_Output.resize(RawROIHeader::SIZE + compressedBytes);
+    }
+    else
+    {
+        m_Output.resize(RawROIHeader::SIZE + bytes);
+        memcpy(m_Output.data() + RawROIHeader::SIZE, payload, bytes);
+    }
+
+    header.serialize(m_Output.data());
+    return true;
+}
+
+bool RawROIDecoder::decode(const void *data, size_t size)
+{
+    const uint8_t *input = static_cast<const uint8_t *>(data);
+    RawROIHeader header;
+    if (data == nullptr || header.deserialize(input, size) == false)
+        return false;
+
+    bool isDelta = header.flags & RawROIHeader::FLAG_DELTA;
+    if (isDelta && (!m_HasFrame || m_Header.sequence != header.reference || !m_Header.isCompatible(header)))
+    {
+        m_HasFrame = false;
+        return false;
+    }
+
+    const size_t bytes = header.pixelBytes;
+    const size_t count = bytes / (header.bpp / 8);
+    const uint8_t *payload = input + RawROIHeader::SIZE;
+    size_t payloadSize = size - RawROIHeader::SIZE;
+
+    if (header.flags & RawROIHeader::FLAG_COMPRESSED)
+    {
+        m_Scratch.resize(bytes);
+        uLongf decompressedBytes = bytes;
+        if (uncompress(m_Scratch.data(), &decompressedBytes, payload, payloadSize) != Z_OK || decompressedBytes != bytes)
+            return false;
+        payload = m_Scratch.data();
+
+        if (header.bpp == 16)
+        {
+            m_Shuffled.resize(bytes);
+            unshuffle(m_Scratch.data(), m_Shuffled.data(), count);
+            payload = m_Shuffled.data();
+        }
+        payloadSize = bytes;
+    }
+
+    if (payloadSize < bytes)
+        return false;
+
+    if (isDelta)
+    {
+        if (header.bpp == 8)
+            delta(payload, m_Pixels.data(), m_Pixels.data(), count, false);
+        else
+            delta(reinterpret_cast<const uint16_t *>(payload), reinterpret_cast<const uint16_t *>(m_Pixels.data()),
+                  reinterpret_cast<uint16_t *>(m_Pixels.data()), count, false);
+    }
+    else
+        m_Pixels.assign(payload, payload + bytes);
+
+    m_Header = header;
+    m_HasFrame = true;
+    return true;
+}
+
+}
@@ -0,0 +1,170 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ Lightweight raw ROI image format.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace INDI
+{
+
+/**
+ * \struct RawROIHeader
+ * \brief Header of a raw ROI frame.
+ *
+ * A raw ROI frame is a fixed size little-endian header followed by the pixels of the region of
+ * interest in native byte order. It is meant for small frames exposed at a high rate, such as
+ * guiding and focusing frames, where building a complete FITS file for every exposure is wasteful.
+ *
+ * If the frame is delta encoded, each pixel holds the difference (modulo 2^bpp) to the same pixel
+ * of frame @a reference. If it is compressed, the payload is deflated after splitting 16-bit pixels
+ * in low and high byte planes.
+ */
+struct RawROIHeader
+{
+    enum
+    {
+        FLAG_DELTA      = 1 << 0, /*!< Pixels are differences to the reference frame */
+        FLAG_COMPRESSED = 1 << 1  /*!< Payload is compressed with zlib */
+    };
+
+    uint8_t version {VERSION};
+    uint8_t flags {0};
+    uint8_t bpp {16};
+    uint8_t channels {1};
+    uint32_t x {0};         /*!< Left edge of the ROI in unbinned sensor pixels */
+    uint32_t y {0};         /*!< Top edge of the ROI in unbinned sensor pixels */
+    uint32_t width {0};     /*!< Width in binned pixels */
+    uint32_t height {0};    /*!< Height in binned pixels */
+    uint16_t binX {1};
+    uint16_t binY {1};
+    uint32_t sequence {0};  /*!< Frame number, incremented for every frame */
+    uint32_t reference {0}; /*!< Frame the deltas are computed against */
+    double exposure {0};    /*!< Exposure duration in seconds */
+    uint64_t pixelBytes {0};/*!< Size of the decoded pixels */
+
+    static constexpr uint8_t VERSION = 1;
+    /// Serialized size including the magic.
+    static constexpr size_t SIZE = 52;
+    static constexpr char MAGIC[4] = {'I', 'R', 'O', 'I'};
+
+    /// Write the header to out, which must hold at least SIZE bytes.
+    void serialize(uint8_t *out) const;
+    /// Read the header from data, returns false if it is not a raw ROI header.
+    bool deserialize(const uint8_t *data, size_t size);
+
+    /// @return True if both headers describe frames of the same geometry and pixel format.
+    bool isCompatible(const RawROIHeader &other) const;
+};
+
+/**
+ * \class RawROIEncoder
+ * \brief Encodes consecutive frames of a region of interest.
+ *
+ * When delta encoding is enabled, a frame is encoded against the previous one as long as the ROI
+ * geometry does not change. A key frame is inserted periodically so that clients connecting in the
+ * middle of a sequence can start decoding.
+ */
+class RawROIEncoder
+{
+    public:
+        /// Encode frames as differences to the previous frame.
+        void setDelta(bool enabled);
+        /// Compress the payload.
+        void setCompression(bool enabled);
+        /// Maximum number of delta frames between two key frames.
+        void setKeyFrameInterval(uint32_t interval);
+        /// Force the next frame to be a key frame.
+        void reset();
+
+        /**
+         * @brief encode Encode a frame.
+         * @param buffer Frame pixels, planar if there are multiple channels.
+         * @param header Geometry and pixel format of the frame, flags and sequence numbers are set by the encoder.
+         * @return True on success, false if the pixel format is not supported or compression failed.
+         */
+        bool encode(const uint8_t *buffer, const RawROIHeader &header);
+
+        /// @return Encoded frame including the header.
+        const uint8_t *data() const
+        {
+            return m_Output.data();
+        }
+        size_t size() const
+        {
+            return m_Output.size();
+        }
+
+    private:
+        bool m_Delta {false};
+        bool m_Compression {false};
+        uint32_t m_KeyFrameInterval {30};
+        uint32_t m_SinceKeyFrame {0};
+        uint32_t m_Sequence {0};
+        bool m_HasReference {false};
+
+        RawROIHeader m_Reference;
+        std::vector<uint8_t> m_ReferencePixels;
+        std::vector<uint8_t> m_Scratch;
+        std::vector<uint8_t> m_Shuffled;
+        std::vector<uint8_t> m_Output;
+};
+
+/**
+ * \class RawROIDecoder
+ * \brief Decodes frames produced by RawROIEncoder.
+ *
+ * Delta frames are only decoded if their reference frame was decoded before. Until then, decode
+ * fails and the decoder waits for the next key frame.
+ */
+class RawROIDecoder
+{
+    public:
+        /**
+         * @brief decode Decode a frame.
+         * @return True if the frame is decoded, false if it is invalid or its reference frame is missing.
+         */
+        bool decode(const void *data, size_t size);
+
+        const RawROIHeader &header() const
+        {
+            return m_Header;
+        }
+        /// @return Decoded pixels in native byte order, planar if there are multiple channels.
+        const uint8_t *pixels() const
+        {
+            return m_Pixels.data();
+        }
+        size_t pixelBytes() const
+        {
+            return m_Pixels.size();
+        }
+
+    private:
+        bool m_HasFrame {false};
+        RawROIHeader m_Header;
+        std::vector<uint8_t> m_Pixels;
+        std::vector<uint8_t> m_Scratch;
+        std::vector<uint8_t> m_Shuffled;
+};
+
+}
@@ -98,14 +98,60 @@ void IUUserIOSwitchContext(const userio *io, void *user, const ISwitchVectorProp
         IUUserIOSwitchContextFull(io, user, svp);
 }
 
+static void s_userio_blob_data(const userio *io, void *user, unsigned int bloblen, const void *blob, const char *format)
+{
+    unsigned char *encblob;
+    int l;
+
+    if (io->joinbuff) {
+        userio_prints    (io, user, "    format='");
+        userio_xml_escape(io, user, format);
+        userio_prints    (io, user, "'\n");
+        userio_printf    (io, user, "    len='%d'\n", bloblen);
+
+        io->joinbuff(user, "    attached='true'>\n", (void*)blob, bloblen);
+    } else {
+        size_t sz = 4 * bloblen / 3 + 4;
+        assert_mem(encblob = (unsigned char *)malloc(sz)); // #PS: TODO
+        l = to64frombits_s(encblob, blob, bloblen, sz);
+        if (l == 0) {
+            fprintf(stderr, "%s: Not enough memory for decoding.\n", __func__);
+            exit(1);
+        }
+        userio_printf    (io, user, "    enclen='%d'\n", l); // safe
+        userio_prints    (io, user, "    format='");
+        userio_xml_escape(io, user, format);
+        userio_prints    (io, user, "'>\n");
+        size_t written = 0;
+        // FIXME: this is not efficient. The CR/LF imply one more copy... Do we need them ?
+        while ((int)written < l)
+        {
+            size_t towrite = ((l - written) > 72) ? 72 : l - written;
+            size_t wr      = userio_write(io, user, encblob + written, towrite);
+
+            if (wr == 0)
+            {
+                free(encblob);
+                return;
+            }
+
+            written += wr;
+            if ((written % 72) == 0)
+                userio_putc(io, user, '\n');
+        }
+
+        if ((written % 72) != 0)
+            userio_putc(io, user, '\n');
+
+        free(encblob);
+    }
+}
+
 void IUUserIOBLOBContextOne(
     const userio *io, void *user,
     const char *name, unsigned int size, unsigned int bloblen, const void *blob, const char *format
 )
 {
-    unsigned char *encblob;
-    int l;
-
     userio_prints    (io, user, "  <oneBLOB\n"
                                 "    name='");
     userio_xml_escape(io, user, name);
@@ -122,49 +168,26 @@ void IUUserIOBLOBContextOne(
     }
     else
     {
-        if (io->joinbuff) {
-            userio_prints    (io, user, "    format='");
-            userio_xml_escape(io, user, format);
-            userio_prints    (io, user, "'\n");
-            userio_printf    (io, user, "    len='%d'\n", bloblen);
-
-            io->joinbuff(user, "    attached='true'>\n", (void*)blob, bloblen);
-        } else {
-            size_t sz = 4 * bloblen / 3 + 4;
-            assert_mem(encblob = (unsigned char *)malloc(sz)); // #PS: TODO
-            l = to64frombits_s(encblob, blob, bloblen, sz);
-            if (l == 0) {
-                fprintf(stderr, "%s: Not enough memory for decoding.\n", __func__);
-                exit(1);
-            }
-            userio_printf    (io, user, "    enclen='%d'\n", l); // safe
-            userio_prints    (io, user, "    format='");
-            userio_xml_escape(io, user, format);
-            userio_prints    (io, user, "'>\n");
-            size_t written = 0;
-            // FIXME: this is not efficient. The CR/LF imply one more copy... Do we need them ?
-            while ((int)written < l)
-            {
-                size_t towrite = ((l - written) > 72) ? 72 : l - written;
-                size_t wr      = userio_write(io, user, encblob + written, towrite);
-
-                if (wr == 0)
-                {
-                    free(encblob);
-                    return;
-                }
-
-                written += wr;
-                if ((written % 72) == 0)
-                    userio_putc(io, user, '\n');
-            }
+        s_userio_blob_data(io, user, bloblen, blob, format);
+    }
 
-            if ((written % 72) != 0)
-                userio_putc(io, user, '\n');
+    userio_prints    (io, user, "  </oneBLOB>\n");
+}
 
-            free(encblob);
-        }
-    }
+void IUUserIOBLOBChunkContextOne(
+    const userio *io, void *user,
+    const char *name, unsigned int offset, unsigned int length, unsigned int total, const void *chunk, const char *format
+)
+{
+    userio_prints    (io, user, "  <oneBLOB\n"
+                                "    name='");
+    userio_xml_escape(io, user, name);
+    userio_prints    (io, user, "'\n");
+    userio_printf    (io, user, "    size='%u'\n", length); // safe
+    userio_printf    (io, user, "    offset='%u'\n", offset); // safe
+    userio_printf    (io, user, "    total='%u'\n", total); // safe
+
+    s_userio_blob_data(io, user, length, chunk, format);
 
     userio_prints    (io, user, "  </oneBLOB>\n");
 }
@@ -748,6 +771,33 @@ void IUUserIOSetBLOBVA(
     indi_locale_C_numeric_pop(orig);
 }
 
+void IUUserIOSetBLOBChunk(
+    const userio *io, void *user,
+    const IBLOBVectorProperty *bvp, const IBLOB *bp, unsigned int offset, unsigned int length, const void *chunk
+)
+{
+    locale_char_t *orig = indi_locale_C_numeric_push();
+    userio_prints    (io, user, "<setBLOBVector\n"
+                                "  device='");
+    userio_xml_escape(io, user, bvp->device);
+    userio_prints    (io, user, "'\n"
+                                "  name='");
+    userio_xml_escape(io, user, bvp->name);
+    userio_prints    (io, user, "'\n");
+    userio_printf    (io, user, "  state='%s'\n", pstateStr(bvp->s)); // safe
+    userio_printf    (io, user, "  timeout='%g'\n", bvp->timeout); // safe
+    userio_printf    (io, user, "  timestamp='%s'\n", indi_timestamp()); // safe
+    userio_prints    (io, user, ">\n");
+
+    IUUserIOBLOBChunkContextOne(
+        io, user,
+        bp->name, offset, length, bp->bloblen, chunk, bp->format
+    );
+
+    userio_prints    (io, user, "</setBLOBVector>\n");
+    indi_locale_C_numeric_pop(orig);
+}
+
 void IUUserIOUpdateMinMax(
     const userio *io, void *user,
     const INumberVectorProperty *nvp
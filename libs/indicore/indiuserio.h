@@ -55,6 +55,10 @@ void IUUserIOBLOBContextOne(
     const userio *io, void *user,
     const char *name, unsigned int size, unsigned int bloblen, const void *blob, const char *format
 );
+void IUUserIOBLOBChunkContextOne(
+    const userio *io, void *user,
+    const char *name, unsigned int offset, unsigned int length, unsigned int total, const void *chunk, const char *format
+);
 void IUUserIONewBLOBFinish(const userio *io, void *user);
 
 void IUUserIOEnableBLOB(
@@ -77,6 +81,8 @@ void IUUserIOSetSwitchVA(const userio *io, void *user, const struct _ISwitchVect
                          va_list ap);
 void IUUserIOSetLightVA(const userio *io, void *user, const struct _ILightVectorProperty *lvp, const char *fmt, va_list ap);
 void IUUserIOSetBLOBVA(const userio *io, void *user, const struct _IBLOBVectorProperty *bvp, const char *fmt, va_list ap);
+void IUUserIOSetBLOBChunk(const userio *io, void *user, const struct _IBLOBVectorProperty *bvp, const struct _IBLOB *bp,
+                          unsigned int offset, unsigned int length, const void *chunk);
 
 void IUUserIOUpdateMinMax(const userio *io, void *user, const struct _INumberVectorProperty *nvp);
 
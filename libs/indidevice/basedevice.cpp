@@ -44,6 +44,7 @@
 #include <thread>
 #include <chrono>
 #include <algorithm>
+#include <vector>
 
 #if defined(_MSC_VER)
 #define snprintf _snprintf
@@ -689,8 +690,12 @@ int BaseDevice::setValue(const INDI::LilXmlElement &root, char *errmsg)
 
         case INDI_BLOB:
         {
-            if (d->setBLOB(PropertyBlob(property), root, errmsg) < 0)
+            int ret = d->setBLOB(PropertyBlob(property), root, errmsg);
+            if (ret < 0)
                 return -1;
+            // Wait for the remaining chunks before notifying
+            if (ret > 0)
+                return 0;
             break;
         }
 
@@ -768,6 +773,16 @@ int BaseDevicePrivate::setBLOB(INDI::PropertyBlob property, const LilXmlElement
             continue;
         }
 
+        if (element.getAttribute("offset"))
+        {
+            int ret = setBLOBChunk(property, *widget, element, errmsg);
+            if (ret != 0)
+                return ret;
+            widget->setFormat(format);
+            property.emitUpdate();
+            continue;
+        }
+
         widget->setSize(size);
 #ifdef ENABLE_INDI_SHARED_MEMORY
         if (sSharedToBlob(element, *widget) == false)
@@ -821,6 +836,91 @@ int BaseDevicePrivate::setBLOB(INDI::PropertyBlob property, const LilXmlElement
     return 0;
 }
 
+int BaseDevicePrivate::setBLOBChunk(INDI::PropertyBlob property, INDI::WidgetViewBlob &widget,
+                                    const LilXmlElement &element, char *errmsg)
+{
+    size_t offset = element.getAttribute("offset");
+    size_t length = element.getAttribute("size");
+    size_t total  = element.getAttribute("total");
+    std::string key = std::string(property.getName()) + "." + widget.getName();
+
+    if (offset + length > total)
+    {
+        snprintf(errmsg, MAXRBUF, "INDI: %s.%s.%s chunk exceeds BLOB size.",
+                 property.getDeviceName(), property.getName(), widget.getName());
+        blobChunkOffsets.erase(key);
+        return -1;
+    }
+
+    // The first chunk allocates the whole BLOB, the following ones must come in order.
+    if (offset == 0)
+    {
+#ifdef ENABLE_INDI_SHARED_MEMORY
+        IDSharedBlobFree(widget.getBlob());
+        widget.setBlob(malloc(total));
+#else
+        widget.setBlob(realloc(widget.getBlob(), total));
+#endif
+        widget.setBlobLen(0);
+        widget.setSize(total);
+        blobChunkOffsets[key] = 0;
+    }
+
+    auto expected = blobChunkOffsets.find(key);
+    if (expected == blobChunkOffsets.end() || expected->second != offset)
+    {
+        // Joined in the middle of a BLOB or a chunk was lost, wait for the next BLOB.
+        blobChunkOffsets.erase(key);
+        return 1;
+    }
+
+    char *destination = static_cast<char *>(widget.getBlob()) + offset;
+#ifdef ENABLE_INDI_SHARED_MEMORY
+    auto attachementId = element.getAttribute("attached-data-id");
+    if (attachementId.isValid())
+    {
+        void *tmp = attachBlobByUid(attachementId.toString(), length);
+        memcpy(destination, tmp, length);
+        IDSharedBlobFree(tmp);
+    }
+    else
+#endif
+    {
+        // The encoded length excludes the line breaks, which the decoder skips on its own.
+        auto enclen = element.getAttribute("enclen");
+        size_t base64_encoded_size = enclen.isValid() ? enclen.toInt() : element.context().size();
+        int decoded;
+        // Decode in place unless the estimated size would overflow the end of the buffer.
+        if (3 * base64_encoded_size / 4 <= total - offset)
+            decoded = from64tobits_fast(destination, element.context(), base64_encoded_size);
+        else
+        {
+            std::vector<char> tail(3 * base64_encoded_size / 4 + 1);
+            decoded = from64tobits_fast(tail.data(), element.context(), base64_encoded_size);
+            memcpy(destination, tail.data(), std::min<size_t>(std::max(decoded, 0), length));
+        }
+
+        if (decoded != static_cast<int>(length))
+        {
+            snprintf(errmsg, MAXRBUF, "INDI: %s.%s.%s chunk length mismatch.",
+                     property.getDeviceName(), property.getName(), widget.getName());
+            blobChunkOffsets.erase(key);
+            return -1;
+        }
+    }
+
+    widget.setBlobLen(offset + length);
+
+    if (offset + length < total)
+    {
+        expected->second = offset + length;
+        return 1;
+    }
+
+    blobChunkOffsets.erase(key);
+    return 0;
+}
+
 void BaseDevice::setDeviceName(const char *dev)
 {
     D_PTR(BaseDevice);
@@ -42,9 +42,17 @@ class BaseDevicePrivate
         BaseDevicePrivate();
         virtual ~BaseDevicePrivate();
 
-        /** @brief Parse and store BLOB in the respective vector */
+        /** @brief Parse and store BLOB in the respective vector
+         *  @return 0 if okay, 1 if only a part of a chunked BLOB was received, -1 if error
+         */
         int setBLOB(INDI::PropertyBlob propertyBlob, const INDI::LilXmlElement &root, char *errmsg);
 
+        /** @brief Copy one chunk of a BLOB sent progressively into the element buffer
+         *  @return 0 if the BLOB is complete, 1 if more chunks are expected, -1 if error
+         */
+        int setBLOBChunk(INDI::PropertyBlob propertyBlob, INDI::WidgetViewBlob &widget, const INDI::LilXmlElement &element,
+                         char *errmsg);
+
         void emitWatchProperty(const INDI::Property &property, bool isNew)
         {
             auto it = watchPropertyMap.find(property.getName());
@@ -184,6 +192,8 @@ class BaseDevicePrivate
 
         INDI::BaseMediator *mediator {nullptr};
         std::deque<std::string> messageLog;
+        // Next expected offset of BLOBs received in chunks, by property and element name.
+        std::map<std::string, size_t> blobChunkOffsets;
         mutable std::mutex m_Lock;
 
         bool valid {true};
@@ -19,6 +19,10 @@
 #include "indipropertyblob.h"
 #include "indipropertyblob_p.h"
 
+#include <cstdio>
+
+extern void (*WeakIDSetBLOBChunk)(const IBLOBVectorProperty *, int, unsigned int, unsigned int);
+
 namespace INDI
 {
 
@@ -64,6 +68,15 @@ bool PropertyBlob::update(
     return d->typedProperty.update(sizes, blobsizes, blobs, formats, names, n) && (emitUpdate(), true);
 }
 
+void PropertyBlob::applyChunk(size_t index, size_t offset, size_t length) const
+{
+    D_PTR(const PropertyBlob);
+    if (WeakIDSetBLOBChunk)
+        WeakIDSetBLOBChunk(&d->typedProperty, static_cast<int>(index), offset, length);
+    else
+        fprintf(stderr, "%s method available only on driver side\n", __FUNCTION__);
+}
+
 void PropertyBlob::fill(
     const char *device, const char *name, const char *label, const char *group,
     IPerm permission, double timeout, IPState state
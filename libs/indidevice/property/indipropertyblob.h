@@ -52,6 +52,18 @@ class PropertyBlob: public INDI::PropertyBasic<IBLOB>
             const char *device, const char *name, const char *label, const char *group,
             IPerm permission, double timeout, IPState state
         );
+
+    public:
+        /**
+         * @brief Send a part of a BLOB element to the clients.
+         * The element must hold the whole BLOB buffer and its full length, chunks are sent in order
+         * starting at offset 0. Clients receive the element once the last chunk arrived.
+         *
+         * @param index index of the element
+         * @param offset offset of the chunk in bytes
+         * @param length length of the chunk in bytes
+         */
+        void applyChunk(size_t index, size_t offset, size_t length) const;
 };
 
 }
@@ -28,6 +28,7 @@ void (*WeakIDSetLightVA)(const ILightVectorProperty *, const char *, va_list) =
 void (*WeakIDDefLightVA)(const ILightVectorProperty *, const char *, va_list) = nullptr;
 void (*WeakIDSetBLOBVA)(const IBLOBVectorProperty *, const char *, va_list) = nullptr;
 void (*WeakIDDefBLOBVA)(const IBLOBVectorProperty *, const char *, va_list) = nullptr;
+void (*WeakIDSetBLOBChunk)(const IBLOBVectorProperty *, int, unsigned int, unsigned int) = nullptr;
 int (*WeakIUUpdateText)(ITextVectorProperty *, char *[], char *[], int) = nullptr;
 int (*WeakIUUpdateNumber)(INumberVectorProperty *, double[], char *[], int n) = nullptr;
 int (*WeakIUUpdateSwitch)(ISwitchVectorProperty *, ISState *, char *[], int n) = nullptr;
@@ -0,0 +1,151 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "parentdevice.h"
+#include "indililxml.h"
+#include "indiuserio.h"
+#include "indipropertyblob.h"
+#include "userio.h"
+
+static const char *defBLOB =
+    "<defBLOBVector device='Camera' name='CCD1' label='Image' group='Info' state='Idle' perm='ro' timeout='60'>"
+    "<defBLOB name='CCD1' label='Image'/>"
+    "</defBLOBVector>";
+
+static std::string serializeChunk(const IBLOBVectorProperty *bvp, unsigned int offset, unsigned int length)
+{
+    char *buffer = nullptr;
+    size_t size = 0;
+    FILE *file = open_memstream(&buffer, &size);
+    IUUserIOSetBLOBChunk(userio_file(), file, bvp, &bvp->bp[0], offset, length,
+                         static_cast<const char *>(bvp->bp[0].blob) + offset);
+    fclose(file);
+    std::string result(buffer, size);
+    free(buffer);
+    return result;
+}
+
+static int setValue(INDI::BaseDevice &device, INDI::LilXmlParser &parser, const std::string &xml)
+{
+    char errmsg[MAXRBUF];
+    int result = -1;
+    for (auto &document : parser.parseChunk(xml.data(), xml.size()))
+    {
+        result = device.setValue(document.root(), errmsg);
+        if (result < 0)
+            ADD_FAILURE() << errmsg;
+    }
+    return result;
+}
+
+TEST(CORE_BLOB_CHUNK, Test_ReassembleChunks)
+{
+    INDI::ParentDevice device(INDI::ParentDevice::Valid);
+    device.setDeviceName("Camera");
+
+    INDI::LilXmlParser parser;
+    char errmsg[MAXRBUF];
+    for (auto &document : parser.parseChunk(defBLOB, strlen(defBLOB)))
+        ASSERT_EQ(device.buildProp(document.root(), errmsg), 0);
+
+    std::vector<unsigned char> data(1000);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = static_cast<unsigned char>(i * 7);
+
+    IBLOB blob;
+    IBLOBVectorProperty bvp;
+    IUFillBLOB(&blob, "CCD1", "Image", ".fits");
+    IUFillBLOBVector(&bvp, &blob, 1, "Camera", "CCD1", "Image", "Info", IP_RO, 60, IPS_BUSY);
+    blob.blob    = data.data();
+    blob.bloblen = data.size();
+    blob.size    = data.size();
+
+    int updates = 0;
+    INDI::PropertyBlob property = device.getBLOB("CCD1");
+    device.watchProperty("CCD1", [&](INDI::Property)
+    {
+        updates++;
+    }, INDI::BaseDevice::WATCH_UPDATE);
+    // The callback is invoked once when the property already exists.
+    updates = 0;
+
+    // Chunks sizes not multiple of 3 exercise the base64 padding.
+    const unsigned int chunk = 301;
+    for (unsigned int offset = 0; offset < data.size(); offset += chunk)
+    {
+        unsigned int length = std::min<unsigned int>(chunk, data.size() - offset);
+        ASSERT_EQ(setValue(device, parser, serializeChunk(&bvp, offset, length)), 0);
+        if (offset + length < data.size())
+        {
+            EXPECT_EQ(updates, 0);
+        }
+    }
+
+    EXPECT_EQ(updates, 1);
+    ASSERT_EQ(property[0].getBlobLen(), static_cast<int>(data.size()));
+    ASSERT_EQ(property[0].getSize(), static_cast<int>(data.size()));
+    EXPECT_STREQ(property[0].getFormat(), ".fits");
+    EXPECT_EQ(memcmp(property[0].getBlob(), data.data(), data.size()), 0);
+}
+
+TEST(CORE_BLOB_CHUNK, Test_IgnoreIncompleteBLOB)
+{
+    INDI::ParentDevice device(INDI::ParentDevice::Valid);
+    device.setDeviceName("Camera");
+
+    INDI::LilXmlParser parser;
+    char errmsg[MAXRBUF];
+    for (auto &document : parser.parseChunk(defBLOB, strlen(defBLOB)))
+        ASSERT_EQ(device.buildProp(document.root(), errmsg), 0);
+
+    std::vector<unsigned char> data(600, 42);
+
+    IBLOB blob;
+    IBLOBVectorProperty bvp;
+    IUFillBLOB(&blob, "CCD1", "Image", ".fits");
+    IUFillBLOBVector(&bvp, &blob, 1, "Camera", "CCD1", "Image", "Info", IP_RO, 60, IPS_BUSY);
+    blob.blob    = data.data();
+    blob.bloblen = data.size();
+    blob.size    = data.size();
+
+    int updates = 0;
+    device.watchProperty("CCD1", [&](INDI::Property)
+    {
+        updates++;
+    }, INDI::BaseDevice::WATCH_UPDATE);
+    // The callback is invoked once when the property already exists.
+    updates = 0;
+
+    // Joining in the middle of a BLOB, the remaining chunks are skipped.
+    ASSERT_EQ(setValue(device, parser, serializeChunk(&bvp, 200, 200)), 0);
+    ASSERT_EQ(setValue(device, parser, serializeChunk(&bvp, 400, 200)), 0);
+    EXPECT_EQ(updates, 0);
+
+    // The next BLOB is received completely.
+    ASSERT_EQ(setValue(device, parser, serializeChunk(&bvp, 0, 300)), 0);
+    ASSERT_EQ(setValue(device, parser, serializeChunk(&bvp, 300, 300)), 0);
+    EXPECT_EQ(updates, 1);
+}
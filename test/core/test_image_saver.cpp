@@ -0,0 +1,155 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "indiimagesaver.h"
+
+class ImageSaverTest : public ::testing::Test
+{
+    protected:
+        void SetUp() override
+        {
+            char path[] = "/tmp/test_image_saver_XXXXXX";
+            ASSERT_NE(mkdtemp(path), nullptr);
+            directory = path;
+            saver.setCallback([this](const std::string &fileName, int error)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                saved.push_back(fileName);
+                errors.push_back(error);
+            });
+        }
+
+        void TearDown() override
+        {
+            saver.flush();
+            DIR *dir = opendir(directory.c_str());
+            if (dir == nullptr)
+                return;
+            struct dirent *entry;
+            while ((entry = readdir(dir)) != nullptr)
+                if (entry->d_name[0] != '.')
+                    unlink((directory + "/" + entry->d_name).c_str());
+            closedir(dir);
+            rmdir(directory.c_str());
+        }
+
+        // Save an image and return the name it was written to.
+        std::string save(const std::string &prefix, const std::string &data = "SIMPLE")
+        {
+            EXPECT_TRUE(saver.save(directory, prefix, ".fits", data.data(), data.size()));
+            saver.flush();
+            std::lock_guard<std::mutex> lock(mutex);
+            EXPECT_FALSE(saved.empty());
+            if (saved.empty())
+                return std::string();
+            EXPECT_EQ(errors.back(), 0);
+            return saved.back();
+        }
+
+        void create(const std::string &name, const std::string &data)
+        {
+            std::ofstream(directory + "/" + name) << data;
+        }
+
+        std::string read(const std::string &fileName)
+        {
+            std::ifstream file(fileName);
+            return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+    protected:
+        INDI::ImageSaver saver;
+        std::string directory;
+        std::mutex mutex;
+        std::vector<std::string> saved;
+        std::vector<int> errors;
+};
+
+TEST_F(ImageSaverTest, Test_NameTemplate)
+{
+    EXPECT_EQ(save("IMAGE_XXX", "first"), directory + "/IMAGE_001.fits");
+    EXPECT_EQ(read(directory + "/IMAGE_001.fits"), "first");
+
+    std::string name = save("LIGHT_ISO8601");
+    EXPECT_TRUE(std::regex_match(name, std::regex(".*/LIGHT_\\d{4}-\\d{2}-\\d{2}T\\d{2}-\\d{2}-\\d{2}\\.\\d{3}\\.fits")))
+            << name;
+
+    name = save("M42_ISO8601_XXX");
+    EXPECT_TRUE(std::regex_match(name, std::regex(".*/M42_\\d{4}-\\d{2}-\\d{2}T\\d{2}-\\d{2}-\\d{2}\\.\\d{3}_001\\.fits")))
+            << name;
+
+    // Without placeholders the same file is overwritten.
+    EXPECT_EQ(save("FIXED", "one"), directory + "/FIXED.fits");
+    EXPECT_EQ(save("FIXED", "two"), directory + "/FIXED.fits");
+    EXPECT_EQ(read(directory + "/FIXED.fits"), "two");
+}
+
+// The directory is scanned once, then indexes are counted in memory until the cache is cleared.
+TEST_F(ImageSaverTest, Test_IndexCache)
+{
+    create("IMAGE_007.fits", "old");
+    EXPECT_EQ(save("IMAGE_XXX"), directory + "/IMAGE_008.fits");
+
+    create("IMAGE_020.fits", "old");
+    EXPECT_EQ(save("IMAGE_XXX"), directory + "/IMAGE_009.fits");
+
+    saver.clearIndexCache();
+    EXPECT_EQ(save("IMAGE_XXX"), directory + "/IMAGE_021.fits");
+
+    // Another prefix in the same directory has its own index.
+    EXPECT_EQ(save("DARK_XXX"), directory + "/DARK_001.fits");
+}
+
+// Files created by somebody else after the scan are skipped, never overwritten.
+TEST_F(ImageSaverTest, Test_Collision)
+{
+    EXPECT_EQ(save("IMAGE_XXX"), directory + "/IMAGE_001.fits");
+
+    create("IMAGE_002.fits", "other");
+    create("IMAGE_003.fits", "other");
+    EXPECT_EQ(save("IMAGE_XXX", "new"), directory + "/IMAGE_004.fits");
+    EXPECT_EQ(read(directory + "/IMAGE_002.fits"), "other");
+    EXPECT_EQ(read(directory + "/IMAGE_003.fits"), "other");
+    EXPECT_EQ(read(directory + "/IMAGE_004.fits"), "new");
+}
+
+// A removed directory is created again and scanned from the start.
+TEST_F(ImageSaverTest, Test_RemovedDirectory)
+{
+    EXPECT_EQ(save("IMAGE_XXX"), directory + "/IMAGE_001.fits");
+    unlink((directory + "/IMAGE_001.fits").c_str());
+    ASSERT_EQ(rmdir(directory.c_str()), 0);
+
+    EXPECT_EQ(save("IMAGE_XXX"), directory + "/IMAGE_001.fits");
+    struct stat st;
+    EXPECT_EQ(stat((directory + "/IMAGE_001.fits").c_str(), &st), 0);
+}
@@ -0,0 +1,122 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "indirawroi.h"
+
+static INDI::RawROIHeader makeHeader(uint8_t bpp)
+{
+    INDI::RawROIHeader header;
+    header.x        = 100;
+    header.y        = 200;
+    header.width    = 64;
+    header.height   = 48;
+    header.binX     = 2;
+    header.binY     = 2;
+    header.bpp      = bpp;
+    header.exposure = 0.5;
+    return header;
+}
+
+// Star field drifting slowly on a noisy background.
+static std::vector<uint16_t> makeFrame(const INDI::RawROIHeader &header, int frame)
+{
+    std::vector<uint16_t> pixels(header.width * header.height);
+    for (uint32_t y = 0; y < header.height; y++)
+        for (uint32_t x = 0; x < header.width; x++)
+        {
+            int dx = x - 32 - frame, dy = y - 24;
+            int value = 1000 + ((x * 7 + y * 13 + frame * 17) % 23) + (dx * dx + dy * dy < 9 ? 60000 : 0);
+            pixels[y * header.width + x] = static_cast<uint16_t>(value);
+        }
+    return pixels;
+}
+
+static void roundTrip(bool delta, bool compression, uint8_t bpp)
+{
+    INDI::RawROIEncoder encoder;
+    INDI::RawROIDecoder decoder;
+    encoder.setDelta(delta);
+    encoder.setCompression(compression);
+    encoder.setKeyFrameInterval(3);
+
+    INDI::RawROIHeader header = makeHeader(bpp);
+    for (int frame = 0; frame < 8; frame++)
+    {
+        std::vector<uint16_t> pixels = makeFrame(header, frame);
+        std::vector<uint8_t> bytes;
+        if (bpp == 8)
+            for (uint16_t value : pixels)
+                bytes.push_back(static_cast<uint8_t>(value));
+        else
+            bytes.assign(reinterpret_cast<uint8_t *>(pixels.data()), reinterpret_cast<uint8_t *>(pixels.data() + pixels.size()));
+
+        ASSERT_TRUE(encoder.encode(bytes.data(), header));
+        ASSERT_TRUE(decoder.decode(encoder.data(), encoder.size()));
+
+        const INDI::RawROIHeader &decoded = decoder.header();
+        EXPECT_TRUE(decoded.isCompatible(header));
+        EXPECT_EQ(decoded.sequence, static_cast<uint32_t>(frame + 1));
+        EXPECT_DOUBLE_EQ(decoded.exposure, 0.5);
+        EXPECT_EQ(static_cast<bool>(decoded.flags & INDI::RawROIHeader::FLAG_DELTA), delta && frame % 4 != 0);
+        ASSERT_EQ(decoder.pixelBytes(), bytes.size());
+        EXPECT_EQ(memcmp(decoder.pixels(), bytes.data(), bytes.size()), 0);
+    }
+}
+
+TEST(CORE_RAW_ROI, Test_RoundTrip)
+{
+    for (uint8_t bpp : {8, 16})
+        for (bool delta : {false, true})
+            for (bool compression : {false, true})
+                roundTrip(delta, compression, bpp);
+}
+
+TEST(CORE_RAW_ROI, Test_MissingReference)
+{
+    INDI::RawROIEncoder encoder;
+    INDI::RawROIDecoder decoder;
+    encoder.setDelta(true);
+
+    INDI::RawROIHeader header = makeHeader(16);
+    std::vector<uint16_t> pixels = makeFrame(header, 0);
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(pixels.data());
+
+    // The decoder joins after the key frame, deltas are rejected until the next key frame.
+    ASSERT_TRUE(encoder.encode(bytes, header));
+    ASSERT_TRUE(encoder.encode(bytes, header));
+    EXPECT_FALSE(decoder.decode(encoder.data(), encoder.size()));
+
+    // A change of geometry starts with a key frame.
+    header.x += 8;
+    ASSERT_TRUE(encoder.encode(bytes, header));
+    EXPECT_TRUE(decoder.decode(encoder.data(), encoder.size()));
+    EXPECT_FALSE(decoder.header().flags & INDI::RawROIHeader::FLAG_DELTA);
+}
+
+TEST(CORE_RAW_ROI, Test_InvalidData)
+{
+    INDI::RawROIDecoder decoder;
+    std::vector<uint8_t> data(INDI::RawROIHeader::SIZE, 0);
+    EXPECT_FALSE(decoder.decode(data.data(), data.size()));
+    EXPECT_FALSE(decoder.decode(data.data(), 4));
+}
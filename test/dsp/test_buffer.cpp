@@ -0,0 +1,377 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "dsp.h"
+#include "test/test_helpers.h"
+
+static const int lengths[] = {1, 7, 16, 17, 33, 1001};
+
+static std::vector<dsp_t> randomValues(int len, std::mt19937 &generator)
+{
+    std::uniform_real_distribution<double> distribution(0.5, 100.0);
+    std::vector<dsp_t> values(len);
+    for (auto &value : values)
+        value = distribution(generator);
+    return values;
+}
+
+TEST(DSP_BUFFER, Test_Precision)
+{
+#ifdef DSP_SINGLE_PRECISION
+    EXPECT_EQ(sizeof(dsp_t), sizeof(float));
+#else
+    EXPECT_EQ(sizeof(dsp_t), sizeof(double));
+#endif
+}
+
+// Every element wise operation gives the same result of a plain scalar loop.
+TEST(DSP_BUFFER, Test_Arithmetic)
+{
+    typedef void (*BufferFunction)(dsp_stream_p, dsp_t *, int);
+    typedef void (*ValueFunction)(dsp_stream_p, double);
+    const struct
+    {
+        const char *name;
+        BufferFunction function;
+        std::function<dsp_t(dsp_t, dsp_t)> reference;
+    } buffers[] =
+    {
+        { "sum", dsp_buffer_sum, [](dsp_t a, dsp_t b) { return (dsp_t)(a + b); } },
+        { "sub", dsp_buffer_sub, [](dsp_t a, dsp_t b) { return (dsp_t)(a - b); } },
+        { "mul", dsp_buffer_mul, [](dsp_t a, dsp_t b) { return (dsp_t)(a * b); } },
+        { "div", dsp_buffer_div, [](dsp_t a, dsp_t b) { return (dsp_t)(a / b); } },
+        { "min", dsp_buffer_min, [](dsp_t a, dsp_t b) { return a < b ? a : b; } },
+        { "max", dsp_buffer_max, [](dsp_t a, dsp_t b) { return a > b ? a : b; } },
+        { "pow", dsp_buffer_pow, [](dsp_t a, dsp_t b) { return (dsp_t)pow((double)a, (double)b); } },
+        { "log", dsp_buffer_log, [](dsp_t a, dsp_t b) { return (dsp_t)(log((double)a) / log((double)b)); } },
+    };
+    const struct
+    {
+        const char *name;
+        ValueFunction function;
+        std::function<dsp_t(dsp_t, double)> reference;
+    } values[] =
+    {
+        { "1div", dsp_buffer_1div, [](dsp_t a, double v) { return (dsp_t)(v / a); } },
+        { "div1", dsp_buffer_div1, [](dsp_t a, double v) { return (dsp_t)(a / v); } },
+        { "mul1", dsp_buffer_mul1, [](dsp_t a, double v) { return (dsp_t)(a * v); } },
+        { "pow1", dsp_buffer_pow1, [](dsp_t a, double v) { return (dsp_t)pow((double)a, v); } },
+        { "log1", dsp_buffer_log1, [](dsp_t a, double v) { return (dsp_t)(log((double)a) / log(v)); } },
+    };
+
+    std::mt19937 generator(7);
+    for (int len : lengths)
+    {
+        auto a = randomValues(len, generator);
+        auto b = randomValues(len, generator);
+        for (const auto &test : buffers)
+        {
+            dsp_stream_p stream = newStream({len}, a);
+            test.function(stream, b.data(), len);
+            for (int i = 0; i < len; i++)
+                ASSERT_EQ(stream->buf[i], test.reference(a[i], b[i])) << test.name << " len " << len << " at " << i;
+            freeStream(stream);
+        }
+        for (const auto &test : values)
+        {
+            dsp_stream_p stream = newStream({len}, a);
+            test.function(stream, 3.7);
+            for (int i = 0; i < len; i++)
+                ASSERT_EQ(stream->buf[i], test.reference(a[i], 3.7)) << test.name << " len " << len << " at " << i;
+            freeStream(stream);
+        }
+
+        // Operands shorter than the stream leave the remaining elements untouched
+        dsp_stream_p stream = newStream({len}, a);
+        dsp_buffer_sum(stream, b.data(), len / 2);
+        for (int i = 0; i < len; i++)
+            ASSERT_EQ(stream->buf[i], i < len / 2 ? (dsp_t)(a[i] + b[i]) : a[i]);
+        // The operand can be the stream buffer itself
+        dsp_buffer_copy(a.data(), stream->buf, len);
+        dsp_buffer_mul(stream, stream->buf, len);
+        for (int i = 0; i < len; i++)
+            ASSERT_EQ(stream->buf[i], (dsp_t)(a[i] * a[i]));
+        freeStream(stream);
+    }
+}
+
+// The extremes are found wherever they are, also within the elements after the last full block.
+template <typename T>
+static void checkMinMax()
+{
+    for (int len : lengths)
+        for (int at = 0; at < len; at++)
+        {
+            std::vector<T> buf(len);
+            for (int i = 0; i < len; i++)
+                buf[i] = (T)(50 + (i * 7) % 13);
+            buf[at] = (T)10;
+            ASSERT_EQ(dsp_stats_min(buf.data(), len), (T)10) << "len " << len << " at " << at;
+            buf[at] = (T)90;
+            ASSERT_EQ(dsp_stats_max(buf.data(), len), (T)90) << "len " << len << " at " << at;
+        }
+}
+
+TEST(DSP_BUFFER, Test_MinMax)
+{
+    checkMinMax<dsp_t>();
+    checkMinMax<float>();
+    checkMinMax<double>();
+    checkMinMax<uint8_t>();
+    checkMinMax<uint16_t>();
+    checkMinMax<int32_t>();
+
+    std::vector<dsp_t> negative = {-3, -1, -7, -2};
+    EXPECT_EQ(dsp_stats_min(negative.data(), 4), -7);
+    EXPECT_EQ(dsp_stats_max(negative.data(), 4), -1);
+}
+
+TEST(DSP_BUFFER, Test_Stretch)
+{
+    std::mt19937 generator(11);
+    for (int len : lengths)
+    {
+        auto buf = randomValues(len, generator);
+        dsp_t mn = buf[0], mx = buf[0];
+        for (auto value : buf)
+        {
+            mn = std::min(mn, value);
+            mx = std::max(mx, value);
+        }
+        double iratio = mx - mn;
+        if (iratio == 0)
+            iratio = 1;
+        std::vector<dsp_t> expected(buf);
+        for (auto &value : expected)
+        {
+            value -= mn;
+            value = (dsp_t)((double)value * (dsp_t)(1000 - 0) / iratio);
+        }
+        dsp_buffer_stretch(buf.data(), len, (dsp_t)0, (dsp_t)1000);
+        for (int i = 0; i < len; i++)
+            ASSERT_EQ(buf[i], expected[i]) << "len " << len << " at " << i;
+    }
+}
+
+// Samples of the window of an element of a 2D frame that are inside of it.
+static std::vector<dsp_t> window(const std::vector<dsp_t> &frame, int width, int height, int x, int y, int size)
+{
+    std::vector<dsp_t> samples;
+    for (int j = y - size / 2; j < y - size / 2 + size; j++)
+        for (int i = x - size / 2; i < x - size / 2 + size; i++)
+            if (i >= 0 && i < width && j >= 0 && j < height)
+                samples.push_back(frame[j * width + i]);
+    return samples;
+}
+
+static std::vector<dsp_t> noiseFrame(int width, int height, double step, std::mt19937 &generator)
+{
+    std::normal_distribution<double> noise(1000, 40);
+    std::vector<dsp_t> frame(width * height);
+    for (auto &value : frame)
+        value = std::floor(noise(generator)) + step;
+    // Hot pixels
+    for (int i = 0; i < width * height; i += 37)
+        frame[i] = 60000 + step;
+    return frame;
+}
+
+static std::vector<dsp_t> filter(const std::vector<dsp_t> &frame, int width, int height, std::function<void(dsp_stream_p)> function)
+{
+    dsp_stream_p stream = newStream({width, height}, frame);
+    function(stream);
+    std::vector<dsp_t> out(stream->buf, stream->buf + stream->len);
+    freeStream(stream);
+    return out;
+}
+
+// Integer frames go through the sliding histogram, the others sort each window: both give the
+// sample of the window with the rank scaled to the samples inside the frame.
+TEST(DSP_BUFFER, Test_Median)
+{
+    const int width = 37, height = 23;
+    std::mt19937 generator(5);
+    for (double step : {0.0, 0.25})
+    {
+        auto frame = noiseFrame(width, height, step, generator);
+        for (int threads : {1, 3})
+        {
+            dsp_max_threads(threads);
+            for (int size : {1, 2, 3, 5, 8})
+                for (int median : {0, size / 2, size - 1})
+                {
+                    auto out = filter(frame, width, height, [&](dsp_stream_p stream)
+                    {
+                        dsp_buffer_median(stream, size, median);
+                    });
+                    for (int y = 0; y < height; y++)
+                        for (int x = 0; x < width; x++)
+                        {
+                            auto samples = window(frame, width, height, x, y, size);
+                            std::sort(samples.begin(), samples.end());
+                            int n = samples.size();
+                            ASSERT_EQ(out[y * width + x], samples[std::max(0, std::min(n - 1, median * n / size))])
+                                    << "step " << step << " size " << size << " median " << median << " at " << x << "," << y;
+                        }
+                }
+        }
+    }
+}
+
+// The sigma of each window is the mean absolute deviation of dsp_stats_stddev.
+TEST(DSP_BUFFER, Test_Sigma)
+{
+    const int width = 29, height = 31;
+    std::mt19937 generator(9);
+    for (double step : {0.0, 0.5})
+    {
+        auto frame = noiseFrame(width, height, step, generator);
+        for (int threads : {1, 3})
+        {
+            dsp_max_threads(threads);
+            for (int size : {1, 2, 3, 6})
+            {
+                auto out = filter(frame, width, height, [&](dsp_stream_p stream)
+                {
+                    dsp_buffer_sigma(stream, size);
+                });
+                for (int y = 0; y < height; y++)
+                    for (int x = 0; x < width; x++)
+                    {
+                        auto samples = window(frame, width, height, x, y, size);
+                        double mean = 0, deviation = 0;
+                        for (auto value : samples)
+                            mean += value;
+                        mean /= samples.size();
+                        for (auto value : samples)
+                            deviation += std::fabs(value - mean);
+                        deviation /= samples.size();
+                        ASSERT_NEAR(out[y * width + x], deviation, 1e-6 * deviation + 1e-9)
+                                << "step " << step << " size " << size << " at " << x << "," << y;
+                    }
+            }
+        }
+    }
+}
+
+// Streams with other than two dimensions clip the windows in every dimension.
+TEST(DSP_BUFFER, Test_Median3D)
+{
+    const int sizes[3] = {6, 5, 4};
+    dsp_stream_p stream = newStream({sizes[0], sizes[1], sizes[2]});
+    std::vector<dsp_t> frame(stream->len);
+    for (int i = 0; i < stream->len; i++)
+        frame[i] = (i * 7919) % 101;
+    std::copy(frame.begin(), frame.end(), stream->buf);
+    dsp_buffer_median(stream, 3, 1);
+    for (int z = 0; z < sizes[2]; z++)
+        for (int y = 0; y < sizes[1]; y++)
+            for (int x = 0; x < sizes[0]; x++)
+            {
+                std::vector<dsp_t> samples;
+                for (int k = z - 1; k <= z + 1; k++)
+                    for (int j = y - 1; j <= y + 1; j++)
+                        for (int i = x - 1; i <= x + 1; i++)
+                            if (i >= 0 && i < sizes[0] && j >= 0 && j < sizes[1] && k >= 0 && k < sizes[2])
+                                samples.push_back(frame[(k * sizes[1] + j) * sizes[0] + i]);
+                std::sort(samples.begin(), samples.end());
+                int n = samples.size();
+                ASSERT_EQ(stream->buf[(z * sizes[1] + y) * sizes[0] + x], samples[std::min(n - 1, n / 3)]);
+            }
+    freeStream(stream);
+}
+
+TEST(DSP_BUFFER, DISABLED_Benchmark_Frame)
+{
+    const int width = 3840, height = 2160, len = width * height;
+    std::mt19937 generator(3);
+    auto frame = randomValues(len, generator);
+    dsp_stream_p stream = newStream({len}, frame);
+
+    volatile dsp_t sink = 0;
+    double scalarMin = bestTime([&]()
+    {
+        dsp_t mn = frame[0];
+        for (int i = 0; i < len; i++)
+            mn = frame[i] < mn ? frame[i] : mn;
+        sink = mn;
+    });
+    double minmax = bestTime([&]()
+    {
+        sink = dsp_stats_min(stream->buf, len);
+        sink = dsp_stats_max(stream->buf, len);
+    }) / 2;
+    double sum = bestTime([&]()
+    {
+        dsp_buffer_sum(stream, frame.data(), len);
+    });
+    double mul = bestTime([&]()
+    {
+        dsp_buffer_mul1(stream, 0.5);
+    });
+    (void)sink;
+    freeStream(stream);
+
+    printf("%dx%d, %zu byte samples: min %.2f ms (scalar loop %.2f ms), sum %.2f ms, mul1 %.2f ms\n", width, height,
+           sizeof(dsp_t), minmax, scalarMin, sum, mul);
+}
+
+TEST(DSP_BUFFER, DISABLED_Benchmark_Median)
+{
+    const int width = 512, height = 512;
+    std::mt19937 generator(13);
+    // Time a single thread, the other tests of the process keep their limit
+    unsigned long threads = dsp_max_threads(0);
+    dsp_max_threads(1);
+    for (int size : {3, 5, 9})
+    {
+        double times[2][2];
+        for (int step = 0; step < 2; step++)
+        {
+            // Integer samples are filtered through the histogram, the others by sorting the windows
+            auto frame = noiseFrame(width, height, step * 0.5, generator);
+            times[step][0] = bestTime([&]()
+            {
+                filter(frame, width, height, [&](dsp_stream_p stream)
+                {
+                    dsp_buffer_median(stream, size, size / 2);
+                });
+            });
+            times[step][1] = bestTime([&]()
+            {
+                filter(frame, width, height, [&](dsp_stream_p stream)
+                {
+                    dsp_buffer_sigma(stream, size);
+                });
+            });
+        }
+        printf("%dx%d, %dx%d window: median %.1f ms (sorted %.1f ms), sigma %.1f ms (scanned %.1f ms)\n", width, height, size, size,
+               times[0][0], times[1][0], times[0][1], times[1][1]);
+    }
+    dsp_max_threads(threads);
+}
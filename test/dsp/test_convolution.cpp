@@ -0,0 +1,226 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "dsp.h"
+#include "test/test_helpers.h"
+
+static const double tolerance = sizeof(dsp_t) == sizeof(float) ? 5e-2 : 1e-6;
+
+static dsp_stream_p randomStream(const std::vector<int> &sizes, double low, double high, std::mt19937 &random)
+{
+    std::uniform_real_distribution<double> value(low, high);
+    dsp_stream_p stream = newStream(sizes);
+    for (int i = 0; i < stream->len; i++)
+        stream->buf[i] = value(random);
+    return stream;
+}
+
+static dsp_stream_p gaussianMatrix(int size)
+{
+    dsp_stream_p matrix = newStream({size, size});
+    double sigma = size / 4.0;
+    for (int y = 0; y < size; y++)
+        for (int x = 0; x < size; x++)
+            matrix->buf[x + y * size] = std::exp(-(std::pow(x - size / 2, 2) + std::pow(y - size / 2, 2)) / (2 * sigma * sigma));
+    return matrix;
+}
+
+// Zero padded convolution, or correlation, with the matrix centered at the half of its sizes, stretched to the input range.
+static std::vector<dsp_t> reference(dsp_stream_p stream, dsp_stream_p matrix, bool correlation)
+{
+    std::vector<double> out(stream->len, 0);
+    std::vector<int> pos(stream->dims), in(stream->dims);
+    for (int i = 0; i < stream->len; i++)
+    {
+        for (int d = 0, p = i; d < stream->dims; p /= stream->sizes[d], d++)
+            pos[d] = p % stream->sizes[d];
+        for (int m = 0; m < matrix->len; m++)
+        {
+            int index = 0, stride = 1;
+            bool inside = true;
+            for (int d = 0, q = m; d < stream->dims; d++)
+            {
+                int size = d < matrix->dims ? matrix->sizes[d] : 1;
+                int k = q % size;
+                q /= size;
+                in[d] = correlation ? pos[d] + k - size / 2 : pos[d] + size / 2 - k;
+                inside = inside && in[d] >= 0 && in[d] < stream->sizes[d];
+                index += in[d] * stride;
+                stride *= stream->sizes[d];
+            }
+            if (inside)
+                out[i] += stream->buf[index] * matrix->buf[m];
+        }
+    }
+    std::vector<dsp_t> result(out.begin(), out.end());
+    dsp_t mn = dsp_stats_min(stream->buf, stream->len);
+    dsp_t mx = dsp_stats_max(stream->buf, stream->len);
+    dsp_buffer_stretch(result.data(), stream->len, mn, mx);
+    return result;
+}
+
+static void expectConvolution(dsp_stream_p stream, dsp_stream_p matrix, bool correlation)
+{
+    auto expected = reference(stream, matrix, correlation);
+    if (correlation)
+        dsp_convolution_correlation(stream, matrix);
+    else
+        dsp_convolution_convolution(stream, matrix);
+    for (int i = 0; i < stream->len; i++)
+        ASSERT_NEAR(stream->buf[i], expected[i], tolerance) << "at " << i;
+}
+
+TEST(DSP_CONVOLUTION, Test_Direct)
+{
+    std::mt19937 random(1);
+    dsp_stream_p stream = randomStream({32, 24}, 0, 255, random);
+    dsp_stream_p matrix = randomStream({3, 3}, -1, 1, random);
+    expectConvolution(stream, matrix, false);
+    freeStream(matrix);
+    freeStream(stream);
+}
+
+// Gaussian matrices are applied as a row and a column.
+TEST(DSP_CONVOLUTION, Test_Separable)
+{
+    std::mt19937 random(2);
+    for (int size : {5, 21})
+    {
+        dsp_stream_p stream = randomStream({40, 30}, 0, 255, random);
+        dsp_stream_p matrix = gaussianMatrix(size);
+        expectConvolution(stream, matrix, false);
+        freeStream(matrix);
+        freeStream(stream);
+    }
+}
+
+// A one dimensional matrix is applied along the rows of a frame.
+TEST(DSP_CONVOLUTION, Test_Rows)
+{
+    std::mt19937 random(3);
+    dsp_stream_p stream = randomStream({50, 20}, 0, 255, random);
+    dsp_stream_p matrix = randomStream({31}, -1, 1, random);
+    expectConvolution(stream, matrix, false);
+    freeStream(matrix);
+    freeStream(stream);
+}
+
+TEST(DSP_CONVOLUTION, Test_EvenSizes)
+{
+    std::mt19937 random(4);
+    for (bool correlation : {false, true})
+    {
+        dsp_stream_p stream = randomStream({27, 19}, 0, 255, random);
+        dsp_stream_p matrix = randomStream({4, 3}, -1, 1, random);
+        expectConvolution(stream, matrix, correlation);
+        freeStream(matrix);
+        freeStream(stream);
+    }
+}
+
+TEST(DSP_CONVOLUTION, Test_Correlation)
+{
+    std::mt19937 random(5);
+    dsp_stream_p stream = randomStream({32, 24}, 0, 255, random);
+    dsp_stream_p matrix = randomStream({5, 3}, 0, 1, random);
+    expectConvolution(stream, matrix, true);
+    freeStream(matrix);
+    freeStream(stream);
+}
+
+TEST(DSP_CONVOLUTION, Test_Cube)
+{
+    std::mt19937 random(6);
+    dsp_stream_p stream = randomStream({12, 10, 6}, 0, 255, random);
+    dsp_stream_p matrix = randomStream({3, 3, 3}, -1, 1, random);
+    expectConvolution(stream, matrix, false);
+    freeStream(matrix);
+    freeStream(stream);
+}
+
+// Large matrices that are not separable go through the transforms.
+TEST(DSP_CONVOLUTION, Test_Transform)
+{
+    std::mt19937 random(7);
+    for (bool correlation : {false, true})
+    {
+        dsp_stream_p stream = randomStream({40, 30}, 0, 255, random);
+        dsp_stream_p matrix = randomStream({15, 14}, -1, 1, random);
+        expectConvolution(stream, matrix, correlation);
+        freeStream(matrix);
+        freeStream(stream);
+    }
+}
+
+// Rows longer than a tile are cut in several transforms.
+TEST(DSP_CONVOLUTION, Test_Tiles)
+{
+    std::mt19937 random(8);
+    dsp_stream_p stream = randomStream({600, 3}, 0, 255, random);
+    dsp_stream_p matrix = randomStream({5, 2}, -1, 1, random);
+    auto expected = reference(stream, matrix, false);
+    dsp_t mn = dsp_stats_min(stream->buf, stream->len);
+    dsp_t mx = dsp_stats_max(stream->buf, stream->len);
+    dsp_fourier_convolution(stream, matrix);
+    dsp_buffer_stretch(stream->buf, stream->len, mn, mx);
+    for (int i = 0; i < stream->len; i++)
+        ASSERT_NEAR(stream->buf[i], expected[i], tolerance) << "at " << i;
+    freeStream(matrix);
+    freeStream(stream);
+}
+
+TEST(DSP_CONVOLUTION, DISABLED_Benchmark_Kernels)
+{
+    const int width = 1024, height = 1024;
+    std::mt19937 random(9);
+    dsp_stream_p stream = randomStream({width, height}, 0, 255, random);
+
+    // Every convolution used to cost a forward and an inverse transform of the whole frame
+    double transform = bestTime([&]()
+    {
+        dsp_fourier_dft(stream, 1);
+        dsp_fourier_idft(stream);
+    }, 3);
+    printf("%dx%d forward and inverse transform: %.1f ms\n", width, height, transform);
+    for (int size : {3, 5, 9, 15, 31})
+    {
+        dsp_stream_p matrix = randomStream({size, size}, 0, 1, random);
+        dsp_stream_p gaussian = gaussianMatrix(size);
+        double times[2];
+        times[0] = bestTime([&]()
+        {
+            dsp_convolution_convolution(stream, matrix);
+        }, 3);
+        times[1] = bestTime([&]()
+        {
+            dsp_convolution_convolution(stream, gaussian);
+        }, 3);
+        printf("%dx%d, %dx%d matrix: %.1f ms, gaussian %.1f ms\n", width, height, size, size, times[0], times[1]);
+        freeStream(gaussian);
+        freeStream(matrix);
+    }
+    freeStream(stream);
+}
@@ -0,0 +1,263 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "dsp.h"
+#include "test/test_helpers.h"
+
+// Component of the filter at a pixel: 0 red, 1 green, 2 blue.
+static int filterColor(int x, int y, dsp_bayer_pattern pattern)
+{
+    int redX = pattern & 1, redY = pattern >> 1;
+    int isRedColumn = ((x ^ redX) & 1) == 0, isRedRow = ((y ^ redY) & 1) == 0;
+    if (isRedColumn != isRedRow)
+        return 1;
+    return isRedRow ? 0 : 2;
+}
+
+static int mirror(int i, int n)
+{
+    if (i < 0)
+        i = -i;
+    if (i >= n)
+        i = 2 * (n - 1) - i;
+    return std::min(std::max(i, 0), n - 1);
+}
+
+// Scalar reference, each pixel computed from its neighbours with the filters of both methods.
+template <typename T>
+static void referenceDemosaic(const std::vector<T> &raw, int width, int height, dsp_bayer_pattern pattern,
+                              dsp_demosaic_method method, double maximum, std::vector<double> &rgb)
+{
+    auto p = [&](int x, int y)
+    {
+        return static_cast<double>(raw[mirror(y, height) * width + mirror(x, width)]);
+    };
+
+    rgb.assign(3 * width * height, 0);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+        {
+            double *out = &rgb[3 * (y * width + x)];
+            int color = filterColor(x, y, pattern);
+            double c = p(x, y);
+            double cross = p(x - 1, y) + p(x + 1, y) + p(x, y - 1) + p(x, y + 1);
+            double diagonal = p(x - 1, y - 1) + p(x + 1, y - 1) + p(x - 1, y + 1) + p(x + 1, y + 1);
+            double horizontal = p(x - 1, y) + p(x + 1, y), vertical = p(x, y - 1) + p(x, y + 1);
+            double horizontalFar = p(x - 2, y) + p(x + 2, y), verticalFar = p(x, y - 2) + p(x, y + 2);
+
+            if (color != 1)
+            {
+                out[color] = c;
+                if (method == DSP_DEMOSAIC_MHC)
+                {
+                    out[1] = (4 * c + 2 * cross - horizontalFar - verticalFar) / 8;
+                    out[2 - color] = (6 * c + 2 * diagonal - 1.5 * (horizontalFar + verticalFar)) / 8;
+                }
+                else
+                {
+                    out[1] = cross / 4;
+                    out[2 - color] = diagonal / 4;
+                }
+            }
+            else
+            {
+                // Component found left and right of this green pixel.
+                int side = filterColor(x + 1, y, pattern);
+                out[1] = c;
+                if (method == DSP_DEMOSAIC_MHC)
+                {
+                    out[side] = (5 * c - diagonal + 4 * horizontal - horizontalFar + 0.5 * verticalFar) / 8;
+                    out[2 - side] = (5 * c - diagonal + 4 * vertical - verticalFar + 0.5 * horizontalFar) / 8;
+                }
+                else
+                {
+                    out[side] = horizontal / 2;
+                    out[2 - side] = vertical / 2;
+                }
+            }
+        }
+
+    if (maximum > 0)
+        for (auto &value : rgb)
+            value = std::floor(std::min(std::max(value + 0.5, 0.0), maximum + 0.5));
+}
+
+template <typename T>
+static std::vector<T> randomFrame(size_t size, int maximum, std::mt19937 &random)
+{
+    std::uniform_int_distribution<int> value(0, maximum);
+    std::vector<T> frame(size);
+    for (auto &pixel : frame)
+        pixel = value(random);
+    return frame;
+}
+
+TEST(DSP_DEMOSAIC, Test_FlatField)
+{
+    const int width = 16, height = 12;
+    const uint8_t levels[3] = {200, 100, 50};
+
+    for (int pattern = DSP_BAYER_RGGB; pattern <= DSP_BAYER_BGGR; pattern++)
+        for (auto method : {DSP_DEMOSAIC_BILINEAR, DSP_DEMOSAIC_MHC})
+        {
+            std::vector<uint8_t> raw(width * height), rgb(3 * width * height);
+            for (int y = 0; y < height; y++)
+                for (int x = 0; x < width; x++)
+                    raw[y * width + x] = levels[filterColor(x, y, static_cast<dsp_bayer_pattern>(pattern))];
+
+            dsp_demosaic_8(raw.data(), width, rgb.data(), 3 * width, width, height, static_cast<dsp_bayer_pattern>(pattern),
+                           method, 1);
+            for (int i = 0; i < width * height; i++)
+                for (int c = 0; c < 3; c++)
+                    ASSERT_EQ(rgb[3 * i + c], levels[c]) << "pattern " << pattern << " pixel " << i;
+        }
+}
+
+TEST(DSP_DEMOSAIC, Test_Reference8)
+{
+    // Odd sizes, frames smaller than the kernel and enough rows for several threads.
+    const int sizes[][2] = {{37, 21}, {3, 3}, {2, 2}, {1, 5}, {64, 300}};
+    std::mt19937 random(1);
+
+    for (const auto &size : sizes)
+    {
+        const int width = size[0], height = size[1];
+        // Rows of the raw frame are padded.
+        const int stride = width + 5;
+        std::vector<uint8_t> frame = randomFrame<uint8_t>(width * height, 255, random);
+        std::vector<uint8_t> padded(stride * height);
+        for (int y = 0; y < height; y++)
+            std::copy(frame.begin() + y * width, frame.begin() + (y + 1) * width, padded.begin() + y * stride);
+
+        for (int pattern = DSP_BAYER_RGGB; pattern <= DSP_BAYER_BGGR; pattern++)
+            for (auto method : {DSP_DEMOSAIC_BILINEAR, DSP_DEMOSAIC_MHC})
+                for (int threads : {1, 4})
+                {
+                    std::vector<double> expected;
+                    referenceDemosaic(frame, width, height, static_cast<dsp_bayer_pattern>(pattern), method, 255, expected);
+
+                    std::vector<uint8_t> rgb(3 * width * height);
+                    dsp_demosaic_8(padded.data(), stride, rgb.data(), 3 * width, width, height,
+                                   static_cast<dsp_bayer_pattern>(pattern), method, threads);
+                    for (size_t i = 0; i < rgb.size(); i++)
+                        ASSERT_EQ(rgb[i], expected[i]) << width << "x" << height << " pattern " << pattern << " method "
+                                                       << method << " sample " << i;
+                }
+    }
+}
+
+TEST(DSP_DEMOSAIC, Test_Reference16)
+{
+    const int width = 45, height = 30;
+    std::mt19937 random(2);
+    std::vector<uint16_t> frame = randomFrame<uint16_t>(width * height, 65535, random);
+
+    for (auto method : {DSP_DEMOSAIC_BILINEAR, DSP_DEMOSAIC_MHC})
+    {
+        std::vector<double> expected;
+        referenceDemosaic(frame, width, height, DSP_BAYER_GBRG, method, 65535, expected);
+
+        std::vector<uint16_t> rgb(3 * width * height);
+        dsp_demosaic_16(frame.data(), width, rgb.data(), 3 * width, width, height, DSP_BAYER_GBRG, method, 1);
+        for (size_t i = 0; i < rgb.size(); i++)
+            ASSERT_EQ(rgb[i], expected[i]) << "method " << method << " sample " << i;
+    }
+}
+
+TEST(DSP_DEMOSAIC, Test_ReferenceDsp)
+{
+    const int width = 20, height = 14;
+    std::mt19937 random(3);
+    std::vector<uint8_t> frame = randomFrame<uint8_t>(width * height, 255, random);
+    std::vector<dsp_t> input(frame.begin(), frame.end());
+
+    std::vector<double> expected;
+    referenceDemosaic(frame, width, height, DSP_BAYER_BGGR, DSP_DEMOSAIC_MHC, 0, expected);
+
+    // Values are not clamped, overshoots of the filter are kept.
+    std::vector<dsp_t> rgb(3 * width * height);
+    dsp_demosaic(input.data(), rgb.data(), width, height, DSP_BAYER_BGGR, DSP_DEMOSAIC_MHC, 1);
+    for (size_t i = 0; i < rgb.size(); i++)
+        ASSERT_NEAR(rgb[i], expected[i], 1e-3) << "sample " << i;
+}
+
+// Mosaic of a color image with detail common to all components, as in real scenes. The edge aware
+// method restores it more closely.
+TEST(DSP_DEMOSAIC, Test_Quality)
+{
+    const int width = 128, height = 96;
+    const double gains[3] = {0.9, 1.0, 0.6};
+    std::vector<uint8_t> truth(3 * width * height), raw(width * height);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+        {
+            double detail = 127.5 + 100 * std::sin(0.5 * x + 0.3 * y) * std::cos(0.2 * y);
+            for (int c = 0; c < 3; c++)
+                truth[3 * (y * width + x) + c] = static_cast<uint8_t>(gains[c] * detail + 10 * c);
+            raw[y * width + x] = truth[3 * (y * width + x) + filterColor(x, y, DSP_BAYER_RGGB)];
+        }
+
+    auto error = [&](dsp_demosaic_method method)
+    {
+        std::vector<uint8_t> rgb(3 * width * height);
+        dsp_demosaic_8(raw.data(), width, rgb.data(), 3 * width, width, height, DSP_BAYER_RGGB, method, 1);
+        double sum = 0;
+        for (size_t i = 0; i < rgb.size(); i++)
+            sum += (rgb[i] - truth[i]) * (rgb[i] - truth[i]);
+        return std::sqrt(sum / rgb.size());
+    };
+
+    double bilinear = error(DSP_DEMOSAIC_BILINEAR), mhc = error(DSP_DEMOSAIC_MHC);
+    EXPECT_LT(mhc, bilinear);
+    printf("RMS error: bilinear %.2f, edge aware %.2f\n", bilinear, mhc);
+}
+
+// Not a pass/fail test, reports the time to interpolate 4K camera frames.
+TEST(DSP_DEMOSAIC, DISABLED_Benchmark_4K)
+{
+    const int width = 3840, height = 2160;
+    std::mt19937 random(4);
+    std::vector<uint8_t> raw8 = randomFrame<uint8_t>(width * height, 255, random);
+    std::vector<uint16_t> raw16 = randomFrame<uint16_t>(width * height, 65535, random);
+    std::vector<uint8_t> rgb8(3 * width * height);
+    std::vector<uint16_t> rgb16(3 * width * height);
+
+    for (auto method : {DSP_DEMOSAIC_BILINEAR, DSP_DEMOSAIC_MHC})
+        for (int threads : {1, 4})
+        {
+            double time8 = bestTime([&]()
+            {
+                dsp_demosaic_8(raw8.data(), width, rgb8.data(), 3 * width, width, height, DSP_BAYER_RGGB, method, threads);
+            });
+            double time16 = bestTime([&]()
+            {
+                dsp_demosaic_16(raw16.data(), width, rgb16.data(), 3 * width, width, height, DSP_BAYER_RGGB, method, threads);
+            });
+            printf("%dx%d %s, %d threads: 8 bit %.2f ms, 16 bit %.2f ms\n", width, height,
+                   method == DSP_DEMOSAIC_MHC ? "edge aware" : "bilinear", threads, time8, time16);
+        }
+}
@@ -0,0 +1,141 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "dsp.h"
+#include "test/test_helpers.h"
+
+static dsp_stream_p randomStream(int width, int height, std::mt19937 &random)
+{
+    std::uniform_real_distribution<double> value(0, 255);
+    dsp_stream_p stream = newStream({width, height});
+    for (int i = 0; i < stream->len; i++)
+        stream->buf[i] = value(random);
+    return stream;
+}
+
+static std::vector<double> spectrum(dsp_stream_p stream)
+{
+    return std::vector<double>(stream->dft.buf, stream->dft.buf + 2 * stream->len);
+}
+
+// A cosine along the rows gives the sum of the frame at DC and half of it at its frequency.
+TEST(DSP_FOURIER, Test_Spectrum)
+{
+    const int width = 24, height = 16, frequency = 3;
+    dsp_stream_p stream = newStream({width, height});
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            stream->buf[y * width + x] = 10 + 4 * std::cos(2 * M_PI * frequency * x / width);
+
+    dsp_fourier_dft(stream, 1);
+    // Rows of the half spectrum hold width / 2 + 1 pairs.
+    const int row = width / 2 + 1;
+    // Single precision builds transform in float
+    const double tolerance = sizeof(dsp_t) == sizeof(float) ? 1e-2 : 1e-6;
+    for (int i = 0; i < row * height; i++)
+    {
+        double expected = i == 0 ? 10.0 * width * height : i == frequency ? 2.0 * width * height : 0;
+        ASSERT_NEAR(stream->dft.pairs[i][0], expected, tolerance) << "pair " << i;
+        ASSERT_NEAR(stream->dft.pairs[i][1], 0, tolerance) << "pair " << i;
+    }
+
+    freeStream(stream);
+}
+
+// Transforms reusing a cached plan give the spectrum of a newly made plan.
+TEST(DSP_FOURIER, Test_CachedPlan)
+{
+    std::mt19937 random(2);
+    dsp_stream_p stream = randomStream(20, 12, random);
+
+    dsp_fourier_clear_plans();
+    dsp_fourier_dft(stream, 1);
+    std::vector<double> expected = spectrum(stream);
+    for (int i = 0; i < 3; i++)
+    {
+        dsp_fourier_dft(stream, 1);
+        ASSERT_EQ(spectrum(stream), expected) << "transform " << i;
+    }
+
+    freeStream(stream);
+}
+
+// Threads transforming frames of the same size each get a plan.
+TEST(DSP_FOURIER, Test_ConcurrentTransforms)
+{
+    const int count = 4;
+    std::mt19937 random(3);
+    std::vector<dsp_stream_p> streams;
+    std::vector<std::vector<double>> expected;
+    for (int i = 0; i < count; i++)
+    {
+        streams.push_back(randomStream(16, 16, random));
+        dsp_fourier_dft(streams.back(), 1);
+        expected.push_back(spectrum(streams.back()));
+    }
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < count; i++)
+        threads.emplace_back([&streams, i]()
+        {
+            for (int repeat = 0; repeat < 5; repeat++)
+                dsp_fourier_dft(streams[i], 1);
+        });
+    for (auto &thread : threads)
+        thread.join();
+
+    for (int i = 0; i < count; i++)
+    {
+        EXPECT_EQ(spectrum(streams[i]), expected[i]) << "stream " << i;
+        freeStream(streams[i]);
+    }
+}
+
+// Not a pass/fail test, reports the time of repeated 2D transforms with and without the plan cache.
+TEST(DSP_FOURIER, DISABLED_Benchmark_Repeated2D)
+{
+    const int width = 512, height = 512;
+    std::mt19937 random(4);
+    dsp_stream_p stream = randomStream(width, height, random);
+
+    double cached = bestTime([&]()
+    {
+        dsp_fourier_dft(stream, 1);
+        dsp_fourier_idft(stream);
+    });
+    double planned = bestTime([&]()
+    {
+        dsp_fourier_clear_plans();
+        dsp_fourier_dft(stream, 1);
+        dsp_fourier_clear_plans();
+        dsp_fourier_idft(stream);
+    });
+    printf("%dx%d forward and inverse transform: %.2f ms, planning every transform %.2f ms\n", width, height, cached,
+           planned);
+
+    freeStream(stream);
+}
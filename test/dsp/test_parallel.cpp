@@ -0,0 +1,220 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+#include "dsp.h"
+#include "test/test_helpers.h"
+
+// Counts how many times each item is visited and checks the worker indexes.
+struct Visits
+{
+    std::vector<std::atomic<int>> items;
+    std::atomic<int> badWorker {0};
+    int threads;
+
+    Visits(int count, int threads) : items(count), threads(threads) {}
+
+    static void range(void *arg, int start, int end, int worker)
+    {
+        auto visits = static_cast<Visits *>(arg);
+        if (worker < 0 || worker >= visits->threads)
+            visits->badWorker++;
+        for (int i = start; i < end; i++)
+            visits->items[i]++;
+    }
+};
+
+TEST(DSP_PARALLEL, Test_EveryItemOnce)
+{
+    for (int threads : {1, 2, 4, 3})
+    {
+        dsp_max_threads(threads);
+        for (int count : {1, 2, 3, 7, 100, 1001})
+            for (int chunk : {0, 1, 5, 64})
+            {
+                Visits visits(count, threads);
+                dsp_parallel_for(count, chunk, Visits::range, &visits);
+                EXPECT_EQ(visits.badWorker, 0);
+                for (int i = 0; i < count; i++)
+                    ASSERT_EQ(visits.items[i], 1) << threads << " threads, " << count << " items, chunk " << chunk
+                                                  << ", item " << i;
+            }
+    }
+    dsp_max_threads(1);
+}
+
+static void nestedRange(void *arg, int start, int end, int)
+{
+    auto visits = static_cast<std::vector<std::unique_ptr<Visits>> *>(arg);
+    for (int i = start; i < end; i++)
+        dsp_parallel_for(50, 3, Visits::range, (*visits)[i].get());
+}
+
+// Jobs started from inside a job run on the calling thread instead of waiting for the pool.
+TEST(DSP_PARALLEL, Test_Nested)
+{
+    dsp_max_threads(4);
+    std::vector<std::unique_ptr<Visits>> visits;
+    for (int i = 0; i < 8; i++)
+        visits.emplace_back(new Visits(50, 4));
+    dsp_parallel_for(8, 1, nestedRange, &visits);
+    for (auto &job : visits)
+        for (auto &item : job->items)
+            ASSERT_EQ(item, 1);
+    dsp_max_threads(1);
+}
+
+TEST(DSP_PARALLEL, Test_ConcurrentCallers)
+{
+    dsp_max_threads(4);
+    std::vector<std::thread> callers;
+    std::atomic<int> errors {0};
+    for (int c = 0; c < 4; c++)
+        callers.emplace_back([&errors]()
+        {
+            for (int repeat = 0; repeat < 200; repeat++)
+            {
+                Visits visits(257, 4);
+                dsp_parallel_for(257, repeat % 2 ? 16 : 0, Visits::range, &visits);
+                for (auto &item : visits.items)
+                    if (item != 1)
+                        errors++;
+            }
+        });
+    for (auto &caller : callers)
+        caller.join();
+    EXPECT_EQ(errors, 0);
+    dsp_max_threads(1);
+}
+
+// The results of the stream functions do not depend on the number of threads.
+TEST(DSP_PARALLEL, Test_StreamFunctions)
+{
+    const int width = 37, height = 23;
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> value(0, 255);
+    std::vector<dsp_t> frame(width * height);
+    for (auto &pixel : frame)
+        pixel = value(random);
+
+    auto run = [&](int threads)
+    {
+        dsp_max_threads(threads);
+        dsp_stream_p stream = newStream({width, height}, frame);
+        stream->align_info.center[0] = width / 2;
+        stream->align_info.center[1] = height / 2;
+        stream->align_info.radians[0] = 0.3;
+        dsp_stream_rotate(stream);
+        std::vector<dsp_t> result(stream->buf, stream->buf + stream->len);
+        std::vector<dsp_t> background(4 * 3), noise(4 * 3);
+        dsp_stats_background(stream, 10, background.data(), noise.data());
+        result.insert(result.end(), background.begin(), background.end());
+        result.insert(result.end(), noise.begin(), noise.end());
+        freeStream(stream);
+        return result;
+    };
+
+    std::vector<dsp_t> single = run(1);
+    EXPECT_EQ(run(3), single);
+    EXPECT_EQ(run(4), single);
+    dsp_max_threads(1);
+}
+
+struct ScaleJob
+{
+    dsp_t *buf;
+    int len;
+    int start;
+    int end;
+};
+
+static void scaleRange(void *arg, int start, int end, int)
+{
+    auto job = static_cast<ScaleJob *>(arg);
+    for (int i = start; i < end; i++)
+        job->buf[i] = job->buf[i] * 0.5 + 1;
+}
+
+static void *scaleThread(void *arg)
+{
+    auto job = static_cast<ScaleJob *>(arg);
+    scaleRange(job, job->start, job->end, 0);
+    return nullptr;
+}
+
+// Not a pass/fail test, reports the time of per frame jobs on the pool and on threads made for each job.
+TEST(DSP_PARALLEL, DISABLED_Benchmark_Frames)
+{
+    const int threads = 4;
+    const int sizes[][2] = {{512, 512}, {3840, 2160}};
+    dsp_max_threads(threads);
+
+    for (const auto &size : sizes)
+    {
+        const int width = size[0], height = size[1];
+        std::vector<dsp_t> frame(width * height, 1);
+        ScaleJob job {frame.data(), width * height, 0, 0};
+
+        double pool = bestTime([&]()
+        {
+            for (int i = 0; i < 10; i++)
+                dsp_parallel_for(job.len, 0, scaleRange, &job);
+        }) / 10;
+        double spawned = bestTime([&]()
+        {
+            for (int i = 0; i < 10; i++)
+            {
+                pthread_t th[threads];
+                ScaleJob bands[threads];
+                for (int t = 0; t < threads; t++)
+                {
+                    bands[t] = job;
+                    bands[t].start = t * job.len / threads;
+                    bands[t].end = (t + 1) * job.len / threads;
+                    pthread_create(&th[t], nullptr, scaleThread, &bands[t]);
+                }
+                for (int t = 0; t < threads; t++)
+                    pthread_join(th[t], nullptr);
+            }
+        }) / 10;
+
+        dsp_stream_p stream = newStream({width, height}, frame);
+        const int tile = 64, tiles = ((width + tile - 1) / tile) * ((height + tile - 1) / tile);
+        std::vector<dsp_t> background(tiles), noise(tiles);
+        double statistics = bestTime([&]()
+        {
+            dsp_stats_background(stream, tile, background.data(), noise.data());
+        });
+        freeStream(stream);
+
+        printf("%dx%d, %d threads: scale %.3f ms on the pool, %.3f ms on new threads, background %.2f ms\n", width, height,
+               threads, pool, spawned, statistics);
+    }
+    dsp_max_threads(1);
+}
@@ -0,0 +1,272 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "dsp.h"
+#include "test/test_helpers.h"
+
+// Position of an index computed as the stream functions did before positions were iterated.
+static std::vector<int> referencePosition(dsp_stream_p stream, int index)
+{
+    std::vector<int> pos(stream->dims);
+    int m = 1;
+    for (int dim = 0; dim < stream->dims; dim++)
+    {
+        pos[dim] = (index / m) % stream->sizes[dim];
+        m *= stream->sizes[dim];
+    }
+    return pos;
+}
+
+// Source element of each element of an aligned, rotated or scaled stream, with the integer
+// truncations of the per element code.
+static int referenceAlign(dsp_stream_p stream, dsp_stream_p in, std::vector<int> pos)
+{
+    for (int dim = 1; dim < stream->dims; dim++)
+    {
+        pos[dim] -= stream->align_info.center[dim];
+        pos[dim - 1] -= stream->align_info.center[dim - 1];
+        pos[dim] += stream->align_info.offset[dim];
+        pos[dim - 1] += stream->align_info.offset[dim - 1];
+        double r1 = stream->align_info.radians[dim - 1];
+        double x = pos[dim - 1];
+        double y = pos[dim];
+        double h = pow(pow(x, 2) + pow(y, 2), 0.5);
+        double r2 = acos(x / h);
+        if (y < 0)
+            r2 = -r2;
+        pos[dim] = sin(r2 - r1) * h;
+        pos[dim - 1] = cos(r2 - r1) * h;
+        pos[dim] /= stream->align_info.factor[dim];
+        pos[dim - 1] /= stream->align_info.factor[dim - 1];
+        pos[dim] += stream->align_info.center[dim];
+        pos[dim - 1] += stream->align_info.center[dim - 1];
+    }
+    return dsp_stream_set_position(in, pos.data());
+}
+
+static int referenceRotate(dsp_stream_p stream, dsp_stream_p in, std::vector<int> pos)
+{
+    for (int dim = 1; dim < stream->dims; dim++)
+    {
+        pos[dim] -= stream->align_info.center[dim];
+        pos[dim - 1] -= stream->align_info.center[dim - 1];
+        double r = stream->align_info.radians[dim - 1];
+        double x = pos[dim - 1];
+        double y = pos[dim];
+        pos[dim] = x * -sin(r);
+        pos[dim - 1] = x * cos(r);
+        pos[dim] += y * cos(r);
+        pos[dim - 1] += y * sin(r);
+        pos[dim] += stream->align_info.center[dim];
+        pos[dim - 1] += stream->align_info.center[dim - 1];
+    }
+    return dsp_stream_set_position(in, pos.data());
+}
+
+static int referenceScale(dsp_stream_p stream, dsp_stream_p in, std::vector<int> pos)
+{
+    for (int d = 0; d < stream->dims; d++)
+    {
+        pos[d] -= stream->align_info.center[d];
+        pos[d] /= stream->align_info.factor[d];
+        pos[d] += stream->align_info.center[d];
+    }
+    return dsp_stream_set_position(in, pos.data());
+}
+
+static dsp_stream_p randomStream(const std::vector<int> &sizes, std::mt19937 &random)
+{
+    std::uniform_real_distribution<double> value(0, 255);
+    dsp_stream_p stream = newStream(sizes);
+    for (int i = 0; i < stream->len; i++)
+        stream->buf[i] = value(random);
+    for (int d = 0; d < stream->dims; d++)
+    {
+        stream->align_info.center[d] = sizes[d] / 2.0 + 0.3;
+        stream->align_info.offset[d] = 1.7 - d;
+        stream->align_info.factor[d] = 0.8 + 0.15 * d;
+        if (d > 0)
+            stream->align_info.radians[d - 1] = 0.35 * d;
+    }
+    return stream;
+}
+
+enum Transform
+{
+    ALIGN,
+    ROTATE,
+    SCALE,
+};
+
+// Runs a transform on a copy of the stream and compares it with the reference, element by element.
+static void checkTransform(const std::vector<int> &sizes, Transform transform, int threads)
+{
+    std::mt19937 random(sizes.size() * 10 + transform);
+    dsp_stream_p in = randomStream(sizes, random);
+    std::vector<dsp_t> original(in->buf, in->buf + in->len);
+
+    std::vector<dsp_t> expected(in->len, 0);
+    double factor = 0.0;
+    for (int d = 0; d < in->dims; d++)
+        factor += pow(in->align_info.factor[d], 2);
+    factor = sqrt(factor);
+    for (int i = 0; i < in->len; i++)
+    {
+        std::vector<int> pos = referencePosition(in, i);
+        int x = transform == ALIGN ? referenceAlign(in, in, pos) : transform == ROTATE ? referenceRotate(in, in, pos) :
+                referenceScale(in, in, pos);
+        if (x >= 0 && x < in->len)
+            expected[i] = transform == SCALE ? expected[i] + original[x] / (factor * in->dims) : original[x];
+    }
+
+    // Most of the elements come from the source stream.
+    EXPECT_GT(std::count_if(expected.begin(), expected.end(), [](dsp_t value)
+    {
+        return value != 0;
+    }), in->len / 4);
+
+    dsp_max_threads(threads);
+    if (transform == ALIGN)
+        dsp_stream_align(in);
+    else if (transform == ROTATE)
+        dsp_stream_rotate(in);
+    else
+        dsp_stream_scale(in);
+    dsp_max_threads(1);
+
+    for (int i = 0; i < in->len; i++)
+        ASSERT_EQ(in->buf[i], expected[i]) << "transform " << transform << ", " << sizes.size() << " dimensions, " << threads
+                                           << " threads, element " << i;
+    freeStream(in);
+}
+
+TEST(DSP_POSITION, Test_FillAndNext)
+{
+    std::mt19937 random(1);
+    dsp_stream_p stream = randomStream({5, 4, 3}, random);
+    std::vector<int> pos(stream->dims), next(stream->dims, 0);
+    for (int i = 0; i < stream->len; i++)
+    {
+        dsp_stream_fill_position(stream, i, pos.data());
+        ASSERT_EQ(pos, referencePosition(stream, i)) << "index " << i;
+        ASSERT_EQ(next, pos) << "index " << i;
+        int *allocated = dsp_stream_get_position(stream, i);
+        ASSERT_TRUE(std::equal(pos.begin(), pos.end(), allocated)) << "index " << i;
+        free(allocated);
+        dsp_stream_next_position(stream, next.data());
+    }
+    // The position after the last element wraps to the first one.
+    EXPECT_EQ(next, std::vector<int>(stream->dims, 0));
+    freeStream(stream);
+}
+
+TEST(DSP_POSITION, Test_Align)
+{
+    for (int threads : {1, 3})
+    {
+        checkTransform({37, 23}, ALIGN, threads);
+        checkTransform({9, 7, 5}, ALIGN, threads);
+    }
+}
+
+TEST(DSP_POSITION, Test_Rotate)
+{
+    for (int threads : {1, 3})
+    {
+        checkTransform({37, 23}, ROTATE, threads);
+        checkTransform({9, 7, 5}, ROTATE, threads);
+    }
+}
+
+TEST(DSP_POSITION, Test_Scale)
+{
+    for (int threads : {1, 3})
+    {
+        checkTransform({37, 23}, SCALE, threads);
+        checkTransform({9, 7, 5}, SCALE, threads);
+    }
+}
+
+TEST(DSP_POSITION, Test_Crop)
+{
+    std::mt19937 random(2);
+    const std::vector<int> sizes = {13, 11, 4};
+    dsp_stream_p in = randomStream(sizes, random);
+    for (int d = 0; d < in->dims; d++)
+    {
+        in->ROI[d].start = d + 2;
+        in->ROI[d].len = sizes[d] / 2;
+    }
+    std::vector<dsp_t> original(in->buf, in->buf + in->len), expected(in->len, 0);
+    for (int i = 0; i < in->len; i++)
+    {
+        std::vector<int> pos = referencePosition(in, i);
+        bool allow = true;
+        for (int d = 0; d < in->dims; d++)
+        {
+            pos[d] += in->ROI[d].start;
+            if (pos[d] < in->ROI[d].start || pos[d] > in->ROI[d].start + in->ROI[d].len || pos[d] < 0 || pos[d] >= in->sizes[d])
+                allow = false;
+        }
+        if (allow)
+            expected[i] = original[dsp_stream_set_position(in, pos.data())];
+    }
+    dsp_stream_crop(in);
+    for (int i = 0; i < in->len; i++)
+        ASSERT_EQ(in->buf[i], expected[i]) << "element " << i;
+    freeStream(in);
+}
+
+TEST(DSP_POSITION, Test_Shift)
+{
+    std::mt19937 random(3);
+    for (const std::vector<int> &sizes : std::vector<std::vector<int>> {{10, 6}, {7, 5}, {4, 3, 6}})
+    {
+        dsp_stream_p stream = randomStream(sizes, random);
+        std::vector<dsp_t> original(stream->buf, stream->buf + stream->len), expected(stream->len);
+        for (int x = 0; x < stream->len / 2; x++)
+        {
+            std::vector<int> pos = referencePosition(stream, x);
+            for (int d = 0; d < stream->dims; d++)
+                pos[d] += pos[d] < stream->sizes[d] / 2 ? stream->sizes[d] / 2 : -(stream->sizes[d] / 2);
+            int y = dsp_stream_set_position(stream, pos.data());
+            expected[x] = original[y];
+            expected[y] = original[x];
+        }
+        dsp_buffer_shift(stream);
+        // Elements that are not swapped keep undefined values, only the swapped ones are compared.
+        for (int x = 0; x < stream->len / 2; x++)
+        {
+            std::vector<int> pos = referencePosition(stream, x);
+            for (int d = 0; d < stream->dims; d++)
+                pos[d] += pos[d] < stream->sizes[d] / 2 ? stream->sizes[d] / 2 : -(stream->sizes[d] / 2);
+            int y = dsp_stream_set_position(stream, pos.data());
+            ASSERT_EQ(stream->buf[x], expected[x]);
+            ASSERT_EQ(stream->buf[y], expected[y]);
+        }
+        freeStream(stream);
+    }
+}
@@ -0,0 +1,134 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "dsp.h"
+#include "test/test_helpers.h"
+
+struct Star
+{
+    double x, y, amplitude, sigma;
+};
+
+// Gaussian stars sampled at the center of the pixels on a background with Gaussian noise.
+static dsp_stream_p starField(int width, int height, const std::vector<Star> &stars, double background, double noise,
+                              std::mt19937 &random)
+{
+    std::normal_distribution<double> value(background, noise);
+    dsp_stream_p stream = newStream({width, height});
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+        {
+            double v = value(random);
+            for (const Star &star : stars)
+            {
+                double r2 = (x - star.x) * (x - star.x) + (y - star.y) * (y - star.y);
+                v += star.amplitude * std::exp(-r2 / (2 * star.sigma * star.sigma));
+            }
+            stream->buf[y * width + x] = v;
+        }
+    return stream;
+}
+
+TEST(DSP_STARS, Test_Background)
+{
+    const int width = 128, height = 96, tile = 32, tiles = 4 * 3;
+    std::mt19937 random(1);
+    std::normal_distribution<double> noise(0, 4);
+    dsp_stream_p stream = newStream({width, height});
+    // Every tile has its own level, a few bright pixels do not move the median
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+        {
+            int t = (y / tile) * 4 + x / tile;
+            stream->buf[y * width + x] = 100 + 10 * t + noise(random) + ((x * 7 + y * 3) % 97 == 0 ? 5000 : 0);
+        }
+
+    std::vector<dsp_t> background(tiles), deviation(tiles);
+    dsp_stats_background(stream, tile, background.data(), deviation.data());
+    for (int t = 0; t < tiles; t++)
+    {
+        EXPECT_NEAR(background[t], 100 + 10 * t, 0.5) << "tile " << t;
+        EXPECT_NEAR(deviation[t], 4, 0.4) << "tile " << t;
+    }
+    freeStream(stream);
+}
+
+TEST(DSP_STARS, Test_FindStars)
+{
+    const int width = 200, height = 150;
+    const std::vector<Star> stars =
+    {
+        {40.3, 30.7, 4000, 2},
+        {150.6, 40.2, 3000, 2},
+        {60.1, 110.5, 2000, 2},
+        {160.8, 120.4, 1000, 2},
+    };
+    std::mt19937 random(2);
+    dsp_stream_p stream = starField(width, height, stars, 500, 5, random);
+    // A hot pixel is not a star
+    stream->buf[75 * width + 100] = 10000;
+
+    ASSERT_EQ(dsp_align_find_stars(stream, 32, 5, 100), static_cast<int>(stars.size()));
+    for (size_t i = 0; i < stars.size(); i++)
+    {
+        // Brightest first
+        const dsp_star &star = stream->stars[i];
+        EXPECT_NEAR(star.center.location[0], stars[i].x, 0.1) << "star " << i;
+        EXPECT_NEAR(star.center.location[1], stars[i].y, 0.1) << "star " << i;
+        // FWHM = 2.3548 sigma, half flux radius = 1.1774 sigma
+        EXPECT_NEAR(star.diameter, 2.3548 * stars[i].sigma, 0.4) << "star " << i;
+        EXPECT_NEAR(star.hfr, 1.1774 * stars[i].sigma, 0.08) << "star " << i;
+        EXPECT_GT(star.flux, 0.95 * 2 * M_PI * stars[i].sigma * stars[i].sigma * stars[i].amplitude) << "star " << i;
+    }
+
+    // Only the brightest are kept
+    ASSERT_EQ(dsp_align_find_stars(stream, 32, 5, 2), 2);
+    EXPECT_NEAR(stream->stars[0].center.location[0], stars[0].x, 0.1);
+    EXPECT_NEAR(stream->stars[1].center.location[0], stars[1].x, 0.1);
+    freeStream(stream);
+}
+
+// The half flux radius follows the width of the stars.
+TEST(DSP_STARS, Test_HalfFluxRadius)
+{
+    const int width = 64, height = 64;
+    for (double sigma : {1.5, 2.0, 3.0})
+    {
+        std::mt19937 random(3);
+        dsp_stream_p stream = starField(width, height, {{32.4, 31.8, 5000, sigma}}, 200, 2, random);
+        ASSERT_EQ(dsp_align_find_stars(stream, 64, 5, 10), 1) << "sigma " << sigma;
+        EXPECT_NEAR(stream->stars[0].hfr, 1.1774 * sigma, 0.04 * sigma) << "sigma " << sigma;
+        EXPECT_NEAR(stream->stars[0].diameter, 2.3548 * sigma, 0.2 * sigma) << "sigma " << sigma;
+        freeStream(stream);
+    }
+}
+
+TEST(DSP_STARS, Test_Empty)
+{
+    std::mt19937 random(4);
+    dsp_stream_p stream = starField(64, 48, {}, 300, 5, random);
+    EXPECT_EQ(dsp_align_find_stars(stream, 16, 5, 10), 0);
+    EXPECT_EQ(stream->stars_count, 0);
+    freeStream(stream);
+}
@@ -0,0 +1,219 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "ccvt.h"
+#include "test/test_helpers.h"
+
+static std::vector<uint8_t> randomBytes(size_t size, std::mt19937 &random)
+{
+    std::uniform_int_distribution<int> value(0, 255);
+    std::vector<uint8_t> bytes(size);
+    for (auto &byte : bytes)
+        byte = value(random);
+    return bytes;
+}
+
+// Scalar reference, the per pixel arithmetic of the original conversions.
+enum Format { RGB24, BGR24, RGB32, BGR32 };
+
+static int formatBytes(Format format)
+{
+    return (format == RGB24 || format == BGR24) ? 3 : 4;
+}
+
+static void referencePixel(int y, int u, int v, Format format, uint8_t *out)
+{
+    auto sat = [](int c)
+    {
+        return static_cast<uint8_t>(std::min(255, std::max(0, c)));
+    };
+    int cb = ((u - 128) * 454) >> 8;
+    int cr = ((v - 128) * 359) >> 8;
+    int cg = ((v - 128) * 183 + (u - 128) * 88) >> 8;
+    uint8_t r = sat(y + cr), g = sat(y - cg), b = sat(y + cb);
+    bool rgb = (format == RGB24 || format == RGB32);
+    out[0] = rgb ? r : b;
+    out[1] = g;
+    out[2] = rgb ? b : r;
+    if (formatBytes(format) == 4)
+        out[3] = 0;
+}
+
+static void reference420p(int width, int height, const uint8_t *src, uint8_t *dst, Format format)
+{
+    const uint8_t *u = src + width * height, *v = u + width * height / 4;
+    for (int row = 0; row < height; row++)
+        for (int col = 0; col < width; col++)
+        {
+            int chroma = (row / 2) * (width / 2) + col / 2;
+            referencePixel(src[row * width + col], u[chroma], v[chroma], format,
+                           dst + (row * width + col) * formatBytes(format));
+        }
+}
+
+static void referenceYUYV(int width, int height, const uint8_t *src, uint8_t *dst, Format format)
+{
+    const int n = width & ~1;
+    for (int row = 0; row < height; row++)
+        for (int col = 0; col < n; col++)
+        {
+            const uint8_t *pair = src + 2 * (row * n + (col & ~1));
+            referencePixel(pair[2 * (col & 1)], pair[1], pair[3], format, dst + (row * n + col) * formatBytes(format));
+        }
+}
+
+typedef void (*RGBConversion)(int, int, const void *, void *);
+
+TEST(STREAM_CCVT, Test_YUV420P_RGB)
+{
+    const RGBConversion conversions[] = {ccvt_420p_rgb24, ccvt_420p_bgr24, ccvt_420p_rgb32, ccvt_420p_bgr32};
+    // Several blocks with a partial last one, and a single 2x2 block.
+    const int sizes[][2] = {{640, 480}, {2 * 257, 6}, {2, 2}};
+    std::mt19937 random(1);
+
+    for (const auto &size : sizes)
+    {
+        const int width = size[0], height = size[1];
+        std::vector<uint8_t> yuv = randomBytes(width * height * 3 / 2, random);
+
+        for (int format = RGB24; format <= BGR32; format++)
+        {
+            std::vector<uint8_t> expected(width * height * 4), actual(width * height * 4);
+            reference420p(width, height, yuv.data(), expected.data(), static_cast<Format>(format));
+            conversions[format](width, height, yuv.data(), actual.data());
+            ASSERT_EQ(expected, actual) << width << "x" << height << " format " << format;
+        }
+    }
+}
+
+TEST(STREAM_CCVT, Test_YUYV_RGB)
+{
+    const RGBConversion conversions[] = {ccvt_yuyv_rgb24, ccvt_yuyv_bgr24, nullptr, ccvt_yuyv_bgr32};
+    // The last column of odd widths is skipped.
+    const int sizes[][2] = {{640, 480}, {2 * 257, 3}, {333, 5}, {2, 1}};
+    std::mt19937 random(2);
+
+    for (const auto &size : sizes)
+    {
+        const int width = size[0], height = size[1];
+        std::vector<uint8_t> yuyv = randomBytes(width * height * 2, random);
+
+        for (int format = RGB24; format <= BGR32; format++)
+        {
+            if (conversions[format] == nullptr)
+                continue;
+            std::vector<uint8_t> expected(width * height * 4), actual(width * height * 4);
+            referenceYUYV(width, height, yuyv.data(), expected.data(), static_cast<Format>(format));
+            conversions[format](width, height, yuyv.data(), actual.data());
+            ASSERT_EQ(expected, actual) << width << "x" << height << " format " << format;
+        }
+    }
+}
+
+TEST(STREAM_CCVT, Test_YUYV_420P)
+{
+    const int width = 2 * 300, height = 10;
+    std::mt19937 random(3);
+    std::vector<uint8_t> yuyv = randomBytes(width * height * 2, random);
+
+    std::vector<uint8_t> y(width * height), u(width * height / 4), v(width * height / 4);
+    ccvt_yuyv_420p(width, height, yuyv.data(), y.data(), u.data(), v.data());
+
+    for (int row = 0; row < height; row++)
+        for (int col = 0; col < width; col++)
+            ASSERT_EQ(y[row * width + col], yuyv[2 * (row * width + col)]);
+
+    // Chroma is the average of two rows.
+    for (int row = 0; row < height / 2; row++)
+        for (int col = 0; col < width / 2; col++)
+        {
+            const uint8_t *top = yuyv.data() + 2 * (2 * row * width + 2 * col), *bottom = top + 2 * width;
+            ASSERT_EQ(u[row * width / 2 + col], (top[1] + bottom[1]) / 2);
+            ASSERT_EQ(v[row * width / 2 + col], (top[3] + bottom[3]) / 2);
+        }
+}
+
+TEST(STREAM_CCVT, Test_Y16_Y8)
+{
+    const int count = 1000;
+    std::mt19937 random(4);
+    std::uniform_int_distribution<int> value(0, 65535);
+
+    for (int depth : {16, 12, 10})
+    {
+        std::vector<uint16_t> y16(count);
+        for (auto &pixel : y16)
+            pixel = value(random) >> (16 - depth);
+
+        std::vector<uint8_t> y8(count);
+        ccvt_y16_y8(count, y16.data(), y8.data(), depth);
+        for (int i = 0; i < count; i++)
+            ASSERT_EQ(y8[i], y16[i] >> (depth - 8));
+
+        // In place, as the V4L2 driver does.
+        std::vector<uint16_t> copy = y16;
+        ccvt_y16_y8(count, copy.data(), copy.data(), depth);
+        ASSERT_TRUE(std::equal(y8.begin(), y8.end(), reinterpret_cast<const uint8_t *>(copy.data())));
+    }
+}
+
+// Not a pass/fail test, reports the time to convert 4K camera frames.
+TEST(STREAM_CCVT, DISABLED_Benchmark_4K)
+{
+    const int width = 3840, height = 2160;
+    std::mt19937 random(5);
+    std::vector<uint8_t> yuyv = randomBytes(width * height * 2, random);
+    std::vector<uint8_t> yuv = randomBytes(width * height * 3 / 2, random);
+    std::vector<uint8_t> rgb(width * height * 3);
+
+    double yuyvTime = bestTime([&]()
+    {
+        ccvt_yuyv_rgb24(width, height, yuyv.data(), rgb.data());
+    });
+    double yuyvReference = bestTime([&]()
+    {
+        referenceYUYV(width, height, yuyv.data(), rgb.data(), RGB24);
+    });
+    double yuvTime = bestTime([&]()
+    {
+        ccvt_420p_rgb24(width, height, yuv.data(), rgb.data());
+    });
+    double yuvReference = bestTime([&]()
+    {
+        reference420p(width, height, yuv.data(), rgb.data(), RGB24);
+    });
+    double planarTime = bestTime([&]()
+    {
+        ccvt_yuyv_420p(width, height, yuyv.data(), rgb.data(), rgb.data() + width * height,
+                       rgb.data() + width * height * 5 / 4);
+    });
+
+    printf("%dx%d YUYV to RGB24: %.2f ms (%.0f fps), scalar %.2f ms\n", width, height, yuyvTime, 1000 / yuyvTime,
+           yuyvReference);
+    printf("%dx%d YUV420P to RGB24: %.2f ms (%.0f fps), scalar %.2f ms\n", width, height, yuvTime, 1000 / yuvTime,
+           yuvReference);
+    printf("%dx%d YUYV to YUV420P: %.2f ms (%.0f fps)\n", width, height, planarTime, 1000 / planarTime);
+}
@@ -0,0 +1,205 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "framering.h"
+
+// Frames carry their sequence number followed by a pattern derived from it.
+static bool push(INDI::FrameRing &ring, uint64_t sequence, size_t nbytes, size_t maxBytes)
+{
+    INDI::FrameRing::Frame *frame = ring.acquire(nbytes, maxBytes);
+    if (frame == nullptr)
+        return false;
+    memcpy(frame->data.data(), &sequence, sizeof(sequence));
+    memset(frame->data.data() + sizeof(sequence), static_cast<int>(sequence & 0xff), nbytes - sizeof(sequence));
+    frame->timestamp = sequence;
+    ring.publish();
+    return true;
+}
+
+static bool check(const INDI::FrameRing::Frame *frame, uint64_t &sequence)
+{
+    memcpy(&sequence, frame->data.data(), sizeof(sequence));
+    if (frame->timestamp != sequence)
+        return false;
+    for (size_t i = sizeof(sequence); i < frame->data.size(); i++)
+        if (frame->data[i] != static_cast<uint8_t>(sequence & 0xff))
+            return false;
+    return true;
+}
+
+static uint64_t pop(INDI::FrameRing &ring)
+{
+    INDI::FrameRing::Frame *frame = ring.front(0);
+    EXPECT_NE(frame, nullptr);
+    if (frame == nullptr)
+        return UINT64_MAX;
+    uint64_t sequence;
+    EXPECT_TRUE(check(frame, sequence));
+    ring.release();
+    return sequence;
+}
+
+// Counters keep running past the number of slots, frames come out in order.
+TEST(FRAME_RING, Test_Wraparound)
+{
+    INDI::FrameRing ring(8);
+    const size_t nbytes = 64, maxBytes = 3 * nbytes;
+    uint64_t next = 0, expected = 0;
+    for (int round = 0; round < 100; round++)
+    {
+        // Queue one to three frames, then drain them
+        for (int i = 0; i <= round % 3; i++)
+            ASSERT_TRUE(push(ring, next++, nbytes, maxBytes));
+        EXPECT_EQ(ring.size(), static_cast<size_t>(round % 3 + 1));
+        while (ring.size() > 0)
+            ASSERT_EQ(pop(ring), expected++);
+    }
+    EXPECT_EQ(ring.front(0), nullptr);
+}
+
+// The number of slots follows the frame size, it changes only once the consumer released every frame.
+TEST(FRAME_RING, Test_ResizeWhileEmpty)
+{
+    INDI::FrameRing ring(8);
+    const size_t maxBytes = 4096;
+    uint64_t next = 0, expected = 0;
+
+    // Eight small frames fit, leave the counters off a multiple of the next size
+    for (int i = 0; i < 7; i++)
+        ASSERT_TRUE(push(ring, next++, 512, maxBytes));
+    for (int i = 0; i < 7; i++)
+        ASSERT_EQ(pop(ring), expected++);
+
+    // Larger frames: only three slots
+    for (int i = 0; i < 3; i++)
+        ASSERT_TRUE(push(ring, next++, 1300, maxBytes));
+    EXPECT_FALSE(push(ring, next, 1300, maxBytes));
+    ASSERT_EQ(pop(ring), expected++);
+
+    // Not empty: a frame too large for the remaining memory is rejected, queued frames are untouched
+    EXPECT_FALSE(push(ring, next, 3000, maxBytes));
+    ASSERT_EQ(pop(ring), expected++);
+    ASSERT_EQ(pop(ring), expected++);
+
+    // Empty again, a single large frame is always accepted
+    ASSERT_TRUE(push(ring, next++, 8192, maxBytes));
+    EXPECT_FALSE(push(ring, next, 8192, maxBytes));
+    ASSERT_EQ(pop(ring), expected++);
+
+    // And small frames get all the slots back
+    for (int i = 0; i < 8; i++)
+        ASSERT_TRUE(push(ring, next++, 512, maxBytes));
+    EXPECT_FALSE(push(ring, next, 512, maxBytes));
+    for (int i = 0; i < 8; i++)
+        ASSERT_EQ(pop(ring), expected++);
+}
+
+// A full ring keeps the queued frames and rejects the new one, the consumer may be reading the oldest.
+TEST(FRAME_RING, Test_DropWhenFull)
+{
+    INDI::FrameRing ring(4);
+    const size_t nbytes = 100, maxBytes = 1 << 20;
+    for (uint64_t i = 0; i < 4; i++)
+        ASSERT_TRUE(push(ring, i, nbytes, maxBytes));
+
+    // The consumer holds the oldest frame while the producer keeps trying
+    INDI::FrameRing::Frame *oldest = ring.front(0);
+    ASSERT_NE(oldest, nullptr);
+    for (uint64_t i = 4; i < 10; i++)
+        EXPECT_FALSE(push(ring, i, nbytes, maxBytes));
+    uint64_t sequence;
+    ASSERT_TRUE(check(oldest, sequence));
+    EXPECT_EQ(sequence, 0u);
+    ring.release();
+
+    // One slot is free again
+    ASSERT_TRUE(push(ring, 10, nbytes, maxBytes));
+    EXPECT_FALSE(push(ring, 11, nbytes, maxBytes));
+    for (uint64_t expected : {1, 2, 3, 10})
+        ASSERT_EQ(pop(ring), expected);
+    EXPECT_EQ(ring.size(), 0u);
+}
+
+TEST(FRAME_RING, Test_Abort)
+{
+    INDI::FrameRing ring(4);
+    auto start = std::chrono::steady_clock::now();
+    std::thread aborter([&]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ring.abort();
+    });
+    EXPECT_EQ(ring.front(10000), nullptr);
+    aborter.join();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+    ring.waitForEmpty();
+}
+
+// One producer and one consumer thread, with frame sizes changing so that the ring is resized while running.
+TEST(FRAME_RING, Test_Stress)
+{
+    INDI::FrameRing ring(16);
+    const uint64_t frames = 50000;
+    const size_t maxBytes = 16 * 1024;
+    uint64_t dropped = 0, received = 0;
+    bool ordered = true, intact = true;
+
+    std::thread consumer([&]()
+    {
+        uint64_t last = 0;
+        bool first = true;
+        for (;;)
+        {
+            INDI::FrameRing::Frame *frame = ring.front(1000);
+            if (frame == nullptr)
+                break;
+            uint64_t sequence;
+            intact = intact && check(frame, sequence);
+            ordered = ordered && (first || sequence > last);
+            first = false;
+            last = sequence;
+            received++;
+            // Now and then the consumer is slower than the producer
+            if (sequence % 1000 < 10)
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            ring.release();
+        }
+    });
+
+    for (uint64_t sequence = 0; sequence < frames; sequence++)
+    {
+        // From one to sixteen slots
+        size_t nbytes = 1024 * (1 + (sequence / 2000) % 16);
+        if (push(ring, sequence, nbytes, maxBytes) == false)
+            dropped++;
+    }
+    ring.waitForEmpty();
+    ring.abort();
+    consumer.join();
+
+    EXPECT_TRUE(ordered);
+    EXPECT_TRUE(intact);
+    EXPECT_EQ(received + dropped, frames);
+    EXPECT_GT(received, 0u);
+}
@@ -0,0 +1,123 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "framestacker.h"
+
+static const uint32_t WIDTH  = 320;
+static const uint32_t HEIGHT = 240;
+
+// Star field moved by dx, dy with stars of the given width.
+static std::vector<uint16_t> starField(int dx, int dy, double sigma, std::mt19937 &random)
+{
+    const double stars[][3] =
+    {
+        {50, 40, 20000}, {120, 90, 30000}, {200, 60, 15000}, {80, 150, 25000},
+        {250, 180, 40000}, {160, 200, 10000}, {30, 190, 12000}, {150, 120, 18000}
+    };
+
+    std::normal_distribution<double> noise(0, 20);
+    std::vector<uint16_t> frame(WIDTH * HEIGHT);
+    for (uint32_t y = 0; y < HEIGHT; y++)
+        for (uint32_t x = 0; x < WIDTH; x++)
+        {
+            double value = 1000 + noise(random);
+            for (auto &star : stars)
+            {
+                double ex = x - (star[0] + dx), ey = y - (star[1] + dy);
+                value += star[2] * std::exp(-(ex * ex + ey * ey) / (2 * sigma * sigma));
+            }
+            frame[y * WIDTH + x] = static_cast<uint16_t>(std::min(std::max(value, 0.0), 65535.0));
+        }
+    return frame;
+}
+
+static bool addFrame(INDI::FrameStacker &stacker, const std::vector<uint16_t> &frame)
+{
+    return stacker.addFrame(reinterpret_cast<const uint8_t *>(frame.data()), frame.size() * 2, WIDTH, HEIGHT,
+                            INDI_MONO, 16);
+}
+
+TEST(STREAM_FRAME_STACKER, Test_Registration)
+{
+    const int shifts[][2] = {{0, 0}, {3, -2}, {-5, 4}, {7, 1}, {-2, -6}, {4, 4}};
+
+    for (auto registration : {INDI::FrameStacker::REGISTRATION_PHASE, INDI::FrameStacker::REGISTRATION_CENTROID})
+    {
+        std::mt19937 random(1);
+        INDI::FrameStacker stacker;
+        stacker.setRegistration(registration);
+        stacker.setThreads(2);
+
+        for (auto &shift : shifts)
+        {
+            ASSERT_TRUE(addFrame(stacker, starField(shift[0], shift[1], 2, random)));
+            // The shift moves the frame back onto the first one.
+            EXPECT_EQ(stacker.shiftX(), -shift[0]) << "registration " << registration;
+            EXPECT_EQ(stacker.shiftY(), -shift[1]) << "registration " << registration;
+        }
+
+        EXPECT_EQ(stacker.stackedFrames(), 6u);
+
+        std::vector<uint8_t> output;
+        ASSERT_TRUE(stacker.render(output));
+        ASSERT_EQ(output.size(), WIDTH * HEIGHT * 2);
+        const uint16_t *pixels = reinterpret_cast<const uint16_t *>(output.data());
+        // Stars stay sharp and the noise of the background averages out.
+        EXPECT_NEAR(pixels[90 * WIDTH + 120], 31000, 100);
+        EXPECT_NEAR(pixels[10 * WIDTH + 300], 1000, 30);
+    }
+}
+
+TEST(STREAM_FRAME_STACKER, Test_KeepBest)
+{
+    std::mt19937 random(2);
+    INDI::FrameStacker stacker;
+    stacker.setRegistration(INDI::FrameStacker::REGISTRATION_NONE);
+    stacker.setKeepFraction(0.5);
+
+    // Warm up with a mix of sharp and blurry frames.
+    for (size_t i = 0; i < INDI::FrameStacker::SCORE_WARMUP; i++)
+        addFrame(stacker, starField(0, 0, i % 2 ? 1.5 : 3, random));
+
+    EXPECT_TRUE(addFrame(stacker, starField(0, 0, 1.2, random)));
+    EXPECT_FALSE(addFrame(stacker, starField(0, 0, 4, random)));
+    EXPECT_EQ(stacker.rejectedFrames(), 1u);
+
+    stacker.reset();
+    EXPECT_TRUE(addFrame(stacker, starField(0, 0, 4, random)));
+    EXPECT_EQ(stacker.stackedFrames(), 1u);
+    EXPECT_EQ(stacker.rejectedFrames(), 0u);
+}
+
+TEST(STREAM_FRAME_STACKER, Test_InvalidFrame)
+{
+    INDI::FrameStacker stacker;
+    std::vector<uint8_t> frame(WIDTH * HEIGHT);
+
+    EXPECT_FALSE(stacker.addFrame(frame.data(), frame.size() - 1, WIDTH, HEIGHT, INDI_MONO, 8));
+    EXPECT_FALSE(stacker.addFrame(frame.data(), frame.size(), WIDTH, HEIGHT, INDI_JPG, 8));
+
+    std::vector<uint8_t> output;
+    EXPECT_FALSE(stacker.render(output));
+}
@@ -0,0 +1,151 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "indibase.h"
+#include "serrecorder.h"
+#include "serreader.h"
+
+static const uint16_t WIDTH  = 64;
+static const uint16_t HEIGHT = 48;
+static const uint32_t FRAMES = 10;
+// One second after the SER epoch, in microseconds.
+static const uint64_t START  = 1000000;
+
+static std::string recordFile(bool writeTrailer)
+{
+    char filename[] = "/tmp/test_ser_readerXXXXXX";
+    int fd = mkstemp(filename);
+    if (fd < 0)
+        return std::string();
+    close(fd);
+
+    char errmsg[MAXRBUF];
+    INDI::SER_Recorder recorder;
+    recorder.setPixelFormat(INDI_BAYER_RGGB, 16);
+    recorder.setSize(WIDTH, HEIGHT);
+    if (recorder.open(filename, errmsg) == false)
+    {
+        ADD_FAILURE() << errmsg;
+        return std::string();
+    }
+
+    std::vector<uint16_t> frame(WIDTH * HEIGHT);
+    for (uint32_t i = 0; i < FRAMES; i++)
+    {
+        for (size_t j = 0; j < frame.size(); j++)
+            frame[j] = static_cast<uint16_t>(i * 1000 + j);
+        // Frames 20 ms apart.
+        recorder.writeFrame(reinterpret_cast<uint8_t *>(frame.data()), frame.size() * 2, START + i * 20000);
+    }
+    recorder.close();
+
+    if (writeTrailer == false)
+    {
+        // Simulate an interrupted recording: no frame count and no timestamps.
+        FILE *file = fopen(filename, "r+b");
+        const uint8_t zero[4] = {0, 0, 0, 0};
+        fseek(file, 38, SEEK_SET);
+        fwrite(zero, 1, sizeof(zero), file);
+        fclose(file);
+        EXPECT_EQ(truncate(filename, INDI::SER_Recorder::HEADER_SIZE + FRAMES * WIDTH * HEIGHT * 2), 0);
+    }
+
+    return filename;
+}
+
+TEST(STREAM_SER_READER, Test_RandomAccess)
+{
+    std::string filename = recordFile(true);
+    ASSERT_FALSE(filename.empty());
+
+    char errmsg[MAXRBUF];
+    INDI::SER_Reader reader;
+    ASSERT_TRUE(reader.open(filename.c_str(), errmsg)) << errmsg;
+
+    EXPECT_EQ(reader.header().ImageWidth, WIDTH);
+    EXPECT_EQ(reader.header().ImageHeight, HEIGHT);
+    EXPECT_EQ(reader.header().PixelDepth, 16u);
+    EXPECT_EQ(reader.pixelFormat(), INDI_BAYER_RGGB);
+    EXPECT_EQ(reader.frameCount(), FRAMES);
+    EXPECT_EQ(reader.frameSize(), WIDTH * HEIGHT * 2u);
+    ASSERT_TRUE(reader.hasTimestamps());
+
+    for (uint32_t i : {7u, 0u, 9u, 3u})
+    {
+        const uint16_t *pixels = reinterpret_cast<const uint16_t *>(reader.frame(i));
+        ASSERT_NE(pixels, nullptr);
+        EXPECT_EQ(pixels[0], static_cast<uint16_t>(i * 1000));
+        EXPECT_EQ(pixels[WIDTH * HEIGHT - 1], static_cast<uint16_t>(i * 1000 + WIDTH * HEIGHT - 1));
+        EXPECT_EQ(reader.timestamp(i), (START + i * 20000) * 10);
+    }
+    EXPECT_EQ(reader.frame(FRAMES), nullptr);
+
+    EXPECT_EQ(reader.findFrame(0), 0u);
+    EXPECT_EQ(reader.findFrame(reader.timestamp(4)), 4u);
+    EXPECT_EQ(reader.findFrame(reader.timestamp(4) + 1), 4u);
+    EXPECT_EQ(reader.findFrame(reader.timestamp(4) - 1), 3u);
+    EXPECT_EQ(reader.findFrame(UINT64_MAX), FRAMES - 1);
+
+    reader.close();
+    unlink(filename.c_str());
+}
+
+TEST(STREAM_SER_READER, Test_InterruptedRecording)
+{
+    std::string filename = recordFile(false);
+    ASSERT_FALSE(filename.empty());
+
+    char errmsg[MAXRBUF];
+    INDI::SER_Reader reader;
+    ASSERT_TRUE(reader.open(filename.c_str(), errmsg)) << errmsg;
+
+    // The frame count is recovered from the file size.
+    EXPECT_EQ(reader.frameCount(), FRAMES);
+    EXPECT_FALSE(reader.hasTimestamps());
+    EXPECT_EQ(reader.timestamp(0), 0u);
+    const uint16_t *pixels = reinterpret_cast<const uint16_t *>(reader.frame(FRAMES - 1));
+    ASSERT_NE(pixels, nullptr);
+    EXPECT_EQ(pixels[1], static_cast<uint16_t>((FRAMES - 1) * 1000 + 1));
+
+    reader.close();
+    unlink(filename.c_str());
+}
+
+TEST(STREAM_SER_READER, Test_InvalidFile)
+{
+    char filename[] = "/tmp/test_ser_readerXXXXXX";
+    int fd = mkstemp(filename);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(write(fd, "LUCAM-RECORDER", 14), 14);
+    close(fd);
+
+    char errmsg[MAXRBUF];
+    INDI::SER_Reader reader;
+    EXPECT_FALSE(reader.open(filename, errmsg));
+    EXPECT_FALSE(reader.isOpen());
+    unlink(filename);
+}
@@ -0,0 +1,147 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "ccvt.h"
+#include "test/test_helpers.h"
+
+static std::vector<uint8_t> randomImage(size_t size, std::mt19937 &random)
+{
+    std::uniform_int_distribution<int> value(0, 255);
+    std::vector<uint8_t> image(size);
+    for (auto &pixel : image)
+        pixel = value(random);
+    return image;
+}
+
+// Check a conversion against the floating point definition, rows are stride bytes apart.
+static void checkConversion(int width, int height, int stride, bool bgr)
+{
+    std::mt19937 random(width * 1000 + height);
+    std::vector<uint8_t> rgb = randomImage(stride * height, random);
+
+    const int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    // Output rows padded like the Theora planes.
+    const int yStride = width + 16, uvStride = chromaWidth + 8;
+    std::vector<uint8_t> y(yStride * height), u(uvStride * chromaHeight), v(uvStride * chromaHeight);
+
+    if (bgr)
+        ccvt_bgr24_420p_stride(width, height, rgb.data(), stride, y.data(), yStride, u.data(), v.data(), uvStride);
+    else
+        ccvt_rgb24_420p_stride(width, height, rgb.data(), stride, y.data(), yStride, u.data(), v.data(), uvStride);
+
+    auto pixel = [&](int px, int py, int channel)
+    {
+        px = std::min(px, width - 1);
+        py = std::min(py, height - 1);
+        if (bgr)
+            channel = 2 - channel;
+        return rgb[py * stride + 3 * px + channel];
+    };
+
+    for (int py = 0; py < height; py++)
+        for (int px = 0; px < width; px++)
+        {
+            double luma = 0.299 * pixel(px, py, 0) + 0.587 * pixel(px, py, 1) + 0.114 * pixel(px, py, 2);
+            ASSERT_NEAR(y[py * yStride + px], luma, 1.0) << px << "," << py;
+        }
+
+    for (int py = 0; py < chromaHeight; py++)
+        for (int px = 0; px < chromaWidth; px++)
+        {
+            double r = 0, g = 0, b = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                r += pixel(2 * px + i % 2, 2 * py + i / 2, 0) / 4.0;
+                g += pixel(2 * px + i % 2, 2 * py + i / 2, 1) / 4.0;
+                b += pixel(2 * px + i % 2, 2 * py + i / 2, 2) / 4.0;
+            }
+            double cb = std::min(255.0, -0.1684 * r - 0.3316 * g + 0.5 * b + 128);
+            double cr = std::min(255.0, 0.5 * r - 0.4187 * g - 0.0813 * b + 128);
+            ASSERT_NEAR(u[py * uvStride + px], cb, 1.0) << px << "," << py;
+            ASSERT_NEAR(v[py * uvStride + px], cr, 1.0) << px << "," << py;
+        }
+}
+
+TEST(STREAM_YUV420, Test_Conversion)
+{
+    checkConversion(64, 48, 3 * 64, false);
+    checkConversion(64, 48, 3 * 64, true);
+    // Several blocks with a partial last one, odd sizes and a region of a wider frame.
+    checkConversion(601, 37, 3 * 601, false);
+    checkConversion(333, 21, 3 * 400 + 5, true);
+    checkConversion(1, 1, 3, false);
+}
+
+TEST(STREAM_YUV420, Test_FlippedOutput)
+{
+    const int width = 40, height = 20;
+    std::mt19937 random(7);
+    std::vector<uint8_t> rgb = randomImage(3 * width * height, random);
+
+    std::vector<uint8_t> y(width * height), u(width * height / 4), v(width * height / 4);
+    ccvt_rgb24_420p(width, height, rgb.data(), y.data(), u.data(), v.data());
+
+    // Negative line sizes write the planes bottom-up.
+    std::vector<uint8_t> fy(width * height), fu(width * height / 4), fv(width * height / 4);
+    ccvt_rgb24_420p_stride(width, height, rgb.data(), 3 * width,
+                           fy.data() + (height - 1) * width, -width,
+                           fu.data() + (height / 2 - 1) * (width / 2), fv.data() + (height / 2 - 1) * (width / 2), -width / 2);
+
+    for (int row = 0; row < height; row++)
+        ASSERT_TRUE(std::equal(y.begin() + row * width, y.begin() + (row + 1) * width, fy.begin() + (height - 1 - row) * width));
+    for (int row = 0; row < height / 2; row++)
+    {
+        const int flipped = height / 2 - 1 - row;
+        ASSERT_TRUE(std::equal(u.begin() + row * width / 2, u.begin() + (row + 1) * width / 2, fu.begin() + flipped * width / 2));
+        ASSERT_TRUE(std::equal(v.begin() + row * width / 2, v.begin() + (row + 1) * width / 2, fv.begin() + flipped * width / 2));
+    }
+}
+
+// Not a pass/fail test, reports the time to convert frames recorded by the Theora recorder.
+TEST(STREAM_YUV420, DISABLED_Benchmark_RGB)
+{
+    const int sizes[][2] = {{1920, 1080}, {3840, 2160}};
+    std::mt19937 random(1);
+
+    for (const auto &size : sizes)
+    {
+        const int width = size[0], height = size[1];
+        std::vector<uint8_t> rgb = randomImage(3 * width * height, random);
+        std::vector<uint8_t> y(width * height), u(width * height / 4), v(width * height / 4);
+
+        double blocked = bestTime([&]()
+        {
+            ccvt_rgb24_420p(width, height, rgb.data(), y.data(), u.data(), v.data());
+        });
+        double legacy = bestTime([&]()
+        {
+            BGR2YUV(width, height, rgb.data(), y.data(), u.data(), v.data(), 0);
+        });
+
+        printf("%dx%d RGB to YUV 4:2:0: %.2f ms, BGR2YUV %.2f ms\n", width, height, blocked, legacy);
+    }
+}
@@ -0,0 +1,63 @@
+/*******************************************************************************
+ Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "dsp.h"
+
+// Time of a job in milliseconds, best of a few runs.
+template <typename Function>
+inline double bestTime(Function function, int runs = 5)
+{
+    double best = 1e9;
+    for (int i = 0; i < runs; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+// A stream with the given sizes and an allocated buffer.
+inline dsp_stream_p newStream(const std::vector<int> &sizes)
+{
+    dsp_stream_p stream = dsp_stream_new();
+    for (int size : sizes)
+        dsp_stream_add_dim(stream, size);
+    dsp_stream_alloc_buffer(stream, stream->len);
+    return stream;
+}
+
+// A stream with the given sizes holding a copy of the values.
+inline dsp_stream_p newStream(const std::vector<int> &sizes, const std::vector<dsp_t> &values)
+{
+    dsp_stream_p stream = newStream(sizes);
+    std::copy(values.begin(), values.begin() + std::min<size_t>(values.size(), stream->len), stream->buf);
+    return stream;
+}
+
+inline void freeStream(dsp_stream_p stream)
+{
+    dsp_stream_free_buffer(stream);
+    dsp_stream_free(stream);
+}